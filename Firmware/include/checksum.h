@@ -0,0 +1,42 @@
+// ============================================================================
+// Internet Checksum (RFC 1071)
+// ============================================================================
+// Ones' complement sums for the NAT's IP, TCP, UDP and ICMP headers. Sums
+// are taken 32 bits at a time and kept in memory byte order, so a folded
+// result is stored into a packet as is - no htons. RFC 1624 incremental
+// updates cover fields rewritten in a packet that already has a checksum.
+// ============================================================================
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+
+// Add length bytes of data to a running (unfolded) sum. data may sit at any
+// alignment, but must start at an even offset of the summed region - use
+// csumAddAt to join a piece that starts at an odd one
+uint32_t csumPartial(const uint8_t* data, uint16_t length, uint32_t sum);
+
+// Copy length bytes from src to dst and return their sum, in one pass
+uint32_t csumCopy(uint8_t* dst, const uint8_t* src, uint16_t length);
+
+// Add a piece's sum taken from offset bytes into the summed region
+uint32_t csumAddAt(uint32_t sum, uint32_t piece, uint16_t offset);
+
+// TCP/UDP pseudo-header sum (addresses in network byte order, as stored)
+uint32_t csumPseudo(uint32_t srcAddr, uint32_t dstAddr, uint8_t protocol,
+                    uint16_t length);
+
+// Fold a sum to 16 bits and complement it - the checksum field's value
+uint16_t csumFold(uint32_t sum);
+
+// RFC 1624: the checksum after a 16- or 32-bit field covered by it changes
+// from oldValue to newValue (all as stored in the packet)
+uint16_t csumReplace16(uint16_t check, uint16_t oldValue, uint16_t newValue);
+uint16_t csumReplace32(uint16_t check, uint32_t oldValue, uint32_t newValue);
+
+#endif // CHECKSUM_H
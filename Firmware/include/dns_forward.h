@@ -0,0 +1,126 @@
+// ============================================================================
+// DNS Forwarder
+// ============================================================================
+// Answers DNS queries the client sends to the gateway's own IP. Answers are
+// cached in RAM for their TTL, NXDOMAIN / NODATA for the SOA minimum
+// (RFC 2308), and a query for a name already being looked up waits on that
+// lookup instead of sending another one upstream.
+// ============================================================================
+
+#ifndef DNS_FORWARD_H
+#define DNS_FORWARD_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+struct NatContext;
+struct udp_pcb;
+struct pbuf;
+
+// ============================================================================
+// DNS Forwarder Configuration Constants
+// ============================================================================
+
+#define DNS_PORT                53
+#define DNS_HEADER_LEN          12
+#define DNS_MESSAGE_MAX         1232    // Largest response cached or relayed (EDNS default)
+#define DNS_QUESTION_MAX        100     // Longest question (name + type + class) cached
+#define DNS_CACHE_ENTRIES       32
+#define DNS_CACHE_BYTES         12288   // Response bytes held across all entries
+#define DNS_TTL_MAX_S           3600    // Cap on how long an answer is kept
+#define DNS_NEGATIVE_TTL_MAX_S  300     // Cap on how long a failure is kept
+#define DNS_PENDING_MAX         8       // Lookups upstream at once
+#define DNS_WAITERS_MAX         4       // Client queries answered by one lookup
+#define DNS_QUERY_TIMEOUT_MS    5000    // Give up on an upstream lookup
+#define DNS_REPLY_QUEUE         8       // Upstream replies waiting for the poll loop
+#define DNS_PORT_RANDOM_MIN     49152   // Lookups go out from a random port at or above
+
+// ============================================================================
+// Cache and Lookup Structures
+// ============================================================================
+
+// A cached response, keyed by its question in wire form with the name
+// lowercased (names compare case-insensitively)
+struct DnsCacheEntry {
+    uint8_t question[DNS_QUESTION_MAX];
+    uint8_t questionLen;        // 0 = slot unused
+    bool negative;              // NXDOMAIN or NODATA
+    uint8_t* response;          // Heap copy of the upstream response
+    uint16_t responseLen;
+    uint32_t ttl;               // Seconds from stored
+    unsigned long stored;       // millis() when cached
+    unsigned long lastUsed;     // For LRU eviction
+};
+
+// A client query waiting on an upstream lookup
+struct DnsWaiter {
+    uint32_t addr;              // Network byte order
+    uint16_t port;
+    uint16_t id;                // The client's query ID, put back on the answer
+};
+
+// An upstream lookup in flight
+struct DnsPending {
+    bool active;
+    bool cacheable;             // False: not one question we can key on
+    uint8_t question[DNS_QUESTION_MAX];
+    uint8_t questionLen;
+    uint16_t upstreamId;        // Query ID sent upstream
+    struct udp_pcb* pcb;        // Its own socket, on a random port
+    unsigned long sent;
+    uint8_t waiterCount;
+    DnsWaiter waiters[DNS_WAITERS_MAX];
+};
+
+struct DnsForwarder {
+    DnsCacheEntry cache[DNS_CACHE_ENTRIES];
+    uint32_t cacheBytes;        // Response bytes on the heap
+    DnsPending pending[DNS_PENDING_MAX];
+
+    // Upstream replies, queued by the lwIP callback for dnsFwdPoll
+    struct {
+        struct pbuf* p;
+        struct udp_pcb* pcb;    // Socket it arrived on - must be its lookup's
+    } replies[DNS_REPLY_QUEUE];
+    volatile uint8_t replyHead;     // Written by the callback
+    volatile uint8_t replyTail;     // Written by the poll loop
+    volatile uint32_t replyDropped; // Replies lost to a full queue
+
+    // Scratch for one message - a cached answer being aged, or an upstream reply
+    uint8_t buffer[DNS_MESSAGE_MAX];
+
+    // Statistics
+    uint32_t queries;           // Client queries to the gateway
+    uint32_t hits;              // Answered from the cache (including negative)
+    uint32_t negativeHits;      // Of those, cached NXDOMAIN / NODATA
+    uint32_t misses;            // Sent upstream
+    uint32_t coalesced;         // Waited on a lookup already in flight
+    uint32_t timeouts;          // Upstream lookups that never answered
+    uint32_t dropped;           // No room to track the query, or malformed
+};
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+
+// Set up an empty forwarder
+void dnsFwdInit(DnsForwarder* fwd);
+
+// Close the upstream socket and free the cache
+void dnsFwdShutdown(DnsForwarder* fwd);
+
+// Handle a query from the client to the gateway (payload of its UDP datagram)
+void dnsFwdQuery(DnsForwarder* fwd, NatContext* ctx, IPAddress clientIP,
+                 uint16_t clientPort, const uint8_t* msg, uint16_t length);
+
+// Answer waiting clients from upstream replies and expire lost lookups
+// Returns number of packets sent to the client
+int dnsFwdPoll(DnsForwarder* fwd, NatContext* ctx);
+
+// Cached answers currently held
+int dnsFwdCacheCount(DnsForwarder* fwd);
+
+// One-line summary for the stats screens
+String dnsFwdSummary(DnsForwarder* fwd);
+
+#endif // DNS_FORWARD_H
@@ -0,0 +1,87 @@
+// ============================================================================
+// Gateway Link Transport
+// ============================================================================
+// The byte stream that PPP and SLIP framing run over: the RS232 UART, or a
+// TCP connection on a listening socket so an emulator (DOSBox, VICE, 86Box)
+// can use the gateway without a real serial port or baud rate ceiling
+// ============================================================================
+
+#ifndef GATEWAY_LINK_H
+#define GATEWAY_LINK_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// Link Transport Types
+// ============================================================================
+
+enum GwLinkTransport {
+    GW_LINK_SERIAL = 0,     // PhysicalSerial (default)
+    GW_LINK_TCP = 1         // One TCP client on a listening socket
+};
+
+#define GW_LINK_DEFAULT_PORT    6502    // TCP listening port
+#define GW_LINK_BUFFER_SIZE     512     // Socket read/write staging buffers
+
+// ============================================================================
+// Link Configuration (saved to EEPROM, shared by SLIP and PPP)
+// ============================================================================
+
+struct GwLinkConfig {
+    uint8_t transport;          // GwLinkTransport
+    uint16_t tcpPort;           // Listening port for GW_LINK_TCP
+};
+
+extern GwLinkConfig gwLinkConfig;
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+
+// Load / save link settings
+void loadGwLinkSettings();
+void saveGwLinkSettings();
+
+// Open the link for a gateway mode (starts the listener in TCP mode)
+void gwLinkBegin();
+
+// Close the link (drops the TCP client and listener)
+void gwLinkEnd();
+
+// True when the link is a TCP socket rather than the UART
+bool gwLinkIsTcp();
+
+// True when there is a peer to talk to (always true on the UART)
+bool gwLinkConnected();
+
+// Accept a waiting TCP client if none is attached
+// Returns true when a new client was just attached
+bool gwLinkAccept();
+
+// True once after the attached TCP client went away
+bool gwLinkDropped();
+
+// Receive
+int gwLinkAvailable();
+int gwLinkRead();
+
+// Bulk receive - up to maxLen bytes already waiting, never blocks
+int gwLinkReadBytes(uint8_t* buffer, int maxLen);
+
+// Transmit - TCP bytes are staged and sent by gwLinkPush/gwLinkFlush
+void gwLinkWrite(uint8_t byte);
+void gwLinkWriteBytes(const uint8_t* data, uint16_t length);
+void gwLinkPush();              // Send staged bytes (end of frame)
+void gwLinkFlush();             // Push, and wait for the UART to drain
+
+// Before a frame: wait (up to 1 second) for CTS when hardware flow control
+// is on - a no-op on TCP, which has its own flow control
+void gwLinkWaitClear();
+
+// Describe the link for status output ("Serial" or "TCP port 6502 <- 1.2.3.4")
+String gwLinkDescription();
+
+// Handle AT$GWLINK commands, returns true if handled
+bool handleGwLinkCommand(String& cmd, String& upCmd);
+
+#endif // GATEWAY_LINK_H
@@ -115,13 +115,22 @@
 #define CONSOLE_MODE_ADDRESS 795
 #define SIGNAL_MONITOR_ADDRESS 796
 
+// Gateway link transport (shared by SLIP and PPP)
+#define GWLINK_TRANSPORT_ADDRESS 940  // 1 byte (0 = serial, 1 = TCP)
+#define GWLINK_PORT_ADDRESS      941  // 2 bytes - TCP listening port
+
+// Serial link protocol auto-detect (0 = off, anything else = on)
+#define AUTODETECT_ADDRESS 943
+
 // Port Forwarding (generic, shared by SLIP and PPP)
 #define PORTFWD_BASE    950   // Port forwards start here
 #define PORTFWD_SIZE    10    // 10 bytes per entry (active, proto, extPort, intPort, intIP)
-#define PORTFWD_COUNT   8     // Max 8 port forwards
-// Total: 950 + (8 * 10) = 1030
+#define PORTFWD_COUNT   16    // Max 16 port forwards
+// Entries 0-7 keep their old addresses 950-1029 and entries 8-15 take the new
+// range 1030-1109, so forwards saved before the upgrade are still read back.
+// Total: 950 + (16 * 10) = 1110
 
-#define LAST_ADDRESS    1030  // Extended for port forwards
+#define LAST_ADDRESS    1110  // Extended for port forwards
 
 // Version
 #define VERSIONA 0
@@ -134,6 +143,9 @@
 #define LED_TIME 15
 #define TX_BUF_SIZE 256
 
+// Serial flow control (stored in flowControl)
+enum flowControl_t { F_NONE, F_HARDWARE, F_SOFTWARE };
+
 // ============================================================================
 // ZMODEM Protocol Constants (per official spec and modern implementations)
 // ============================================================================
@@ -0,0 +1,70 @@
+// ============================================================================
+// Serial Link Protocol Auto-Detection
+// ============================================================================
+// Classifies what the DTE sends while the modem is in command mode: AT text,
+// a PPP LCP Configure-Request, or a SLIP-framed IPv4 datagram. PPP and SLIP
+// start their gateway directly, so a client configured for a direct cable
+// connection works without a dial string or menu selection
+// ============================================================================
+
+#ifndef LINK_DETECT_H
+#define LINK_DETECT_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// Detection Constants
+// ============================================================================
+
+#define LINK_DETECT_BUFFER_SIZE     64      // Bytes held while classifying
+#define LINK_DETECT_TIMEOUT_MS      1000    // Give up on a partial frame
+#define LINK_DETECT_PPP_BYTES       5       // (FF 03) C0 21 01 after unescaping
+#define LINK_DETECT_SLIP_BYTES      20      // Minimum IPv4 header
+
+enum LinkDetectResult {
+    LINK_DETECT_NONE = 0,
+    LINK_DETECT_AT,
+    LINK_DETECT_PPP,
+    LINK_DETECT_SLIP,
+    LINK_DETECT_UNKNOWN
+};
+
+// ============================================================================
+// Detection Statistics
+// ============================================================================
+
+struct LinkDetectStats {
+    uint32_t atDetected;        // Command lines started on the serial port
+    uint32_t pppDetected;
+    uint32_t slipDetected;
+    uint32_t unknown;           // Framing seen but not a PPP or SLIP start
+    uint32_t noWifi;            // Recognized but WiFi was not connected
+
+    uint8_t lastResult;         // LinkDetectResult
+    uint8_t lastBytes;          // Bytes examined for the last classification
+    uint32_t lastClassifyUs;    // First byte to decision
+    uint32_t maxClassifyUs;
+};
+
+extern LinkDetectStats linkDetectStats;
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+
+// Load / save the auto-detect setting
+void loadLinkDetectSettings();
+void saveLinkDetectSettings();
+
+// Poll from the modem command loop while no command text is pending
+// Returns true when serial input was consumed (classifying, or a gateway
+// mode was entered) and must not be read as AT text
+bool linkDetectPoll();
+
+// Name of a LinkDetectResult for status output
+const char* linkDetectResultName(uint8_t result);
+
+// Handle AT$AUTODETECT commands, returns true if handled
+bool handleLinkDetectCommand(String& cmd, String& upCmd);
+
+#endif // LINK_DETECT_H
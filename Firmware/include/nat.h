@@ -0,0 +1,529 @@
+// ============================================================================
+// NAT Engine
+// ============================================================================
+// Network Address Translation shared by the SLIP and PPP gateways. The
+// engine sees whole IP packets only; each gateway feeds it the datagrams it
+// deframes and supplies a link adapter that frames the packets going back.
+// Uses TCP proxy approach - an lwIP raw TCP pcb carries each flow's remote side
+// ============================================================================
+
+#ifndef NAT_H
+#define NAT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "dns_forward.h"
+
+// lwIP types, opaque here to avoid the header dependency
+struct tcp_pcb;
+struct udp_pcb;
+struct pbuf;
+
+// ============================================================================
+// NAT Configuration Constants
+// ============================================================================
+
+// Flow table sizes - allocated at mode entry from the free heap, between
+// these bounds (ESP32 RAM limited - ~320KB total)
+#define NAT_TCP_FLOWS_MIN        8
+#define NAT_TCP_FLOWS_MAX        64
+#define NAT_UDP_FLOWS_MIN        16
+#define NAT_UDP_FLOWS_MAX        128
+#define NAT_ICMP_FLOWS_MIN       4
+#define NAT_ICMP_FLOWS_MAX       16
+#define NAT_MAX_PORT_FORWARDS    16    // Max port forwarding rules
+#define NAT_ACCEPT_QUEUE         4     // Accepted port forward connections awaiting a flow
+#define NAT_UDP_QUEUE            16    // UDP replies received, awaiting the poll loop
+#define NAT_ICMP_QUEUE           8     // ICMP replies and errors awaiting the poll loop
+
+// Heap budgeting for the flow tables
+#define NAT_HEAP_RESERVE         49152   // Left for WiFi, web UI and the framers
+#define NAT_RESERVED_PCBS        4       // lwIP TCP pcbs kept for the web UI and the link
+#define NAT_RESERVED_LISTEN_PCBS 2       // Listen pcbs kept for the web UI and the link server
+#define NAT_FLOW_NONE            0xFFFF  // End of a hash chain / free list
+
+// A full table evicts its least recently used idle flow. TCP flows only
+// count as idle with nothing in flight and no traffic for this long
+#define NAT_EVICT_IDLE_MS        5000
+
+// Timeout values (milliseconds)
+#define NAT_TCP_TIMEOUT_MS       1800000 // 30 minutes for established TCP (IRC, etc)
+#define NAT_UDP_TIMEOUT_MS       30000   // 30 seconds for UDP
+#define NAT_TCP_SYN_TIMEOUT_MS   30000   // 30 seconds for connection setup
+#define NAT_TCP_CONNECT_TIMEOUT_MS 15000 // Outbound connect before the client gets a RST
+#define NAT_ICMP_TIMEOUT_MS      10000   // 10 seconds for ICMP
+#define NAT_TCP_KEEPALIVE_MS     300000  // 5 minutes between keepalives
+
+// Stall timeout - close connection if no ACK received within this time
+// Set to 60s to handle very slow serial links
+#define NAT_TCP_STALL_TIMEOUT_MS 60000
+
+// Link packet limits (both framers carry up to an Ethernet-sized datagram)
+#define NAT_LINK_MTU_MIN         128
+#define NAT_LINK_MTU_MAX         1500
+
+// TCP segment sizing toward the serial client
+#define NAT_TCP_MSS_DEFAULT      536     // RFC 879 - client sent no MSS option
+#define NAT_TCP_SEGMENT_MAX      1000    // Upper bound per segment, even on a 1500 MTU
+#define NAT_TCP_BURST_SEGMENTS   4       // Segments one flow may send per poll
+
+// Server data taken off lwIP ahead of the client, so the server's window
+// stays open while the serial link drains
+#define NAT_TCP_READAHEAD        8192    // Per flow
+#define NAT_READAHEAD_BUDGET     24576   // Across all flows
+
+// Retransmission toward the client (RFC 6298). The initial RTO is the
+// RFC 1122 value rather than 1 s: a full segment at 2400 baud takes ~4 s
+#define NAT_TCP_RTO_INITIAL_MS   3000
+#define NAT_TCP_RTO_MIN_MS       1000
+#define NAT_TCP_RTO_MAX_MS       60000
+#define NAT_TCP_RTO_GRANULARITY_MS 10    // Poll loop clock granularity
+#define NAT_TCP_DUPACK_THRESHOLD 3       // Duplicate ACKs before fast retransmit
+
+// Client segments that arrive beyond a gap, held until it is filled
+#define NAT_TCP_REASM_SLOTS      4
+
+// Window scaling (RFC 7323), negotiated on the TCP link or fast serial.
+// No per-flow buffer reaches 64 KB on this heap, so our own shift is 0:
+// agreeing to scaling lets the client advertise a scaled window to us
+#define NAT_TCP_WSCALE_MIN_BAUD  115200
+#define NAT_TCP_WSCALE_SHIFT     0
+#define NAT_TCP_WSCALE_NONE      0xFF    // Parsed SYN had no window scale option
+
+// Free heap below which every flow's receive window drops to one segment
+#define NAT_HEAP_LOW             (NAT_HEAP_RESERVE / 2)
+
+// ============================================================================
+// IP Protocol Numbers
+// ============================================================================
+
+#define IP_PROTO_ICMP   1
+#define IP_PROTO_TCP    6
+#define IP_PROTO_UDP    17
+
+// ============================================================================
+// TCP Flags
+// ============================================================================
+
+#define TCP_FLAG_FIN    0x01
+#define TCP_FLAG_SYN    0x02
+#define TCP_FLAG_RST    0x04
+#define TCP_FLAG_PSH    0x08
+#define TCP_FLAG_ACK    0x10
+#define TCP_FLAG_URG    0x20
+
+// TCP options
+#define TCP_OPT_END     0
+#define TCP_OPT_NOP     1
+#define TCP_OPT_MSS     2
+#define TCP_OPT_WSCALE  3
+
+// ============================================================================
+// TCP NAT Connection States
+// ============================================================================
+
+enum NatTcpState {
+    NAT_TCP_CLOSED,         // No connection
+    NAT_TCP_SYN_PENDING,    // Client SYN held while we connect to the server
+    NAT_TCP_SYN_SENT,       // Port forward SYN sent to the client
+    NAT_TCP_ESTABLISHED,    // Connection active
+    NAT_TCP_FIN_WAIT,       // Client sent FIN - server data still delivered
+    NAT_TCP_CLOSING         // Our FIN sent to the client, waiting for cleanup
+};
+
+// Remote side events, raised by the lwIP callbacks for the poll loop
+#define NAT_UP_CONNECTED        0x01    // Outbound connect completed
+#define NAT_UP_CLOSED           0x02    // Server sent FIN
+#define NAT_UP_ERROR            0x04    // Reset or aborted - lwIP freed the pcb
+
+// ============================================================================
+// Flow Key and Flow Table
+// ============================================================================
+// Flows are looked up by hashing a packed key of network-order addresses and
+// host-order ports. Each table is a fixed array of slots with a chained hash
+// index beside it; unused slots sit on a free list threaded through next[].
+
+struct NatFlowKey {
+    uint32_t srcAddr;       // Client side address (network byte order)
+    uint32_t dstAddr;       // Remote side address (network byte order)
+    uint16_t srcPort;       // Client side port (ICMP: unused)
+    uint16_t dstPort;       // Remote side port (ICMP: echo identifier)
+};
+
+struct NatFlowTable {
+    uint16_t size;          // Slots allocated at mode entry
+    uint16_t count;         // Slots in use
+    uint16_t bucketMask;    // Bucket count - 1 (power of two)
+    uint16_t freeHead;      // First unused slot
+    uint16_t* buckets;      // First slot in each hash chain
+    uint16_t* next;         // Per slot: next in its hash chain or the free list
+    uint32_t evictions;     // Idle flows dropped to make room
+};
+
+// ============================================================================
+// NAT TCP Connection Entry
+// ============================================================================
+
+struct NatTcpEntry {
+    bool active;
+    NatTcpState state;
+    NatFlowKey key;         // Hash key (same endpoints as below, packed)
+
+    // Original endpoint (vintage computer side)
+    IPAddress srcIP;        // Vintage computer's IP
+    uint16_t srcPort;       // Vintage computer's port
+
+    // Remote endpoint (internet side)
+    IPAddress dstIP;        // Remote server IP
+    uint16_t dstPort;       // Remote server port
+
+    // Local NAT port (ESP32's ephemeral port)
+    uint16_t natPort;
+
+    // TCP sequence tracking (for proper ACK handling)
+    uint32_t clientSeq;     // Last sequence from client
+    uint32_t clientAck;     // Last ACK from client
+    uint32_t serverSeq;     // Last sequence from server
+    uint32_t serverAck;     // Last ACK from server
+
+    // Largest segment we send the client (its MSS, clamped to the link)
+    uint16_t clientMss;
+
+    // Send window toward the client
+    uint32_t clientWindow;  // Window the client last advertised (scaled)
+    uint8_t clientWscale;   // Shift for the client's window field
+    bool wscaleOk;          // Both SYNs carried window scale
+    struct pbuf* sendChain; // Server data from serverAck on, in lwIP's own pbufs
+    uint16_t sendLen;       // Bytes in sendChain (in flight + unsent)
+    uint16_t readAhead;     // Of those, the oldest already recved to lwIP
+
+    // Receive window from the client - client data goes straight into
+    // lwIP's send buffer, so the window is the room left there
+    uint16_t upstreamRoom;  // tcp_sndbuf at the last look
+    bool clientFin;         // The client's FIN has arrived - it sends no more
+    uint32_t advertisedWindow;  // Window in the last segment we sent
+
+    // Retransmission (RFC 6298 timer, fast retransmit on duplicate ACKs)
+    uint32_t srtt;          // Smoothed RTT in ms, 0 until the first sample
+    uint32_t rttvar;        // RTT variation in ms
+    uint32_t rto;           // Retransmission timeout in ms
+    unsigned long rtoTimer; // Restarted on each send into an empty window / new ACK
+    unsigned long rttStart; // When the timed segment was sent
+    uint32_t rttSeq;        // ACK that covers the timed segment
+    bool rttTiming;         // A segment is being timed (never a resent one)
+    uint8_t dupAcks;        // Duplicate ACKs in a row
+    bool recovering;        // Resending holes until recoverSeq is ACKed
+    uint8_t persistProbes;  // Zero-window probes sent (0 = window not shut)
+    uint32_t recoverSeq;    // serverSeq when recovery began
+
+    // Reassembly queue for client data beyond a gap (heap, per segment)
+    uint8_t* reasmData[NAT_TCP_REASM_SLOTS];
+    uint32_t reasmSeq[NAT_TCP_REASM_SLOTS];
+    uint16_t reasmLen[NAT_TCP_REASM_SLOTS];
+
+    // Remote side (lwIP raw TCP)
+    struct tcp_pcb* volatile pcb;       // Cleared by the error callback
+    struct pbuf* volatile rxPending;    // Received by the callback, not yet in sendChain
+    volatile uint8_t upEvents;          // NAT_UP_* flags
+
+    // Timestamps
+    unsigned long lastActivity;
+    unsigned long lastKeepalive;    // Last keepalive sent
+    unsigned long lastServerData;   // Last data received from server
+    unsigned long created;
+};
+
+// Growth here multiplies by every slot natAllocTables sizes for. The bound
+// is for the firmware build - arduino-esp32 2.x, with 4-byte pointers and
+// longs and an 8-byte IPAddress - where a slot is 188 bytes. The host test
+// build's 8-byte pointers and longs make it 240
+#ifdef ESP32
+#define NAT_TCP_ENTRY_MAX 200
+#else
+#define NAT_TCP_ENTRY_MAX 256
+#endif
+static_assert(sizeof(NatTcpEntry) <= NAT_TCP_ENTRY_MAX,
+              "NatTcpEntry grew - check NAT_TCP_ENTRY_MAX against the flow table sizing");
+
+// ============================================================================
+// NAT UDP Session Entry
+// ============================================================================
+
+struct NatUdpEntry {
+    bool active;
+    NatFlowKey key;         // Hash key (same endpoints as below, packed)
+
+    // Original endpoint
+    IPAddress srcIP;
+    uint16_t srcPort;
+
+    // Remote endpoint
+    IPAddress dstIP;
+    uint16_t dstPort;
+
+    // Local NAT port
+    uint16_t natPort;
+
+    // lwIP raw UDP pcb, connected to the remote endpoint - its replies
+    // come back to this session and no other. A port forward's sessions
+    // share the forward's pcb instead, bound to its external port
+    struct udp_pcb* pcb;
+    bool forwarded;         // pcb belongs to a port forward, not the session
+    uint8_t generation;     // Bumped per pcb the slot opens - tells a queued
+                            // reply for a recycled slot and pcb from a new one
+
+    // Timestamp
+    unsigned long lastActivity;
+};
+
+// ============================================================================
+// NAT ICMP Session Entry
+// ============================================================================
+
+struct NatIcmpEntry {
+    bool active;
+    NatFlowKey key;         // Remote address and echo id, as a reply carries
+
+    IPAddress srcIP;        // Original source (serial client)
+    IPAddress dstIP;        // Destination (ping target)
+    uint16_t id;            // ICMP identifier
+    uint16_t sequence;      // ICMP sequence number
+
+    unsigned long lastActivity;
+};
+
+// ============================================================================
+// Port Forward Entry
+// ============================================================================
+
+struct PortForwardEntry {
+    bool active;
+    uint8_t protocol;       // IP_PROTO_TCP or IP_PROTO_UDP
+    uint16_t externalPort;  // Port on ESP32 (WAN side)
+    IPAddress internalIP;   // Destination IP (vintage computer)
+    uint16_t internalPort;  // Destination port
+};
+
+// ============================================================================
+// Accepted Port Forward Connection
+// ============================================================================
+// Queued by the lwIP accept callback until the poll loop gives it a flow.
+// Its data waits in lwIP (refused) until then.
+
+struct NatAcceptSlot {
+    struct tcp_pcb* volatile pcb;       // Cleared if the connection dies first
+    volatile bool closed;               // Peer already sent FIN
+};
+
+// ============================================================================
+// Link Adapter
+// ============================================================================
+// Frames one IP packet toward the client (SLIP or PPP). The packet buffer
+// may be modified in place, e.g. by header compression.
+
+typedef void (*NatLinkSendFn)(void* link, uint8_t* packet, uint16_t length);
+
+// ============================================================================
+// NAT Gateway Context
+// ============================================================================
+
+struct NatContext {
+    // IP Configuration (serial side)
+    IPAddress gatewayIP;    // ESP32's IP on the serial link (e.g., 192.168.7.1)
+    IPAddress clientIP;     // Vintage computer's IP (e.g., 192.168.7.2)
+    IPAddress subnetMask;   // Subnet mask (e.g., 255.255.255.0)
+    IPAddress dnsServer;    // Upstream DNS server
+
+    // Link adapter - where packets for the client go
+    NatLinkSendFn linkSend;
+    void* link;             // SlipContext* or PppContext*
+
+    // Link sizes - IP packet limits in each direction
+    uint16_t linkMtu;       // Largest packet the client receives
+    uint16_t linkMru;       // Largest packet we receive
+
+    // Connection tables (heap, sized by natInit)
+    NatTcpEntry* tcpTable;
+    NatUdpEntry* udpTable;
+    NatIcmpEntry* icmpTable;
+    NatFlowTable tcpFlows;
+    NatFlowTable udpFlows;
+    NatFlowTable icmpFlows;
+
+    // Port forwarding rules (shared EEPROM storage for SLIP and PPP)
+    PortForwardEntry portForwards[NAT_MAX_PORT_FORWARDS];
+
+    // ICMP raw socket for ping NAT (lwIP raw socket)
+    void* icmpPcb;          // struct raw_pcb* (opaque to avoid header dependency)
+
+    // Port forwarding listeners (struct tcp_pcb*, lwIP raw TCP) and the
+    // connections they have accepted - the callback fills at acceptHead,
+    // the poll loop takes from acceptTail
+    struct tcp_pcb* tcpForwardListeners[NAT_MAX_PORT_FORWARDS];
+    struct udp_pcb* udpForwardPcbs[NAT_MAX_PORT_FORWARDS];
+    NatAcceptSlot acceptQueue[NAT_ACCEPT_QUEUE];
+    volatile uint8_t acceptHead;
+    volatile uint8_t acceptTail;
+
+    // DNS forwarder answering on gatewayIP (heap, null if it didn't fit)
+    DnsForwarder* dns;
+
+    // Server data held as read-ahead, summed over all TCP flows
+    uint32_t readAheadBytes;
+
+    // Statistics
+    uint32_t packetsToInternet;
+    uint32_t packetsFromInternet;
+    uint32_t droppedPackets;
+    uint32_t tcpConnections;
+    uint32_t udpSessions;
+    uint32_t icmpPackets;
+    uint32_t mssClamped;    // Client MSS options larger than the link
+    uint32_t tcpBytesToClient;  // TCP payload sent to the client (goodput)
+    uint32_t tcpRetransmits;    // Segments resent on RTO expiry
+    uint32_t tcpFastRetransmits;// Segments resent on duplicate / partial ACKs
+    uint32_t tcpDupSegments;    // Client segments already delivered, dropped
+    uint32_t tcpOutOfOrder;     // Client segments queued beyond a gap
+    uint32_t tcpWindowUpdates;  // ACKs sent only to reopen a window
+    uint32_t icmpErrors;        // ICMP errors passed to the client (or raised for TTL)
+    uint32_t readAheadPeak;     // Most read-ahead held at once
+};
+
+// ============================================================================
+// IP Header Structure (20 bytes minimum)
+// ============================================================================
+
+struct __attribute__((packed)) IpHeader {
+    uint8_t  versionIhl;    // Version (4 bits) + IHL (4 bits)
+    uint8_t  tos;           // Type of service
+    uint16_t totalLength;   // Total length (big endian)
+    uint16_t id;            // Identification
+    uint16_t flagsFragment; // Flags (3 bits) + Fragment offset (13 bits)
+    uint8_t  ttl;           // Time to live
+    uint8_t  protocol;      // Protocol (TCP=6, UDP=17, ICMP=1)
+    uint16_t checksum;      // Header checksum
+    uint32_t srcIP;         // Source IP (big endian)
+    uint32_t dstIP;         // Destination IP (big endian)
+};
+
+// ============================================================================
+// TCP Header Structure (20 bytes minimum)
+// ============================================================================
+
+struct __attribute__((packed)) TcpHeader {
+    uint16_t srcPort;       // Source port (big endian)
+    uint16_t dstPort;       // Destination port (big endian)
+    uint32_t seqNum;        // Sequence number
+    uint32_t ackNum;        // Acknowledgment number
+    uint8_t  dataOffset;    // Data offset (4 bits) + reserved (4 bits)
+    uint8_t  flags;         // Control flags
+    uint16_t window;        // Window size
+    uint16_t checksum;      // Checksum
+    uint16_t urgentPtr;     // Urgent pointer
+};
+
+// ============================================================================
+// UDP Header Structure (8 bytes)
+// ============================================================================
+
+struct __attribute__((packed)) UdpHeader {
+    uint16_t srcPort;       // Source port (big endian)
+    uint16_t dstPort;       // Destination port (big endian)
+    uint16_t length;        // Length (big endian)
+    uint16_t checksum;      // Checksum
+};
+
+// ============================================================================
+// ICMP Header Structure
+// ============================================================================
+
+struct __attribute__((packed)) IcmpHeader {
+    uint8_t  type;          // Message type
+    uint8_t  code;          // Message code
+    uint16_t checksum;      // Checksum
+    uint16_t id;            // Identifier
+    uint16_t sequence;      // Sequence number
+};
+
+// ICMP types
+#define ICMP_ECHO_REPLY     0
+#define ICMP_DEST_UNREACHABLE 3
+#define ICMP_ECHO_REQUEST   8
+#define ICMP_TIME_EXCEEDED  11
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+
+// Initialize NAT context and size the flow tables from the free heap
+void natInit(NatContext* ctx);
+
+// Shutdown NAT - close all connections and free the flow tables
+void natShutdown(NatContext* ctx);
+
+// Attach the link adapter that frames packets for the client
+void natSetLink(NatContext* ctx, NatLinkSendFn send, void* link);
+
+// Set IP configuration
+void natSetIPs(NatContext* ctx, IPAddress gateway, IPAddress client,
+               IPAddress subnet, IPAddress dns);
+
+// Set link packet limits (mtu toward the client, mru from it).
+// PPP calls this when IPCP comes up, SLIP when the gateway starts.
+void natSetLinkMtu(NatContext* ctx, uint16_t mtu, uint16_t mru);
+
+// Process incoming IP packet from vintage computer
+void natProcessPacket(NatContext* ctx, uint8_t* packet, uint16_t length);
+
+// Poll all active connections for incoming data
+// Returns number of packets sent back to vintage computer
+int natPollConnections(NatContext* ctx);
+
+// Deliver queued ICMP replies and errors (call from main loop)
+void natProcessPendingIcmp(NatContext* ctx);
+
+// ICMP queue counters, updated by the lwIP callback
+extern volatile uint32_t g_icmpCallbackCount;
+extern volatile uint32_t g_icmpCallbackStored;
+extern volatile uint32_t g_icmpCallbackDropped;
+extern volatile uint32_t g_icmpProcessedCount;
+
+// Clean up expired connections
+void natCleanupExpired(NatContext* ctx);
+
+// Port forwarding management
+int natAddPortForward(NatContext* ctx, uint8_t proto, uint16_t extPort,
+                      IPAddress intIP, uint16_t intPort, bool startServer = false);
+void natRemovePortForward(NatContext* ctx, int index);
+void natStartPortForwardServers(NatContext* ctx);
+void natStopPortForwardServers(NatContext* ctx);
+
+// Port forward persistence (EEPROM, shared by SLIP and PPP)
+void savePortForwards(NatContext* ctx);
+void loadPortForwards(NatContext* ctx);
+
+// Check for incoming port-forwarded connections
+void natCheckPortForwards(NatContext* ctx);
+
+// Utility functions
+uint16_t ipChecksum(const uint8_t* data, uint16_t length);
+void ipRecalcChecksum(IpHeader* ip);
+uint16_t tcpUdpChecksum(IpHeader* ip, const uint8_t* payload, uint16_t payloadLen);
+
+// Send IP packet back to vintage computer through the link adapter
+void natSendToClient(NatContext* ctx, uint8_t* packet, uint16_t length);
+
+// Send a UDP datagram to the client from srcIP:srcPort
+void natSendUdpReply(NatContext* ctx, IPAddress srcIP, uint16_t srcPort,
+                     IPAddress dstIP, uint16_t dstPort,
+                     const uint8_t* data, uint16_t length);
+
+// Run fn(arg) in the lwIP task and wait for it - how the main loop makes
+// raw API calls
+void natLwipExec(void (*fn)(void* arg), void* arg);
+
+// Get active connection counts
+int natGetActiveTcpCount(NatContext* ctx);
+int natGetActiveUdpCount(NatContext* ctx);
+
+#endif // NAT_H
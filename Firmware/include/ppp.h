@@ -22,14 +22,24 @@
 
 // PPP Protocol numbers (big-endian in frame)
 #define PPP_PROTO_IP    0x0021  // Internet Protocol
+#define PPP_PROTO_VJC_COMP   0x002D  // Van Jacobson compressed TCP/IP
+#define PPP_PROTO_VJC_UNCOMP 0x002F  // Van Jacobson uncompressed TCP/IP
+#define PPP_PROTO_COMP  0x00FD  // Compressed datagram (CCP)
 #define PPP_PROTO_IPCP  0x8021  // IP Control Protocol
+#define PPP_PROTO_CCP   0x80FD  // Compression Control Protocol
 #define PPP_PROTO_LCP   0xC021  // Link Control Protocol
+#define PPP_PROTO_LQR   0xC025  // Link Quality Report
 
 // PPP configuration
 #define PPP_MTU         1500    // Maximum transmission unit
 #define PPP_MRU         1500    // Maximum receive unit
 #define PPP_BUFFER_SIZE 1600    // Buffer size with overhead
 
+// Adaptive restart timer for Configure-Requests (LCP, IPCP, CCP)
+#define PPP_RESTART_MIN_MS      300     // Floor, even on a fast link
+#define PPP_RESTART_DEFAULT_MS  1000    // First attempt before any RTT sample
+#define PPP_RESTART_MAX_MS      3000    // RFC 1661 default, upper bound for backoff
+
 // FCS (Frame Check Sequence) - CRC-16 CCITT
 #define PPP_FCS_INIT    0xFFFF  // Initial FCS value
 #define PPP_FCS_GOOD    0xF0B8  // Good final FCS after including received FCS
@@ -45,6 +55,9 @@ enum PppRxState {
     PPP_RX_FRAME_DONE   // Frame complete, caller processing it
 };
 
+struct VjContext;
+struct CcpContext;
+
 // ============================================================================
 // PPP Context Structure
 // ============================================================================
@@ -70,11 +83,22 @@ struct PppContext {
     // Protocol field compression negotiated
     bool protoCompression;
 
+    // Van Jacobson header compression state (set up by PPP mode, may be null)
+    VjContext* vj;
+
+    // Compression Control Protocol state (set up by PPP mode, may be null)
+    CcpContext* ccp;
+
+    // Smoothed Configure-Request round trip in ms (0 = no sample yet)
+    uint16_t negotiationRttMs;
+
     // Statistics
     uint32_t framesReceived;
     uint32_t framesSent;
     uint32_t fcsErrors;     // CRC failures
     uint32_t rxErrors;      // Framing errors, overruns
+    uint32_t rxAborts;      // Frames aborted by the sender (0x7D 0x7E)
+    uint32_t rxOverruns;    // Frames longer than the receive buffer
     uint32_t bytesReceived;
     uint32_t bytesSent;
 };
@@ -89,7 +113,7 @@ void pppInit(PppContext* ctx);
 // Process incoming byte from serial
 // Returns: 0 = byte consumed, continue receiving
 //          >0 = complete frame length (frame data in ctx->rxBuffer)
-//          -1 = FCS error (frame discarded)
+//          -1 = FCS error or aborted frame (frame discarded)
 int pppReceiveByte(PppContext* ctx, uint8_t byte);
 
 // Send a frame with PPP encoding
@@ -99,6 +123,17 @@ int pppReceiveByte(PppContext* ctx, uint8_t byte);
 void pppSendFrame(PppContext* ctx, uint16_t protocol,
                   const uint8_t* data, uint16_t length);
 
+// Send an IP packet, using VJ header compression and CCP when negotiated
+// packet may be modified in place (compressed header written over it)
+void pppSendIpPacket(PppContext* ctx, uint8_t* packet, uint16_t length);
+
+// Restart timer for the Nth transmission of a Configure-Request (sends >= 1)
+// Starts near the measured round trip and doubles per retransmission
+uint16_t pppRestartTimerMs(PppContext* ctx, uint8_t sends);
+
+// Feed a Configure-Request -> reply round-trip sample into the timer
+void pppNoteNegotiationRtt(PppContext* ctx, unsigned long sampleMs);
+
 // Calculate FCS (CRC-16) for one byte
 // Uses table-driven calculation for speed
 uint16_t pppCalcFcs(uint16_t fcs, uint8_t byte);
@@ -0,0 +1,156 @@
+// ============================================================================
+// PPP Compression Control Protocol (CCP) - RFC 1962
+// ============================================================================
+// Negotiates per-direction data compression and implements the
+// Predictor type 1 algorithm (RFC 1978)
+// ============================================================================
+
+#ifndef PPP_CCP_H
+#define PPP_CCP_H
+
+#include <Arduino.h>
+#include "ppp.h"
+
+// ============================================================================
+// CCP Code Values (LCP codes plus Reset-Request/Ack)
+// ============================================================================
+
+#define CCP_CONFIGURE_REQUEST   1
+#define CCP_CONFIGURE_ACK       2
+#define CCP_CONFIGURE_NAK       3
+#define CCP_CONFIGURE_REJECT    4
+#define CCP_TERMINATE_REQUEST   5
+#define CCP_TERMINATE_ACK       6
+#define CCP_CODE_REJECT         7
+#define CCP_RESET_REQUEST       14
+#define CCP_RESET_ACK           15
+
+// ============================================================================
+// CCP Option Types
+// ============================================================================
+
+#define CCP_OPT_PREDICTOR1      1   // Predictor type 1 (RFC 1978)
+
+// ============================================================================
+// Predictor-1 Constants
+// ============================================================================
+
+#define CCP_PRED1_TABLE_SIZE    65536   // Guess table, indexed by 16-bit hash
+#define CCP_HEAP_RESERVE        49152   // Keep this much heap free after allocating a table
+
+// ============================================================================
+// CCP States (same subset as IPCP)
+// ============================================================================
+
+enum CcpState {
+    CCP_STATE_INITIAL,
+    CCP_STATE_CLOSED,
+    CCP_STATE_STOPPED,
+    CCP_STATE_CLOSING,
+    CCP_STATE_REQ_SENT,
+    CCP_STATE_ACK_RCVD,
+    CCP_STATE_ACK_SENT,
+    CCP_STATE_OPENED
+};
+
+// ============================================================================
+// Predictor-1 Direction State
+// ============================================================================
+
+struct CcpPred1State {
+    uint8_t* table;         // Guess table (heap, CCP_PRED1_TABLE_SIZE bytes)
+    uint16_t hash;
+};
+
+// ============================================================================
+// CCP Context Structure
+// ============================================================================
+
+struct CcpContext {
+    CcpState state;
+    bool enabled;               // Config: negotiate CCP at all
+
+    // Negotiation
+    bool ourRequest;            // We still ask the peer to compress (cleared on Reject)
+    bool ourAcked;              // Peer will compress toward us
+    bool peerAccepted;          // We will compress toward the peer
+    bool peerDeclines;          // Peer is known to refuse Predictor-1 (don't request it)
+
+    // Predictor-1 state per direction
+    CcpPred1State tx;
+    CcpPred1State rx;
+    bool rxResetPending;        // Reset-Request sent, discarding until Reset-Ack
+
+    // Request tracking
+    uint8_t identifier;
+    uint8_t resetId;
+    uint8_t configRetries;
+    unsigned long lastSendTime;
+    unsigned long lastResetTime;
+
+    // Statistics (per session)
+    uint32_t txBytesIn;         // Uncompressed bytes offered to the compressor
+    uint32_t txBytesOut;        // Bytes sent on the link after compression
+    uint32_t rxBytesIn;         // Compressed bytes received
+    uint32_t rxBytesOut;        // Bytes after decompression
+    uint32_t rxErrors;          // CRC / length mismatches
+    uint32_t resetRequestsSent;
+    uint32_t resetRequestsRcvd;
+    uint32_t heapRefusals;      // Tables not allocated due to low heap
+
+    // Timeouts and limits (Configure-Request uses pppRestartTimerMs)
+    static const uint16_t RESET_TIMER_MS = 3000;     // Reset-Request retransmit
+    static const uint8_t MAX_CONFIGURE = 10;
+};
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+
+// Initialize CCP context
+void ccpInit(CcpContext* ctx);
+
+// Start CCP negotiation (call after LCP opens, alongside IPCP)
+void ccpOpen(CcpContext* ctx, PppContext* ppp);
+
+// Close CCP and free compression tables
+void ccpClose(CcpContext* ctx);
+
+// Peer sent LCP Protocol-Reject for CCP - stop negotiating
+void ccpProtocolRejected(CcpContext* ctx);
+
+// Process incoming CCP packet
+void ccpProcessPacket(CcpContext* ctx, PppContext* ppp,
+                      uint8_t* data, uint16_t length);
+
+// Handle timeout (retransmit Configure-Request / Reset-Request)
+bool ccpTimeout(CcpContext* ctx, PppContext* ppp);
+
+// Check if compression is active toward the peer
+inline bool ccpTxActive(CcpContext* ctx) {
+    return ctx->state == CCP_STATE_OPENED && ctx->peerAccepted && ctx->tx.table;
+}
+
+// Check if compression is active from the peer
+inline bool ccpRxActive(CcpContext* ctx) {
+    return ctx->state == CCP_STATE_OPENED && ctx->ourAcked && ctx->rx.table;
+}
+
+// Compress a network-layer datagram and send it as a PPP_PROTO_COMP frame
+void ccpSendCompressed(CcpContext* ctx, PppContext* ppp, uint16_t protocol,
+                       const uint8_t* data, uint16_t length);
+
+// Decompress a PPP_PROTO_COMP frame
+// On success returns the inner datagram length (protocol in *protocol,
+// data in out). Returns -1 on error (a Reset-Request has been sent).
+int ccpDecompress(CcpContext* ctx, PppContext* ppp, const uint8_t* in, uint16_t inLen,
+                  uint16_t* protocol, uint8_t* out, uint16_t outSize);
+
+// Compression ratio in hundredths (e.g. 185 = 1.85:1), 100 if no data
+uint16_t ccpTxRatio(CcpContext* ctx);
+uint16_t ccpRxRatio(CcpContext* ctx);
+
+// Get state name for debugging
+const char* ccpStateName(CcpState state);
+
+#endif // PPP_CCP_H
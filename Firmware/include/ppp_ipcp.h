@@ -22,6 +22,13 @@
 #define IPCP_TERMINATE_REQUEST   5
 #define IPCP_TERMINATE_ACK       6
 
+// ============================================================================
+// Van Jacobson compression option (RFC 1332 section 3.2)
+// ============================================================================
+
+#define IPCP_VJ_PROTOCOL         0x002D  // IP-Compression-Protocol value for VJ
+#define IPCP_VJ_MAX_SLOT_ID      15      // Highest slot id we offer/accept (16 slots)
+
 // ============================================================================
 // IPCP Option Types
 // ============================================================================
@@ -83,13 +90,22 @@ struct IpcpContext {
     // IP Pool
     PppIpPool pool;
 
+    // Van Jacobson header compression
+    bool vjAllowed;             // Config: negotiate VJ at all
+    bool vjRequest;             // We still ask the peer to compress (cleared on Reject)
+    bool vjPeerRejects;         // Peer is known to reject VJ (skip it in requests)
+    uint8_t vjOurMaxSlot;       // Max slot id in our request (peer may Nak lower)
+    bool vjOurAcked;            // Peer agreed to compress toward us
+    bool vjPeerAccepted;        // We agreed to compress toward the peer
+    uint8_t vjPeerMaxSlot;      // Peer's max slot id
+    bool vjPeerCompSlot;        // Peer allows slot id compression
+
     // Request tracking
     uint8_t identifier;
     uint8_t configRetries;
     unsigned long lastSendTime;
 
-    // Timeouts and limits
-    static const uint16_t RESTART_TIMER_MS = 3000;
+    // Timeouts and limits (restart timer is adaptive, see pppRestartTimerMs)
     static const uint8_t MAX_CONFIGURE = 10;
 };
 
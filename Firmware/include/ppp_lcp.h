@@ -37,6 +37,27 @@
 #define LCP_OPT_MAGIC_NUMBER    5   // Magic Number (loop detection)
 #define LCP_OPT_PFC             7   // Protocol Field Compression
 #define LCP_OPT_ACFC            8   // Address/Control Field Compression
+#define LCP_OPT_CALLBACK        13  // Callback (sent by Windows 9x/NT Dial-Up Networking)
+
+#define LCP_LQR_PERIOD          1000    // Reporting period we request (1/100 s)
+
+// ============================================================================
+// ACCM Compatibility Profiles
+// ============================================================================
+// Controls which control characters WE escape when transmitting.
+//   AUTO         - honor the peer's negotiated ACCM, falling back to escaping
+//                  everything for peers fingerprinted as needing it
+//   NEGOTIATED   - always honor the peer's negotiated ACCM (RFC 1662)
+//   CONSERVATIVE - always escape all control characters (0xFFFFFFFF)
+
+enum LcpAccmProfile {
+    LCP_ACCM_AUTO = 0,
+    LCP_ACCM_NEGOTIATED = 1,
+    LCP_ACCM_CONSERVATIVE = 2
+};
+
+// XON (0x11) and XOFF (0x13) - always escaped when software flow control is on
+#define LCP_ACCM_XON_XOFF       0x000A0000UL
 
 // ============================================================================
 // LCP States (Simplified from RFC 1661)
@@ -75,6 +96,7 @@ struct LcpContext {
     // Request tracking
     uint8_t identifier;         // Current request ID (incremented per request)
     uint8_t configRetries;      // Configure-Request retry counter
+    bool retransmitted;         // Current request sent more than once (Karn: no RTT sample)
     uint8_t termRetries;        // Terminate-Request retry counter
     unsigned long lastSendTime; // Time of last packet sent (for timeout)
 
@@ -83,8 +105,35 @@ struct LcpContext {
     bool ourAccmAcked;
     bool ourMagicAcked;
 
-    // Timeouts and limits
-    static const uint16_t RESTART_TIMER_MS = 3000;  // Retransmit timeout
+    // ACCM compatibility (set from PPP config before lcpOpen)
+    LcpAccmProfile accmProfile;
+    bool peerLegacy;            // Peer fingerprinted as needing full escaping
+
+    // Last protocol the peer Protocol-Rejected (0 = none, cleared by caller)
+    uint16_t rejectedProtocol;
+
+    // Options the peer rejected (also seeded from a remembered peer profile)
+    bool omitAccm;
+    bool omitMagic;
+
+    // Hash of the peer's first Configure-Request (0 = none yet), used to
+    // recognize a returning peer
+    uint32_t peerFingerprint;
+
+    // Link-Quality-Report negotiation (RFC 1989), periods in 1/100 s
+    bool lqrAllowed;            // Config: negotiate LQR (set before lcpOpen)
+    bool omitQuality;           // Peer rejected our Quality-Protocol option
+    uint32_t ourLqrPeriod;      // How often we ask the peer to report
+    bool ourLqrAcked;           // Peer will send LQRs to us
+    bool peerLqrAccepted;       // We must send LQRs to the peer
+    uint32_t peerLqrPeriod;     // Peer's requested period (0 = reply to its LQRs only)
+
+    // Last Echo-Reply received (cleared by caller)
+    bool echoReplied;
+    uint8_t echoReplyId;
+    bool echoLooped;            // Reply carried our own magic number (looped link)
+
+    // Timeouts and limits (restart timer is adaptive, see pppRestartTimerMs)
     static const uint8_t MAX_CONFIGURE = 10;        // Max configure retries
     static const uint8_t MAX_TERMINATE = 2;         // Max terminate retries
 };
@@ -124,7 +173,17 @@ inline bool lcpIsNegotiating(LcpContext* ctx) {
            ctx->state == LCP_STATE_ACK_SENT;
 }
 
+// Send an Echo-Request (link quality probe)
+void lcpSendEchoRequest(LcpContext* ctx, PppContext* ppp, uint8_t id);
+
+// Retransmit our Configure-Request now instead of waiting for the timer
+// (used when the peer's traffic shows it missed our last reply)
+void lcpResendRequest(LcpContext* ctx, PppContext* ppp);
+
 // Get state name for debugging
 const char* lcpStateName(LcpState state);
 
+// Get ACCM profile name for display
+const char* lcpAccmProfileName(LcpAccmProfile profile);
+
 #endif // PPP_LCP_H
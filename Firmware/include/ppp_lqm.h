@@ -0,0 +1,115 @@
+// ============================================================================
+// PPP Link Quality Monitoring
+// ============================================================================
+// Periodic LCP Echo-Request prober (RFC 1661) with round-trip statistics,
+// optional Link-Quality-Report exchange (RFC 1989), and link-down detection
+// ============================================================================
+
+#ifndef PPP_LQM_H
+#define PPP_LQM_H
+
+#include <Arduino.h>
+#include "ppp.h"
+#include "ppp_lcp.h"
+
+// ============================================================================
+// LQM Configuration Constants
+// ============================================================================
+
+#define LQM_RTT_SAMPLES             32      // Echo round trips kept for percentiles
+#define LQM_DEFAULT_ECHO_INTERVAL   10      // Seconds between Echo-Requests
+#define LQM_DEFAULT_ECHO_FAILURES   4       // Consecutive misses before link down
+#define LQR_PACKET_LEN              48      // 12 counters of 4 bytes
+
+// ============================================================================
+// LQM Context Structure
+// ============================================================================
+
+struct LqmContext {
+    // Configuration (set from PPP config)
+    uint8_t echoIntervalSec;    // 0 = no echo probing
+    uint8_t echoFailures;       // Consecutive misses that mean link down (0 = never)
+
+    // Echo prober
+    bool running;               // LCP is open
+    uint8_t echoId;
+    bool echoPending;           // Waiting for a reply to echoId
+    unsigned long echoSendTime;
+    uint32_t framesAtProbe;     // Frames received when the probe went out
+    uint8_t consecutiveMisses;  // Misses with nothing else heard from the peer
+    bool linkDown;              // Set once echoFailures is reached
+
+    // Round-trip samples (ring buffer, ms)
+    uint16_t rttSamples[LQM_RTT_SAMPLES];
+    uint8_t rttCount;
+    uint8_t rttNext;
+    uint16_t rttLastMs;
+    uint16_t rttMinMs;
+    uint16_t rttMaxMs;
+
+    // Echo statistics
+    uint32_t echoesSent;
+    uint32_t echoReplies;
+    uint32_t echoesMissed;      // No reply before the next probe was due
+    uint32_t echoesLate;        // Reply for an echo already counted as missed
+    uint32_t loopbacks;         // Replies carrying our own magic number
+
+    // Link-Quality-Report (RFC 1989)
+    bool lqrTx;                 // We send LQRs (peer asked for them)
+    bool lqrRx;                 // Peer sends LQRs (we asked for them)
+    uint32_t lqrPeriodMs;       // Our send period, 0 = only in reply to the peer
+    unsigned long lastLqrSent;
+    uint32_t outLqrs;           // LQRs sent
+    uint32_t inLqrs;            // LQRs received
+
+    // Our receive counters captured when the last LQR arrived
+    uint32_t saveInLqrs;
+    uint32_t saveInPackets;
+    uint32_t saveInErrors;
+    uint32_t saveInOctets;
+
+    // Last received LQR (echoed back as LastOut*, and base for loss deltas)
+    bool havePeerLqr;
+    uint32_t peerOutLqrs;
+    uint32_t peerOutPackets;
+    uint32_t peerOutOctets;
+    uint32_t peerLastOutPackets;
+    uint32_t peerInPackets;
+    uint32_t prevSaveInPackets;
+
+    // Loss measured from LQR exchanges (packets)
+    uint32_t lqrOutSent;        // Sent by us, per the peer's reports
+    uint32_t lqrOutLost;        // ... and never counted in by the peer
+    uint32_t lqrInSent;         // Sent by the peer
+    uint32_t lqrInLost;         // ... and never counted in by us
+};
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+
+// Initialize LQM context (keeps nothing from a previous session)
+void lqmInit(LqmContext* ctx, uint8_t echoIntervalSec, uint8_t echoFailures);
+
+// Start monitoring (call when LCP opens - picks up negotiated LQR)
+void lqmStart(LqmContext* ctx, LcpContext* lcp);
+
+// Stop monitoring (link closed); statistics are kept for display
+void lqmStop(LqmContext* ctx);
+
+// Periodic work: send probes and LQRs, detect missed replies
+// Call after each LCP packet and from the main loop.
+// Returns true when the link has just been declared down.
+bool lqmPoll(LqmContext* ctx, LcpContext* lcp, PppContext* ppp);
+
+// Process incoming Link-Quality-Report (PPP_PROTO_LQR)
+void lqmProcessLqr(LqmContext* ctx, LcpContext* lcp, PppContext* ppp,
+                   const uint8_t* data, uint16_t length);
+
+// Echo round-trip percentile in ms (pct 0-100), 0 if no samples
+uint16_t lqmRttPercentile(LqmContext* ctx, uint8_t pct);
+
+// Echo loss in tenths of a percent (e.g. 25 = 2.5%)
+uint16_t lqmEchoLossPermille(LqmContext* ctx);
+
+#endif // PPP_LQM_H
@@ -12,7 +12,10 @@
 #include "ppp.h"
 #include "ppp_lcp.h"
 #include "ppp_ipcp.h"
-#include "ppp_nat.h"
+#include "ppp_ccp.h"
+#include "ppp_lqm.h"
+#include "nat.h"
+#include "vj_compress.h"
 
 // ============================================================================
 // PPP Mode States
@@ -38,6 +41,32 @@ struct PppConfig {
     IPAddress poolStart;        // First IP in client pool
     IPAddress primaryDns;       // Primary DNS server
     IPAddress secondaryDns;     // Secondary DNS server
+    uint8_t accmProfile;        // LcpAccmProfile (AUTO/NEGOTIATED/CONSERVATIVE)
+    bool vjCompression;         // Negotiate Van Jacobson TCP/IP header compression
+    bool ccpCompression;        // Negotiate CCP (Predictor-1) data compression
+    uint8_t echoInterval;       // Seconds between LCP Echo-Requests (0 = off)
+    uint8_t echoFailures;       // Missed echoes before link down (0 = never)
+    bool lqrEnabled;            // Negotiate Link-Quality-Report (RFC 1989)
+};
+
+// ============================================================================
+// Remembered Peer Profile (RAM only, lost on reboot)
+// ============================================================================
+// What a client refused on its last call, so the next call from the same
+// client skips the round trips spent rediscovering it
+
+#define PPP_PEER_PROFILES   4
+
+struct PppPeerProfile {
+    uint32_t fingerprint;       // Hash of the peer's LCP Configure-Request (0 = empty)
+    uint32_t lastUsed;          // LRU stamp
+    uint16_t negotiationRttMs;  // Smoothed Configure-Request round trip
+    bool omitAccm;              // LCP ACCM option rejected
+    bool omitMagic;             // LCP Magic-Number option rejected
+    bool omitQuality;           // LCP Quality-Protocol option rejected
+    bool vjRejected;            // IPCP VJ compression rejected
+    bool ccpDeclined;           // Predictor-1 Nak'd or rejected
+    bool ccpUnsupported;        // CCP Protocol-Rejected
 };
 
 // ============================================================================
@@ -54,6 +83,17 @@ struct PppModeContext {
     unsigned long lastStatusUpdate; // Last OLED status update
     unsigned long lastLcpTimeout;   // Last LCP timeout check
     unsigned long stateStartTime;   // When current state started
+    unsigned long linkStartTime;    // First LCP packet from the peer (0 = none yet)
+
+    // Bring-up time of the last call (0 = not measured)
+    uint32_t lastLcpUpMs;           // First LCP packet -> LCP opened
+    uint32_t lastTimeToIpMs;        // First LCP packet -> IPCP opened
+
+    // Peer profile cache
+    PppPeerProfile profiles[PPP_PEER_PROFILES];
+    uint32_t profileStamp;          // LRU clock
+    uint32_t profileFingerprint;    // Fingerprint the current settings came from
+    bool ccpUnsupported;            // Peer Protocol-Rejected CCP this call
 
     // Previous mode to return to on disconnect
     int previousMenuMode;
@@ -68,7 +108,13 @@ struct PppModeContext {
 #define PPP_POOL_START_ADDRESS      904   // 4 bytes
 #define PPP_PRIMARY_DNS_ADDRESS     908   // 4 bytes
 #define PPP_SECONDARY_DNS_ADDRESS   912   // 4 bytes
-#define PPP_EEPROM_END              920
+#define PPP_ACCM_PROFILE_ADDRESS    916   // 1 byte
+#define PPP_VJ_ADDRESS              917   // 1 byte (0 = off, else on)
+#define PPP_CCP_ADDRESS             918   // 1 byte (0 = off, else on)
+#define PPP_ECHO_INTERVAL_ADDRESS   919   // 1 byte (seconds, 0 = off)
+#define PPP_ECHO_FAILURES_ADDRESS   920   // 1 byte (0 = never drop)
+#define PPP_LQR_ADDRESS             921   // 1 byte (1 = on, else off)
+#define PPP_EEPROM_END              922
 
 // ============================================================================
 // Function Declarations - Mode Interface
@@ -86,6 +132,9 @@ void enterPppMode();
 // Exit PPP gateway mode (stop PPP, return to menu)
 void exitPppMode();
 
+// Feed link bytes that arrived before PPP mode was entered (auto-detect)
+void pppReplayInput(const uint8_t* data, uint16_t length);
+
 // ============================================================================
 // Function Declarations - Display
 // ============================================================================
@@ -96,6 +145,9 @@ void pppShowStatus();
 // Show PPP statistics
 void pppShowStatistics();
 
+// Show link quality (echo round trips, loss, framing errors)
+void pppShowLinkQuality();
+
 // ============================================================================
 // Function Declarations - Configuration
 // ============================================================================
@@ -124,7 +176,8 @@ bool handlePppCommand(String& cmd, String& upCmd);
 extern PppContext pppCtx;
 extern LcpContext lcpCtx;
 extern IpcpContext ipcpCtx;
-extern PppNatContext pppNatCtx;
+extern NatContext pppNatCtx;
+extern LqmContext lqmCtx;
 extern PppModeContext pppModeCtx;
 
 #endif // PPP_MODE_H
@@ -2,6 +2,7 @@
 #define SLIP_H
 
 #include <Arduino.h>
+#include "vj_compress.h"
 
 // ============================================================================
 // SLIP Protocol Constants (RFC 1055)
@@ -16,6 +17,12 @@
 // SLIP configuration
 #define SLIP_MTU         1500   // Maximum transmission unit (matches Ethernet)
 #define SLIP_BUFFER_SIZE 1600   // Buffer size with overhead for escaping
+#define SLIP_IDLE_END_MS 100    // Idle time before a frame gets a leading END
+
+// CSLIP packet type, carried in the top bits of the first byte (RFC 1144)
+// The VJ_TYPE_* values are already the matching bit patterns
+#define CSLIP_TYPE_MASK  0xF0
+#define CSLIP_IP_MASK    0x4F   // Restores the IPv4 version nibble
 
 // ============================================================================
 // SLIP State Machine
@@ -37,9 +44,13 @@ struct SlipContext {
     uint8_t rxBuffer[SLIP_BUFFER_SIZE];
     uint16_t rxPos;
 
-    // Transmit buffer (for building frames if needed)
+    // Transmit buffer - frames are encoded here and written in one call
     uint8_t txBuffer[SLIP_BUFFER_SIZE];
     uint16_t txPos;
+    unsigned long lastTxTime;  // End of the last frame sent
+
+    // VJ header compression (CSLIP), nullptr when not in use
+    VjContext* vj;
 
     // Statistics
     uint32_t framesReceived;
@@ -57,15 +68,42 @@ struct SlipContext {
 // Initialize SLIP context
 void slipInit(SlipContext* ctx);
 
+// Process a span of received bytes
+// Returns: 0 = all bytes consumed, continue receiving
+//          >0 = complete frame length (frame data in ctx->rxBuffer)
+// *consumed is set to the bytes used - call again with the remainder
+int slipReceive(SlipContext* ctx, const uint8_t* data, uint16_t length,
+                uint16_t* consumed);
+
 // Process incoming byte from serial
 // Returns: 0 = byte consumed, continue receiving
 //          >0 = complete frame length (frame data in ctx->rxBuffer)
 int slipReceiveByte(SlipContext* ctx, uint8_t byte);
 
 // Send a frame (IP packet) with SLIP encoding
-// Writes directly to PhysicalSerial
+// Encodes into ctx->txBuffer and writes it to the gateway link in one call
 void slipSendFrame(SlipContext* ctx, const uint8_t* data, uint16_t length);
 
+// Send an IP packet, VJ-compressed when ctx->vj has transmit enabled
+// The packet buffer is modified in place
+void slipSendIpPacket(SlipContext* ctx, uint8_t* packet, uint16_t length);
+
+// Rebuild the IP packet in a received frame, undoing CSLIP compression when
+// ctx->vj has receive enabled. *packet is set to the frame itself or to out
+// Returns: >0 = packet length, 0 = tossed until resync, -1 = error
+int slipUncompressFrame(SlipContext* ctx, uint8_t* frame, uint16_t length,
+                        uint8_t* out, uint16_t outSize, uint8_t** packet);
+
+// CSLIP type of a received frame: VJ_TYPE_IP, VJ_TYPE_UNCOMPRESSED_TCP or
+// VJ_TYPE_COMPRESSED_TCP
+inline uint8_t cslipFrameType(const uint8_t* frame) {
+    uint8_t c = frame[0] & CSLIP_TYPE_MASK;
+    if (c & VJ_TYPE_COMPRESSED_TCP) {
+        return VJ_TYPE_COMPRESSED_TCP;
+    }
+    return (c == VJ_TYPE_UNCOMPRESSED_TCP) ? VJ_TYPE_UNCOMPRESSED_TCP : VJ_TYPE_IP;
+}
+
 // Reset receiver state (after error or timeout)
 void slipReset(SlipContext* ctx);
 
@@ -3,7 +3,7 @@
 
 #include <Arduino.h>
 #include "slip.h"
-#include "slip_nat.h"
+#include "nat.h"
 
 // ============================================================================
 // SLIP Mode States
@@ -21,11 +21,21 @@ enum SlipModeState {
 // SLIP Configuration (saved to EEPROM)
 // ============================================================================
 
+// CSLIP (VJ-compressed SLIP) selection
+enum SlipCslipMode {
+    SLIP_CSLIP_OFF = 0,     // Plain SLIP only
+    SLIP_CSLIP_ON = 1,      // Compress and decompress from the first packet
+    SLIP_CSLIP_AUTO = 2     // Decompress always, compress once the client does
+};
+
+#define SLIP_VJ_MAX_SLOT    15  // 16 slots, as every CSLIP driver assumes
+
 struct SlipConfig {
     IPAddress slipIP;       // Gateway IP (ESP32 side)
     IPAddress clientIP;     // Client IP (vintage computer)
     IPAddress subnetMask;   // Subnet mask
     IPAddress dnsServer;    // DNS server
+    uint8_t cslipMode;      // SlipCslipMode
 };
 
 // ============================================================================
@@ -48,7 +58,8 @@ struct SlipModeContext {
 #define SLIP_CLIENT_IP_ADDRESS  804   // 4 bytes - Client IP
 #define SLIP_SUBNET_ADDRESS     808   // 4 bytes - Subnet mask
 #define SLIP_DNS_ADDRESS        812   // 4 bytes - DNS server
-#define SLIP_EEPROM_END         816   // End of SLIP EEPROM area
+#define SLIP_CSLIP_ADDRESS      816   // 1 byte - SlipCslipMode
+#define SLIP_EEPROM_END         817   // End of SLIP EEPROM area
 // Note: Port forwards are stored in a shared location (PORTFWD_BASE in globals.h)
 
 // ============================================================================
@@ -67,6 +78,9 @@ void enterSlipMode();
 // Exit SLIP gateway mode (stop SLIP, return to menu)
 void exitSlipMode();
 
+// Feed link bytes that arrived before SLIP mode was entered (auto-detect)
+void slipReplayInput(const uint8_t* data, uint16_t length);
+
 // ============================================================================
 // Function Declarations - Display
 // ============================================================================
@@ -109,6 +123,7 @@ bool handleSlipCommand(String& cmd, String& upCmd);
 // ============================================================================
 
 extern SlipContext slipCtx;
+extern VjContext slipVjCtx;
 extern NatContext natCtx;
 extern SlipModeContext slipModeCtx;
 
@@ -0,0 +1,111 @@
+// ============================================================================
+// Van Jacobson TCP/IP Header Compression (RFC 1144)
+// ============================================================================
+// Compresses the 40-byte TCP/IP header of established connections down to
+// 3-7 bytes on the serial link. Link independent: PPP carries the packet
+// type in the protocol field, CSLIP in the top bits of the first byte.
+// ============================================================================
+
+#ifndef VJ_COMPRESS_H
+#define VJ_COMPRESS_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// VJ Configuration Constants
+// ============================================================================
+
+#define VJ_MAX_SLOTS        16      // Connection slots per direction (RFC 1144 default)
+#define VJ_MAX_HDR          128     // Max saved IP+TCP header (60 + 60, rounded)
+
+// Packet types returned by vjCompress() / accepted by vjUncompress()
+#define VJ_TYPE_ERROR               0x00
+#define VJ_TYPE_IP                  0x40
+#define VJ_TYPE_UNCOMPRESSED_TCP    0x70
+#define VJ_TYPE_COMPRESSED_TCP      0x80
+
+// Change mask bits (first byte of a compressed header)
+#define VJ_NEW_C    0x40    // Connection number present
+#define VJ_NEW_I    0x20    // IP id delta present
+#define VJ_TCP_PUSH 0x10    // TCP PSH flag
+#define VJ_NEW_S    0x08    // Sequence delta present
+#define VJ_NEW_A    0x04    // Ack delta present
+#define VJ_NEW_W    0x02    // Window delta present
+#define VJ_NEW_U    0x01    // Urgent pointer present
+
+// Special-case change masks (unidirectional data / echoed interactive traffic)
+#define VJ_SPECIAL_I    (VJ_NEW_S | VJ_NEW_W | VJ_NEW_U)
+#define VJ_SPECIAL_D    (VJ_NEW_S | VJ_NEW_A | VJ_NEW_W | VJ_NEW_U)
+#define VJ_SPECIALS_MASK (VJ_NEW_S | VJ_NEW_A | VJ_NEW_W | VJ_NEW_U)
+
+// ============================================================================
+// Connection Slot (saved copy of the last header sent/received)
+// ============================================================================
+
+struct VjSlot {
+    uint8_t hdr[VJ_MAX_HDR];
+    uint8_t hdrLen;         // IP + TCP header length (0 = slot unused)
+    uint32_t lastUsed;      // Compressor LRU stamp
+};
+
+// ============================================================================
+// VJ Context (one per link, both directions)
+// ============================================================================
+
+struct VjContext {
+    // Compressor (toward the serial client)
+    bool txEnabled;
+    uint8_t txMaxSlot;          // Highest slot id the peer can hold
+    bool txCompressSlotId;      // Peer allows omitting the slot id
+    uint8_t txLastSlot;         // Slot id of the last compressed packet sent
+    uint32_t txStamp;           // LRU clock
+    VjSlot txSlots[VJ_MAX_SLOTS];
+
+    // Decompressor (from the serial client)
+    bool rxEnabled;
+    uint8_t rxMaxSlot;          // Highest slot id we offered
+    uint8_t rxLastSlot;         // Slot id of the last packet received
+    bool rxToss;                // Discard compressed packets until resync
+    VjSlot rxSlots[VJ_MAX_SLOTS];
+
+    // Statistics
+    uint32_t txCompressed;      // Sent as COMPRESSED_TCP
+    uint32_t txUncompressed;    // Sent as UNCOMPRESSED_TCP (slot refresh)
+    uint32_t txSearches;        // Slot lookups
+    uint32_t txMisses;          // Lookups that had to evict a slot
+    uint32_t txBytesSaved;      // Header bytes removed from the link
+    uint32_t rxCompressed;
+    uint32_t rxUncompressed;
+    uint32_t rxErrors;          // Bad slot ids / truncated headers
+    uint32_t rxTossed;          // Dropped while waiting to resync
+};
+
+// ============================================================================
+// Function Declarations
+// ============================================================================
+
+// Initialize VJ context (both directions disabled, all slots empty)
+void vjInit(VjContext* ctx);
+
+// Enable compression toward the peer (peer's negotiated max slot id)
+void vjEnableTx(VjContext* ctx, uint8_t maxSlot, bool compressSlotId);
+
+// Enable decompression from the peer (our negotiated max slot id)
+void vjEnableRx(VjContext* ctx, uint8_t maxSlot);
+
+// Compress an outbound IP packet in place
+// On VJ_TYPE_COMPRESSED_TCP *packet and *length are advanced past the removed
+// header bytes; on VJ_TYPE_UNCOMPRESSED_TCP the IP protocol byte carries the
+// slot id. Returns VJ_TYPE_IP for anything that cannot be compressed.
+uint8_t vjCompress(VjContext* ctx, uint8_t** packet, uint16_t* length);
+
+// Rebuild an inbound IP packet
+// type: VJ_TYPE_COMPRESSED_TCP or VJ_TYPE_UNCOMPRESSED_TCP
+// Returns rebuilt length in out, 0 if the packet was tossed, -1 on error
+int vjUncompress(VjContext* ctx, uint8_t type, const uint8_t* in, uint16_t inLen,
+                 uint8_t* out, uint16_t outSize);
+
+// Framing error on the link - drop compressed packets until the peer resyncs
+void vjToss(VjContext* ctx);
+
+#endif // VJ_COMPRESS_H
@@ -12,6 +12,7 @@ void handleWebHangUp();
 
 // API handlers (internal - not meant to be called directly)
 void handleApiStatus();
+void handleApiPpp();
 void handleApiSettingsGet();
 void handleApiSettingsPost();
 void handleApiReboot();
@@ -335,7 +335,6 @@ bool petTranslate = false; // Fix PET MCTerm 1.26C Pet->ASCII encoding to actual
 bool consoleMode = true;   // AT&C: First telnet connection becomes console (true) or all connections ring (false)
 bool signalMonitorEnabled = false; // Show signal states on OLED in modem mode
 bool bHex = false;
-enum flowControl_t { F_NONE, F_HARDWARE, F_SOFTWARE };
 byte flowControl = F_NONE;      // Use flow control
 bool txPaused = false;          // Has flow control asked us to pause?
 enum pinPolarity_t { P_INVERTED, P_NORMAL }; // Is LOW (0) or HIGH (1) active?
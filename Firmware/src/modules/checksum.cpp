@@ -0,0 +1,123 @@
+// ============================================================================
+// Internet Checksum Implementation
+// ============================================================================
+// The sum is carried in 64 bits so 32-bit words can be added without
+// handling each carry; the carries are folded back in at the end. A 32-bit
+// word sums the same as its two 16-bit halves, since 2^16 = 1 in ones'
+// complement arithmetic.
+// ============================================================================
+
+#include "checksum.h"
+
+// Fold a wide sum to 32 bits without losing carries
+static inline uint32_t csumFold64(uint64_t acc) {
+    acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+    acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+    return (uint32_t)acc;
+}
+
+static inline uint32_t csumLoad32(const uint8_t* p) {
+    uint32_t word;
+    memcpy(&word, p, 4);
+    return word;
+}
+
+// ============================================================================
+// Sums
+// ============================================================================
+
+uint32_t csumPartial(const uint8_t* data, uint16_t length, uint32_t sum) {
+    uint64_t acc = sum;
+
+    // Sixteen bytes per pass, then what is left a word at a time
+    while (length >= 16) {
+        acc += csumLoad32(data);
+        acc += csumLoad32(data + 4);
+        acc += csumLoad32(data + 8);
+        acc += csumLoad32(data + 12);
+        data += 16;
+        length -= 16;
+    }
+    while (length >= 4) {
+        acc += csumLoad32(data);
+        data += 4;
+        length -= 4;
+    }
+    if (length >= 2) {
+        uint16_t half;
+        memcpy(&half, data, 2);
+        acc += half;
+        data += 2;
+        length -= 2;
+    }
+
+    // Odd byte - the high half of a network-order word, padded with zero
+    if (length) {
+        uint8_t last[2] = {data[0], 0};
+        uint16_t half;
+        memcpy(&half, last, 2);
+        acc += half;
+    }
+
+    return csumFold64(acc);
+}
+
+uint32_t csumCopy(uint8_t* dst, const uint8_t* src, uint16_t length) {
+    uint64_t acc = 0;
+
+    while (length >= 4) {
+        uint32_t word = csumLoad32(src);
+        memcpy(dst, &word, 4);
+        acc += word;
+        src += 4;
+        dst += 4;
+        length -= 4;
+    }
+    memcpy(dst, src, length);
+
+    return csumPartial(src, length, csumFold64(acc));
+}
+
+uint32_t csumAddAt(uint32_t sum, uint32_t piece, uint16_t offset) {
+    if (offset & 1) {
+        // Every byte of the piece sits in the other half of its word
+        piece = (piece & 0xFFFF) + (piece >> 16);
+        piece = (piece & 0xFFFF) + (piece >> 16);
+        piece = ((piece & 0xFF) << 8) | (piece >> 8);
+    }
+    return csumFold64((uint64_t)sum + piece);
+}
+
+uint32_t csumPseudo(uint32_t srcAddr, uint32_t dstAddr, uint8_t protocol,
+                    uint16_t length) {
+    // Zero, protocol, then the length - as they would sit in memory
+    uint8_t tail[4] = {0, protocol, (uint8_t)(length >> 8), (uint8_t)(length & 0xFF)};
+    uint64_t acc = (uint64_t)srcAddr + dstAddr;
+    acc += csumLoad32(tail);
+    return csumFold64(acc);
+}
+
+uint16_t csumFold(uint32_t sum) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return ~sum & 0xFFFF;
+}
+
+// ============================================================================
+// Incremental Update (RFC 1624)
+// ============================================================================
+// HC' = ~(~HC + ~m + m') - eqn. 3, which never yields the -0 of eqn. 2
+
+uint16_t csumReplace16(uint16_t check, uint16_t oldValue, uint16_t newValue) {
+    uint32_t sum = (uint16_t)~check;
+    sum += (uint16_t)~oldValue;
+    sum += newValue;
+    return csumFold(sum);
+}
+
+uint16_t csumReplace32(uint16_t check, uint32_t oldValue, uint32_t newValue) {
+    uint32_t sum = (uint16_t)~check;
+    sum += (~oldValue & 0xFFFF) + (~oldValue >> 16);
+    sum += (newValue & 0xFFFF) + (newValue >> 16);
+    return csumFold(sum);
+}
@@ -0,0 +1,629 @@
+// ============================================================================
+// DNS Forwarder Implementation
+// ============================================================================
+// The client's queries to the gateway IP arrive through natProcessUdp. A hit
+// is answered from the cache with the client's ID and the TTLs counted down
+// by the time it has been held; a miss goes upstream from a udp_pcb of its
+// own on a random port, and the poll loop answers everyone who asked once
+// the reply is back. A spoofed answer has to guess the port and the ID.
+// ============================================================================
+
+#include "dns_forward.h"
+#include "nat.h"
+#include "serial_io.h"
+#include <ctype.h>
+
+extern "C" {
+#include "lwip/udp.h"
+#include "lwip/ip_addr.h"
+}
+
+// ============================================================================
+// Debug output (controlled by usbDebug setting)
+// ============================================================================
+
+extern bool usbDebug;
+
+#define DNS_DEBUG_F(fmt, ...) if (usbDebug) { UsbDebugPrint(""); Serial.printf(fmt "\r\n", ##__VA_ARGS__); }
+
+#define DNS_TYPE_SOA        6
+#define DNS_TYPE_OPT        41
+#define DNS_RCODE_NXDOMAIN  3
+
+// ============================================================================
+// Upstream Transport (lwIP raw API)
+// ============================================================================
+// The callback only queues the reply's pbuf; dnsFwdPoll takes it from there.
+
+struct DnsFwdCall {
+    DnsForwarder* fwd;
+    DnsPending* pending;
+    uint32_t server;            // Network byte order
+    struct pbuf* p;
+    err_t err;
+};
+
+static void dnsFwdRecvCallback(void* arg, struct udp_pcb* pcb, struct pbuf* p,
+                               const ip_addr_t* addr, u16_t port) {
+    DnsForwarder* fwd = (DnsForwarder*)arg;
+    uint8_t head = fwd->replyHead;
+    uint8_t next = (head + 1) % DNS_REPLY_QUEUE;
+    if (next == fwd->replyTail) {
+        fwd->replyDropped++;
+        pbuf_free(p);
+        return;
+    }
+    fwd->replies[head].p = p;
+    fwd->replies[head].pcb = pcb;
+    fwd->replyHead = next;  // After the slot is filled
+}
+
+// lwIP hands out its ephemeral ports in sequence, so pick one at random -
+// a few tries, in case the first ones are taken
+static err_t dnsFwdBindRandom(struct udp_pcb* pcb) {
+    for (int tries = 0; tries < 4; tries++) {
+        uint16_t port = DNS_PORT_RANDOM_MIN +
+                        esp_random() % (65536 - DNS_PORT_RANDOM_MIN);
+        if (udp_bind(pcb, IP4_ADDR_ANY, port) == ERR_OK) {
+            return ERR_OK;
+        }
+    }
+    return ERR_USE;
+}
+
+static void dnsFwdOpenFn(void* arg) {
+    DnsFwdCall* call = (DnsFwdCall*)arg;
+    struct udp_pcb* pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb) {
+        return;
+    }
+    ip_addr_t addr = IPADDR4_INIT(call->server);
+    if (dnsFwdBindRandom(pcb) != ERR_OK ||
+        udp_connect(pcb, &addr, DNS_PORT) != ERR_OK) {
+        udp_remove(pcb);
+        return;
+    }
+    udp_recv(pcb, dnsFwdRecvCallback, call->fwd);
+    call->pending->pcb = pcb;
+}
+
+static void dnsFwdCloseFn(void* arg) {
+    DnsFwdCall* call = (DnsFwdCall*)arg;
+    udp_remove(call->pending->pcb);
+    call->pending->pcb = nullptr;
+}
+
+static void dnsFwdSendFn(void* arg) {
+    DnsFwdCall* call = (DnsFwdCall*)arg;
+    call->err = udp_send(call->pending->pcb, call->p);
+}
+
+// A lookup is over - answered, timed out or never sent
+static void dnsFwdFinish(DnsForwarder* fwd, DnsPending* pending) {
+    if (pending->pcb) {
+        DnsFwdCall call = {};
+        call.fwd = fwd;
+        call.pending = pending;
+        natLwipExec(dnsFwdCloseFn, &call);
+    }
+    pending->active = false;
+}
+
+// ============================================================================
+// Message Parsing
+// ============================================================================
+
+static uint16_t dnsGet16(const uint8_t* p) {
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static uint32_t dnsGet32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void dnsPut16(uint8_t* p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value & 0xFF;
+}
+
+static void dnsPut32(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = (value >> 16) & 0xFF;
+    p[2] = (value >> 8) & 0xFF;
+    p[3] = value & 0xFF;
+}
+
+// Copy a message's one question as the cache key, with the name lowercased.
+// Returns the offset just past the question, or 0 when the message is not a
+// standard query with exactly one question that fits a key
+static uint16_t dnsReadQuestion(const uint8_t* msg, uint16_t length,
+                                uint8_t* key, uint8_t* keyLen) {
+    if (length < DNS_HEADER_LEN || ((msg[2] >> 3) & 0x0F) != 0 ||
+        dnsGet16(msg + 4) != 1) {
+        return 0;
+    }
+
+    uint16_t pos = DNS_HEADER_LEN;
+    uint8_t n = 0;
+    while (true) {
+        if (pos >= length) {
+            return 0;
+        }
+        uint8_t label = msg[pos++];
+        // The question comes first, so its name is never compressed
+        if ((label & 0xC0) || pos + label > length ||
+            n + 1 + label + 4 > DNS_QUESTION_MAX) {
+            return 0;
+        }
+        key[n++] = label;
+        if (label == 0) {
+            break;
+        }
+        for (uint8_t i = 0; i < label; i++) {
+            key[n++] = tolower(msg[pos++]);
+        }
+    }
+
+    // Type and class
+    if (pos + 4 > length) {
+        return 0;
+    }
+    memcpy(&key[n], &msg[pos], 4);
+    *keyLen = n + 4;
+    return pos + 4;
+}
+
+// Step over the resource record at *pos, noting where its fixed fields
+// (type, class, TTL, rdlength) and its rdata start. False if it overruns
+static bool dnsNextRecord(const uint8_t* msg, uint16_t length, uint16_t* pos,
+                          uint16_t* fixed, uint16_t* rdLen) {
+    uint16_t p = *pos;
+    while (true) {
+        if (p >= length) {
+            return false;
+        }
+        uint8_t label = msg[p];
+        if (label == 0) {
+            p++;
+            break;
+        }
+        if ((label & 0xC0) == 0xC0) {
+            p += 2;     // Compression pointer ends the name
+            break;
+        }
+        if (label & 0xC0) {
+            return false;
+        }
+        p += label + 1;
+    }
+
+    if (p + 10 > length) {
+        return false;
+    }
+    *fixed = p;
+    *rdLen = dnsGet16(&msg[p + 8]);
+    if (p + 10 + *rdLen > length) {
+        return false;
+    }
+    *pos = p + 10 + *rdLen;
+    return true;
+}
+
+// How long a response may be cached, in seconds (0 = not at all). An answer
+// lives for its lowest TTL; NXDOMAIN and NODATA for the lower of the SOA's
+// TTL and its MINIMUM field (RFC 2308), and not at all without an SOA.
+// Truncated and failed responses are never cached
+static uint32_t dnsCacheTtl(const uint8_t* msg, uint16_t length, uint16_t pos,
+                            bool* negative) {
+    uint8_t rcode = msg[3] & 0x0F;
+    if ((msg[2] & 0x02) || (rcode != 0 && rcode != DNS_RCODE_NXDOMAIN)) {
+        return 0;
+    }
+
+    uint16_t answers = dnsGet16(&msg[6]);
+    uint16_t authority = dnsGet16(&msg[8]);
+    *negative = (rcode == DNS_RCODE_NXDOMAIN || answers == 0);
+
+    uint16_t fixed, rdLen;
+    uint32_t ttl = DNS_TTL_MAX_S;
+    for (uint16_t i = 0; i < answers; i++) {
+        if (!dnsNextRecord(msg, length, &pos, &fixed, &rdLen)) {
+            return 0;
+        }
+        ttl = min(ttl, dnsGet32(&msg[fixed + 4]));
+    }
+    if (!*negative) {
+        return ttl;
+    }
+
+    for (uint16_t i = 0; i < authority; i++) {
+        if (!dnsNextRecord(msg, length, &pos, &fixed, &rdLen)) {
+            return 0;
+        }
+        if (dnsGet16(&msg[fixed]) == DNS_TYPE_SOA && rdLen >= 22) {
+            uint32_t soaTtl = dnsGet32(&msg[fixed + 4]);
+            uint32_t minimum = dnsGet32(&msg[fixed + 10 + rdLen - 4]);
+            return min(min(soaTtl, minimum), (uint32_t)DNS_NEGATIVE_TTL_MAX_S);
+        }
+    }
+    return 0;
+}
+
+// Count every record's TTL down by age seconds (the OPT pseudo-record's
+// TTL field holds flags, so it is left alone)
+static void dnsAgeTtls(uint8_t* msg, uint16_t length, uint16_t pos, uint32_t age) {
+    uint16_t records = dnsGet16(&msg[6]) + dnsGet16(&msg[8]) + dnsGet16(&msg[10]);
+    uint16_t fixed, rdLen;
+    for (uint16_t i = 0; i < records; i++) {
+        if (!dnsNextRecord(msg, length, &pos, &fixed, &rdLen)) {
+            return;
+        }
+        if (dnsGet16(&msg[fixed]) != DNS_TYPE_OPT) {
+            uint32_t ttl = dnsGet32(&msg[fixed + 4]);
+            dnsPut32(&msg[fixed + 4], (ttl > age) ? ttl - age : 0);
+        }
+    }
+}
+
+// ============================================================================
+// Cache
+// ============================================================================
+// A handful of entries found by scanning, each holding its response on the
+// heap. The byte budget and the slot count are both enforced by dropping
+// expired entries first, then the least recently used.
+
+static void dnsCacheFree(DnsForwarder* fwd, DnsCacheEntry* entry) {
+    free(entry->response);
+    fwd->cacheBytes -= entry->responseLen;
+    entry->response = nullptr;
+    entry->responseLen = 0;
+    entry->questionLen = 0;
+}
+
+static bool dnsCacheExpired(DnsCacheEntry* entry, unsigned long now) {
+    return now - entry->stored >= entry->ttl * 1000UL;
+}
+
+static DnsCacheEntry* dnsCacheFind(DnsForwarder* fwd, const uint8_t* key,
+                                   uint8_t keyLen) {
+    unsigned long now = millis();
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        DnsCacheEntry* entry = &fwd->cache[i];
+        if (entry->questionLen != keyLen || memcmp(entry->question, key, keyLen) != 0) {
+            continue;
+        }
+        if (dnsCacheExpired(entry, now)) {
+            dnsCacheFree(fwd, entry);
+            return nullptr;
+        }
+        return entry;
+    }
+    return nullptr;
+}
+
+static void dnsCacheStore(DnsForwarder* fwd, const uint8_t* key, uint8_t keyLen,
+                          const uint8_t* msg, uint16_t length, uint32_t ttl,
+                          bool negative) {
+    unsigned long now = millis();
+
+    // Drop an older copy of this answer and anything expired
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        DnsCacheEntry* entry = &fwd->cache[i];
+        if (entry->questionLen > 0 &&
+            ((entry->questionLen == keyLen && memcmp(entry->question, key, keyLen) == 0) ||
+             dnsCacheExpired(entry, now))) {
+            dnsCacheFree(fwd, entry);
+        }
+    }
+
+    // Evict least recently used until there is a slot and the bytes fit
+    DnsCacheEntry* slot;
+    while (true) {
+        DnsCacheEntry* oldest = nullptr;
+        slot = nullptr;
+        for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+            DnsCacheEntry* entry = &fwd->cache[i];
+            if (entry->questionLen == 0) {
+                if (!slot) slot = entry;
+            } else if (!oldest || now - entry->lastUsed > now - oldest->lastUsed) {
+                oldest = entry;
+            }
+        }
+        if (slot && fwd->cacheBytes + length <= DNS_CACHE_BYTES) {
+            break;
+        }
+        if (!oldest) {
+            return;
+        }
+        dnsCacheFree(fwd, oldest);
+    }
+
+    uint8_t* copy = (uint8_t*)malloc(length);
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, msg, length);
+    memcpy(slot->question, key, keyLen);
+    slot->questionLen = keyLen;
+    slot->negative = negative;
+    slot->response = copy;
+    slot->responseLen = length;
+    slot->ttl = ttl;
+    slot->stored = now;
+    slot->lastUsed = now;
+    fwd->cacheBytes += length;
+}
+
+// ============================================================================
+// Initialize / Shutdown
+// ============================================================================
+
+void dnsFwdInit(DnsForwarder* fwd) {
+    memset(fwd, 0, sizeof(*fwd));
+}
+
+void dnsFwdShutdown(DnsForwarder* fwd) {
+    for (int i = 0; i < DNS_PENDING_MAX; i++) {
+        dnsFwdFinish(fwd, &fwd->pending[i]);
+    }
+    while (fwd->replyTail != fwd->replyHead) {
+        pbuf_free(fwd->replies[fwd->replyTail].p);
+        fwd->replyTail = (fwd->replyTail + 1) % DNS_REPLY_QUEUE;
+    }
+
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (fwd->cache[i].questionLen > 0) {
+            dnsCacheFree(fwd, &fwd->cache[i]);
+        }
+    }
+}
+
+// ============================================================================
+// Client Queries
+// ============================================================================
+
+// Send one response to a client, under its own query ID
+static void dnsFwdReply(NatContext* ctx, uint8_t* msg, uint16_t length,
+                        const DnsWaiter& waiter) {
+    dnsPut16(msg, waiter.id);
+    natSendUdpReply(ctx, ctx->gatewayIP, DNS_PORT, IPAddress(waiter.addr), waiter.port,
+                    msg, length);
+}
+
+// Forward the query upstream under a fresh ID, from a fresh port
+static bool dnsFwdSendUpstream(DnsForwarder* fwd, NatContext* ctx,
+                               DnsPending* pending, const uint8_t* msg,
+                               uint16_t length) {
+    DnsFwdCall call = {};
+    call.fwd = fwd;
+    call.pending = pending;
+    call.server = (uint32_t)ctx->dnsServer;
+    natLwipExec(dnsFwdOpenFn, &call);
+    if (!pending->pcb) {
+        return false;
+    }
+
+    call.p = pbuf_alloc(PBUF_TRANSPORT, length, PBUF_RAM);
+    if (!call.p) {
+        return false;
+    }
+    memcpy(call.p->payload, msg, length);
+    dnsPut16((uint8_t*)call.p->payload, pending->upstreamId);
+    natLwipExec(dnsFwdSendFn, &call);
+    pbuf_free(call.p);
+    return call.err == ERR_OK;
+}
+
+// A query ID an off-path spoofer can't predict, not shared with another
+// lookup still upstream
+static uint16_t dnsFwdNewId(DnsForwarder* fwd) {
+    while (true) {
+        uint16_t id = esp_random() & 0xFFFF;
+        bool inUse = false;
+        for (int i = 0; i < DNS_PENDING_MAX; i++) {
+            if (fwd->pending[i].active && fwd->pending[i].upstreamId == id) {
+                inUse = true;
+                break;
+            }
+        }
+        if (!inUse) {
+            return id;
+        }
+    }
+}
+
+void dnsFwdQuery(DnsForwarder* fwd, NatContext* ctx, IPAddress clientIP,
+                 uint16_t clientPort, const uint8_t* msg, uint16_t length) {
+    // Only queries - a response sent to the gateway is nothing we asked for
+    if (length < DNS_HEADER_LEN || length > DNS_MESSAGE_MAX || (msg[2] & 0x80)) {
+        fwd->dropped++;
+        return;
+    }
+    fwd->queries++;
+
+    DnsWaiter waiter;
+    waiter.addr = (uint32_t)clientIP;
+    waiter.port = clientPort;
+    waiter.id = dnsGet16(msg);
+
+    uint8_t key[DNS_QUESTION_MAX];
+    uint8_t keyLen = 0;
+    bool cacheable = dnsReadQuestion(msg, length, key, &keyLen) != 0;
+
+    if (cacheable) {
+        DnsCacheEntry* entry = dnsCacheFind(fwd, key, keyLen);
+        if (entry) {
+            uint8_t* reply = fwd->buffer;
+            memcpy(reply, entry->response, entry->responseLen);
+            uint16_t pos = dnsReadQuestion(reply, entry->responseLen, key, &keyLen);
+            dnsAgeTtls(reply, entry->responseLen, pos,
+                       (millis() - entry->stored) / 1000);
+            entry->lastUsed = millis();
+            dnsFwdReply(ctx, reply, entry->responseLen, waiter);
+            fwd->hits++;
+            if (entry->negative) {
+                fwd->negativeHits++;
+            }
+            return;
+        }
+
+        // Same question already upstream - wait for that answer
+        for (int i = 0; i < DNS_PENDING_MAX; i++) {
+            DnsPending* pending = &fwd->pending[i];
+            if (!pending->active || !pending->cacheable ||
+                pending->questionLen != keyLen ||
+                memcmp(pending->question, key, keyLen) != 0) {
+                continue;
+            }
+            for (uint8_t w = 0; w < pending->waiterCount; w++) {
+                DnsWaiter& other = pending->waiters[w];
+                if (other.id == waiter.id && other.port == waiter.port &&
+                    other.addr == waiter.addr) {
+                    // The client's own retry - one answer will do
+                    fwd->coalesced++;
+                    return;
+                }
+            }
+            if (pending->waiterCount == DNS_WAITERS_MAX) {
+                fwd->dropped++;
+                return;
+            }
+            pending->waiters[pending->waiterCount++] = waiter;
+            fwd->coalesced++;
+            return;
+        }
+    }
+
+    DnsPending* pending = nullptr;
+    for (int i = 0; i < DNS_PENDING_MAX; i++) {
+        if (!fwd->pending[i].active) {
+            pending = &fwd->pending[i];
+            break;
+        }
+    }
+    if (!pending) {
+        // The client will retry once a lookup finishes
+        fwd->dropped++;
+        return;
+    }
+
+    pending->cacheable = cacheable;
+    memcpy(pending->question, key, keyLen);
+    pending->questionLen = keyLen;
+    pending->upstreamId = dnsFwdNewId(fwd);
+    pending->sent = millis();
+    pending->waiterCount = 1;
+    pending->waiters[0] = waiter;
+
+    if (!dnsFwdSendUpstream(fwd, ctx, pending, msg, length)) {
+        dnsFwdFinish(fwd, pending);
+        fwd->dropped++;
+        return;
+    }
+    pending->active = true;
+    fwd->misses++;
+    DNS_DEBUG_F("DNS: Miss, forwarded as ID %04X", pending->upstreamId);
+}
+
+// ============================================================================
+// Upstream Replies
+// ============================================================================
+
+static void dnsFwdAnswer(DnsForwarder* fwd, NatContext* ctx, struct udp_pcb* pcb,
+                         uint8_t* msg, uint16_t length, int* sent) {
+    uint16_t id = dnsGet16(msg);
+    DnsPending* pending = nullptr;
+    for (int i = 0; i < DNS_PENDING_MAX; i++) {
+        if (fwd->pending[i].active && fwd->pending[i].upstreamId == id &&
+            fwd->pending[i].pcb == pcb) {
+            pending = &fwd->pending[i];
+            break;
+        }
+    }
+    if (!pending) {
+        DNS_DEBUG_F("DNS: Reply ID %04X matches no lookup", id);
+        return;
+    }
+
+    if (pending->cacheable) {
+        // The reply must be for the question we asked
+        uint8_t key[DNS_QUESTION_MAX];
+        uint8_t keyLen = 0;
+        uint16_t pos = dnsReadQuestion(msg, length, key, &keyLen);
+        if (pos == 0 || keyLen != pending->questionLen ||
+            memcmp(key, pending->question, keyLen) != 0) {
+            DNS_DEBUG_F("DNS: Reply ID %04X is for another question", id);
+            return;
+        }
+
+        bool negative = false;
+        uint32_t ttl = dnsCacheTtl(msg, length, pos, &negative);
+        if (ttl > 0) {
+            dnsCacheStore(fwd, key, keyLen, msg, length, ttl, negative);
+        }
+    }
+
+    for (uint8_t w = 0; w < pending->waiterCount; w++) {
+        dnsFwdReply(ctx, msg, length, pending->waiters[w]);
+        (*sent)++;
+    }
+    dnsFwdFinish(fwd, pending);
+}
+
+int dnsFwdPoll(DnsForwarder* fwd, NatContext* ctx) {
+    int sent = 0;
+
+    while (fwd->replyTail != fwd->replyHead) {
+        uint8_t tail = fwd->replyTail;
+        struct pbuf* p = fwd->replies[tail].p;
+
+        if (p->tot_len >= DNS_HEADER_LEN && p->tot_len <= DNS_MESSAGE_MAX) {
+            uint16_t length = pbuf_copy_partial(p, fwd->buffer, p->tot_len, 0);
+            dnsFwdAnswer(fwd, ctx, fwd->replies[tail].pcb, fwd->buffer, length, &sent);
+        }
+
+        pbuf_free(p);
+        fwd->replyTail = (tail + 1) % DNS_REPLY_QUEUE;
+    }
+
+    // Lookups upstream never answered - the clients' own retries start over
+    unsigned long now = millis();
+    for (int i = 0; i < DNS_PENDING_MAX; i++) {
+        DnsPending* pending = &fwd->pending[i];
+        if (pending->active && now - pending->sent > DNS_QUERY_TIMEOUT_MS) {
+            DNS_DEBUG_F("DNS: Lookup ID %04X timed out", pending->upstreamId);
+            dnsFwdFinish(fwd, pending);
+            fwd->timeouts++;
+        }
+    }
+
+    return sent;
+}
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+int dnsFwdCacheCount(DnsForwarder* fwd) {
+    int count = 0;
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (fwd->cache[i].questionLen > 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+String dnsFwdSummary(DnsForwarder* fwd) {
+    uint32_t rate = fwd->queries ? (fwd->hits * 100) / fwd->queries : 0;
+    String s = String(fwd->hits) + "/" + String(fwd->queries) + " hits (" +
+               String(rate) + "%), " + String(fwd->negativeHits) + " negative, " +
+               String(fwd->coalesced) + " coalesced, " +
+               String(dnsFwdCacheCount(fwd)) + " cached";
+    if (fwd->timeouts > 0 || fwd->dropped > 0 || fwd->replyDropped > 0) {
+        s += ", " + String(fwd->timeouts) + " timeouts, " +
+             String(fwd->dropped + fwd->replyDropped) + " dropped";
+    }
+    return s;
+}
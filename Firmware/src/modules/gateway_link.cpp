@@ -0,0 +1,324 @@
+// ============================================================================
+// Gateway Link Transport Implementation
+// ============================================================================
+// UART or TCP byte stream underneath the SLIP and PPP framers
+// ============================================================================
+
+#include "gateway_link.h"
+#include "globals.h"
+#include "serial_io.h"
+#include "network.h"
+#include <WiFi.h>
+#include <EEPROM.h>
+
+extern bool usbDebug;
+
+GwLinkConfig gwLinkConfig;
+
+// TCP transport state
+static WiFiServer* gwLinkServer = nullptr;
+static WiFiClient gwLinkClient;
+static bool gwLinkClientAttached = false;
+static bool gwLinkClientDropped = false;
+
+// Staging buffers - the framers work a byte at a time, sockets don't
+static uint8_t gwLinkRxBuffer[GW_LINK_BUFFER_SIZE];
+static uint16_t gwLinkRxPos = 0;
+static uint16_t gwLinkRxLen = 0;
+static uint8_t gwLinkTxBuffer[GW_LINK_BUFFER_SIZE];
+static uint16_t gwLinkTxLen = 0;
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+void loadGwLinkSettings() {
+    // Unprogrammed EEPROM reads 0xFF -> serial on the default port
+    gwLinkConfig.transport = EEPROM.read(GWLINK_TRANSPORT_ADDRESS);
+    if (gwLinkConfig.transport != GW_LINK_TCP) {
+        gwLinkConfig.transport = GW_LINK_SERIAL;
+    }
+
+    gwLinkConfig.tcpPort = word(EEPROM.read(GWLINK_PORT_ADDRESS),
+                                EEPROM.read(GWLINK_PORT_ADDRESS + 1));
+    if (gwLinkConfig.tcpPort == 0 || gwLinkConfig.tcpPort == 0xFFFF) {
+        gwLinkConfig.tcpPort = GW_LINK_DEFAULT_PORT;
+    }
+}
+
+void saveGwLinkSettings() {
+    EEPROM.write(GWLINK_TRANSPORT_ADDRESS, gwLinkConfig.transport);
+    EEPROM.write(GWLINK_PORT_ADDRESS, highByte(gwLinkConfig.tcpPort));
+    EEPROM.write(GWLINK_PORT_ADDRESS + 1, lowByte(gwLinkConfig.tcpPort));
+    EEPROM.commit();
+}
+
+// ============================================================================
+// Open / Close
+// ============================================================================
+
+static void gwLinkDropClient() {
+    if (gwLinkClientAttached) {
+        gwLinkClient.stop();
+    }
+    gwLinkClientAttached = false;
+    gwLinkRxPos = 0;
+    gwLinkRxLen = 0;
+    gwLinkTxLen = 0;
+}
+
+void gwLinkBegin() {
+    loadGwLinkSettings();
+    gwLinkDropClient();
+    gwLinkClientDropped = false;
+
+    if (gwLinkConfig.transport == GW_LINK_TCP && !gwLinkServer) {
+        gwLinkServer = new WiFiServer(gwLinkConfig.tcpPort);
+        gwLinkServer->begin();
+        gwLinkServer->setNoDelay(true);
+    }
+}
+
+void gwLinkEnd() {
+    gwLinkDropClient();
+    if (gwLinkServer) {
+        gwLinkServer->stop();
+        delete gwLinkServer;
+        gwLinkServer = nullptr;
+    }
+}
+
+// ============================================================================
+// Link state
+// ============================================================================
+
+bool gwLinkIsTcp() {
+    return gwLinkServer != nullptr;
+}
+
+bool gwLinkConnected() {
+    return !gwLinkServer || gwLinkClientAttached;
+}
+
+bool gwLinkAccept() {
+    if (!gwLinkServer || !gwLinkServer->hasClient()) {
+        return false;
+    }
+
+    WiFiClient incoming = gwLinkServer->available();
+    if (gwLinkClientAttached && gwLinkClient.connected()) {
+        // One link at a time - turn the newcomer away
+        incoming.stop();
+        return false;
+    }
+
+    gwLinkDropClient();
+    gwLinkClient = incoming;
+    gwLinkClient.setNoDelay(true);
+    gwLinkClientAttached = true;
+    gwLinkClientDropped = false;
+
+    if (usbDebug) {
+        UsbDebugPrint("");
+        Serial.printf("LINK: TCP client %s attached\r\n", gwLinkClient.remoteIP().toString().c_str());
+    }
+    return true;
+}
+
+bool gwLinkDropped() {
+    if (gwLinkClientAttached && !gwLinkClient.connected() && gwLinkRxPos >= gwLinkRxLen &&
+        !gwLinkClient.available()) {
+        gwLinkDropClient();
+        gwLinkClientDropped = true;
+    }
+
+    if (gwLinkClientDropped) {
+        gwLinkClientDropped = false;
+        return true;
+    }
+    return false;
+}
+
+// ============================================================================
+// Receive
+// ============================================================================
+
+int gwLinkAvailable() {
+    if (!gwLinkServer) {
+        return PhysicalSerial.available();
+    }
+    if (gwLinkRxPos < gwLinkRxLen) {
+        return gwLinkRxLen - gwLinkRxPos;
+    }
+    if (!gwLinkClientAttached) {
+        return 0;
+    }
+
+    // Refill in one socket read instead of one call per byte
+    int n = gwLinkClient.read(gwLinkRxBuffer, sizeof(gwLinkRxBuffer));
+    if (n <= 0) {
+        return 0;
+    }
+    gwLinkRxPos = 0;
+    gwLinkRxLen = n;
+    return n;
+}
+
+int gwLinkRead() {
+    if (!gwLinkServer) {
+        return PhysicalSerial.read();
+    }
+    if (gwLinkRxPos >= gwLinkRxLen && gwLinkAvailable() == 0) {
+        return -1;
+    }
+    return gwLinkRxBuffer[gwLinkRxPos++];
+}
+
+int gwLinkReadBytes(uint8_t* buffer, int maxLen) {
+    if (!gwLinkServer) {
+        int n = PhysicalSerial.available();
+        if (n > maxLen) {
+            n = maxLen;
+        }
+        return (n > 0) ? PhysicalSerial.read(buffer, n) : 0;
+    }
+
+    int n = gwLinkAvailable();
+    if (n > maxLen) {
+        n = maxLen;
+    }
+    if (n > 0) {
+        memcpy(buffer, &gwLinkRxBuffer[gwLinkRxPos], n);
+        gwLinkRxPos += n;
+    }
+    return n;
+}
+
+// ============================================================================
+// Transmit
+// ============================================================================
+
+void gwLinkWrite(uint8_t byte) {
+    if (!gwLinkServer) {
+        PhysicalSerial.write(byte);
+        return;
+    }
+    if (gwLinkTxLen >= sizeof(gwLinkTxBuffer)) {
+        gwLinkPush();
+    }
+    gwLinkTxBuffer[gwLinkTxLen++] = byte;
+}
+
+void gwLinkWriteBytes(const uint8_t* data, uint16_t length) {
+    if (!gwLinkServer) {
+        PhysicalSerial.write(data, length);
+        return;
+    }
+    if (gwLinkTxLen + length > sizeof(gwLinkTxBuffer)) {
+        gwLinkPush();
+    }
+    if (length >= sizeof(gwLinkTxBuffer)) {
+        // Too big to stage - straight to the socket
+        if (gwLinkClientAttached && gwLinkClient.connected()) {
+            gwLinkClient.write(data, length);
+        }
+        return;
+    }
+    memcpy(&gwLinkTxBuffer[gwLinkTxLen], data, length);
+    gwLinkTxLen += length;
+}
+
+void gwLinkPush() {
+    if (!gwLinkServer || gwLinkTxLen == 0) {
+        return;
+    }
+    if (gwLinkClientAttached && gwLinkClient.connected()) {
+        gwLinkClient.write(gwLinkTxBuffer, gwLinkTxLen);
+    }
+    // With no client attached the frame is lost, just as on an unplugged cable
+    gwLinkTxLen = 0;
+}
+
+void gwLinkFlush() {
+    if (!gwLinkServer) {
+        PhysicalSerial.flush();
+        return;
+    }
+    gwLinkPush();
+}
+
+void gwLinkWaitClear() {
+    // Logic matches handleFlowControl(): pause when CTS == pinPolarity
+    if (flowControl != F_HARDWARE || gwLinkServer) {
+        return;
+    }
+    unsigned long startWait = millis();
+    while (readCTS()) {
+        if (millis() - startWait > 1000) {
+            // Timeout after 1 second - don't block forever
+            break;
+        }
+        yield();  // Allow other tasks to run
+    }
+}
+
+// ============================================================================
+// Status
+// ============================================================================
+
+String gwLinkDescription() {
+    if (gwLinkConfig.transport != GW_LINK_TCP) {
+        return "Serial";
+    }
+    String desc = "TCP port " + String(gwLinkConfig.tcpPort);
+    if (gwLinkClientAttached) {
+        desc += " <- " + ipToString(gwLinkClient.remoteIP());
+    }
+    return desc;
+}
+
+// ============================================================================
+// AT Commands
+// ============================================================================
+
+bool handleGwLinkCommand(String& cmd, String& upCmd) {
+    // AT$GWLINK? - Show link transport
+    if (upCmd == "AT$GWLINK?" || upCmd == "AT$GWLINK") {
+        loadGwLinkSettings();
+        SerialPrint("Gateway link: ");
+        SerialPrintLn(gwLinkDescription());
+        return true;
+    }
+
+    // AT$GWLINK=SERIAL | AT$GWLINK=TCP[,port] - Select SLIP/PPP link transport
+    if (upCmd.indexOf("AT$GWLINK=") == 0) {
+        String params = upCmd.substring(10);
+        int comma = params.indexOf(',');
+        String mode = (comma >= 0) ? params.substring(0, comma) : params;
+
+        loadGwLinkSettings();
+        if (mode == "SERIAL" || mode == "0") {
+            gwLinkConfig.transport = GW_LINK_SERIAL;
+        } else if (mode == "TCP" || mode == "1") {
+            gwLinkConfig.transport = GW_LINK_TCP;
+            if (comma >= 0) {
+                // 65535 is what unprogrammed EEPROM reads as, so it can't be stored
+                long port = params.substring(comma + 1).toInt();
+                if (port < 1 || port > 65534) {
+                    SerialPrintLn("Invalid port");
+                    return false;
+                }
+                gwLinkConfig.tcpPort = port;
+            }
+        } else {
+            SerialPrintLn("Usage: AT$GWLINK=SERIAL|TCP[,port]");
+            return false;
+        }
+        saveGwLinkSettings();
+        SerialPrint("Gateway link set to ");
+        SerialPrintLn(gwLinkDescription());
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,309 @@
+// ============================================================================
+// Serial Link Protocol Auto-Detection Implementation
+// ============================================================================
+// A PPP client opens with a flag and an LCP Configure-Request, a SLIP client
+// with END and an IPv4 header - neither byte can start an AT command, so the
+// sniffer only steps in when a line starts with one of them
+// ============================================================================
+
+#include "link_detect.h"
+#include "globals.h"
+#include "serial_io.h"
+#include "network.h"
+#include "ppp.h"
+#include "ppp_mode.h"
+#include "slip.h"
+#include "slip_mode.h"
+#include "gateway_link.h"
+#include <EEPROM.h>
+
+extern bool usbDebug;
+
+LinkDetectStats linkDetectStats;
+
+static bool linkDetectEnabled = true;
+static bool linkDetectLoaded = false;
+
+// Classification in progress
+static bool sniffing = false;
+static uint8_t sniffBuffer[LINK_DETECT_BUFFER_SIZE];
+static uint8_t sniffLen = 0;
+static unsigned long sniffStartUs = 0;
+static unsigned long sniffStartMs = 0;
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+void loadLinkDetectSettings() {
+    // Unprogrammed EEPROM (0xFF) means enabled
+    linkDetectEnabled = (EEPROM.read(AUTODETECT_ADDRESS) != 0);
+    linkDetectLoaded = true;
+}
+
+void saveLinkDetectSettings() {
+    EEPROM.write(AUTODETECT_ADDRESS, linkDetectEnabled ? 1 : 0);
+    EEPROM.commit();
+}
+
+// ============================================================================
+// Classifiers - look at what has arrived so far
+// ============================================================================
+// Each returns the protocol once the evidence is conclusive, UNKNOWN once it
+// cannot be that protocol, or NONE while more bytes are needed.
+
+static uint8_t classifyPpp() {
+    uint8_t decoded[LINK_DETECT_PPP_BYTES + 2];
+    uint8_t n = 0;
+    bool escaped = false;
+
+    for (uint8_t i = 0; i < sniffLen && n < sizeof(decoded); i++) {
+        uint8_t b = sniffBuffer[i];
+        if (b == PPP_FLAG) {
+            if (n > 0) {
+                return LINK_DETECT_UNKNOWN;     // Frame ended too soon
+            }
+            continue;                           // Leading or repeated flags
+        }
+        if (b == PPP_ESCAPE) {
+            escaped = true;
+            continue;
+        }
+        decoded[n++] = escaped ? (b ^ PPP_ESCAPE_XOR) : b;
+        escaped = false;
+    }
+
+    // Address/control may be omitted (ACFC) - both forms end in C0 21 01
+    uint8_t start = 0;
+    if (n >= 1 && decoded[0] == PPP_ADDR) {
+        if (n >= 2 && decoded[1] != PPP_CTRL) {
+            return LINK_DETECT_UNKNOWN;
+        }
+        start = 2;
+    }
+
+    static const uint8_t lcpConfReq[] = { 0xC0, 0x21, 0x01 };
+    for (uint8_t i = 0; i < sizeof(lcpConfReq); i++) {
+        if (start + i >= n) {
+            return LINK_DETECT_NONE;
+        }
+        if (decoded[start + i] != lcpConfReq[i]) {
+            return LINK_DETECT_UNKNOWN;
+        }
+    }
+    return LINK_DETECT_PPP;
+}
+
+static uint8_t classifySlip() {
+    uint8_t header[LINK_DETECT_SLIP_BYTES];
+    uint8_t n = 0;
+    bool escaped = false;
+
+    for (uint8_t i = 0; i < sniffLen && n < sizeof(header); i++) {
+        uint8_t b = sniffBuffer[i];
+        if (b == SLIP_END) {
+            if (n > 0) {
+                return LINK_DETECT_UNKNOWN;
+            }
+            continue;
+        }
+        if (b == SLIP_ESC) {
+            escaped = true;
+            continue;
+        }
+        if (escaped) {
+            b = (b == SLIP_ESC_END) ? SLIP_END : (b == SLIP_ESC_ESC) ? SLIP_ESC : b;
+            escaped = false;
+        }
+        header[n++] = b;
+    }
+
+    // Reject early on the version nibble rather than wait for 20 bytes
+    if (n >= 1 && (header[0] >> 4) != 4) {
+        return LINK_DETECT_UNKNOWN;
+    }
+    if (n < LINK_DETECT_SLIP_BYTES) {
+        return LINK_DETECT_NONE;
+    }
+
+    // A valid IPv4 header checksum rules out line noise
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < LINK_DETECT_SLIP_BYTES; i += 2) {
+        sum += ((uint16_t)header[i] << 8) | header[i + 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    if ((header[0] & 0x0F) < 5 || sum != 0xFFFF) {
+        return LINK_DETECT_UNKNOWN;
+    }
+    return LINK_DETECT_SLIP;
+}
+
+// ============================================================================
+// Record a classification
+// ============================================================================
+
+static void linkDetectFinish(uint8_t result) {
+    uint32_t elapsed = micros() - sniffStartUs;
+
+    linkDetectStats.lastResult = result;
+    linkDetectStats.lastBytes = sniffLen;
+    linkDetectStats.lastClassifyUs = elapsed;
+    if (elapsed > linkDetectStats.maxClassifyUs) {
+        linkDetectStats.maxClassifyUs = elapsed;
+    }
+
+    if (usbDebug) {
+        UsbDebugPrint("");
+        Serial.printf("DETECT: %s after %d bytes, %luus\r\n",
+                      linkDetectResultName(result), sniffLen, (unsigned long)elapsed);
+    }
+
+    sniffing = false;
+}
+
+// ============================================================================
+// Poll
+// ============================================================================
+
+bool linkDetectPoll() {
+    if (!linkDetectLoaded) {
+        loadLinkDetectSettings();
+    }
+
+    if (!sniffing) {
+        // USB console input is read first by SerialRead - leave it alone
+        if (!linkDetectEnabled || Serial.available() || !PhysicalSerial.available()) {
+            return false;
+        }
+
+        int first = PhysicalSerial.peek();
+        if (first != PPP_FLAG && first != SLIP_END) {
+            if (first == 'A' || first == 'a') {
+                linkDetectStats.atDetected++;
+            }
+            return false;
+        }
+
+        // With the gateway link on TCP, the serial port is not a gateway
+        loadGwLinkSettings();
+        if (gwLinkConfig.transport != GW_LINK_SERIAL) {
+            return false;
+        }
+
+        sniffing = true;
+        sniffLen = 0;
+        sniffStartUs = micros();
+        sniffStartMs = millis();
+    }
+
+    uint8_t result = LINK_DETECT_NONE;
+    while (PhysicalSerial.available() && sniffLen < LINK_DETECT_BUFFER_SIZE) {
+        sniffBuffer[sniffLen++] = PhysicalSerial.read();
+        result = (sniffBuffer[0] == PPP_FLAG) ? classifyPpp() : classifySlip();
+        if (result != LINK_DETECT_NONE) {
+            break;
+        }
+    }
+
+    if (result == LINK_DETECT_NONE) {
+        if (sniffLen < LINK_DETECT_BUFFER_SIZE &&
+            millis() - sniffStartMs < LINK_DETECT_TIMEOUT_MS) {
+            return true;                        // Keep listening
+        }
+        result = LINK_DETECT_UNKNOWN;
+    }
+
+    linkDetectFinish(result);
+
+    if (result == LINK_DETECT_UNKNOWN) {
+        linkDetectStats.unknown++;
+        return true;                            // Discard - it was never AT text
+    }
+
+    if (WiFi.status() != WL_CONNECTED) {
+        linkDetectStats.noWifi++;
+        SerialPrintLn("\r\nWiFi not connected");
+        return true;
+    }
+
+    if (result == LINK_DETECT_PPP) {
+        linkDetectStats.pppDetected++;
+        enterPppMode();
+        pppReplayInput(sniffBuffer, sniffLen);
+    } else {
+        linkDetectStats.slipDetected++;
+        enterSlipMode();
+        slipReplayInput(sniffBuffer, sniffLen);
+    }
+    return true;
+}
+
+// ============================================================================
+// Status
+// ============================================================================
+
+const char* linkDetectResultName(uint8_t result) {
+    switch (result) {
+        case LINK_DETECT_AT:      return "AT";
+        case LINK_DETECT_PPP:     return "PPP";
+        case LINK_DETECT_SLIP:    return "SLIP";
+        case LINK_DETECT_UNKNOWN: return "Unknown";
+        default:                  return "None";
+    }
+}
+
+// ============================================================================
+// AT Commands
+// ============================================================================
+
+bool handleLinkDetectCommand(String& cmd, String& upCmd) {
+    // AT$AUTODETECT? - Show setting and classification statistics
+    if (upCmd == "AT$AUTODETECT?" || upCmd == "AT$AUTODETECT") {
+        loadLinkDetectSettings();
+        SerialPrintLn("\r\n=== Link Auto-Detect ===");
+        SerialPrint("Enabled:       ");
+        SerialPrintLn(linkDetectEnabled ? "YES" : "NO");
+        SerialPrint("AT lines:      ");
+        SerialPrintLn(String(linkDetectStats.atDetected));
+        SerialPrint("PPP starts:    ");
+        SerialPrintLn(String(linkDetectStats.pppDetected));
+        SerialPrint("SLIP starts:   ");
+        SerialPrintLn(String(linkDetectStats.slipDetected));
+        SerialPrint("Unrecognized:  ");
+        SerialPrintLn(String(linkDetectStats.unknown));
+        SerialPrint("No WiFi:       ");
+        SerialPrintLn(String(linkDetectStats.noWifi));
+        if (linkDetectStats.lastResult != LINK_DETECT_NONE) {
+            SerialPrint("Last:          ");
+            SerialPrint(linkDetectResultName(linkDetectStats.lastResult));
+            SerialPrint(" in ");
+            SerialPrint(String(linkDetectStats.lastBytes));
+            SerialPrint(" bytes, ");
+            SerialPrint(String(linkDetectStats.lastClassifyUs / 1000.0, 1));
+            SerialPrintLn(" ms");
+            SerialPrint("Slowest:       ");
+            SerialPrint(String(linkDetectStats.maxClassifyUs / 1000.0, 1));
+            SerialPrintLn(" ms");
+        }
+        return true;
+    }
+
+    // AT$AUTODETECT=0|1 - Disable/enable PPP and SLIP detection in command mode
+    if (upCmd.indexOf("AT$AUTODETECT=") == 0) {
+        String value = upCmd.substring(14);
+        if (value != "0" && value != "1") {
+            SerialPrintLn("Usage: AT$AUTODETECT=0|1");
+            return false;
+        }
+        linkDetectEnabled = (value == "1");
+        linkDetectLoaded = true;
+        saveLinkDetectSettings();
+        SerialPrint("Auto-detect ");
+        SerialPrintLn(linkDetectEnabled ? "enabled" : "disabled");
+        return true;
+    }
+
+    return false;
+}
@@ -12,6 +12,8 @@
 #include "playback.h"
 #include "firmware.h"
 #include "slip_mode.h"
+#include "gateway_link.h"
+#include "link_detect.h"
 #include "ppp_mode.h"
 #include "wifi_setup.h"
 #include "diagnostics.h"
@@ -68,7 +70,6 @@ extern String files[];
 
 enum resultCodes_t { R_OK_STAT, R_CONNECT, R_RING, R_NOCARRIER, R_ERROR, R_NONE, R_NODIALTONE, R_BUSY, R_NOANSWER };
 enum dispOrientation_t { D_NORMAL, D_FLIPPED }; // Normal or Flipped
-enum flowControl_t { F_NONE, F_HARDWARE, F_SOFTWARE };
 enum pinPolarity_t { P_INVERTED, P_NORMAL }; // Is LOW (0) or HIGH (1) active?
 
 // Array sizes (since we can't use sizeof on extern arrays)
@@ -1082,6 +1083,16 @@ void command()
     delete hostChr;
   }
 
+  /**** Serial Link Protocol Auto-Detect ****/
+  else if (handleLinkDetectCommand(cmd, upCmd)) {
+    sendResult(R_OK_STAT);
+  }
+
+  /**** Gateway Link Transport (SLIP/PPP over serial or TCP) ****/
+  else if (handleGwLinkCommand(cmd, upCmd)) {
+    sendResult(R_OK_STAT);
+  }
+
   /**** SLIP Gateway Commands ****/
   else if (handleSlipCommand(cmd, upCmd)) {
     // Command was handled by SLIP module
@@ -1927,7 +1938,12 @@ void modemLoop()
   if (cmdMode == true)
   {
     // In command mode - don't exchange with TCP but gather characters to a string
-    if (SerialAvailable())
+    // A line that opens with PPP or SLIP framing goes straight to that gateway
+    if (cmd.length() == 0 && linkDetectPoll())
+    {
+      // Input consumed by the protocol sniffer
+    }
+    else if (SerialAvailable())
     {
       char chr = SerialRead();
 
@@ -0,0 +1,3199 @@
+// ============================================================================
+// NAT Engine Implementation
+// ============================================================================
+// Handles NAT translation between the vintage computer and WiFi, for either
+// gateway - the SLIP or PPP framer is reached through ctx->linkSend
+// ============================================================================
+
+#include "nat.h"
+#include "globals.h"
+#include "serial_io.h"
+#include "gateway_link.h"
+#include "checksum.h"
+#include <EEPROM.h>
+#include <new>
+
+// lwIP includes for raw ICMP socket and raw TCP flows
+extern "C" {
+#include "lwip/raw.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "lwip/ip_addr.h"
+#include "lwip/icmp.h"
+#include "lwip/inet_chksum.h"
+}
+
+// Global context pointer for ICMP callback (lwIP callbacks don't have user data)
+static NatContext* g_icmpNatCtx = nullptr;
+
+// ============================================================================
+// Debug output (controlled by usbDebug setting)
+// ============================================================================
+
+extern bool usbDebug;
+
+#define NAT_DEBUG(msg) if (usbDebug) { UsbDebugPrintLn(msg); }
+#define NAT_DEBUG_F(fmt, ...) if (usbDebug) { UsbDebugPrint(""); Serial.printf(fmt "\r\n", ##__VA_ARGS__); }
+
+// Forward declarations for internal functions
+static void natProcessTcp(NatContext* ctx, uint8_t* packet, uint16_t length,
+                          IpHeader* ip, uint8_t ipHeaderLen);
+static void natProcessUdp(NatContext* ctx, uint8_t* packet, uint16_t length,
+                          IpHeader* ip, uint8_t ipHeaderLen);
+static void natProcessIcmp(NatContext* ctx, uint8_t* packet, uint16_t length,
+                           IpHeader* ip, uint8_t ipHeaderLen);
+static NatTcpEntry* natFindTcpEntry(NatContext* ctx, const NatFlowKey& key);
+static bool natTcpStartConnect(NatTcpEntry* entry);
+static void natTcpCheckConnect(NatContext* ctx, NatTcpEntry* entry);
+static NatTcpEntry* natCreateTcpEntry(NatContext* ctx, IPAddress srcIP,
+                                       uint16_t srcPort, IPAddress dstIP,
+                                       uint16_t dstPort);
+static NatUdpEntry* natFindOrCreateUdp(NatContext* ctx, IPAddress srcIP,
+                                        uint16_t srcPort, IPAddress dstIP,
+                                        uint16_t dstPort);
+static NatUdpEntry* natUdpForwardSession(NatContext* ctx, struct udp_pcb* pcb,
+                                         uint32_t addr, uint16_t port);
+static void natSendTcpToClient(NatContext* ctx, NatTcpEntry* entry,
+                                uint16_t length, uint8_t flags);
+static void natSendTcpSegment(NatContext* ctx, NatTcpEntry* entry, uint32_t seq,
+                              uint16_t length, uint8_t flags);
+static void natTcpProcessAck(NatContext* ctx, NatTcpEntry* entry, uint32_t ack,
+                             uint32_t window, uint16_t payloadLen);
+static bool natTcpClientSending(NatTcpEntry* entry);
+static void natTcpReceive(NatContext* ctx, NatTcpEntry* entry, uint32_t seq,
+                          const uint8_t* payload, uint16_t length);
+static void natTcpReasmClear(NatTcpEntry* entry, int slot);
+static void natSendUdpToClient(NatContext* ctx, NatUdpEntry* entry, struct pbuf* p);
+static void natSendIcmpToClient(NatContext* ctx, NatIcmpEntry* entry,
+                                 uint8_t type, uint8_t code, struct pbuf* p,
+                                 uint16_t offset, uint16_t length);
+static void natSendIcmpError(NatContext* ctx, uint32_t fromAddr, IPAddress toIP,
+                             uint8_t type, uint8_t code, const uint8_t* rest,
+                             const uint8_t* quote, uint16_t quoteLen);
+static void natIcmpTimeExceeded(NatContext* ctx, uint8_t* packet, uint16_t length,
+                                uint8_t ipHeaderLen);
+static u8_t natIcmpRecvCallback(void* arg, struct raw_pcb* pcb,
+                                 struct pbuf* p, const ip_addr_t* addr);
+static void natIcmpQueueFlush();
+
+// ============================================================================
+// Remote TCP Transport (lwIP raw API)
+// ============================================================================
+// A flow's server side is a raw tcp_pcb - no socket, no WiFiClient. lwIP
+// calls back from its own task, so the callbacks only hand over pbufs and
+// raise event bits, and everything that touches a pcb runs in that task
+// through natLwipRun. Server data waits on the flow's send chain until the
+// client ACKs it, but is recved to lwIP up to a read-ahead limit as soon
+// as it is taken, so the server's window doesn't close behind a slow link.
+
+struct NatLwipCall {
+    struct tcpip_api_call_data base;    // First - lwIP hands this back
+    void (*fn)(NatLwipCall* call);
+    NatContext* ctx;
+    NatTcpEntry* entry;
+    NatUdpEntry* udp;
+    const uint8_t* data;
+    struct tcp_pcb* pcb;
+    struct udp_pcb* udpPcb;
+    struct pbuf* p;
+    err_t err;
+    uint32_t addr;                      // Network byte order
+    uint16_t port;
+    uint16_t localPort;
+    uint16_t len;
+    uint8_t ttl;
+};
+
+static err_t natLwipTrampoline(struct tcpip_api_call_data* data) {
+    NatLwipCall* call = (NatLwipCall*)data;
+    call->fn(call);
+    return ERR_OK;
+}
+
+// Run fn in the lwIP task and wait for it to finish
+static void natLwipRun(NatLwipCall* call, void (*fn)(NatLwipCall* call)) {
+    call->fn = fn;
+    tcpip_api_call(natLwipTrampoline, &call->base);
+}
+
+// The same for other modules, which bring their own argument
+struct NatLwipExec {
+    struct tcpip_api_call_data base;    // First - lwIP hands this back
+    void (*fn)(void* arg);
+    void* arg;
+};
+
+static err_t natLwipExecTrampoline(struct tcpip_api_call_data* data) {
+    NatLwipExec* exec = (NatLwipExec*)data;
+    exec->fn(exec->arg);
+    return ERR_OK;
+}
+
+void natLwipExec(void (*fn)(void* arg), void* arg) {
+    NatLwipExec exec = {};
+    exec.fn = fn;
+    exec.arg = arg;
+    tcpip_api_call(natLwipExecTrampoline, &exec.base);
+}
+
+// Callbacks (lwIP task)
+
+static err_t natTcpRecvCallback(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err) {
+    NatTcpEntry* entry = (NatTcpEntry*)arg;
+    if (!p) {
+        entry->upEvents |= NAT_UP_CLOSED;
+        return ERR_OK;
+    }
+    if (entry->rxPending) {
+        pbuf_cat(entry->rxPending, p);
+    } else {
+        entry->rxPending = p;
+    }
+    return ERR_OK;
+}
+
+static void natTcpErrCallback(void* arg, err_t err) {
+    NatTcpEntry* entry = (NatTcpEntry*)arg;
+    entry->pcb = nullptr;  // Already freed by lwIP
+    entry->upEvents |= NAT_UP_ERROR;
+}
+
+static err_t natTcpConnectedCallback(void* arg, struct tcp_pcb* pcb, err_t err) {
+    ((NatTcpEntry*)arg)->upEvents |= NAT_UP_CONNECTED;
+    return ERR_OK;
+}
+
+// A queued accept has no flow yet - refuse its data so lwIP holds it
+static err_t natAcceptRecvCallback(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err) {
+    if (!p) {
+        ((NatAcceptSlot*)arg)->closed = true;
+        return ERR_OK;
+    }
+    return ERR_MEM;
+}
+
+static void natAcceptErrCallback(void* arg, err_t err) {
+    ((NatAcceptSlot*)arg)->pcb = nullptr;
+}
+
+static err_t natTcpAcceptCallback(void* arg, struct tcp_pcb* pcb, err_t err) {
+    NatContext* ctx = (NatContext*)arg;
+    if (err != ERR_OK || !pcb) {
+        return ERR_VAL;
+    }
+
+    uint8_t head = ctx->acceptHead;
+    uint8_t next = (head + 1) % NAT_ACCEPT_QUEUE;
+    if (next == ctx->acceptTail) {
+        tcp_abort(pcb);  // Queue full - the poll loop is behind
+        return ERR_ABRT;
+    }
+
+    NatAcceptSlot* slot = &ctx->acceptQueue[head];
+    slot->pcb = pcb;
+    slot->closed = false;
+    tcp_arg(pcb, slot);
+    tcp_recv(pcb, natAcceptRecvCallback);
+    tcp_err(pcb, natAcceptErrCallback);
+    ctx->acceptHead = next;
+    return ERR_OK;
+}
+
+// Operations (lwIP task, through natLwipRun)
+
+static void natTcpAttach(NatTcpEntry* entry, struct tcp_pcb* pcb) {
+    entry->pcb = pcb;
+    tcp_arg(pcb, entry);
+    tcp_recv(pcb, natTcpRecvCallback);
+    tcp_err(pcb, natTcpErrCallback);
+}
+
+static void natTcpConnectFn(NatLwipCall* call) {
+    struct tcp_pcb* pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb) {
+        return;
+    }
+    natTcpAttach(call->entry, pcb);
+
+    ip_addr_t addr = IPADDR4_INIT(call->addr);
+    if (tcp_connect(pcb, &addr, call->port, natTcpConnectedCallback) != ERR_OK) {
+        tcp_arg(pcb, nullptr);
+        tcp_err(pcb, nullptr);
+        tcp_abort(pcb);
+        call->entry->pcb = nullptr;
+        return;
+    }
+    call->entry->natPort = pcb->local_port;    // Bound by tcp_connect
+}
+
+// Detach and close the pcb - a RST if that fails - and drop undelivered data
+static void natTcpCloseFn(NatLwipCall* call) {
+    NatTcpEntry* entry = call->entry;
+    struct tcp_pcb* pcb = entry->pcb;
+    if (pcb) {
+        tcp_arg(pcb, nullptr);
+        tcp_recv(pcb, nullptr);
+        tcp_err(pcb, nullptr);
+        if (tcp_close(pcb) != ERR_OK) {
+            tcp_abort(pcb);
+        }
+        entry->pcb = nullptr;
+    }
+    if (entry->rxPending) {
+        pbuf_free(entry->rxPending);
+        entry->rxPending = nullptr;
+    }
+}
+
+// Look at the send buffer again - the server's ACKs free it
+static void natTcpRoomFn(NatLwipCall* call) {
+    NatTcpEntry* entry = call->entry;
+    entry->upstreamRoom = entry->pcb ? tcp_sndbuf(entry->pcb) : 0;
+}
+
+// Send our FIN to the server, still taking its data
+static void natTcpShutdownFn(NatLwipCall* call) {
+    if (call->entry->pcb) {
+        tcp_shutdown(call->entry->pcb, 0, 1);
+    }
+}
+
+// Queue as much client data as the server side will take (len: bytes
+// offered, then written), and note the send buffer left
+static void natTcpWriteFn(NatLwipCall* call) {
+    NatTcpEntry* entry = call->entry;
+    uint16_t len = 0;
+    entry->upstreamRoom = 0;
+    if (entry->pcb) {
+        len = min(call->len, (uint16_t)tcp_sndbuf(entry->pcb));
+        if (len > 0 && tcp_write(entry->pcb, call->data, len, TCP_WRITE_FLAG_COPY) == ERR_OK) {
+            tcp_output(entry->pcb);
+        } else {
+            len = 0;
+        }
+        entry->upstreamRoom = tcp_sndbuf(entry->pcb);
+    }
+    call->len = len;
+}
+
+// Move what the recv callback handed over onto the send chain
+static void natTcpTakeFn(NatLwipCall* call) {
+    NatTcpEntry* entry = call->entry;
+    struct pbuf* p = entry->rxPending;
+    entry->rxPending = nullptr;
+    if (!p) {
+        return;
+    }
+    // Read-ahead can hold data for a long while - copy it out of the WiFi
+    // driver's receive buffers, which are few, onto the heap
+    struct pbuf* q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+    if (q) {
+        pbuf_free(p);
+        p = q;
+    }
+    if (entry->sendChain) {
+        pbuf_cat(entry->sendChain, p);
+    } else {
+        entry->sendChain = p;
+    }
+    entry->sendLen = entry->sendChain->tot_len;
+}
+
+// Reopen the server's window by len bytes
+static void natTcpRecvedFn(NatLwipCall* call) {
+    if (call->entry->pcb) {
+        tcp_recved(call->entry->pcb, call->len);
+    }
+}
+
+static void natTcpListenFn(NatLwipCall* call) {
+    call->pcb = nullptr;
+    struct tcp_pcb* pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb) {
+        return;
+    }
+    struct tcp_pcb* listener = nullptr;
+    if (tcp_bind(pcb, IP4_ADDR_ANY, call->port) == ERR_OK) {
+        listener = tcp_listen(pcb);  // Frees pcb on success
+    }
+    if (!listener) {
+        tcp_close(pcb);
+        return;
+    }
+    tcp_arg(listener, call->ctx);
+    tcp_accept(listener, natTcpAcceptCallback);
+    call->pcb = listener;
+}
+
+static void natTcpUnlistenFn(NatLwipCall* call) {
+    tcp_arg(call->pcb, nullptr);
+    tcp_accept(call->pcb, nullptr);
+    tcp_close(call->pcb);
+}
+
+// Look at the oldest queued accept: its pcb (null if it died) and peer
+static void natAcceptPeekFn(NatLwipCall* call) {
+    NatAcceptSlot* slot = &call->ctx->acceptQueue[call->ctx->acceptTail];
+    call->pcb = slot->pcb;
+    if (call->pcb) {
+        call->addr = ip4_addr_get_u32(ip_2_ip4(&call->pcb->remote_ip));
+        call->port = call->pcb->remote_port;
+        call->localPort = call->pcb->local_port;
+    }
+}
+
+// Hand the oldest queued accept to its flow, or reset it (no flow)
+static void natAcceptTakeFn(NatLwipCall* call) {
+    NatAcceptSlot* slot = &call->ctx->acceptQueue[call->ctx->acceptTail];
+    struct tcp_pcb* pcb = slot->pcb;
+    if (call->entry) {
+        if (pcb) {
+            natTcpAttach(call->entry, pcb);
+            call->entry->natPort = pcb->local_port;
+            if (slot->closed) {
+                call->entry->upEvents |= NAT_UP_CLOSED;
+            }
+        } else {
+            call->entry->upEvents |= NAT_UP_ERROR;
+        }
+    } else if (pcb) {
+        tcp_arg(pcb, nullptr);
+        tcp_err(pcb, nullptr);
+        tcp_abort(pcb);
+    }
+    slot->pcb = nullptr;
+    call->ctx->acceptTail = (call->ctx->acceptTail + 1) % NAT_ACCEPT_QUEUE;
+}
+
+static void natTcpShutdownUpstream(NatTcpEntry* entry) {
+    NatLwipCall call = {};
+    call.entry = entry;
+    natLwipRun(&call, natTcpShutdownFn);
+}
+
+// ============================================================================
+// Remote UDP Transport (lwIP raw API)
+// ============================================================================
+// Each session has its own udp_pcb on an lwIP-chosen port, connected to the
+// remote endpoint, so a reply names its session as the callback argument.
+// The callback queues the reply's pbuf; the poll loop drains every queued
+// reply in one pass and copies each straight into the packet for the client.
+// A UDP port forward's pcb is bound to its external port and queues with no
+// session - the poll loop finds or makes one for the sender.
+
+static struct {
+    struct pbuf* p;
+    NatUdpEntry* entry;     // Null: arrived on a port forward
+    struct udp_pcb* pcb;
+    uint8_t generation;     // The session's when queued - it may be gone since
+    uint32_t addr;          // Sender, network byte order
+    uint16_t port;
+} g_udpQueue[NAT_UDP_QUEUE];
+static volatile uint8_t g_udpQueueHead = 0;     // Written by the callback
+static volatile uint8_t g_udpQueueTail = 0;     // Written by the poll loop
+volatile uint32_t g_udpQueueDropped = 0;        // Replies lost to a full queue
+
+static void natUdpRecvCallback(void* arg, struct udp_pcb* pcb, struct pbuf* p,
+                               const ip_addr_t* addr, u16_t port) {
+    uint8_t head = g_udpQueueHead;
+    uint8_t next = (head + 1) % NAT_UDP_QUEUE;
+    if (next == g_udpQueueTail) {
+        g_udpQueueDropped++;
+        pbuf_free(p);
+        return;
+    }
+    g_udpQueue[head].p = p;
+    g_udpQueue[head].entry = (NatUdpEntry*)arg;
+    g_udpQueue[head].pcb = pcb;
+    g_udpQueue[head].generation = arg ? ((NatUdpEntry*)arg)->generation : 0;
+    g_udpQueue[head].addr = ip4_addr_get_u32(ip_2_ip4(addr));
+    g_udpQueue[head].port = port;
+    g_udpQueueHead = next;  // After the slot is filled
+}
+
+static void natUdpOpenFn(NatLwipCall* call) {
+    NatUdpEntry* entry = call->udp;
+    struct udp_pcb* pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb) {
+        return;
+    }
+    ip_addr_t addr = IPADDR4_INIT(entry->key.dstAddr);
+    if (udp_bind(pcb, IP4_ADDR_ANY, 0) != ERR_OK ||
+        udp_connect(pcb, &addr, entry->dstPort) != ERR_OK) {
+        udp_remove(pcb);
+        return;
+    }
+    udp_recv(pcb, natUdpRecvCallback, entry);
+    entry->pcb = pcb;
+    entry->natPort = pcb->local_port;
+    entry->generation++;
+}
+
+static void natUdpCloseFn(NatLwipCall* call) {
+    udp_remove(call->udp->pcb);
+    call->udp->pcb = nullptr;
+}
+
+static void natUdpSendFn(NatLwipCall* call) {
+    NatUdpEntry* entry = call->udp;
+    entry->pcb->ttl = call->ttl;
+    if (entry->forwarded) {
+        ip_addr_t addr = IPADDR4_INIT(entry->key.dstAddr);
+        call->err = udp_sendto(entry->pcb, call->p, &addr, entry->dstPort);
+    } else {
+        call->err = udp_send(entry->pcb, call->p);
+    }
+}
+
+// Bind a port forward's pcb to its external port
+static void natUdpListenFn(NatLwipCall* call) {
+    call->udpPcb = nullptr;
+    struct udp_pcb* pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+    if (!pcb) {
+        return;
+    }
+    if (udp_bind(pcb, IP4_ADDR_ANY, call->port) != ERR_OK) {
+        udp_remove(pcb);
+        return;
+    }
+    udp_recv(pcb, natUdpRecvCallback, nullptr);
+    call->udpPcb = pcb;
+}
+
+static void natUdpUnlistenFn(NatLwipCall* call) {
+    udp_remove(call->udpPcb);
+}
+
+static bool natUdpOpen(NatUdpEntry* entry) {
+    NatLwipCall call = {};
+    call.udp = entry;
+    natLwipRun(&call, natUdpOpenFn);
+    return entry->pcb != nullptr;
+}
+
+// ============================================================================
+// Remote ICMP Transport (lwIP raw API)
+// ============================================================================
+// One raw pcb carries every ping. Replies and errors come back through
+// natIcmpRecvCallback into the ICMP queue.
+
+static void natIcmpOpenFn(NatLwipCall* call) {
+    struct raw_pcb* pcb = raw_new(IP_PROTO_ICMP);
+    if (pcb) {
+        raw_recv(pcb, natIcmpRecvCallback, call->ctx);
+        raw_bind(pcb, IP_ADDR_ANY);
+    }
+    call->ctx->icmpPcb = pcb;
+}
+
+static void natIcmpCloseFn(NatLwipCall* call) {
+    raw_remove((struct raw_pcb*)call->ctx->icmpPcb);
+    call->ctx->icmpPcb = nullptr;
+}
+
+static void natIcmpSendFn(NatLwipCall* call) {
+    struct raw_pcb* pcb = (struct raw_pcb*)call->ctx->icmpPcb;
+    ip_addr_t addr = IPADDR4_INIT(call->addr);
+    pcb->ttl = call->ttl;
+    call->err = raw_sendto(pcb, call->p, &addr);
+}
+
+// ============================================================================
+// Flow Tables
+// ============================================================================
+
+static NatFlowKey natFlowKey(uint32_t srcAddr, uint16_t srcPort,
+                             uint32_t dstAddr, uint16_t dstPort) {
+    NatFlowKey key;
+    key.srcAddr = srcAddr;
+    key.dstAddr = dstAddr;
+    key.srcPort = srcPort;
+    key.dstPort = dstPort;
+    return key;
+}
+
+static bool natFlowKeyEqual(const NatFlowKey& a, const NatFlowKey& b) {
+    return a.srcAddr == b.srcAddr && a.dstAddr == b.dstAddr &&
+           a.srcPort == b.srcPort && a.dstPort == b.dstPort;
+}
+
+// Multiplicative mix - cheap, and spreads sequential ephemeral ports
+static uint32_t natFlowHash(const NatFlowKey& key) {
+    uint32_t h = key.srcAddr * 0x9E3779B1u;
+    h = (h ^ key.dstAddr) * 0x85EBCA6Bu;
+    h = (h ^ (((uint32_t)key.srcPort << 16) | key.dstPort)) * 0xC2B2AE35u;
+    return h ^ (h >> 16);
+}
+
+// Slots a heap budget buys at perFlow bytes each, within bounds
+static uint16_t natFlowTableFit(uint32_t budget, uint32_t perFlow,
+                                uint16_t minSize, uint16_t maxSize) {
+    uint32_t n = budget / perFlow;
+    if (n < minSize) return minSize;
+    if (n > maxSize) return maxSize;
+    return n;
+}
+
+static void natFlowTableFree(NatFlowTable* t) {
+    delete[] t->buckets;
+    delete[] t->next;
+    t->buckets = nullptr;
+    t->next = nullptr;
+    t->size = 0;
+    t->count = 0;
+    t->bucketMask = 0;
+    t->freeHead = NAT_FLOW_NONE;
+}
+
+static bool natFlowTableAlloc(NatFlowTable* t, uint16_t size) {
+    uint16_t buckets = 1;
+    while (buckets < size) {
+        buckets <<= 1;
+    }
+
+    t->buckets = new (std::nothrow) uint16_t[buckets];
+    t->next = new (std::nothrow) uint16_t[size];
+    if (!t->buckets || !t->next) {
+        natFlowTableFree(t);
+        return false;
+    }
+
+    for (uint16_t b = 0; b < buckets; b++) {
+        t->buckets[b] = NAT_FLOW_NONE;
+    }
+    for (uint16_t i = 0; i < size; i++) {
+        t->next[i] = (i + 1 < size) ? i + 1 : NAT_FLOW_NONE;
+    }
+    t->size = size;
+    t->count = 0;
+    t->bucketMask = buckets - 1;
+    t->freeHead = 0;
+    t->evictions = 0;
+    return true;
+}
+
+// Take a slot off the free list and link it into the chain for hash
+static uint16_t natFlowTableInsert(NatFlowTable* t, uint32_t hash) {
+    uint16_t slot = t->freeHead;
+    if (slot == NAT_FLOW_NONE) {
+        return NAT_FLOW_NONE;
+    }
+    t->freeHead = t->next[slot];
+
+    uint16_t* head = &t->buckets[hash & t->bucketMask];
+    t->next[slot] = *head;
+    *head = slot;
+    t->count++;
+    return slot;
+}
+
+// Unlink a slot from the chain for hash and put it back on the free list
+static void natFlowTableRemove(NatFlowTable* t, uint16_t slot, uint32_t hash) {
+    uint16_t* link = &t->buckets[hash & t->bucketMask];
+    while (*link != NAT_FLOW_NONE && *link != slot) {
+        link = &t->next[*link];
+    }
+    if (*link != slot) {
+        return;
+    }
+    *link = t->next[slot];
+    t->next[slot] = t->freeHead;
+    t->freeHead = slot;
+    t->count--;
+}
+
+static uint16_t natFlowTableFirst(const NatFlowTable* t, uint32_t hash) {
+    return t->size ? t->buckets[hash & t->bucketMask] : NAT_FLOW_NONE;
+}
+
+// Size the tables from what the heap can spare right now. A TCP flow costs
+// far more than its slot - its pcb, up to a full lwIP window of server data
+// held until the client ACKs it, and a send buffer of client data (with any
+// segments queued beyond a gap, which our window keeps inside it) held until
+// the server ACKs it - and lwIP caps the pcbs, so TCP gets half the budget
+// and a pcb limit
+static void natAllocTables(NatContext* ctx) {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t budget = (freeHeap > NAT_HEAP_RESERVE) ? freeHeap - NAT_HEAP_RESERVE : 0;
+
+    uint16_t tcpMax = NAT_TCP_FLOWS_MAX;
+    if (MEMP_NUM_TCP_PCB - NAT_RESERVED_PCBS < tcpMax) {
+        tcpMax = max(MEMP_NUM_TCP_PCB - NAT_RESERVED_PCBS, NAT_TCP_FLOWS_MIN);
+    }
+    uint32_t tcpFlowCost = sizeof(NatTcpEntry) + sizeof(struct tcp_pcb) + TCP_WND + TCP_SND_BUF;
+    uint16_t tcpSize = natFlowTableFit(budget / 2, tcpFlowCost,
+                                       NAT_TCP_FLOWS_MIN, tcpMax);
+    uint16_t udpSize = natFlowTableFit(budget / 16, sizeof(NatUdpEntry),
+                                       NAT_UDP_FLOWS_MIN, NAT_UDP_FLOWS_MAX);
+    uint16_t icmpSize = natFlowTableFit(budget / 64, sizeof(NatIcmpEntry),
+                                        NAT_ICMP_FLOWS_MIN, NAT_ICMP_FLOWS_MAX);
+
+    ctx->tcpTable = new (std::nothrow) NatTcpEntry[tcpSize];
+    if (!ctx->tcpTable || !natFlowTableAlloc(&ctx->tcpFlows, tcpSize)) {
+        NAT_DEBUG("NAT: No heap for TCP flow table");
+        tcpSize = 0;
+    }
+    for (uint16_t i = 0; i < tcpSize; i++) {
+        ctx->tcpTable[i].active = false;
+        ctx->tcpTable[i].pcb = nullptr;
+        ctx->tcpTable[i].rxPending = nullptr;
+        ctx->tcpTable[i].sendChain = nullptr;
+        ctx->tcpTable[i].sendLen = 0;
+        ctx->tcpTable[i].readAhead = 0;
+        for (int r = 0; r < NAT_TCP_REASM_SLOTS; r++) {
+            ctx->tcpTable[i].reasmData[r] = nullptr;
+        }
+    }
+
+    ctx->udpTable = new (std::nothrow) NatUdpEntry[udpSize];
+    if (!ctx->udpTable || !natFlowTableAlloc(&ctx->udpFlows, udpSize)) {
+        NAT_DEBUG("NAT: No heap for UDP flow table");
+        udpSize = 0;
+    }
+    for (uint16_t i = 0; i < udpSize; i++) {
+        ctx->udpTable[i].active = false;
+        ctx->udpTable[i].pcb = nullptr;
+        ctx->udpTable[i].forwarded = false;
+        ctx->udpTable[i].generation = 0;
+    }
+
+    ctx->icmpTable = new (std::nothrow) NatIcmpEntry[icmpSize];
+    if (!ctx->icmpTable || !natFlowTableAlloc(&ctx->icmpFlows, icmpSize)) {
+        NAT_DEBUG("NAT: No heap for ICMP flow table");
+        icmpSize = 0;
+    }
+    for (uint16_t i = 0; i < icmpSize; i++) {
+        ctx->icmpTable[i].active = false;
+    }
+
+    NAT_DEBUG_F("NAT: Flow tables TCP %d (%u bytes/flow), UDP %d, ICMP %d (heap %u)",
+                tcpSize, tcpFlowCost, udpSize, icmpSize, freeHeap);
+}
+
+static void natFreeTables(NatContext* ctx) {
+    delete[] ctx->tcpTable;
+    delete[] ctx->udpTable;
+    delete[] ctx->icmpTable;
+    ctx->tcpTable = nullptr;
+    ctx->udpTable = nullptr;
+    ctx->icmpTable = nullptr;
+    natFlowTableFree(&ctx->tcpFlows);
+    natFlowTableFree(&ctx->udpFlows);
+    natFlowTableFree(&ctx->icmpFlows);
+}
+
+// Close a TCP flow and return its slot to the table
+static void natTcpRelease(NatContext* ctx, NatTcpEntry* entry) {
+    if (entry->pcb || entry->rxPending) {
+        NatLwipCall call = {};
+        call.entry = entry;
+        natLwipRun(&call, natTcpCloseFn);
+    }
+    if (entry->sendChain) {
+        pbuf_free(entry->sendChain);
+        entry->sendChain = nullptr;
+    }
+    entry->sendLen = 0;
+    ctx->readAheadBytes -= entry->readAhead;
+    entry->readAhead = 0;
+    for (int i = 0; i < NAT_TCP_REASM_SLOTS; i++) {
+        natTcpReasmClear(entry, i);
+    }
+    if (entry->active) {
+        entry->active = false;
+        natFlowTableRemove(&ctx->tcpFlows, entry - ctx->tcpTable, natFlowHash(entry->key));
+    }
+}
+
+static void natUdpRelease(NatContext* ctx, NatUdpEntry* entry) {
+    if (entry->pcb && !entry->forwarded) {
+        NatLwipCall call = {};
+        call.udp = entry;
+        natLwipRun(&call, natUdpCloseFn);
+    }
+    entry->pcb = nullptr;
+    entry->forwarded = false;
+    if (entry->active) {
+        entry->active = false;
+        natFlowTableRemove(&ctx->udpFlows, entry - ctx->udpTable, natFlowHash(entry->key));
+    }
+}
+
+static void natIcmpRelease(NatContext* ctx, NatIcmpEntry* entry) {
+    if (entry->active) {
+        entry->active = false;
+        natFlowTableRemove(&ctx->icmpFlows, entry - ctx->icmpTable, natFlowHash(entry->key));
+    }
+}
+
+// ============================================================================
+// LRU Eviction (table full)
+// ============================================================================
+// Tables are small, so the least recently used flow is found by scanning
+// lastActivity - this only runs when a new flow finds no free slot.
+
+// A TCP flow may go if it is closing, or has nothing in flight, nothing
+// undelivered from the server and has been quiet for NAT_EVICT_IDLE_MS. The
+// client gets a RST so its stack doesn't wait on a dead connection.
+static bool natTcpEvictIdle(NatContext* ctx) {
+    unsigned long now = millis();
+    NatTcpEntry* victim = nullptr;
+
+    for (uint16_t i = 0; i < ctx->tcpFlows.size; i++) {
+        NatTcpEntry* e = &ctx->tcpTable[i];
+        if (!e->active || e->state == NAT_TCP_SYN_SENT || e->state == NAT_TCP_SYN_PENDING) continue;
+        if (e->state == NAT_TCP_ESTABLISHED || e->state == NAT_TCP_FIN_WAIT) {
+            if (e->serverSeq != e->serverAck) continue;
+            if (now - e->lastActivity < NAT_EVICT_IDLE_MS) continue;
+            if (e->sendLen > 0 || e->rxPending) continue;
+        }
+        if (!victim || now - e->lastActivity > now - victim->lastActivity) {
+            victim = e;
+        }
+    }
+
+    if (!victim) {
+        return false;
+    }
+
+    NAT_DEBUG_F("NAT: Evicting TCP[%d] (idle %lums)",
+                (int)(victim - ctx->tcpTable), now - victim->lastActivity);
+    if (victim->state == NAT_TCP_ESTABLISHED || victim->state == NAT_TCP_FIN_WAIT) {
+        natSendTcpToClient(ctx, victim, 0, TCP_FLAG_RST | TCP_FLAG_ACK);
+    }
+    natTcpRelease(ctx, victim);
+    ctx->tcpFlows.evictions++;
+    return true;
+}
+
+// For a pcb (ownPcb), only a session with a pcb of its own will do -
+// releasing one that shares a port forward's, or has none, frees nothing
+static bool natUdpEvictOldest(NatContext* ctx, bool ownPcb) {
+    unsigned long now = millis();
+    NatUdpEntry* victim = nullptr;
+
+    for (uint16_t i = 0; i < ctx->udpFlows.size; i++) {
+        NatUdpEntry* e = &ctx->udpTable[i];
+        if (!e->active || (ownPcb && (!e->pcb || e->forwarded))) continue;
+        if (!victim || now - e->lastActivity > now - victim->lastActivity) {
+            victim = e;
+        }
+    }
+
+    if (!victim) {
+        return false;
+    }
+    NAT_DEBUG_F("NAT: Evicting UDP[%d]", (int)(victim - ctx->udpTable));
+    natUdpRelease(ctx, victim);
+    ctx->udpFlows.evictions++;
+    return true;
+}
+
+static bool natIcmpEvictOldest(NatContext* ctx) {
+    unsigned long now = millis();
+    NatIcmpEntry* victim = nullptr;
+
+    for (uint16_t i = 0; i < ctx->icmpFlows.size; i++) {
+        NatIcmpEntry* e = &ctx->icmpTable[i];
+        if (e->active && (!victim || now - e->lastActivity > now - victim->lastActivity)) {
+            victim = e;
+        }
+    }
+
+    if (!victim) {
+        return false;
+    }
+    natIcmpRelease(ctx, victim);
+    ctx->icmpFlows.evictions++;
+    return true;
+}
+
+// ============================================================================
+// Initialize NAT Context
+// ============================================================================
+
+void natInit(NatContext* ctx) {
+    // Default subnet (192.168.7.0/24) until the gateway sets its own
+    ctx->gatewayIP = IPAddress(192, 168, 7, 1);
+    ctx->clientIP = IPAddress(192, 168, 7, 2);
+    ctx->subnetMask = IPAddress(255, 255, 255, 0);
+    ctx->dnsServer = IPAddress(8, 8, 8, 8);  // Google DNS
+    ctx->linkSend = nullptr;
+    ctx->link = nullptr;
+    ctx->linkMtu = NAT_LINK_MTU_MAX;
+    ctx->linkMru = NAT_LINK_MTU_MAX;
+
+    // Flow tables - any left from a previous session are stale
+    natFreeTables(ctx);
+    natAllocTables(ctx);
+
+    // Initialize port forwards
+    for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
+        ctx->portForwards[i].active = false;
+        ctx->tcpForwardListeners[i] = nullptr;
+        ctx->udpForwardPcbs[i] = nullptr;
+    }
+    ctx->acceptHead = 0;
+    ctx->acceptTail = 0;
+
+    // DNS forwarder - its cache is only good for one session too
+    if (ctx->dns) {
+        dnsFwdShutdown(ctx->dns);
+    } else {
+        ctx->dns = new (std::nothrow) DnsForwarder;
+    }
+    if (ctx->dns) {
+        dnsFwdInit(ctx->dns);
+    } else {
+        NAT_DEBUG("NAT: No memory for the DNS forwarder");
+    }
+
+    // Create ICMP raw socket for ping NAT
+    NatLwipCall call = {};
+    call.ctx = ctx;
+    natLwipRun(&call, natIcmpOpenFn);
+    if (ctx->icmpPcb) {
+        NAT_DEBUG("NAT: ICMP raw socket created");
+    } else {
+        NAT_DEBUG("NAT: Failed to create ICMP raw socket");
+    }
+
+    // Set global context for ICMP callback
+    g_icmpNatCtx = ctx;
+
+    // Statistics
+    ctx->packetsToInternet = 0;
+    ctx->packetsFromInternet = 0;
+    ctx->droppedPackets = 0;
+    ctx->tcpConnections = 0;
+    ctx->udpSessions = 0;
+    ctx->icmpPackets = 0;
+    ctx->mssClamped = 0;
+    ctx->tcpBytesToClient = 0;
+    ctx->tcpRetransmits = 0;
+    ctx->tcpFastRetransmits = 0;
+    ctx->tcpDupSegments = 0;
+    ctx->tcpOutOfOrder = 0;
+    ctx->tcpWindowUpdates = 0;
+    ctx->icmpErrors = 0;
+    ctx->readAheadBytes = 0;
+    ctx->readAheadPeak = 0;
+}
+
+// ============================================================================
+// Link Adapter and Configuration
+// ============================================================================
+
+void natSetLink(NatContext* ctx, NatLinkSendFn send, void* link) {
+    ctx->linkSend = send;
+    ctx->link = link;
+}
+
+void natSetIPs(NatContext* ctx, IPAddress gateway, IPAddress client,
+               IPAddress subnet, IPAddress dns) {
+    ctx->gatewayIP = gateway;
+    ctx->clientIP = client;
+    ctx->subnetMask = subnet;
+    ctx->dnsServer = dns;
+}
+
+// TCP segments to the client, and the MSS we advertise to it, are sized so
+// every packet fits one link frame in its direction.
+void natSetLinkMtu(NatContext* ctx, uint16_t mtu, uint16_t mru) {
+    ctx->linkMtu = constrain(mtu, NAT_LINK_MTU_MIN, NAT_LINK_MTU_MAX);
+    ctx->linkMru = constrain(mru, NAT_LINK_MTU_MIN, NAT_LINK_MTU_MAX);
+    NAT_DEBUG_F("NAT: Link MTU %d, MRU %d", ctx->linkMtu, ctx->linkMru);
+}
+
+// ============================================================================
+// Shutdown NAT - Clean up all connections
+// ============================================================================
+
+void natShutdown(NatContext* ctx) {
+    // Close all TCP connections
+    for (uint16_t i = 0; i < ctx->tcpFlows.size; i++) {
+        natTcpRelease(ctx, &ctx->tcpTable[i]);
+    }
+
+    // Stop port forward servers first - a forward's pcb can queue a
+    // datagram right up until it is removed
+    natStopPortForwardServers(ctx);
+
+    // Close the UDP sessions, and drop any replies still queued for them
+    for (uint16_t i = 0; i < ctx->udpFlows.size; i++) {
+        natUdpRelease(ctx, &ctx->udpTable[i]);
+    }
+    while (g_udpQueueTail != g_udpQueueHead) {
+        pbuf_free(g_udpQueue[g_udpQueueTail].p);
+        g_udpQueueTail = (g_udpQueueTail + 1) % NAT_UDP_QUEUE;
+    }
+
+    // Drop the ICMP sessions with the tables
+    natFreeTables(ctx);
+
+    // DNS forwarder and its cache
+    if (ctx->dns) {
+        dnsFwdShutdown(ctx->dns);
+        delete ctx->dns;
+        ctx->dns = nullptr;
+    }
+
+    // Close ICMP raw socket, and drop what it queued
+    if (ctx->icmpPcb) {
+        NatLwipCall call = {};
+        call.ctx = ctx;
+        natLwipRun(&call, natIcmpCloseFn);
+    }
+    g_icmpNatCtx = nullptr;
+    natIcmpQueueFlush();
+}
+
+// ============================================================================
+// Packet Buffer
+// ============================================================================
+// Packets to the client are built in one static buffer instead of 1.5 KB
+// arrays on the loop task's small stack. A build writes every byte it
+// sends - headers in front, payload copied straight from lwIP's pbufs
+// behind them - so the buffer is never cleared first. Each packet goes out
+// before its builder returns, and no builder runs inside another, so one
+// buffer serves them all.
+
+static uint8_t g_packetBuffer[NAT_LINK_MTU_MAX] __attribute__((aligned(4)));
+
+// ============================================================================
+// IP Checksum Calculation
+// ============================================================================
+// Host byte order results, for callers that compare or htons them - the
+// packet builders below store csumFold's result directly
+
+uint16_t ipChecksum(const uint8_t* data, uint16_t length) {
+    return ntohs(csumFold(csumPartial(data, length, 0)));
+}
+
+// ============================================================================
+// Recalculate IP Header Checksum
+// ============================================================================
+
+void ipRecalcChecksum(IpHeader* ip) {
+    uint8_t headerLen = (ip->versionIhl & 0x0F) * 4;
+    ip->checksum = 0;
+    ip->checksum = csumFold(csumPartial((uint8_t*)ip, headerLen, 0));
+}
+
+// ============================================================================
+// TCP/UDP Pseudo-header Checksum
+// ============================================================================
+
+uint16_t tcpUdpChecksum(IpHeader* ip, const uint8_t* payload, uint16_t payloadLen) {
+    uint32_t sum = csumPseudo(ip->srcIP, ip->dstIP, ip->protocol, payloadLen);
+    return ntohs(csumFold(csumPartial(payload, payloadLen, sum)));
+}
+
+// Copy length bytes at offset in a pbuf chain to dst, returning their sum -
+// the payload is summed in the same pass that copies it
+static uint32_t natCopyChainSum(struct pbuf* p, uint8_t* dst, uint16_t length,
+                                uint16_t offset) {
+    while (p && offset >= p->len) {
+        offset -= p->len;
+        p = p->next;
+    }
+
+    uint32_t sum = 0;
+    uint16_t done = 0;
+    for (; p && done < length; p = p->next) {
+        uint16_t n = min((uint16_t)(p->len - offset), (uint16_t)(length - done));
+        sum = csumAddAt(sum, csumCopy(dst + done, (uint8_t*)p->payload + offset, n), done);
+        done += n;
+        offset = 0;
+    }
+    return sum;
+}
+
+// ============================================================================
+// Process Incoming IP Packet from Vintage Computer
+// ============================================================================
+
+void natProcessPacket(NatContext* ctx, uint8_t* packet, uint16_t length) {
+    // Minimum IP header is 20 bytes
+    if (length < 20) {
+        NAT_DEBUG_F("NAT: Packet too short (%d bytes)", length);
+        ctx->droppedPackets++;
+        return;
+    }
+
+    IpHeader* ip = (IpHeader*)packet;
+
+    // Check IP version (must be 4)
+    uint8_t version = (ip->versionIhl >> 4) & 0x0F;
+    if (version != 4) {
+        NAT_DEBUG_F("NAT: Invalid IP version %d", version);
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Get header length
+    uint8_t headerLen = (ip->versionIhl & 0x0F) * 4;
+    if (headerLen < 20 || headerLen > length) {
+        NAT_DEBUG_F("NAT: Invalid header length %d", headerLen);
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Verify checksum
+    uint16_t originalChecksum = ip->checksum;
+    ip->checksum = 0;
+    uint16_t calculatedChecksum = htons(ipChecksum(packet, headerLen));
+    ip->checksum = originalChecksum;
+
+    if (originalChecksum != calculatedChecksum) {
+        // Bad checksum - drop packet
+        NAT_DEBUG_F("NAT: IP checksum mismatch: got 0x%04X, calc 0x%04X",
+                    ntohs(originalChecksum), ntohs(calculatedChecksum));
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Log incoming packet info
+    uint8_t* srcBytes = (uint8_t*)&ip->srcIP;
+    uint8_t* dstBytes = (uint8_t*)&ip->dstIP;
+    NAT_DEBUG_F("NAT: RX proto=%d %d.%d.%d.%d -> %d.%d.%d.%d len=%d",
+                ip->protocol,
+                srcBytes[0], srcBytes[1], srcBytes[2], srcBytes[3],
+                dstBytes[0], dstBytes[1], dstBytes[2], dstBytes[3],
+                length);
+
+    // Get total length from header
+    uint16_t totalLength = ntohs(ip->totalLength);
+    if (totalLength > length) {
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Route based on protocol
+    switch (ip->protocol) {
+        case IP_PROTO_TCP:
+            natProcessTcp(ctx, packet, totalLength, ip, headerLen);
+            break;
+        case IP_PROTO_UDP:
+            natProcessUdp(ctx, packet, totalLength, ip, headerLen);
+            break;
+        case IP_PROTO_ICMP:
+            natProcessIcmp(ctx, packet, totalLength, ip, headerLen);
+            break;
+        default:
+            // Unknown protocol - drop
+            ctx->droppedPackets++;
+            break;
+    }
+}
+
+// ============================================================================
+// Process TCP Packet
+// ============================================================================
+
+// ============================================================================
+// TCP MSS Option
+// ============================================================================
+
+static void natTcpParseOptions(const TcpHeader* tcp, uint8_t tcpHeaderLen,
+                               uint16_t* mss, uint8_t* wscale) {
+    const uint8_t* opt = (const uint8_t*)tcp + 20;
+    uint8_t len = tcpHeaderLen - 20;
+    uint8_t pos = 0;
+
+    *mss = 0;
+    *wscale = NAT_TCP_WSCALE_NONE;
+    while (pos < len) {
+        uint8_t kind = opt[pos];
+        if (kind == TCP_OPT_END) {
+            break;
+        }
+        if (kind == TCP_OPT_NOP) {
+            pos++;
+            continue;
+        }
+        if (pos + 1 >= len || opt[pos + 1] < 2 || pos + opt[pos + 1] > len) {
+            break;                              // Malformed - ignore the rest
+        }
+        if (kind == TCP_OPT_MSS && opt[pos + 1] == 4) {
+            *mss = ((uint16_t)opt[pos + 2] << 8) | opt[pos + 3];
+        } else if (kind == TCP_OPT_WSCALE && opt[pos + 1] == 3) {
+            *wscale = min(opt[pos + 2], (uint8_t)14);  // RFC 7323 limit
+        }
+        pos += opt[pos + 1];
+    }
+}
+
+// Window scaling only pays where a window can outgrow 64 KB in flight:
+// the TCP socket link, or the fastest serial rates
+static bool natTcpLinkIsFast() {
+    return gwLinkIsTcp() || bauds[serialSpeed] >= NAT_TCP_WSCALE_MIN_BAUD;
+}
+
+// Record the client's MSS from its SYN, clamped to what one frame carries,
+// and whether both sides scale windows. That takes a window scale option
+// in both SYNs - ours goes out when the link is fast
+static void natTcpSetClientOptions(NatContext* ctx, NatTcpEntry* entry,
+                                   const TcpHeader* tcp, uint8_t tcpHeaderLen) {
+    uint16_t mss;
+    uint8_t wscale;
+    natTcpParseOptions(tcp, tcpHeaderLen, &mss, &wscale);
+    uint16_t linkMss = ctx->linkMtu - 40;
+
+    if (mss == 0) {
+        mss = NAT_TCP_MSS_DEFAULT;
+    }
+    if (mss > linkMss) {
+        mss = linkMss;
+        ctx->mssClamped++;
+    }
+    entry->clientMss = mss;
+
+    entry->wscaleOk = (wscale != NAT_TCP_WSCALE_NONE) && natTcpLinkIsFast();
+    entry->clientWscale = entry->wscaleOk ? wscale : 0;
+}
+
+static void natProcessTcp(NatContext* ctx, uint8_t* packet, uint16_t length,
+                          IpHeader* ip, uint8_t ipHeaderLen) {
+    // Minimum TCP header is 20 bytes
+    if (length < ipHeaderLen + 20) {
+        ctx->droppedPackets++;
+        return;
+    }
+
+    TcpHeader* tcp = (TcpHeader*)(packet + ipHeaderLen);
+    uint16_t srcPort = ntohs(tcp->srcPort);
+    uint16_t dstPort = ntohs(tcp->dstPort);
+    // Construct IPs from network byte order (bytes are already in correct order)
+    uint8_t* dstBytes = (uint8_t*)&ip->dstIP;
+    uint8_t* srcBytes = (uint8_t*)&ip->srcIP;
+    IPAddress dstIP(dstBytes[0], dstBytes[1], dstBytes[2], dstBytes[3]);
+    IPAddress srcIP(srcBytes[0], srcBytes[1], srcBytes[2], srcBytes[3]);
+
+    // Get TCP header length
+    uint8_t tcpHeaderLen = ((tcp->dataOffset >> 4) & 0x0F) * 4;
+    if (tcpHeaderLen < 20 || ipHeaderLen + tcpHeaderLen > length) {
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Get flags
+    uint8_t flags = tcp->flags;
+
+    // Calculate payload length
+    uint16_t payloadLen = length - ipHeaderLen - tcpHeaderLen;
+    uint8_t* payload = packet + ipHeaderLen + tcpHeaderLen;
+
+    // Find existing connection or create new one on SYN
+    NatFlowKey key = natFlowKey(ip->srcIP, srcPort, ip->dstIP, dstPort);
+    NatTcpEntry* entry = natFindTcpEntry(ctx, key);
+
+    // Debug: always log TCP packet details
+    NAT_DEBUG_F("NAT: TCP %d.%d.%d.%d:%d -> %d.%d.%d.%d:%d flags=0x%02X entry=%s",
+                srcIP[0], srcIP[1], srcIP[2], srcIP[3], srcPort,
+                dstIP[0], dstIP[1], dstIP[2], dstIP[3], dstPort,
+                flags, entry ? "found" : "null");
+
+    if (flags & TCP_FLAG_SYN) {
+        // Debug: log SYN packet details
+        NAT_DEBUG_F("NAT: TCP SYN state=%d", entry ? entry->state : -1);
+
+        // A fresh SYN on a flow that is closing - the client has reused
+        // the port, so the old flow is done with
+        if (entry && !(flags & TCP_FLAG_ACK) &&
+            (entry->state == NAT_TCP_FIN_WAIT || entry->state == NAT_TCP_CLOSING)) {
+            NAT_DEBUG_F("NAT: Port %d reused - closing its old flow", srcPort);
+            natTcpRelease(ctx, entry);
+            entry = nullptr;
+        }
+
+        // New connection request
+        if (!entry) {
+            entry = natCreateTcpEntry(ctx, srcIP, srcPort, dstIP, dstPort);
+            if (!entry) {
+                // Table full
+                ctx->droppedPackets++;
+                NAT_DEBUG("NAT: TCP table full");
+                return;
+            }
+        }
+
+        if (entry->state == NAT_TCP_SYN_PENDING) {
+            // Retransmitted SYN - the SYN-ACK follows when the server answers
+            return;
+        }
+        if (entry->state == NAT_TCP_ESTABLISHED) {
+            // Retransmitted SYN - our SYN-ACK was lost. Until the client ACKs
+            // it, serverAck still sits just past our SYN
+            if (!(flags & TCP_FLAG_ACK) && ntohl(tcp->seqNum) + 1 == entry->clientSeq) {
+                natSendTcpSegment(ctx, entry, entry->serverAck - 1, 0,
+                                  TCP_FLAG_SYN | TCP_FLAG_ACK);
+            }
+            return;
+        }
+
+        // Store initial sequence number (+1 because SYN consumes 1 seq number)
+        entry->clientSeq = ntohl(tcp->seqNum) + 1;
+        entry->clientAck = ntohl(tcp->ackNum);
+        entry->clientWindow = ntohs(tcp->window);  // Never scaled in a SYN
+        natTcpSetClientOptions(ctx, entry, tcp, tcpHeaderLen);
+
+        // Initiate connection to remote server - natPollConnections answers
+        // the client once it resolves
+        if (entry->state == NAT_TCP_CLOSED) {
+            entry->state = NAT_TCP_SYN_PENDING;
+            entry->created = millis();
+            entry->lastActivity = millis();
+            entry->lastKeepalive = millis();
+
+            NAT_DEBUG_F("NAT: TCP connecting to %d.%d.%d.%d:%d",
+                        dstIP[0], dstIP[1], dstIP[2], dstIP[3], dstPort);
+
+            if (!natTcpStartConnect(entry)) {
+                NAT_DEBUG("NAT: TCP connect failed");
+                // Connection failed - send RST
+                natSendTcpToClient(ctx, entry, 0, TCP_FLAG_RST | TCP_FLAG_ACK);
+                natTcpRelease(ctx, entry);
+            }
+        } else if (entry->state == NAT_TCP_SYN_SENT && (flags & TCP_FLAG_ACK)) {
+            // Port forward case: SYN-ACK from the vintage computer answering our
+            // SYN. Update serverAck from it - critical for flow control to work
+            entry->serverAck = ntohl(tcp->ackNum);
+            entry->state = NAT_TCP_ESTABLISHED;
+            entry->lastActivity = millis();
+            entry->lastKeepalive = millis();
+            ctx->tcpConnections++;
+
+            NAT_DEBUG_F("NAT: Port forward handshake complete (clientSeq=%u, serverAck=%u)",
+                        entry->clientSeq, entry->serverAck);
+
+            // Send ACK to complete 3-way handshake with vintage computer
+            natSendTcpToClient(ctx, entry, 0, TCP_FLAG_ACK);
+        }
+        return;
+    }
+
+    if (!entry) {
+        // No connection for this packet
+        ctx->droppedPackets++;
+        NAT_DEBUG_F("NAT: TCP no entry for %d.%d.%d.%d:%d",
+                    dstIP[0], dstIP[1], dstIP[2], dstIP[3], dstPort);
+        return;
+    }
+
+    entry->lastActivity = millis();
+
+    // Handle RST
+    if (flags & TCP_FLAG_RST) {
+        natTcpRelease(ctx, entry);
+        return;
+    }
+
+    // Handle data from client
+    if (payloadLen > 0 && natTcpClientSending(entry)) {
+        if (entry->pcb) {
+            natTcpReceive(ctx, entry, ntohl(tcp->seqNum), payload, payloadLen);
+            entry->lastActivity = millis();
+        } else {
+            NAT_DEBUG("NAT: TCP client->server failed: not connected");
+        }
+    }
+
+    // Update ACK tracking - client's ACK acknowledges data WE sent
+    if (flags & TCP_FLAG_ACK) {
+        entry->lastActivity = millis();
+        natTcpProcessAck(ctx, entry, ntohl(tcp->ackNum),
+                         (uint32_t)ntohs(tcp->window) << entry->clientWscale, payloadLen);
+    }
+
+    // Handle FIN - it takes the sequence number after the segment's data,
+    // and only counts once everything before it has arrived
+    if (flags & TCP_FLAG_FIN) {
+        uint32_t finSeq = ntohl(tcp->seqNum) + payloadLen;
+        if (finSeq == entry->clientSeq && natTcpClientSending(entry)) {
+            entry->clientSeq++;
+            entry->clientFin = true;
+            // The client is done sending. Close toward the server - lwIP
+            // sends our FIN after the data it holds
+            natTcpShutdownUpstream(entry);
+            if (entry->state == NAT_TCP_ESTABLISHED) {
+                // The server may not be done - keep delivering what it sends
+                entry->state = NAT_TCP_FIN_WAIT;
+            }
+            // Server closed first (CLOSING) - our FIN is already out
+            natSendTcpToClient(ctx, entry, 0, TCP_FLAG_ACK);
+        } else if (finSeq + 1 == entry->clientSeq && entry->state != NAT_TCP_ESTABLISHED) {
+            // Retransmitted FIN - our ACK was lost. Resend it, with our FIN
+            // if that is out and unacked too
+            if (entry->state == NAT_TCP_CLOSING && entry->serverSeq != entry->serverAck) {
+                natSendTcpSegment(ctx, entry, entry->serverSeq - 1, 0,
+                                  TCP_FLAG_FIN | TCP_FLAG_ACK);
+            } else {
+                natSendTcpToClient(ctx, entry, 0, TCP_FLAG_ACK);
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Process UDP Packet
+// ============================================================================
+
+static void natProcessUdp(NatContext* ctx, uint8_t* packet, uint16_t length,
+                          IpHeader* ip, uint8_t ipHeaderLen) {
+    // UDP header is 8 bytes
+    if (length < ipHeaderLen + 8) {
+        ctx->droppedPackets++;
+        return;
+    }
+
+    UdpHeader* udp = (UdpHeader*)(packet + ipHeaderLen);
+    uint16_t srcPort = ntohs(udp->srcPort);
+    uint16_t dstPort = ntohs(udp->dstPort);
+    uint16_t udpLen = ntohs(udp->length);
+    // Construct IPs from network byte order (bytes are already in correct order)
+    uint8_t* dstBytes = (uint8_t*)&ip->dstIP;
+    uint8_t* srcBytes = (uint8_t*)&ip->srcIP;
+    IPAddress dstIP(dstBytes[0], dstBytes[1], dstBytes[2], dstBytes[3]);
+    IPAddress srcIP(srcBytes[0], srcBytes[1], srcBytes[2], srcBytes[3]);
+
+    if (udpLen < 8 || ipHeaderLen + udpLen > length) {
+        ctx->droppedPackets++;
+        return;
+    }
+
+    uint16_t payloadLen = udpLen - 8;
+    uint8_t* payload = packet + ipHeaderLen + 8;
+
+    // DNS to the gateway itself is answered by the forwarder
+    if (dstIP == ctx->gatewayIP && dstPort == DNS_PORT && ctx->dns) {
+        dnsFwdQuery(ctx->dns, ctx, srcIP, srcPort, payload, payloadLen);
+        return;
+    }
+
+    // We are a hop on the way - this is as far as a TTL of 1 goes
+    if (ip->ttl <= 1) {
+        natIcmpTimeExceeded(ctx, packet, length, ipHeaderLen);
+        return;
+    }
+
+    // Find or create UDP session
+    NatUdpEntry* entry = natFindOrCreateUdp(ctx, srcIP, srcPort, dstIP, dstPort);
+    if (!entry) {
+        ctx->droppedPackets++;
+        NAT_DEBUG("NAT: UDP table full");
+        return;
+    }
+
+    entry->lastActivity = millis();
+
+    // Open the session's pcb on its first datagram. lwIP has fewer UDP pcbs
+    // than the table has slots, so running out evicts the oldest session
+    if (!entry->pcb && !natUdpOpen(entry) &&
+        !(natUdpEvictOldest(ctx, true) && entry->active && natUdpOpen(entry))) {
+        NAT_DEBUG("NAT: No UDP pcb for session");
+        ctx->droppedPackets++;
+        return;
+    }
+
+    struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, payloadLen, PBUF_RAM);
+    if (!p) {
+        ctx->droppedPackets++;
+        return;
+    }
+    memcpy(p->payload, payload, payloadLen);
+
+    // Send UDP packet to remote
+    NatLwipCall call = {};
+    call.udp = entry;
+    call.p = p;
+    call.ttl = ip->ttl - 1;
+    natLwipRun(&call, natUdpSendFn);
+    pbuf_free(p);
+
+    if (call.err == ERR_OK) {
+        ctx->packetsToInternet++;
+        NAT_DEBUG_F("NAT: UDP sent to %d.%d.%d.%d:%d",
+                    dstIP[0], dstIP[1], dstIP[2], dstIP[3], dstPort);
+    } else {
+        ctx->droppedPackets++;
+    }
+}
+
+// ============================================================================
+// ICMP Queue (filled by the raw socket callback, drained by the main loop)
+// ============================================================================
+// Echo replies and ICMP errors are queued as the pbufs lwIP delivered them,
+// so a burst - fast pings, a traceroute's probes - loses nothing until the
+// queue itself is full, and that is counted.
+
+// ICMP diagnostic counters (volatile: updated from lwIP callback on Core 0)
+volatile uint32_t g_icmpCallbackCount = 0;    // Total callback invocations (replies and errors)
+volatile uint32_t g_icmpCallbackStored = 0;   // Successfully queued
+volatile uint32_t g_icmpCallbackDropped = 0;  // Dropped (queue full)
+volatile uint32_t g_icmpProcessedCount = 0;   // Processed by main loop
+
+static struct pbuf* g_icmpQueue[NAT_ICMP_QUEUE];
+static volatile uint8_t g_icmpQueueHead = 0;  // Written by the callback
+static volatile uint8_t g_icmpQueueTail = 0;  // Written by the main loop
+
+static void natIcmpQueueFlush() {
+    while (g_icmpQueueTail != g_icmpQueueHead) {
+        pbuf_free(g_icmpQueue[g_icmpQueueTail]);
+        g_icmpQueueTail = (g_icmpQueueTail + 1) % NAT_ICMP_QUEUE;
+    }
+}
+
+// ============================================================================
+// ICMP Raw Socket Receive Callback
+// ============================================================================
+
+static u8_t natIcmpRecvCallback(void* arg, struct raw_pcb* pcb,
+                                 struct pbuf* p, const ip_addr_t* addr) {
+    (void)arg;  // Use global context instead
+
+    // pbuf includes IP header - we need to skip it
+    if (p->tot_len < 28) {  // Min IP (20) + Min ICMP (8)
+        return 0;
+    }
+
+    uint8_t* ipData = (uint8_t*)p->payload;
+    uint8_t ipHeaderLen = (ipData[0] & 0x0F) * 4;
+
+    if (p->len < ipHeaderLen + 8) {
+        return 0;
+    }
+
+    // Echo replies, and errors that may be about one of our flows
+    uint8_t type = ipData[ipHeaderLen];
+    if (type != ICMP_ECHO_REPLY && type != ICMP_DEST_UNREACHABLE &&
+        type != ICMP_TIME_EXCEEDED) {
+        return 0;
+    }
+
+    g_icmpCallbackCount++;
+
+    // Queue for deferred processing (the link can't be written from here)
+    uint8_t head = g_icmpQueueHead;
+    uint8_t next = (head + 1) % NAT_ICMP_QUEUE;
+    if (next == g_icmpQueueTail) {
+        g_icmpCallbackDropped++;
+        pbuf_free(p);
+        return 1;
+    }
+    g_icmpQueue[head] = p;
+    g_icmpQueueHead = next;  // After the slot is filled
+    g_icmpCallbackStored++;
+
+    // lwIP raw_recv contract: returning 1 hands us the pbuf - the main loop
+    // frees it once delivered
+    return 1;
+}
+
+// ============================================================================
+// Process Pending ICMP (called from main loop)
+// ============================================================================
+
+// The payload is copied from p, at offset, straight into the client's packet
+static void natIcmpEchoReply(NatContext* ctx, IpHeader* ip, IcmpHeader* icmp,
+                             struct pbuf* p, uint16_t offset, uint16_t dataLen) {
+    uint16_t id = ntohs(icmp->id);
+    uint16_t seq = ntohs(icmp->sequence);
+
+    NAT_DEBUG_F("NAT: Processing ICMP reply from %d.%d.%d.%d id=%d seq=%d",
+                (int)(ip->srcIP & 0xFF), (int)((ip->srcIP >> 8) & 0xFF),
+                (int)((ip->srcIP >> 16) & 0xFF), (int)(ip->srcIP >> 24), id, seq);
+
+    // Find matching NAT entry
+    NatFlowKey key = natFlowKey(0, 0, ip->srcIP, id);
+    NatIcmpEntry* entry = nullptr;
+    for (uint16_t i = natFlowTableFirst(&ctx->icmpFlows, natFlowHash(key));
+         i != NAT_FLOW_NONE; i = ctx->icmpFlows.next[i]) {
+        if (natFlowKeyEqual(ctx->icmpTable[i].key, key)) {
+            entry = &ctx->icmpTable[i];
+            NAT_DEBUG_F("NAT: Matched ICMP entry %d", i);
+            break;
+        }
+    }
+
+    if (!entry) {
+        NAT_DEBUG("NAT: No matching ICMP entry for reply");
+        return;
+    }
+
+    // Update entry with sequence from reply
+    entry->sequence = seq;
+
+    // Send reply to the client
+    natSendIcmpToClient(ctx, entry, ICMP_ECHO_REPLY, 0, p, offset, dataLen);
+
+    NAT_DEBUG_F("NAT: Forwarded ping reply to client, %d bytes payload", dataLen);
+    ctx->icmpPackets++;
+    entry->lastActivity = millis();
+}
+
+// An ICMP error quotes the IP header and first 8 bytes of the packet that
+// caused it - one we sent on behalf of a flow. The quoted ports (or echo
+// id) find the flow; the quote is rewritten to the client's own addresses
+// and the error passed on from the router that sent it, so traceroute and
+// unreachables look to the client as if it were talking directly.
+static void natIcmpError(NatContext* ctx, IpHeader* ip, IcmpHeader* icmp,
+                         uint8_t* quote, uint16_t quoteLen) {
+    if (quoteLen < 20) {
+        return;
+    }
+    IpHeader* inner = (IpHeader*)quote;
+    uint8_t innerHeaderLen = (inner->versionIhl & 0x0F) * 4;
+    if (innerHeaderLen < 20 || quoteLen < innerHeaderLen + 8) {
+        return;
+    }
+    quoteLen = innerHeaderLen + 8;
+    uint8_t* transport = quote + innerHeaderLen;
+    uint16_t localPort = ((uint16_t)transport[0] << 8) | transport[1];
+    uint16_t remotePort = ((uint16_t)transport[2] << 8) | transport[3];
+
+    IPAddress clientIP;
+    uint16_t clientPort = 0;
+    bool found = false;
+
+    if (inner->protocol == IP_PROTO_UDP) {
+        for (uint16_t i = 0; i < ctx->udpFlows.size && !found; i++) {
+            NatUdpEntry* entry = &ctx->udpTable[i];
+            if (entry->active && entry->pcb && entry->natPort == localPort &&
+                entry->dstPort == remotePort && entry->key.dstAddr == inner->dstIP) {
+                clientIP = entry->srcIP;
+                clientPort = entry->srcPort;
+                found = true;
+            }
+        }
+    } else if (inner->protocol == IP_PROTO_TCP) {
+        for (uint16_t i = 0; i < ctx->tcpFlows.size && !found; i++) {
+            NatTcpEntry* entry = &ctx->tcpTable[i];
+            if (entry->active && entry->pcb && entry->natPort == localPort &&
+                entry->dstPort == remotePort && entry->key.dstAddr == inner->dstIP) {
+                clientIP = entry->srcIP;
+                clientPort = entry->srcPort;
+                // Our sequence numbers toward the server aren't the
+                // client's - quote its next byte instead
+                uint32_t seq = htonl(entry->clientSeq);
+                memcpy(transport + 4, &seq, 4);
+                found = true;
+            }
+        }
+    } else if (inner->protocol == IP_PROTO_ICMP && transport[0] == ICMP_ECHO_REQUEST) {
+        // Echo ids pass through unchanged, so the quote already matches
+        uint16_t id = ((uint16_t)transport[4] << 8) | transport[5];
+        NatFlowKey key = natFlowKey(0, 0, inner->dstIP, id);
+        for (uint16_t i = natFlowTableFirst(&ctx->icmpFlows, natFlowHash(key));
+             i != NAT_FLOW_NONE; i = ctx->icmpFlows.next[i]) {
+            if (natFlowKeyEqual(ctx->icmpTable[i].key, key)) {
+                clientIP = ctx->icmpTable[i].srcIP;
+                found = true;
+                break;
+            }
+        }
+    }
+
+    if (!found) {
+        NAT_DEBUG_F("NAT: ICMP type %d for no flow (proto %d, port %d)",
+                    icmp->type, inner->protocol, localPort);
+        return;
+    }
+
+    // Rewrite the quote, patching its checksums rather than summing again.
+    // A quoted UDP checksum covers the source address and port; zero is none
+    uint32_t clientAddr = (uint32_t)clientIP;
+    uint16_t oldPort, newPort = htons(clientPort);
+    memcpy(&oldPort, transport, 2);
+    if (inner->protocol == IP_PROTO_UDP && (transport[6] | transport[7])) {
+        uint16_t check;
+        memcpy(&check, transport + 6, 2);
+        check = csumReplace32(check, inner->srcIP, clientAddr);
+        check = csumReplace16(check, oldPort, newPort);
+        memcpy(transport + 6, &check, 2);
+    }
+    inner->checksum = csumReplace32(inner->checksum, inner->srcIP, clientAddr);
+    inner->srcIP = clientAddr;
+    if (clientPort != 0) {
+        memcpy(transport, &newPort, 2);
+    }
+
+    NAT_DEBUG_F("NAT: ICMP type %d code %d passed to client (proto %d)",
+                icmp->type, icmp->code, inner->protocol);
+    natSendIcmpError(ctx, ip->srcIP, clientIP, icmp->type, icmp->code,
+                     (const uint8_t*)&icmp->id, quote, quoteLen);
+}
+
+void natProcessPendingIcmp(NatContext* ctx) {
+    while (g_icmpQueueTail != g_icmpQueueHead) {
+        uint8_t tail = g_icmpQueueTail;
+        struct pbuf* p = g_icmpQueue[tail];
+
+        // Only the headers, and an error's quote, are copied out here
+        uint8_t head[60 + 8 + 60 + 8];  // IP + ICMP header + quoted header + 8 bytes
+        uint16_t length = pbuf_copy_partial(p, head, min((uint16_t)sizeof(head), p->tot_len), 0);
+
+        IpHeader* ip = (IpHeader*)head;
+        uint8_t ipHeaderLen = (ip->versionIhl & 0x0F) * 4;
+        IcmpHeader* icmp = (IcmpHeader*)(head + ipHeaderLen);
+
+        if (length < ipHeaderLen + 8) {
+            // Header options ran past the packet - nothing to pass on
+        } else if (icmp->type == ICMP_ECHO_REPLY) {
+            natIcmpEchoReply(ctx, ip, icmp, p, ipHeaderLen + 8,
+                             p->tot_len - ipHeaderLen - 8);
+        } else {
+            natIcmpError(ctx, ip, icmp, head + ipHeaderLen + 8,
+                         length - ipHeaderLen - 8);
+        }
+
+        pbuf_free(p);
+        g_icmpQueueTail = (tail + 1) % NAT_ICMP_QUEUE;
+        g_icmpProcessedCount++;
+    }
+}
+
+// ============================================================================
+// Process ICMP Packet (Echo Request/Reply)
+// ============================================================================
+
+static void natProcessIcmp(NatContext* ctx, uint8_t* packet, uint16_t length,
+                           IpHeader* ip, uint8_t ipHeaderLen) {
+    // ICMP header is 8 bytes minimum
+    if (length < ipHeaderLen + 8) {
+        ctx->droppedPackets++;
+        return;
+    }
+
+    IcmpHeader* icmp = (IcmpHeader*)(packet + ipHeaderLen);
+
+    // Only handle Echo Request (ping)
+    if (icmp->type != ICMP_ECHO_REQUEST) {
+        NAT_DEBUG_F("NAT: ICMP type %d dropped", icmp->type);
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Construct IPs from network byte order (bytes are already in correct order)
+    uint8_t* dstBytes = (uint8_t*)&ip->dstIP;
+    uint8_t* srcBytes = (uint8_t*)&ip->srcIP;
+    IPAddress dstIP(dstBytes[0], dstBytes[1], dstBytes[2], dstBytes[3]);
+    IPAddress srcIP(srcBytes[0], srcBytes[1], srcBytes[2], srcBytes[3]);
+
+    NAT_DEBUG_F("NAT: ICMP echo request to %d.%d.%d.%d",
+                dstIP[0], dstIP[1], dstIP[2], dstIP[3]);
+
+    // Check if ping is for our gateway IP
+    if (dstIP == ctx->gatewayIP) {
+        // Respond directly
+        uint16_t oldWord, newWord;
+
+        // Swap IPs - their order doesn't change the header checksum
+        uint32_t tmp = ip->srcIP;
+        ip->srcIP = ip->dstIP;
+        ip->dstIP = tmp;
+
+        // Change to echo reply, patching the checksum for the type
+        memcpy(&oldWord, icmp, 2);
+        icmp->type = ICMP_ECHO_REPLY;
+        memcpy(&newWord, icmp, 2);
+        icmp->checksum = csumReplace16(icmp->checksum, oldWord, newWord);
+
+        // And the IP checksum for the TTL
+        memcpy(&oldWord, &ip->ttl, 2);
+        ip->ttl = 64;
+        memcpy(&newWord, &ip->ttl, 2);
+        ip->checksum = csumReplace16(ip->checksum, oldWord, newWord);
+
+        // Send back
+        natSendToClient(ctx, packet, length);
+        ctx->packetsFromInternet++;
+        ctx->icmpPackets++;
+
+        NAT_DEBUG("NAT: Responded to gateway ping");
+        return;
+    }
+
+    // External ping - forward via ICMP NAT
+    if (!ctx->icmpPcb) {
+        NAT_DEBUG("NAT: No ICMP socket, dropping ping");
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Traceroute by echo request - the first hop is us
+    if (ip->ttl <= 1) {
+        natIcmpTimeExceeded(ctx, packet, length, ipHeaderLen);
+        return;
+    }
+
+    uint16_t icmpId = ntohs(icmp->id);
+    uint16_t icmpSeq = ntohs(icmp->sequence);
+
+    // Find or create ICMP NAT entry
+    NatFlowKey key = natFlowKey(0, 0, ip->dstIP, icmpId);
+    uint32_t hash = natFlowHash(key);
+    NatIcmpEntry* entry = nullptr;
+
+    for (uint16_t i = natFlowTableFirst(&ctx->icmpFlows, hash);
+         i != NAT_FLOW_NONE; i = ctx->icmpFlows.next[i]) {
+        if (natFlowKeyEqual(ctx->icmpTable[i].key, key)) {
+            entry = &ctx->icmpTable[i];
+            break;
+        }
+    }
+
+    if (!entry) {
+        uint16_t slot = natFlowTableInsert(&ctx->icmpFlows, hash);
+        if (slot == NAT_FLOW_NONE && natIcmpEvictOldest(ctx)) {
+            slot = natFlowTableInsert(&ctx->icmpFlows, hash);
+        }
+        if (slot != NAT_FLOW_NONE) {
+            entry = &ctx->icmpTable[slot];
+            entry->active = true;
+            entry->key = key;
+            entry->srcIP = srcIP;
+            entry->dstIP = dstIP;
+            entry->id = icmpId;
+            NAT_DEBUG_F("NAT: Created ICMP entry %d for ping to %d.%d.%d.%d",
+                        slot, dstIP[0], dstIP[1], dstIP[2], dstIP[3]);
+        }
+    }
+
+    if (!entry) {
+        NAT_DEBUG("NAT: ICMP table full");
+        ctx->droppedPackets++;
+        return;
+    }
+
+    entry->sequence = icmpSeq;
+    entry->lastActivity = millis();
+
+    // Build ICMP packet to send via raw socket
+    uint16_t icmpLen = length - ipHeaderLen;
+    struct pbuf* p = pbuf_alloc(PBUF_IP, icmpLen, PBUF_RAM);
+    if (!p) {
+        NAT_DEBUG("NAT: Failed to allocate pbuf for ICMP");
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Copy ICMP data (header + payload)
+    memcpy(p->payload, icmp, icmpLen);
+
+    // Send via raw socket
+    NatLwipCall call = {};
+    call.ctx = ctx;
+    call.p = p;
+    call.addr = ip->dstIP;
+    call.ttl = ip->ttl - 1;
+    natLwipRun(&call, natIcmpSendFn);
+    err_t err = call.err;
+    pbuf_free(p);
+
+    if (err == ERR_OK) {
+        NAT_DEBUG_F("NAT: Forwarded ping to %d.%d.%d.%d id=%d seq=%d",
+                    dstIP[0], dstIP[1], dstIP[2], dstIP[3], icmpId, icmpSeq);
+        ctx->packetsToInternet++;
+        ctx->icmpPackets++;
+    } else {
+        NAT_DEBUG_F("NAT: Failed to send ICMP, err=%d", err);
+        ctx->droppedPackets++;
+    }
+}
+
+// ============================================================================
+// Send ICMP Packet to Client (Vintage Computer)
+// ============================================================================
+
+static void natSendIcmpToClient(NatContext* ctx, NatIcmpEntry* entry,
+                                 uint8_t type, uint8_t code, struct pbuf* p,
+                                 uint16_t offset, uint16_t length) {
+    uint16_t ipHeaderLen = 20;
+    uint16_t icmpHeaderLen = 8;
+    uint16_t totalLen = ipHeaderLen + icmpHeaderLen + length;
+
+    if (totalLen > ctx->linkMtu) {
+        NAT_DEBUG_F("NAT: ICMP reply of %d bytes exceeds link MTU", totalLen);
+        return;
+    }
+    uint8_t* packet = g_packetBuffer;
+
+    // Build IP header
+    IpHeader* ip = (IpHeader*)packet;
+    ip->versionIhl = 0x45;
+    ip->tos = 0;
+    ip->totalLength = htons(totalLen);
+    ip->id = htons(random(1, 65535));
+    ip->flagsFragment = htons(0x4000);
+    ip->ttl = 64;
+    ip->protocol = IP_PROTO_ICMP;
+    ip->checksum = 0;
+    // Construct IP addresses in network byte order from IPAddress bytes
+    ip->srcIP = entry->dstIP[0] | ((uint32_t)entry->dstIP[1] << 8) |
+                ((uint32_t)entry->dstIP[2] << 16) | ((uint32_t)entry->dstIP[3] << 24);
+    ip->dstIP = entry->srcIP[0] | ((uint32_t)entry->srcIP[1] << 8) |
+                ((uint32_t)entry->srcIP[2] << 16) | ((uint32_t)entry->srcIP[3] << 24);
+
+    // Build ICMP header
+    IcmpHeader* icmp = (IcmpHeader*)(packet + ipHeaderLen);
+    icmp->type = type;
+    icmp->code = code;
+    icmp->checksum = 0;
+    icmp->id = htons(entry->id);
+    icmp->sequence = htons(entry->sequence);
+
+    // Copy data, summing it on the way
+    uint32_t sum = 0;
+    if (p && length > 0) {
+        sum = natCopyChainSum(p, packet + ipHeaderLen + icmpHeaderLen, length, offset);
+    }
+
+    // Calculate ICMP checksum
+    icmp->checksum = csumFold(csumPartial((uint8_t*)icmp, icmpHeaderLen, sum));
+
+    // Calculate IP checksum
+    ipRecalcChecksum(ip);
+
+    // Send to client
+    natSendToClient(ctx, packet, totalLen);
+    ctx->packetsFromInternet++;
+}
+
+// ============================================================================
+// Send ICMP Error to Client
+// ============================================================================
+// rest is the 4 bytes after the checksum (unused, or the next-hop MTU)
+
+static void natSendIcmpError(NatContext* ctx, uint32_t fromAddr, IPAddress toIP,
+                             uint8_t type, uint8_t code, const uint8_t* rest,
+                             const uint8_t* quote, uint16_t quoteLen) {
+    uint8_t packet[20 + 8 + 60 + 8];  // IP + ICMP header + quoted header + 8 bytes
+    uint16_t totalLen = 20 + 8 + quoteLen;
+
+    if (totalLen > sizeof(packet)) {
+        return;
+    }
+
+    // Build IP header
+    IpHeader* ip = (IpHeader*)packet;
+    ip->versionIhl = 0x45;
+    ip->tos = 0;
+    ip->totalLength = htons(totalLen);
+    ip->id = htons(random(1, 65535));
+    ip->flagsFragment = 0;
+    ip->ttl = 64;
+    ip->protocol = IP_PROTO_ICMP;
+    ip->srcIP = fromAddr;
+    ip->dstIP = (uint32_t)toIP;
+    ipRecalcChecksum(ip);
+
+    // Build ICMP header and the quote
+    IcmpHeader* icmp = (IcmpHeader*)(packet + 20);
+    icmp->type = type;
+    icmp->code = code;
+    icmp->checksum = 0;
+    memcpy(&icmp->id, rest, 4);
+    uint32_t sum = csumCopy(packet + 28, quote, quoteLen);
+    icmp->checksum = csumFold(csumPartial((uint8_t*)icmp, 8, sum));
+
+    natSendToClient(ctx, packet, totalLen);
+    ctx->icmpErrors++;
+}
+
+// The client's packet ran out of TTL here - say so from the gateway
+static void natIcmpTimeExceeded(NatContext* ctx, uint8_t* packet, uint16_t length,
+                                uint8_t ipHeaderLen) {
+    static const uint8_t unused[4] = {0, 0, 0, 0};
+    IpHeader* ip = (IpHeader*)packet;
+    uint16_t quoteLen = min((uint16_t)(ipHeaderLen + 8), length);
+
+    NAT_DEBUG("NAT: TTL expired at the gateway");
+    natSendIcmpError(ctx, (uint32_t)ctx->gatewayIP, IPAddress(ip->srcIP),
+                     ICMP_TIME_EXCEEDED, 0, unused, packet, quoteLen);
+}
+
+// ============================================================================
+// Find TCP Entry
+// ============================================================================
+
+static NatTcpEntry* natFindTcpEntry(NatContext* ctx, const NatFlowKey& key) {
+    for (uint16_t i = natFlowTableFirst(&ctx->tcpFlows, natFlowHash(key));
+         i != NAT_FLOW_NONE; i = ctx->tcpFlows.next[i]) {
+        if (natFlowKeyEqual(ctx->tcpTable[i].key, key)) {
+            return &ctx->tcpTable[i];
+        }
+    }
+    return nullptr;
+}
+
+// ============================================================================
+// Create TCP Entry
+// ============================================================================
+
+static NatTcpEntry* natCreateTcpEntry(NatContext* ctx, IPAddress srcIP,
+                                       uint16_t srcPort, IPAddress dstIP,
+                                       uint16_t dstPort) {
+    NatFlowKey key = natFlowKey((uint32_t)srcIP, srcPort, (uint32_t)dstIP, dstPort);
+    uint32_t hash = natFlowHash(key);
+
+    // Take a free slot, making room when the table is full
+    uint16_t slot = natFlowTableInsert(&ctx->tcpFlows, hash);
+    if (slot == NAT_FLOW_NONE && natTcpEvictIdle(ctx)) {
+        slot = natFlowTableInsert(&ctx->tcpFlows, hash);
+    }
+    if (slot == NAT_FLOW_NONE) {
+        return nullptr;
+    }
+
+    NatTcpEntry* entry = &ctx->tcpTable[slot];
+    entry->active = true;
+    entry->state = NAT_TCP_CLOSED;
+    entry->key = key;
+    entry->srcIP = srcIP;
+    entry->srcPort = srcPort;
+    entry->dstIP = dstIP;
+    entry->dstPort = dstPort;
+    entry->natPort = 0;     // lwIP picks it when the pcb connects
+    entry->pcb = nullptr;
+    entry->rxPending = nullptr;
+    entry->upEvents = 0;
+    entry->clientSeq = 0;
+    entry->clientAck = 0;
+    entry->serverSeq = random(1, 0x7FFFFFFF);  // Random initial sequence
+    entry->serverAck = 0;
+    entry->clientMss = NAT_TCP_MSS_DEFAULT;
+    entry->clientWindow = NAT_TCP_MSS_DEFAULT;
+    entry->clientWscale = 0;
+    entry->wscaleOk = false;
+    entry->upstreamRoom = TCP_SND_BUF;
+    entry->clientFin = false;
+    entry->advertisedWindow = 0;
+    entry->sendLen = 0;
+    entry->readAhead = 0;
+    entry->srtt = 0;
+    entry->rttvar = 0;
+    entry->rto = NAT_TCP_RTO_INITIAL_MS;
+    entry->rtoTimer = millis();
+    entry->rttTiming = false;
+    entry->dupAcks = 0;
+    entry->recovering = false;
+    entry->persistProbes = 0;
+    entry->lastActivity = millis();
+    entry->lastKeepalive = millis();
+    entry->lastServerData = millis();
+    entry->created = millis();
+    return entry;
+}
+
+// ============================================================================
+// Find or Create UDP Entry
+// ============================================================================
+
+static NatUdpEntry* natFindOrCreateUdp(NatContext* ctx, IPAddress srcIP,
+                                        uint16_t srcPort, IPAddress dstIP,
+                                        uint16_t dstPort) {
+    NatFlowKey key = natFlowKey((uint32_t)srcIP, srcPort, (uint32_t)dstIP, dstPort);
+    uint32_t hash = natFlowHash(key);
+
+    // Find existing
+    for (uint16_t i = natFlowTableFirst(&ctx->udpFlows, hash);
+         i != NAT_FLOW_NONE; i = ctx->udpFlows.next[i]) {
+        if (natFlowKeyEqual(ctx->udpTable[i].key, key)) {
+            return &ctx->udpTable[i];
+        }
+    }
+
+    // Create new, making room when the table is full
+    uint16_t slot = natFlowTableInsert(&ctx->udpFlows, hash);
+    if (slot == NAT_FLOW_NONE && natUdpEvictOldest(ctx, false)) {
+        slot = natFlowTableInsert(&ctx->udpFlows, hash);
+    }
+    if (slot == NAT_FLOW_NONE) {
+        return nullptr;
+    }
+
+    NatUdpEntry* entry = &ctx->udpTable[slot];
+    entry->active = true;
+    entry->key = key;
+    entry->srcIP = srcIP;
+    entry->srcPort = srcPort;
+    entry->dstIP = dstIP;
+    entry->dstPort = dstPort;
+    entry->natPort = 0;     // lwIP picks it when the pcb is bound
+    entry->pcb = nullptr;
+    entry->forwarded = false;
+    entry->lastActivity = millis();
+    ctx->udpSessions++;
+    return entry;
+}
+
+// ============================================================================
+// Outbound Connect
+// ============================================================================
+// The remote handshake can take seconds - longer still to a dead host - so
+// the flow waits in SYN_PENDING while lwIP connects, and the poll loop
+// keeps servicing the link and the other flows until the connected or
+// error callback has fired.
+
+static bool natTcpStartConnect(NatTcpEntry* entry) {
+    NatLwipCall call = {};
+    call.entry = entry;
+    call.addr = entry->key.dstAddr;
+    call.port = entry->dstPort;
+    natLwipRun(&call, natTcpConnectFn);
+    return entry->pcb != nullptr;
+}
+
+static void natTcpCheckConnect(NatContext* ctx, NatTcpEntry* entry) {
+    uint8_t events = entry->upEvents;
+    if (events & NAT_UP_CONNECTED) {
+        entry->state = NAT_TCP_ESTABLISHED;
+        entry->lastActivity = millis();
+        ctx->packetsToInternet++;
+        ctx->tcpConnections++;
+        NAT_DEBUG_F("NAT: TCP[%d] connected in %lums", (int)(entry - ctx->tcpTable),
+                    millis() - entry->created);
+
+        // Send SYN-ACK back to client
+        natSendTcpToClient(ctx, entry, 0, TCP_FLAG_SYN | TCP_FLAG_ACK);
+
+        // Initialize serverAck for flow control - our SYN counts as
+        // delivered, so the send window starts at the first data byte
+        entry->serverAck = entry->serverSeq;
+        return;
+    }
+
+    if (events & NAT_UP_ERROR) {
+        NAT_DEBUG_F("NAT: TCP[%d] connect failed", (int)(entry - ctx->tcpTable));
+    } else if (millis() - entry->created > NAT_TCP_CONNECT_TIMEOUT_MS) {
+        NAT_DEBUG_F("NAT: TCP[%d] connect timed out", (int)(entry - ctx->tcpTable));
+    } else {
+        return;  // Still connecting
+    }
+
+    // Refused, unreachable or timed out - reset the client's SYN
+    natSendTcpToClient(ctx, entry, 0, TCP_FLAG_RST | TCP_FLAG_ACK);
+    natTcpRelease(ctx, entry);
+}
+
+// ============================================================================
+// TCP Receive (client -> server)
+// ============================================================================
+// clientSeq is the next byte we expect from the client. In-order data goes
+// straight to the server; bytes the client resends are trimmed or dropped,
+// and segments that arrive beyond a gap wait in a small reassembly queue.
+// Every data segment is answered with an ACK for clientSeq, so a gap gives
+// the client duplicate ACKs and it fast-retransmits the missing segment.
+
+// The client may send until its FIN - in ESTABLISHED, and in CLOSING, where
+// only the server has closed
+static bool natTcpClientSending(NatTcpEntry* entry) {
+    return entry->state == NAT_TCP_ESTABLISHED ||
+           (entry->state == NAT_TCP_CLOSING && !entry->clientFin);
+}
+
+// Our receive window is the room left in lwIP's send buffer toward the
+// server, in whole segments (receiver-side silly window avoidance). When the
+// heap runs low it shrinks to one segment, so a fast uploader can't pin
+// memory that WiFi and the framers need
+static uint32_t natTcpReceiveWindow(NatContext* ctx, NatTcpEntry* entry) {
+    uint32_t ourMss = ctx->linkMru - 40;
+    uint32_t space = entry->upstreamRoom;
+    if (ESP.getFreeHeap() < NAT_HEAP_LOW) {
+        space = min(space, ourMss);
+    }
+    return space - space % ourMss;
+}
+
+// Tell the client its window has opened once the server has ACKed enough
+// of the send buffer (RFC 1122: two segments, or half the buffer)
+static void natTcpWindowUpdate(NatContext* ctx, NatTcpEntry* entry) {
+    if (entry->upstreamRoom < TCP_SND_BUF) {
+        NatLwipCall call = {};
+        call.entry = entry;
+        natLwipRun(&call, natTcpRoomFn);
+    }
+    uint32_t window = natTcpReceiveWindow(ctx, entry);
+    uint32_t step = min((uint32_t)TCP_SND_BUF / 2, 2 * (uint32_t)(ctx->linkMru - 40));
+    if (window >= entry->advertisedWindow + step ||
+        (entry->advertisedWindow == 0 && window > 0)) {
+        natSendTcpToClient(ctx, entry, 0, TCP_FLAG_ACK);
+        ctx->tcpWindowUpdates++;
+    }
+}
+
+// Write client data straight to the server, advancing clientSeq by what
+// lwIP took - the client resends the rest once the window opens
+static bool natTcpDeliver(NatContext* ctx, NatTcpEntry* entry,
+                          const uint8_t* data, uint16_t length) {
+    NatLwipCall call = {};
+    call.entry = entry;
+    call.data = data;
+    call.len = length;
+    natLwipRun(&call, natTcpWriteFn);
+    if (call.len > 0) {
+        NAT_DEBUG_F("NAT: TCP client->server: %d bytes", call.len);
+        entry->clientSeq += call.len;
+        ctx->packetsToInternet++;
+    }
+    return call.len == length;
+}
+
+static void natTcpReasmClear(NatTcpEntry* entry, int slot) {
+    delete[] entry->reasmData[slot];
+    entry->reasmData[slot] = nullptr;
+}
+
+// Deliver queued segments that the in-order data has now caught up with
+static void natTcpReasmDrain(NatContext* ctx, NatTcpEntry* entry) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (int i = 0; i < NAT_TCP_REASM_SLOTS; i++) {
+            if (!entry->reasmData[i]) continue;
+
+            // Bytes of this segment the server already has
+            int32_t offset = entry->clientSeq - entry->reasmSeq[i];
+            if (offset < 0) continue;  // Still beyond a gap
+
+            if (offset < entry->reasmLen[i] &&
+                !natTcpDeliver(ctx, entry, entry->reasmData[i] + offset,
+                               entry->reasmLen[i] - offset)) {
+                return;  // Server backed up - keep the rest queued
+            }
+            natTcpReasmClear(entry, i);
+            progress = true;
+        }
+    }
+}
+
+static void natTcpReasmQueue(NatContext* ctx, NatTcpEntry* entry, uint32_t seq,
+                             const uint8_t* data, uint16_t length) {
+    int freeSlot = -1;
+    for (int i = 0; i < NAT_TCP_REASM_SLOTS; i++) {
+        if (!entry->reasmData[i]) {
+            if (freeSlot < 0) freeSlot = i;
+        } else if (entry->reasmSeq[i] == seq && entry->reasmLen[i] >= length) {
+            return;  // Already queued
+        }
+    }
+    if (freeSlot < 0) {
+        return;  // Queue full - the client will send it again
+    }
+
+    uint8_t* copy = new (std::nothrow) uint8_t[length];
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, data, length);
+    entry->reasmData[freeSlot] = copy;
+    entry->reasmSeq[freeSlot] = seq;
+    entry->reasmLen[freeSlot] = length;
+    ctx->tcpOutOfOrder++;
+}
+
+static void natTcpReceive(NatContext* ctx, NatTcpEntry* entry, uint32_t seq,
+                          const uint8_t* payload, uint16_t length) {
+    // Bytes of this segment already received (negative: a gap before it)
+    int32_t offset = entry->clientSeq - seq;
+
+    if (offset >= (int32_t)length) {
+        // Entirely old - a retransmission of data the server already has
+        ctx->tcpDupSegments++;
+        NAT_DEBUG_F("NAT: TCP duplicate segment seq=%u (expecting %u)", seq, entry->clientSeq);
+    } else if (offset >= 0) {
+        // In order, possibly overlapping what we had - deliver the new part
+        if (natTcpDeliver(ctx, entry, payload + offset, length - offset)) {
+            natTcpReasmDrain(ctx, entry);
+        }
+    } else if ((uint32_t)(-offset) + length <= natTcpReceiveWindow(ctx, entry)) {
+        NAT_DEBUG_F("NAT: TCP out-of-order segment seq=%u (expecting %u)", seq, entry->clientSeq);
+        natTcpReasmQueue(ctx, entry, seq, payload, length);
+    }
+    // Beyond our window - dropped, the ACK below tells the client where we are
+
+    natSendTcpToClient(ctx, entry, 0, TCP_FLAG_ACK);
+}
+
+// ============================================================================
+// TCP Send Window
+// ============================================================================
+// Server data is held, in the pbufs lwIP received it in, until the client
+// ACKs it. The send chain starts at the byte at serverAck, so its first
+// (serverSeq - serverAck) bytes are in flight and the rest are unsent.
+// Several segments may be in flight at once, up to the client's window.
+// Taken data is recved to lwIP straight away as read-ahead, up to
+// NAT_TCP_READAHEAD per flow and NAT_READAHEAD_BUDGET in all; past that it
+// is recved as the client ACKs it. The chain is at most the read-ahead
+// plus TCP_WND.
+
+// Recve what the read-ahead limits allow. Bytes are recved oldest first,
+// so the read-ahead is always the front of the send chain
+static void natTcpReadAhead(NatContext* ctx, NatTcpEntry* entry) {
+    uint32_t held = entry->sendLen - entry->readAhead;
+    uint32_t room = min((uint32_t)(NAT_TCP_READAHEAD - entry->readAhead),
+                        NAT_READAHEAD_BUDGET - ctx->readAheadBytes);
+    uint32_t len = min(held, room);
+    if (len == 0) {
+        return;
+    }
+    NatLwipCall call = {};
+    call.entry = entry;
+    call.len = len;
+    natLwipRun(&call, natTcpRecvedFn);
+    entry->readAhead += len;
+    ctx->readAheadBytes += len;
+    if (ctx->readAheadBytes > ctx->readAheadPeak) {
+        ctx->readAheadPeak = ctx->readAheadBytes;
+    }
+}
+
+static void natTcpTakeReceived(NatContext* ctx, NatTcpEntry* entry) {
+    if (entry->rxPending) {
+        NatLwipCall call = {};
+        call.entry = entry;
+        natLwipRun(&call, natTcpTakeFn);
+        entry->lastServerData = millis();
+    }
+    natTcpReadAhead(ctx, entry);
+}
+
+// Segments fit the client's MSS and the link MTU, capped at 1000 bytes -
+// balance between throughput and reliability
+static uint32_t natTcpSegmentSize(NatTcpEntry* entry) {
+    return min((uint16_t)NAT_TCP_SEGMENT_MAX, entry->clientMss);
+}
+
+// Returns number of segments sent
+static int natTcpSendWindow(NatContext* ctx, NatTcpEntry* entry) {
+    uint32_t mss = natTcpSegmentSize(entry);
+    int segments = 0;
+
+    // A burst limit keeps one busy flow from holding up the others
+    while (segments < NAT_TCP_BURST_SEGMENTS) {
+        uint32_t inFlight = entry->serverSeq - entry->serverAck;
+        if (inFlight >= entry->sendLen) {
+            break;  // Nothing unsent
+        }
+        uint32_t unsent = entry->sendLen - inFlight;
+        uint32_t window = (entry->clientWindow > inFlight) ? entry->clientWindow - inFlight : 0;
+
+        uint32_t len = min(unsent, mss);
+        if (len > window) {
+            // Don't dribble runts into a nearly shut window - wait for the
+            // client to open it, unless nothing at all is in flight
+            if (inFlight > 0 || window == 0) {
+                break;
+            }
+            len = window;
+        }
+
+        unsigned long now = millis();
+        if (inFlight == 0) {
+            entry->rtoTimer = now;
+        }
+        if (!entry->rttTiming) {
+            // Time this segment - the ACK covering it gives an RTT sample
+            entry->rttTiming = true;
+            entry->rttSeq = entry->serverSeq + len;
+            entry->rttStart = now;
+        }
+
+        NAT_DEBUG_F("NAT: TCP sending %u bytes, seq=%u, inFlight=%u",
+                    len, entry->serverSeq, inFlight);
+        natSendTcpToClient(ctx, entry, len, TCP_FLAG_PSH | TCP_FLAG_ACK);
+        ctx->tcpBytesToClient += len;
+        entry->lastActivity = now;
+        segments++;
+    }
+    return segments;
+}
+
+// Persist timer (RFC 1122 4.2.2.17): with data queued, nothing in flight
+// and a zero window, only the client's window update restarts the flow. If
+// that update is lost, a probe at the RTO - an ACK just below the window,
+// which the client must answer - fetches it again, backing off each time
+static void natTcpCheckPersist(NatContext* ctx, NatTcpEntry* entry) {
+    uint32_t inFlight = entry->serverSeq - entry->serverAck;
+    if (inFlight > 0 || entry->sendLen == 0 || entry->clientWindow > 0) {
+        entry->persistProbes = 0;
+        return;
+    }
+
+    unsigned long now = millis();
+    if (entry->persistProbes == 0) {
+        entry->persistProbes = 1;
+        entry->rtoTimer = now;
+        return;
+    }
+
+    uint32_t interval = entry->rto << min(entry->persistProbes - 1, 6);
+    if (now - entry->rtoTimer < min(interval, (uint32_t)NAT_TCP_RTO_MAX_MS)) {
+        return;
+    }
+
+    NAT_DEBUG_F("NAT: TCP zero window probe %d, seq=%u", entry->persistProbes,
+                entry->serverSeq - 1);
+    natSendTcpSegment(ctx, entry, entry->serverSeq - 1, 0, TCP_FLAG_ACK);
+    entry->rtoTimer = now;
+    if (entry->persistProbes < 0xFF) {
+        entry->persistProbes++;
+    }
+}
+
+// ============================================================================
+// TCP Retransmission
+// ============================================================================
+// RFC 6298 timer: one per flow, covering the oldest unacked segment, with
+// RTT samples taken from segments sent once only (Karn). Three duplicate
+// ACKs retransmit without waiting for the timer, and partial ACKs during
+// recovery resend the next hole straight away (NewReno style) - on a
+// serial line, loss means a corrupted frame, so nothing else backs off.
+
+static void natTcpRttSample(NatTcpEntry* entry, uint32_t rtt) {
+    if (entry->srtt == 0) {
+        // First measurement
+        entry->srtt = max(rtt, (uint32_t)1);
+        entry->rttvar = rtt / 2;
+    } else {
+        uint32_t delta = (entry->srtt > rtt) ? entry->srtt - rtt : rtt - entry->srtt;
+        entry->rttvar = (3 * entry->rttvar + delta) / 4;
+        entry->srtt = (7 * entry->srtt + rtt) / 8;
+    }
+
+    uint32_t rto = entry->srtt + max((uint32_t)NAT_TCP_RTO_GRANULARITY_MS, 4 * entry->rttvar);
+    entry->rto = constrain(rto, (uint32_t)NAT_TCP_RTO_MIN_MS, (uint32_t)NAT_TCP_RTO_MAX_MS);
+}
+
+// Resend the oldest unacked segment straight from the send chain - or, if
+// no data is outstanding, the SYN or FIN that is. Returns false if there
+// was nothing to resend
+static bool natTcpRetransmit(NatContext* ctx, NatTcpEntry* entry) {
+    uint32_t inFlight = entry->serverSeq - entry->serverAck;
+    uint32_t len = min(natTcpSegmentSize(entry), min(inFlight, (uint32_t)entry->sendLen));
+    uint8_t flags = TCP_FLAG_PSH | TCP_FLAG_ACK;
+    if (len == 0) {
+        if (inFlight == 0) {
+            return false;
+        } else if (entry->state == NAT_TCP_SYN_SENT) {
+            flags = TCP_FLAG_SYN;   // Port forward SYN to the client
+        } else if (entry->state == NAT_TCP_CLOSING) {
+            flags = TCP_FLAG_FIN | TCP_FLAG_ACK;
+        } else {
+            return false;
+        }
+    }
+
+    NAT_DEBUG_F("NAT: TCP retransmit %u bytes, seq=%u, flags=0x%02X, rto=%ums",
+                len, entry->serverAck, flags, entry->rto);
+    natSendTcpSegment(ctx, entry, entry->serverAck, len, flags);
+    entry->rttTiming = false;
+    entry->rtoTimer = millis();
+    return true;
+}
+
+// Called from the poll loop while anything is in flight
+static void natTcpCheckRto(NatContext* ctx, NatTcpEntry* entry) {
+    if (millis() - entry->rtoTimer < entry->rto) {
+        return;
+    }
+
+    // Resend from the oldest hole, and back off only if something went
+    if (!natTcpRetransmit(ctx, entry)) {
+        entry->rtoTimer = millis();
+        return;
+    }
+    entry->rto = min(entry->rto * 2, (uint32_t)NAT_TCP_RTO_MAX_MS);
+    entry->recovering = entry->sendLen > 0;
+    entry->recoverSeq = entry->serverSeq;
+    entry->dupAcks = 0;
+    ctx->tcpRetransmits++;
+}
+
+// Cumulative ACK: free what the client has now received, and let the
+// server send that much more
+static void natTcpProcessAck(NatContext* ctx, NatTcpEntry* entry, uint32_t ack,
+                             uint32_t window, uint16_t payloadLen) {
+    uint32_t acked = ack - entry->serverAck;
+    uint32_t inFlight = entry->serverSeq - entry->serverAck;
+    bool windowUpdate = (window != entry->clientWindow);
+    entry->clientWindow = window;
+
+    if (acked == 0) {
+        // RFC 5681 duplicate ACK: nothing new, no data, same window
+        if (inFlight > 0 && payloadLen == 0 && !windowUpdate) {
+            entry->dupAcks++;
+            NAT_DEBUG_F("NAT: TCP duplicate ACK %d at %u (inFlight=%u)",
+                        entry->dupAcks, ack, inFlight);
+            if (entry->dupAcks == NAT_TCP_DUPACK_THRESHOLD && !entry->recovering &&
+                natTcpRetransmit(ctx, entry)) {
+                entry->recovering = true;
+                entry->recoverSeq = entry->serverSeq;
+                ctx->tcpFastRetransmits++;
+            }
+        }
+        return;
+    }
+    if (acked > inFlight) {
+        // Old or bogus ACK - outside what we have sent
+        return;
+    }
+
+    NAT_DEBUG_F("NAT: TCP ACK update: serverAck %u -> %u (serverSeq=%u)",
+                entry->serverAck, ack, entry->serverSeq);
+
+    // SYN and FIN take a sequence number but no buffer space
+    uint32_t dataAcked = min(acked, (uint32_t)entry->sendLen);
+    if (dataAcked > 0) {
+        entry->sendChain = pbuf_free_header(entry->sendChain, dataAcked);
+        entry->sendLen -= dataAcked;
+
+        // ACKed read-ahead was recved already; anything past it leaves the
+        // server's window only now
+        uint16_t fromReadAhead = min(dataAcked, (uint32_t)entry->readAhead);
+        entry->readAhead -= fromReadAhead;
+        ctx->readAheadBytes -= fromReadAhead;
+        if (dataAcked > fromReadAhead) {
+            NatLwipCall call = {};
+            call.entry = entry;
+            call.len = dataAcked - fromReadAhead;
+            natLwipRun(&call, natTcpRecvedFn);
+        }
+    }
+    entry->serverAck = ack;
+    entry->dupAcks = 0;
+
+    unsigned long now = millis();
+    if (entry->rttTiming && (int32_t)(ack - entry->rttSeq) >= 0) {
+        natTcpRttSample(entry, now - entry->rttStart);
+        entry->rttTiming = false;
+    }
+
+    // Restart the timer for whatever is still in flight
+    entry->rtoTimer = now;
+
+    if (entry->recovering) {
+        if ((int32_t)(ack - entry->recoverSeq) >= 0) {
+            entry->recovering = false;
+        } else {
+            // Partial ACK - the next segment was lost too
+            if (natTcpRetransmit(ctx, entry)) {
+                ctx->tcpFastRetransmits++;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// Poll Connections for Incoming Data
+// ============================================================================
+
+int natPollConnections(NatContext* ctx) {
+    int packetsSent = 0;
+
+    // Poll TCP connections
+    for (int i = 0; i < ctx->tcpFlows.size; i++) {
+        NatTcpEntry* entry = &ctx->tcpTable[i];
+        if (!entry->active) continue;
+        if (entry->state == NAT_TCP_SYN_PENDING) {
+            natTcpCheckConnect(ctx, entry);
+            continue;
+        }
+
+        if (entry->upEvents & NAT_UP_ERROR) {
+            // Server reset the connection - pass that on
+            NAT_DEBUG_F("NAT: TCP[%d] reset by server", i);
+            if (entry->state == NAT_TCP_ESTABLISHED || entry->state == NAT_TCP_FIN_WAIT) {
+                natSendTcpToClient(ctx, entry, 0, TCP_FLAG_RST | TCP_FLAG_ACK);
+            }
+            natTcpRelease(ctx, entry);
+            continue;
+        }
+
+        // Tell the client when the server's ACKs reopen its window
+        if (natTcpClientSending(entry)) {
+            natTcpWindowUpdate(ctx, entry);
+        }
+
+        if (entry->state == NAT_TCP_SYN_SENT || entry->state == NAT_TCP_CLOSING) {
+            // Only our SYN or FIN can be outstanding - resend it if lost
+            if (entry->serverSeq != entry->serverAck) {
+                natTcpCheckRto(ctx, entry);
+            }
+        }
+
+        // Server data flows until our FIN, whether or not the client has
+        // sent its own
+        bool delivering = entry->state == NAT_TCP_ESTABLISHED ||
+                          entry->state == NAT_TCP_FIN_WAIT;
+        if (delivering) {
+            // Resend anything the client has had too long, take what the
+            // server has sent, then send what the client's window allows
+            if (entry->serverSeq != entry->serverAck) {
+                natTcpCheckRto(ctx, entry);
+            }
+            natTcpTakeReceived(ctx, entry);
+            packetsSent += natTcpSendWindow(ctx, entry);
+            natTcpCheckPersist(ctx, entry);
+
+            uint32_t inFlight = entry->serverSeq - entry->serverAck;
+            if (inFlight > 0) {
+                // Data in flight - waiting for ACK from client
+                unsigned long now = millis();
+                unsigned long waitTime = now - entry->lastActivity;
+
+                // Periodic debug every 5 seconds while waiting
+                static unsigned long lastWaitDebug = 0;
+                if (usbDebug && now - lastWaitDebug > 5000) {
+                    NAT_DEBUG_F("NAT: TCP[%d] WAITING: inFlight=%u, window=%u, buffered=%u, wait=%lums, pending=%d, events=0x%02X",
+                                i, inFlight, entry->clientWindow, entry->sendLen, waitTime,
+                                entry->rxPending != nullptr, entry->upEvents);
+                    lastWaitDebug = now;
+                }
+
+                // Stall detection - close if no ACKs for too long
+                if (waitTime > NAT_TCP_STALL_TIMEOUT_MS) {
+                    NAT_DEBUG_F("NAT: TCP[%d] stalled (no ACK for %lums, inFlight=%u), closing",
+                            i, waitTime, inFlight);
+                    natTcpRelease(ctx, entry);
+                    continue;
+                }
+            }
+        }
+
+        // Check if connection closed by remote - FIN once everything it sent
+        // has been delivered and ACKed
+        if (delivering && entry->sendLen == 0 &&
+            (entry->upEvents & NAT_UP_CLOSED) && !entry->rxPending) {
+            // Send FIN to client
+            entry->rtoTimer = millis();
+            natSendTcpToClient(ctx, entry, 0, TCP_FLAG_FIN | TCP_FLAG_ACK);
+            entry->state = NAT_TCP_CLOSING;
+        }
+
+        // TCP keepalive - send periodic ACK to keep connection alive
+        if (entry->state == NAT_TCP_ESTABLISHED) {
+            unsigned long now = millis();
+            if (now - entry->lastKeepalive > NAT_TCP_KEEPALIVE_MS) {
+                NAT_DEBUG_F("NAT: TCP[%d] sending keepalive", i);
+                natSendTcpToClient(ctx, entry, 0, TCP_FLAG_ACK);
+                entry->lastKeepalive = now;
+                entry->lastActivity = now;
+            }
+
+            // Check for server silence - warn if no data from server for 5+ minutes
+            unsigned long serverSilence = now - entry->lastServerData;
+            if (serverSilence > 300000) {
+                static unsigned long lastSilenceWarn = 0;
+                if (now - lastSilenceWarn > 60000) {
+                    NAT_DEBUG_F("NAT: TCP[%d] server silent for %lu seconds", i, serverSilence / 1000);
+                    lastSilenceWarn = now;
+                }
+            }
+        }
+    }
+
+    // Deliver every UDP reply the callbacks have queued
+    while (g_udpQueueTail != g_udpQueueHead) {
+        uint8_t tail = g_udpQueueTail;
+        NatUdpEntry* entry = g_udpQueue[tail].entry;
+        struct pbuf* p = g_udpQueue[tail].p;
+
+        bool live;
+        if (entry) {
+            // The slot may have been freed and reopened, and lwIP may have
+            // handed it the same pcb - only the generation tells
+            live = entry->active && entry->pcb == g_udpQueue[tail].pcb &&
+                   entry->generation == g_udpQueue[tail].generation;
+        } else {
+            entry = natUdpForwardSession(ctx, g_udpQueue[tail].pcb,
+                                         g_udpQueue[tail].addr, g_udpQueue[tail].port);
+            live = entry != nullptr;
+        }
+
+        if (live) {
+            NAT_DEBUG_F("NAT: UDP response for entry %d len=%d",
+                        (int)(entry - ctx->udpTable), p->tot_len);
+            natSendUdpToClient(ctx, entry, p);
+            packetsSent++;
+            // For DNS (port 53), release entry after response
+            if (entry->dstPort == 53 && !entry->forwarded) {
+                natUdpRelease(ctx, entry);
+            } else {
+                entry->lastActivity = millis();
+            }
+        } else {
+            NAT_DEBUG("NAT: UDP response for a closed session");
+        }
+
+        pbuf_free(p);
+        g_udpQueueTail = (tail + 1) % NAT_UDP_QUEUE;
+    }
+
+    // Answer DNS queries whose upstream lookups are back
+    if (ctx->dns) {
+        packetsSent += dnsFwdPoll(ctx->dns, ctx);
+    }
+
+    // Process any pending ICMP replies
+    natProcessPendingIcmp(ctx);
+
+    return packetsSent;
+}
+
+// ============================================================================
+// Clean Up Expired Connections
+// ============================================================================
+
+void natCleanupExpired(NatContext* ctx) {
+    unsigned long now = millis();
+
+    // Clean TCP connections
+    for (int i = 0; i < ctx->tcpFlows.size; i++) {
+        NatTcpEntry* entry = &ctx->tcpTable[i];
+        if (!entry->active) continue;
+
+        unsigned long timeout = NAT_TCP_TIMEOUT_MS;
+        if (entry->state == NAT_TCP_SYN_SENT || entry->state == NAT_TCP_SYN_PENDING) {
+            timeout = NAT_TCP_SYN_TIMEOUT_MS;
+        } else if (entry->state == NAT_TCP_FIN_WAIT) {
+            timeout = NAT_TCP_STALL_TIMEOUT_MS;  // Half-closed - the server may still send
+        } else if (entry->state == NAT_TCP_CLOSING) {
+            timeout = 10000;  // 10 seconds for closing
+        }
+
+        if (now - entry->lastActivity > timeout) {
+            NAT_DEBUG_F("NAT: Closing expired TCP %d", i);
+            natTcpRelease(ctx, entry);
+        }
+    }
+
+    // Clean UDP sessions
+    for (int i = 0; i < ctx->udpFlows.size; i++) {
+        NatUdpEntry* entry = &ctx->udpTable[i];
+        if (entry->active && now - entry->lastActivity > NAT_UDP_TIMEOUT_MS) {
+            NAT_DEBUG_F("NAT: Closing expired UDP %d", i);
+            natUdpRelease(ctx, entry);
+        }
+    }
+
+    // Clean ICMP sessions
+    for (int i = 0; i < ctx->icmpFlows.size; i++) {
+        NatIcmpEntry* entry = &ctx->icmpTable[i];
+        if (entry->active && now - entry->lastActivity > NAT_ICMP_TIMEOUT_MS) {
+            NAT_DEBUG_F("NAT: Closing expired ICMP %d", i);
+            natIcmpRelease(ctx, entry);
+        }
+    }
+}
+
+// ============================================================================
+// Send TCP Packet to Client (Vintage Computer)
+// ============================================================================
+
+static void natSendTcpToClient(NatContext* ctx, NatTcpEntry* entry,
+                                uint16_t length, uint8_t flags) {
+    natSendTcpSegment(ctx, entry, entry->serverSeq, length, flags);
+
+    // Update sequence for next packet
+    if (flags & TCP_FLAG_SYN) {
+        entry->serverSeq++;
+    }
+    if (flags & TCP_FLAG_FIN) {
+        entry->serverSeq++;
+    }
+    if (length > 0) {
+        entry->serverSeq += length;
+    }
+}
+
+// Build and send one segment at seq without touching the flow's sequence
+// state - natSendTcpToClient for new data, directly for retransmissions.
+// Payload bytes come from the send chain, copied once from lwIP's pbufs
+// straight into the packet
+static void natSendTcpSegment(NatContext* ctx, NatTcpEntry* entry, uint32_t seq,
+                              uint16_t length, uint8_t flags) {
+    // Build IP + TCP packet
+    uint16_t ipHeaderLen = 20;
+    // A SYN carries MSS, and window scale when offered (ours) or agreed (theirs)
+    bool sendWscale = (flags & TCP_FLAG_SYN) &&
+                      ((flags & TCP_FLAG_ACK) ? entry->wscaleOk : natTcpLinkIsFast());
+    uint16_t tcpHeaderLen = 20;
+    if (flags & TCP_FLAG_SYN) {
+        tcpHeaderLen += sendWscale ? 8 : 4;
+    }
+    uint16_t totalLen = ipHeaderLen + tcpHeaderLen + length;
+    uint16_t ourMss = ctx->linkMru - 40;
+    uint32_t window = natTcpReceiveWindow(ctx, entry);
+
+    if (totalLen > NAT_LINK_MTU_MAX) {
+        return;
+    }
+    uint8_t* packet = g_packetBuffer;
+
+    // Headers only - the payload overwrites the rest
+    memset(packet, 0, ipHeaderLen + tcpHeaderLen);
+
+    // Build IP header
+    IpHeader* ip = (IpHeader*)packet;
+    ip->versionIhl = 0x45;  // IPv4, 5 words header
+    ip->tos = 0;
+    ip->totalLength = htons(totalLen);
+    ip->id = htons(random(1, 65535));
+    ip->flagsFragment = htons(0x4000);  // Don't fragment
+    ip->ttl = 64;
+    ip->protocol = IP_PROTO_TCP;
+    // Construct IP addresses in network byte order from IPAddress bytes
+    ip->srcIP = entry->dstIP[0] | ((uint32_t)entry->dstIP[1] << 8) |
+                ((uint32_t)entry->dstIP[2] << 16) | ((uint32_t)entry->dstIP[3] << 24);
+    ip->dstIP = entry->srcIP[0] | ((uint32_t)entry->srcIP[1] << 8) |
+                ((uint32_t)entry->srcIP[2] << 16) | ((uint32_t)entry->srcIP[3] << 24);
+
+    // Build TCP header
+    TcpHeader* tcp = (TcpHeader*)(packet + ipHeaderLen);
+    tcp->srcPort = htons(entry->dstPort);
+    tcp->dstPort = htons(entry->srcPort);
+    tcp->seqNum = htonl(seq);
+    tcp->ackNum = htonl(entry->clientSeq);  // clientSeq is already "next expected byte"
+    tcp->dataOffset = (tcpHeaderLen / 4) << 4;
+    tcp->flags = flags;
+    // The window field is never scaled in a SYN
+    uint8_t shift = (entry->wscaleOk && !(flags & TCP_FLAG_SYN)) ? NAT_TCP_WSCALE_SHIFT : 0;
+    tcp->window = htons(min(window >> shift, (uint32_t)0xFFFF));
+    tcp->urgentPtr = 0;
+    entry->advertisedWindow = window;
+
+    // MSS option - the client never sends us more than one frame carries
+    if (flags & TCP_FLAG_SYN) {
+        uint8_t* opt = (uint8_t*)tcp + 20;
+        opt[0] = TCP_OPT_MSS;
+        opt[1] = 4;
+        opt[2] = (ourMss >> 8) & 0xFF;
+        opt[3] = ourMss & 0xFF;
+        if (sendWscale) {
+            opt[4] = TCP_OPT_NOP;
+            opt[5] = TCP_OPT_WSCALE;
+            opt[6] = 3;
+            opt[7] = NAT_TCP_WSCALE_SHIFT;
+        }
+    }
+
+    // Copy data, summing it in the same pass
+    uint32_t sum = 0;
+    if (length > 0) {
+        sum = natCopyChainSum(entry->sendChain, packet + ipHeaderLen + tcpHeaderLen,
+                              length, seq - entry->serverAck);
+    }
+
+    // Calculate checksums - the header joins the payload's sum
+    ipRecalcChecksum(ip);
+    tcp->checksum = 0;
+    sum = csumAddAt(sum, csumPseudo(ip->srcIP, ip->dstIP, IP_PROTO_TCP,
+                                    tcpHeaderLen + length), 0);
+    tcp->checksum = csumFold(csumPartial((uint8_t*)tcp, tcpHeaderLen, sum));
+
+    // Send to client
+    natSendToClient(ctx, packet, totalLen);
+    ctx->packetsFromInternet++;
+}
+
+// ============================================================================
+// Send UDP Packet to Client (Vintage Computer)
+// ============================================================================
+
+// Fill in the IP and UDP headers for a datagram of length payload bytes
+// from src to dst. Returns the packet length, or 0 if it is too big
+static uint16_t natBuildUdpHeaders(uint8_t* packet, uint16_t size,
+                                   IPAddress srcIP, uint16_t srcPort,
+                                   IPAddress dstIP, uint16_t dstPort,
+                                   uint16_t length) {
+    uint16_t totalLen = 20 + 8 + length;  // IP header + UDP header + data
+
+    if (totalLen > size) {
+        return 0;
+    }
+    memset(packet, 0, 28);
+
+    // Build IP header
+    IpHeader* ip = (IpHeader*)packet;
+    ip->versionIhl = 0x45;
+    ip->tos = 0;
+    ip->totalLength = htons(totalLen);
+    ip->id = htons(random(1, 65535));
+    ip->flagsFragment = htons(0x4000);
+    ip->ttl = 64;
+    ip->protocol = IP_PROTO_UDP;
+    // Construct IP addresses in network byte order from IPAddress bytes
+    ip->srcIP = srcIP[0] | ((uint32_t)srcIP[1] << 8) |
+                ((uint32_t)srcIP[2] << 16) | ((uint32_t)srcIP[3] << 24);
+    ip->dstIP = dstIP[0] | ((uint32_t)dstIP[1] << 8) |
+                ((uint32_t)dstIP[2] << 16) | ((uint32_t)dstIP[3] << 24);
+    ipRecalcChecksum(ip);
+
+    // Build UDP header
+    UdpHeader* udp = (UdpHeader*)(packet + 20);
+    udp->srcPort = htons(srcPort);
+    udp->dstPort = htons(dstPort);
+    udp->length = htons(8 + length);
+    return totalLen;
+}
+
+// Checksum the datagram from its payload's sum (taken as it was copied
+// in) and send it. A computed zero goes out as
+// 0xFFFF - zero means none
+static void natFinishUdp(NatContext* ctx, uint8_t* packet, uint16_t totalLen,
+                         uint32_t sum) {
+    IpHeader* ip = (IpHeader*)packet;
+    UdpHeader* udp = (UdpHeader*)(packet + 20);
+    udp->checksum = 0;
+    sum = csumAddAt(sum, csumPseudo(ip->srcIP, ip->dstIP, IP_PROTO_UDP, totalLen - 20), 0);
+    udp->checksum = csumFold(csumPartial((uint8_t*)udp, 8, sum));
+    if (udp->checksum == 0) {
+        udp->checksum = 0xFFFF;
+    }
+
+    // Send to client
+    natSendToClient(ctx, packet, totalLen);
+    ctx->packetsFromInternet++;
+}
+
+static void natSendUdpToClient(NatContext* ctx, NatUdpEntry* entry, struct pbuf* p) {
+    uint8_t* packet = g_packetBuffer;
+    // The client's link has no fragmentation - a larger datagram is lost
+    uint16_t totalLen = natBuildUdpHeaders(packet, ctx->linkMtu,
+                                           entry->dstIP, entry->dstPort,
+                                           entry->srcIP, entry->srcPort, p->tot_len);
+    if (totalLen == 0) {
+        NAT_DEBUG_F("NAT: UDP reply of %d bytes exceeds link MTU", p->tot_len + 28);
+        ctx->droppedPackets++;
+        return;
+    }
+
+    // Copy data straight from lwIP's pbufs
+    uint32_t sum = natCopyChainSum(p, packet + 28, p->tot_len, 0);
+    natFinishUdp(ctx, packet, totalLen, sum);
+}
+
+void natSendUdpReply(NatContext* ctx, IPAddress srcIP, uint16_t srcPort,
+                     IPAddress dstIP, uint16_t dstPort,
+                     const uint8_t* data, uint16_t length) {
+    uint8_t* packet = g_packetBuffer;
+    uint16_t totalLen = natBuildUdpHeaders(packet, ctx->linkMtu, srcIP, srcPort,
+                                           dstIP, dstPort, length);
+    if (totalLen == 0) {
+        NAT_DEBUG_F("NAT: UDP reply of %d bytes exceeds link MTU", length + 28);
+        ctx->droppedPackets++;
+        return;
+    }
+
+    uint32_t sum = csumCopy(packet + 28, data, length);
+    natFinishUdp(ctx, packet, totalLen, sum);
+}
+
+// ============================================================================
+// Send IP Packet to Client via the Link Adapter
+// ============================================================================
+
+void natSendToClient(NatContext* ctx, uint8_t* packet, uint16_t length) {
+    if (ctx->linkSend) {
+        ctx->linkSend(ctx->link, packet, length);
+    }
+}
+
+// ============================================================================
+// Port Forwarding Management
+// ============================================================================
+
+// Listen on port through lwIP - connections queue via natTcpAcceptCallback
+static struct tcp_pcb* natTcpListen(NatContext* ctx, uint16_t port) {
+    NatLwipCall call = {};
+    call.ctx = ctx;
+    call.port = port;
+    natLwipRun(&call, natTcpListenFn);
+    return call.pcb;
+}
+
+static void natTcpUnlisten(NatContext* ctx, int index) {
+    if (ctx->tcpForwardListeners[index]) {
+        NatLwipCall call = {};
+        call.pcb = ctx->tcpForwardListeners[index];
+        natLwipRun(&call, natTcpUnlistenFn);
+        ctx->tcpForwardListeners[index] = nullptr;
+    }
+}
+
+// Bind port through lwIP - datagrams queue via natUdpRecvCallback
+static struct udp_pcb* natUdpListen(uint16_t port) {
+    NatLwipCall call = {};
+    call.port = port;
+    natLwipRun(&call, natUdpListenFn);
+    return call.udpPcb;
+}
+
+// The forward's sessions go with its pcb
+static void natUdpUnlisten(NatContext* ctx, int index) {
+    struct udp_pcb* pcb = ctx->udpForwardPcbs[index];
+    if (!pcb) {
+        return;
+    }
+    for (uint16_t i = 0; i < ctx->udpFlows.size; i++) {
+        NatUdpEntry* entry = &ctx->udpTable[i];
+        if (entry->active && entry->forwarded && entry->pcb == pcb) {
+            natUdpRelease(ctx, entry);
+        }
+    }
+    NatLwipCall call = {};
+    call.udpPcb = pcb;
+    natLwipRun(&call, natUdpUnlistenFn);
+    ctx->udpForwardPcbs[index] = nullptr;
+}
+
+// Start the rule's listener (TCP) or bound pcb (UDP)
+static void natStartPortForward(NatContext* ctx, int index) {
+    PortForwardEntry* rule = &ctx->portForwards[index];
+    bool started;
+    if (rule->protocol == IP_PROTO_TCP) {
+        // lwIP's listen pcbs are shared with the web UI and the TCP link
+        // server - TCP forwards may only take what those leave
+        int listening = 0;
+        for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
+            if (ctx->tcpForwardListeners[i]) {
+                listening++;
+            }
+        }
+        if (!ctx->tcpForwardListeners[index] &&
+            listening < MEMP_NUM_TCP_PCB_LISTEN - NAT_RESERVED_LISTEN_PCBS) {
+            ctx->tcpForwardListeners[index] = natTcpListen(ctx, rule->externalPort);
+        }
+        started = ctx->tcpForwardListeners[index] != nullptr;
+    } else {
+        if (!ctx->udpForwardPcbs[index]) {
+            ctx->udpForwardPcbs[index] = natUdpListen(rule->externalPort);
+        }
+        started = ctx->udpForwardPcbs[index] != nullptr;
+    }
+    if (started) {
+        NAT_DEBUG_F("NAT: Started port forward server on %s port %d",
+                    rule->protocol == IP_PROTO_TCP ? "TCP" : "UDP", rule->externalPort);
+    } else {
+        NAT_DEBUG_F("NAT: Port forward on port %d failed to start", rule->externalPort);
+    }
+}
+
+// A datagram on a UDP port forward: the session between the rule's internal
+// host and the sender, sharing the forward's pcb so replies leave from the
+// external port. Null if the rule is gone or the table is full
+static NatUdpEntry* natUdpForwardSession(NatContext* ctx, struct udp_pcb* pcb,
+                                         uint32_t addr, uint16_t port) {
+    PortForwardEntry* rule = nullptr;
+    for (int i = 0; pcb && i < NAT_MAX_PORT_FORWARDS; i++) {
+        if (ctx->udpForwardPcbs[i] == pcb) {
+            rule = &ctx->portForwards[i];
+            break;
+        }
+    }
+    if (!rule) {
+        return nullptr;
+    }
+
+    IPAddress remoteIP(addr);
+    NatUdpEntry* entry = natFindOrCreateUdp(ctx, rule->internalIP, rule->internalPort,
+                                            remoteIP, port);
+    if (!entry) {
+        NAT_DEBUG("NAT: Port forward datagram dropped - UDP table full");
+        ctx->droppedPackets++;
+        return nullptr;
+    }
+    if (!entry->pcb) {
+        NAT_DEBUG_F("NAT: UDP port forward session on port %d from %s",
+                    rule->externalPort, remoteIP.toString().c_str());
+        entry->pcb = pcb;
+        entry->forwarded = true;
+        entry->natPort = rule->externalPort;
+    }
+    return entry;
+}
+
+int natAddPortForward(NatContext* ctx, uint8_t proto, uint16_t extPort,
+                      IPAddress intIP, uint16_t intPort, bool startServer) {
+    // Find free slot
+    for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
+        if (!ctx->portForwards[i].active) {
+            ctx->portForwards[i].active = true;
+            ctx->portForwards[i].protocol = proto;
+            ctx->portForwards[i].externalPort = extPort;
+            ctx->portForwards[i].internalIP = intIP;
+            ctx->portForwards[i].internalPort = intPort;
+
+            // Start the listener only if requested
+            if (startServer) {
+                natStartPortForward(ctx, i);
+            }
+            return i;
+        }
+    }
+    return -1;  // Table full
+}
+
+void natStartPortForwardServers(NatContext* ctx) {
+    for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
+        if (ctx->portForwards[i].active) {
+            natStartPortForward(ctx, i);
+        }
+    }
+}
+
+void natStopPortForwardServers(NatContext* ctx) {
+    for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
+        natTcpUnlisten(ctx, i);
+        natUdpUnlisten(ctx, i);
+    }
+
+    // Reset connections accepted but not yet given a flow
+    NatLwipCall call = {};
+    call.ctx = ctx;
+    while (ctx->acceptTail != ctx->acceptHead) {
+        natLwipRun(&call, natAcceptTakeFn);
+    }
+}
+
+void natRemovePortForward(NatContext* ctx, int index) {
+    if (index < 0 || index >= NAT_MAX_PORT_FORWARDS) return;
+    if (!ctx->portForwards[index].active) return;
+
+    natTcpUnlisten(ctx, index);
+    natUdpUnlisten(ctx, index);
+    ctx->portForwards[index].active = false;
+}
+
+// ============================================================================
+// Check Port Forwards for Incoming Connections
+// ============================================================================
+// The listeners accept in lwIP's task; this gives each queued connection a
+// flow and sends the internal host its SYN.
+
+void natCheckPortForwards(NatContext* ctx) {
+    while (ctx->acceptTail != ctx->acceptHead) {
+        NatLwipCall call = {};
+        call.ctx = ctx;
+        natLwipRun(&call, natAcceptPeekFn);
+
+        // The rule is the one listening on the connection's local port
+        PortForwardEntry* rule = nullptr;
+        for (int i = 0; call.pcb && i < NAT_MAX_PORT_FORWARDS; i++) {
+            if (ctx->portForwards[i].active && ctx->portForwards[i].protocol == IP_PROTO_TCP &&
+                ctx->portForwards[i].externalPort == call.localPort) {
+                rule = &ctx->portForwards[i];
+                break;
+            }
+        }
+
+        NatTcpEntry* entry = nullptr;
+        if (rule) {
+            IPAddress remoteIP(call.addr);
+            NAT_DEBUG_F("NAT: Port forward connection on port %d from %s",
+                        rule->externalPort, remoteIP.toString().c_str());
+
+            // Create NAT entry for this inbound connection
+            entry = natCreateTcpEntry(ctx, rule->internalIP, rule->internalPort,
+                                      remoteIP, call.port);
+            if (!entry) {
+                NAT_DEBUG("NAT: Port forward rejected - TCP table full");
+            }
+        }
+
+        // Attach the connection to its flow, or reset it
+        call.entry = entry;
+        natLwipRun(&call, natAcceptTakeFn);
+        if (!entry) {
+            continue;
+        }
+        if (entry->upEvents & NAT_UP_ERROR) {
+            natTcpRelease(ctx, entry);  // Gone while it waited
+            continue;
+        }
+
+        entry->state = NAT_TCP_SYN_SENT;  // Wait for SYN-ACK from internal host
+
+        // Initialize serverAck for flow control before sending SYN
+        // serverSeq will be incremented when SYN is sent
+        entry->serverAck = entry->serverSeq;
+
+        NAT_DEBUG_F("NAT: Port forward entry created: src=%d.%d.%d.%d:%d dst=%d.%d.%d.%d:%d",
+                    entry->srcIP[0], entry->srcIP[1], entry->srcIP[2], entry->srcIP[3], entry->srcPort,
+                    entry->dstIP[0], entry->dstIP[1], entry->dstIP[2], entry->dstIP[3], entry->dstPort);
+
+        // Send SYN to internal host
+        entry->rtoTimer = millis();
+        natSendTcpToClient(ctx, entry, 0, TCP_FLAG_SYN);
+    }
+}
+
+// ============================================================================
+// Get Connection Counts
+// ============================================================================
+
+int natGetActiveTcpCount(NatContext* ctx) {
+    return ctx->tcpFlows.count;
+}
+
+int natGetActiveUdpCount(NatContext* ctx) {
+    return ctx->udpFlows.count;
+}
+
+// ============================================================================
+// Port Forward Persistence (EEPROM - shared storage for SLIP and PPP)
+// ============================================================================
+
+void savePortForwards(NatContext* ctx) {
+    for (int i = 0; i < PORTFWD_COUNT; i++) {
+        int addr = PORTFWD_BASE + (i * PORTFWD_SIZE);
+
+        if (ctx->portForwards[i].active) {
+            EEPROM.write(addr, 1);  // active flag
+            EEPROM.write(addr + 1, ctx->portForwards[i].protocol);
+            EEPROM.write(addr + 2, (ctx->portForwards[i].externalPort >> 8) & 0xFF);
+            EEPROM.write(addr + 3, ctx->portForwards[i].externalPort & 0xFF);
+            EEPROM.write(addr + 4, (ctx->portForwards[i].internalPort >> 8) & 0xFF);
+            EEPROM.write(addr + 5, ctx->portForwards[i].internalPort & 0xFF);
+            EEPROM.write(addr + 6, ctx->portForwards[i].internalIP[0]);
+            EEPROM.write(addr + 7, ctx->portForwards[i].internalIP[1]);
+            EEPROM.write(addr + 8, ctx->portForwards[i].internalIP[2]);
+            EEPROM.write(addr + 9, ctx->portForwards[i].internalIP[3]);
+        } else {
+            EEPROM.write(addr, 0);  // inactive
+        }
+    }
+    EEPROM.commit();
+}
+
+void loadPortForwards(NatContext* ctx) {
+    for (int i = 0; i < PORTFWD_COUNT; i++) {
+        int addr = PORTFWD_BASE + (i * PORTFWD_SIZE);
+
+        uint8_t active = EEPROM.read(addr);
+        if (active == 1) {
+            ctx->portForwards[i].active = true;
+            ctx->portForwards[i].protocol = EEPROM.read(addr + 1);
+            ctx->portForwards[i].externalPort = (EEPROM.read(addr + 2) << 8) | EEPROM.read(addr + 3);
+            ctx->portForwards[i].internalPort = (EEPROM.read(addr + 4) << 8) | EEPROM.read(addr + 5);
+            ctx->portForwards[i].internalIP = IPAddress(
+                EEPROM.read(addr + 6),
+                EEPROM.read(addr + 7),
+                EEPROM.read(addr + 8),
+                EEPROM.read(addr + 9)
+            );
+            NAT_DEBUG_F("NAT: Loaded port forward %d: %s %d -> %s:%d",
+                        i,
+                        ctx->portForwards[i].protocol == IP_PROTO_TCP ? "TCP" : "UDP",
+                        ctx->portForwards[i].externalPort,
+                        ctx->portForwards[i].internalIP.toString().c_str(),
+                        ctx->portForwards[i].internalPort);
+        } else {
+            ctx->portForwards[i].active = false;
+        }
+    }
+}
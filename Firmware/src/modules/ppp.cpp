@@ -7,6 +7,9 @@
 #include "ppp.h"
 #include "globals.h"
 #include "network.h"
+#include "vj_compress.h"
+#include "ppp_ccp.h"
+#include "gateway_link.h"
 
 // ============================================================================
 // CRC-16 FCS Table (CCITT polynomial 0x8408, reversed 0x1021)
@@ -66,12 +69,19 @@ void pppInit(PppContext* ctx) {
     // No compression until negotiated
     ctx->addrCtrlCompression = false;
     ctx->protoCompression = false;
+    ctx->vj = nullptr;
+    ctx->ccp = nullptr;
+
+    // No round-trip sample until the first Configure-Request is answered
+    ctx->negotiationRttMs = 0;
 
     // Reset statistics
     ctx->framesReceived = 0;
     ctx->framesSent = 0;
     ctx->fcsErrors = 0;
     ctx->rxErrors = 0;
+    ctx->rxAborts = 0;
+    ctx->rxOverruns = 0;
     ctx->bytesReceived = 0;
     ctx->bytesSent = 0;
 }
@@ -118,7 +128,7 @@ bool pppNeedsEscape(PppContext* ctx, uint8_t byte) {
 // Process one byte at a time from serial input
 // Returns: 0 = continue receiving
 //          >0 = complete frame length (data in rxBuffer, including addr/ctrl/proto)
-//          -1 = FCS error (frame discarded)
+//          -1 = FCS error or aborted frame (frame discarded)
 
 int pppReceiveByte(PppContext* ctx, uint8_t byte) {
     ctx->bytesReceived++;
@@ -206,6 +216,7 @@ int pppReceiveByte(PppContext* ctx, uint8_t byte) {
                 } else {
                     // Buffer overflow - discard frame
                     ctx->rxErrors++;
+                    ctx->rxOverruns++;
                     ctx->rxState = PPP_RX_IDLE;
                     ctx->rxPos = 0;
                 }
@@ -213,6 +224,17 @@ int pppReceiveByte(PppContext* ctx, uint8_t byte) {
             }
 
         case PPP_RX_ESCAPE:
+            // Escape followed by a flag aborts the frame (RFC 1662 section 4.2)
+            // The flag then starts the next frame
+            if (byte == PPP_FLAG) {
+                ctx->rxErrors++;
+                ctx->rxAborts++;
+                ctx->rxState = PPP_RX_RECEIVING;
+                ctx->rxPos = 0;
+                ctx->rxFcs = PPP_FCS_INIT;
+                return -1;
+            }
+
             // Process escaped byte - XOR with 0x20
             ctx->rxState = PPP_RX_RECEIVING;
             byte ^= PPP_ESCAPE_XOR;
@@ -223,6 +245,7 @@ int pppReceiveByte(PppContext* ctx, uint8_t byte) {
             } else {
                 // Buffer overflow
                 ctx->rxErrors++;
+                ctx->rxOverruns++;
                 ctx->rxState = PPP_RX_IDLE;
                 ctx->rxPos = 0;
             }
@@ -241,40 +264,29 @@ int pppReceiveByte(PppContext* ctx, uint8_t byte) {
 // ============================================================================
 // Send PPP-encoded frame
 // ============================================================================
-// Takes protocol and payload, adds framing and FCS, sends to PhysicalSerial
+// Takes protocol and payload, adds framing and FCS, sends over the gateway link
 
 void pppSendFrame(PppContext* ctx, uint16_t protocol,
                   const uint8_t* data, uint16_t length) {
     uint16_t fcs = PPP_FCS_INIT;
 
     // Wait for CTS (Clear To Send) ONCE at start of frame when hardware flow control enabled
-    // F_HARDWARE = 1 (from modem.cpp enum)
-    // Logic matches handleFlowControl(): pause when CTS == pinPolarity
-    if (flowControl == 1) {  // F_HARDWARE
-        unsigned long startWait = millis();
-        while (readCTS()) {
-            if (millis() - startWait > 1000) {
-                // Timeout after 1 second - don't block forever
-                break;
-            }
-            yield();  // Allow other tasks to run
-        }
-    }
+    gwLinkWaitClear();
 
     // Helper to send a byte with escaping if needed
     auto sendByte = [&](uint8_t byte) {
         if (pppNeedsEscape(ctx, byte)) {
-            PhysicalSerial.write(PPP_ESCAPE);
-            PhysicalSerial.write(byte ^ PPP_ESCAPE_XOR);
+            gwLinkWrite(PPP_ESCAPE);
+            gwLinkWrite(byte ^ PPP_ESCAPE_XOR);
             ctx->bytesSent += 2;
         } else {
-            PhysicalSerial.write(byte);
+            gwLinkWrite(byte);
             ctx->bytesSent++;
         }
     };
 
     // Opening flag
-    PhysicalSerial.write(PPP_FLAG);
+    gwLinkWrite(PPP_FLAG);
     ctx->bytesSent++;
 
     // Address field (unless compression negotiated)
@@ -311,16 +323,87 @@ void pppSendFrame(PppContext* ctx, uint16_t protocol,
     sendByte((fcs >> 8) & 0xFF);
 
     // Closing flag
-    PhysicalSerial.write(PPP_FLAG);
+    gwLinkWrite(PPP_FLAG);
     ctx->bytesSent++;
 
     // Flush to ensure all bytes are transmitted before proceeding
     // This prevents TX buffer overflow on large frames
-    PhysicalSerial.flush();
+    gwLinkFlush();
 
     ctx->framesSent++;
 }
 
+// ============================================================================
+// Send IP packet (with optional VJ header compression and CCP)
+// ============================================================================
+
+static void pppSendNetworkFrame(PppContext* ctx, uint16_t protocol,
+                                const uint8_t* data, uint16_t length) {
+    if (ctx->ccp != nullptr && ccpTxActive(ctx->ccp)) {
+        ccpSendCompressed(ctx->ccp, ctx, protocol, data, length);
+    } else {
+        pppSendFrame(ctx, protocol, data, length);
+    }
+}
+
+void pppSendIpPacket(PppContext* ctx, uint8_t* packet, uint16_t length) {
+    uint16_t protocol = PPP_PROTO_IP;
+
+    if (ctx->vj != nullptr && ctx->vj->txEnabled) {
+        switch (vjCompress(ctx->vj, &packet, &length)) {
+            case VJ_TYPE_COMPRESSED_TCP:
+                protocol = PPP_PROTO_VJC_COMP;
+                break;
+            case VJ_TYPE_UNCOMPRESSED_TCP:
+                protocol = PPP_PROTO_VJC_UNCOMP;
+                break;
+            default:
+                break;
+        }
+    }
+
+    pppSendNetworkFrame(ctx, protocol, packet, length);
+}
+
+// ============================================================================
+// Adaptive restart timer
+// ============================================================================
+// A sample is the time from a Configure-Request to its reply. LCP resends
+// a request under the same Identifier, so a reply to a resent request may
+// answer an earlier copy - by Karn's rule it gives no sample. IPCP and CCP
+// number every transmission afresh, so their replies always time the last.
+
+uint16_t pppRestartTimerMs(PppContext* ctx, uint8_t sends) {
+    uint32_t timer = PPP_RESTART_DEFAULT_MS;
+    if (ctx->negotiationRttMs > 0) {
+        timer = (uint32_t)ctx->negotiationRttMs * 2 + 100;
+    }
+    if (timer < PPP_RESTART_MIN_MS) {
+        timer = PPP_RESTART_MIN_MS;
+    }
+
+    // Exponential backoff for retransmissions
+    for (uint8_t i = 1; i < sends && timer < PPP_RESTART_MAX_MS; i++) {
+        timer <<= 1;
+    }
+    if (timer > PPP_RESTART_MAX_MS) {
+        timer = PPP_RESTART_MAX_MS;
+    }
+    return (uint16_t)timer;
+}
+
+void pppNoteNegotiationRtt(PppContext* ctx, unsigned long sampleMs) {
+    if (sampleMs > PPP_RESTART_MAX_MS) {
+        sampleMs = PPP_RESTART_MAX_MS;
+    }
+    if (ctx->negotiationRttMs == 0) {
+        ctx->negotiationRttMs = sampleMs;
+    } else {
+        // 1/4 weight for the new sample
+        ctx->negotiationRttMs = (ctx->negotiationRttMs * 3 + sampleMs) / 4;
+    }
+}
+
 // ============================================================================
 // Reset PPP receiver state
 // ============================================================================
@@ -0,0 +1,665 @@
+// ============================================================================
+// PPP Compression Control Protocol (CCP) Implementation - RFC 1962
+// ============================================================================
+// Predictor type 1 (RFC 1978): each byte is guessed from a 64KB table
+// indexed by a hash of the preceding bytes. Cheap enough to run inline at
+// serial speeds, and only the tables themselves need heap.
+// ============================================================================
+
+#include "ppp_ccp.h"
+#include "globals.h"
+
+// ============================================================================
+// Debug output
+// ============================================================================
+
+#ifdef PPP_DEBUG
+#define CCP_DEBUG(msg) Serial.print(msg); Serial.print("\r\n")
+#define CCP_DEBUG_F(fmt, ...) Serial.printf(fmt "\r\n", ##__VA_ARGS__)
+#else
+#define CCP_DEBUG(msg)
+#define CCP_DEBUG_F(fmt, ...)
+#endif
+
+// Staging buffers (protocol + datagram, and the encoded result)
+static uint8_t ccpTxStage[PPP_BUFFER_SIZE];
+static uint8_t ccpTxOut[PPP_BUFFER_SIZE + PPP_BUFFER_SIZE / 8 + 8];
+
+// ============================================================================
+// Predictor-1 codec
+// ============================================================================
+
+#define PRED1_HASH(st, x) ((st)->hash = (uint16_t)(((st)->hash << 4) ^ (x)))
+
+static uint16_t pred1Compress(CcpPred1State* st, const uint8_t* src, uint16_t len,
+                              uint8_t* dest) {
+    uint8_t* orgDest = dest;
+    while (len) {
+        uint8_t* flagDest = dest++;
+        uint8_t flags = 0;
+        for (uint8_t bit = 1; bit && len; bit <<= 1) {
+            if (st->table[st->hash] == *src) {
+                flags |= bit;
+            } else {
+                st->table[st->hash] = *src;
+                *dest++ = *src;
+            }
+            PRED1_HASH(st, *src++);
+            len--;
+        }
+        *flagDest = flags;
+    }
+    return dest - orgDest;
+}
+
+// Returns decompressed length, or -1 if the output would overflow
+static int pred1Decompress(CcpPred1State* st, const uint8_t* src, uint16_t len,
+                           uint8_t* dest, uint16_t destSize) {
+    uint8_t* orgDest = dest;
+    uint8_t* destEnd = dest + destSize;
+    while (len) {
+        uint8_t flags = *src++;
+        len--;
+        for (uint8_t i = 0; i < 8; i++, flags >>= 1) {
+            if (!(flags & 1) && len == 0) {
+                break;  // Short final group
+            }
+            if (dest >= destEnd) {
+                return -1;
+            }
+            if (flags & 1) {
+                *dest = st->table[st->hash];
+            } else {
+                st->table[st->hash] = *src;
+                *dest = *src++;
+                len--;
+            }
+            PRED1_HASH(st, *dest++);
+        }
+    }
+    return dest - orgDest;
+}
+
+// Uncompressed packets still feed the guess table on both sides
+static void pred1Sync(CcpPred1State* st, const uint8_t* src, uint8_t* dest, uint16_t len) {
+    while (len--) {
+        st->table[st->hash] = *src;
+        *dest = *src++;
+        PRED1_HASH(st, *dest++);
+    }
+}
+
+// ============================================================================
+// Guess table management (heap-aware)
+// ============================================================================
+
+static bool ccpAllocTable(CcpContext* ctx, CcpPred1State* st) {
+    if (!st->table) {
+        if (ESP.getFreeHeap() < CCP_PRED1_TABLE_SIZE + CCP_HEAP_RESERVE ||
+            ESP.getMaxAllocHeap() < CCP_PRED1_TABLE_SIZE) {
+            ctx->heapRefusals++;
+            CCP_DEBUG_F("CCP: Not enough heap for Predictor-1 table (free=%u)",
+                        ESP.getFreeHeap());
+            return false;
+        }
+        st->table = (uint8_t*)malloc(CCP_PRED1_TABLE_SIZE);
+        if (!st->table) {
+            ctx->heapRefusals++;
+            return false;
+        }
+    }
+    memset(st->table, 0, CCP_PRED1_TABLE_SIZE);
+    st->hash = 0;
+    return true;
+}
+
+static void ccpFreeTable(CcpPred1State* st) {
+    if (st->table) {
+        free(st->table);
+        st->table = nullptr;
+    }
+    st->hash = 0;
+}
+
+static void ccpResetTable(CcpPred1State* st) {
+    if (st->table) {
+        memset(st->table, 0, CCP_PRED1_TABLE_SIZE);
+    }
+    st->hash = 0;
+}
+
+// ============================================================================
+// Initialize CCP Context
+// ============================================================================
+
+void ccpInit(CcpContext* ctx) {
+    memset(ctx, 0, sizeof(CcpContext));
+    ctx->state = CCP_STATE_INITIAL;
+    ctx->tx.table = nullptr;
+    ctx->rx.table = nullptr;
+}
+
+// ============================================================================
+// Send helpers
+// ============================================================================
+
+// Retransmissions too take a fresh Identifier, so a late reply to an
+// earlier copy is ignored rather than timed against this one
+static void ccpSendConfigRequest(CcpContext* ctx, PppContext* ppp) {
+    uint8_t packet[8];
+    uint16_t pos = 0;
+
+    packet[pos++] = CCP_CONFIGURE_REQUEST;
+    packet[pos++] = ++ctx->identifier;
+    uint16_t lenPos = pos;
+    pos += 2;
+
+    // Option: we can decompress Predictor-1
+    if (ctx->ourRequest) {
+        packet[pos++] = CCP_OPT_PREDICTOR1;
+        packet[pos++] = 2;
+    }
+
+    packet[lenPos] = (pos >> 8) & 0xFF;
+    packet[lenPos + 1] = pos & 0xFF;
+
+    pppSendFrame(ppp, PPP_PROTO_CCP, packet, pos);
+    ctx->lastSendTime = millis();
+    ctx->configRetries++;
+
+    CCP_DEBUG_F("CCP: Sent Configure-Request id=%d (Predictor-1 %s)",
+                ctx->identifier, ctx->ourRequest ? "requested" : "not requested");
+}
+
+static void ccpSendReply(PppContext* ppp, uint8_t code, uint8_t id,
+                         const uint8_t* options, uint16_t optLen) {
+    uint8_t packet[64];
+    if (optLen > sizeof(packet) - 4) {
+        optLen = sizeof(packet) - 4;
+    }
+    uint16_t totalLen = 4 + optLen;
+    packet[0] = code;
+    packet[1] = id;
+    packet[2] = (totalLen >> 8) & 0xFF;
+    packet[3] = totalLen & 0xFF;
+    if (optLen > 0) {
+        memcpy(&packet[4], options, optLen);
+    }
+    pppSendFrame(ppp, PPP_PROTO_CCP, packet, totalLen);
+}
+
+static void ccpSendResetRequest(CcpContext* ctx, PppContext* ppp) {
+    ccpSendReply(ppp, CCP_RESET_REQUEST, ++ctx->resetId, nullptr, 0);
+    ctx->rxResetPending = true;
+    ctx->lastResetTime = millis();
+    ctx->resetRequestsSent++;
+    CCP_DEBUG_F("CCP: Sent Reset-Request id=%d", ctx->resetId);
+}
+
+// ============================================================================
+// State helpers
+// ============================================================================
+
+static void ccpEnterOpened(CcpContext* ctx) {
+    ctx->state = CCP_STATE_OPENED;
+    ctx->rxResetPending = false;
+
+    // Directions that ended up unused don't need their tables
+    if (!ctx->peerAccepted) {
+        ccpFreeTable(&ctx->tx);
+    }
+    if (!ctx->ourAcked) {
+        ccpFreeTable(&ctx->rx);
+    }
+    ccpResetTable(&ctx->tx);
+    ccpResetTable(&ctx->rx);
+
+    CCP_DEBUG_F("CCP: OPENED (tx %s, rx %s)",
+                ccpTxActive(ctx) ? "Predictor-1" : "none",
+                ccpRxActive(ctx) ? "Predictor-1" : "none");
+}
+
+static void ccpStop(CcpContext* ctx, CcpState state) {
+    ctx->state = state;
+    ctx->rxResetPending = false;
+    ccpFreeTable(&ctx->tx);
+    ccpFreeTable(&ctx->rx);
+}
+
+// ============================================================================
+// Handle incoming Configure-Request
+// ============================================================================
+
+static void ccpHandleConfigRequest(CcpContext* ctx, PppContext* ppp,
+                                    uint8_t id, uint8_t* options, uint16_t optLen) {
+    uint8_t ackOptions[64];
+    uint8_t rejOptions[64];
+    uint16_t ackLen = 0;
+    uint16_t rejLen = 0;
+
+    // Peer renegotiating an open link - restart our side too
+    if (ctx->state == CCP_STATE_OPENED) {
+        ctx->ourAcked = false;
+        ctx->state = CCP_STATE_REQ_SENT;
+        ctx->configRetries = 0;
+        ccpSendConfigRequest(ctx, ppp);
+    }
+
+    ctx->peerAccepted = false;
+
+    uint16_t pos = 0;
+    while (pos + 1 < optLen) {
+        uint8_t optType = options[pos];
+        uint8_t optLen2 = options[pos + 1];
+
+        if (optLen2 < 2 || pos + optLen2 > optLen) {
+            break;  // Malformed
+        }
+
+        if (optType == CCP_OPT_PREDICTOR1 && optLen2 == 2 && !ctx->peerAccepted &&
+            ccpAllocTable(ctx, &ctx->tx)) {
+            ctx->peerAccepted = true;
+            if (ackLen + optLen2 <= sizeof(ackOptions)) {
+                memcpy(&ackOptions[ackLen], &options[pos], optLen2);
+                ackLen += optLen2;
+            }
+        } else {
+            // Other algorithms (STAC, MPPC, Deflate, BSD) or no heap - reject
+            CCP_DEBUG_F("CCP: Rejecting option %d", optType);
+            if (rejLen + optLen2 <= sizeof(rejOptions)) {
+                memcpy(&rejOptions[rejLen], &options[pos], optLen2);
+                rejLen += optLen2;
+            }
+        }
+
+        pos += optLen2;
+    }
+
+    if (rejLen > 0) {
+        ctx->peerAccepted = false;
+        ccpSendReply(ppp, CCP_CONFIGURE_REJECT, id, rejOptions, rejLen);
+        CCP_DEBUG_F("CCP: Sent Configure-Reject id=%d", id);
+        return;
+    }
+
+    ccpSendReply(ppp, CCP_CONFIGURE_ACK, id, ackOptions, ackLen);
+    CCP_DEBUG_F("CCP: Sent Configure-Ack id=%d", id);
+
+    switch (ctx->state) {
+        case CCP_STATE_REQ_SENT:
+            ctx->state = CCP_STATE_ACK_SENT;
+            break;
+        case CCP_STATE_ACK_RCVD:
+            ccpEnterOpened(ctx);
+            break;
+        default:
+            break;
+    }
+}
+
+// ============================================================================
+// Handle Configure-Ack / Nak / Reject
+// ============================================================================
+
+static void ccpHandleConfigAck(CcpContext* ctx, PppContext* ppp, uint8_t id) {
+    if (id != ctx->identifier) {
+        return;
+    }
+
+    pppNoteNegotiationRtt(ppp, millis() - ctx->lastSendTime);
+
+    ctx->configRetries = 0;
+    ctx->ourAcked = ctx->ourRequest;
+
+    switch (ctx->state) {
+        case CCP_STATE_REQ_SENT:
+            ctx->state = CCP_STATE_ACK_RCVD;
+            break;
+        case CCP_STATE_ACK_SENT:
+            ccpEnterOpened(ctx);
+            break;
+        default:
+            break;
+    }
+}
+
+static void ccpHandleConfigNakOrReject(CcpContext* ctx, PppContext* ppp, uint8_t id) {
+    if (id != ctx->identifier) {
+        return;
+    }
+
+    pppNoteNegotiationRtt(ppp, millis() - ctx->lastSendTime);
+
+    // Predictor-1 is the only algorithm we offer and it has no parameters,
+    // so either response means the peer won't use it toward us
+    if (ctx->ourRequest) {
+        ctx->ourRequest = false;
+        ctx->peerDeclines = true;
+        ccpFreeTable(&ctx->rx);
+        CCP_DEBUG("CCP: Peer declined Predictor-1");
+    }
+
+    ctx->configRetries = 0;
+    ccpSendConfigRequest(ctx, ppp);
+}
+
+// ============================================================================
+// Start CCP negotiation
+// ============================================================================
+
+void ccpOpen(CcpContext* ctx, PppContext* ppp) {
+    if (!ctx->enabled) {
+        return;
+    }
+
+    ccpFreeTable(&ctx->tx);
+    ccpFreeTable(&ctx->rx);
+
+    ctx->state = CCP_STATE_REQ_SENT;
+    ctx->identifier = 0;
+    ctx->configRetries = 0;
+    ctx->ourAcked = false;
+    ctx->peerAccepted = false;
+    ctx->rxResetPending = false;
+
+    // Per-session statistics
+    ctx->txBytesIn = 0;
+    ctx->txBytesOut = 0;
+    ctx->rxBytesIn = 0;
+    ctx->rxBytesOut = 0;
+    ctx->rxErrors = 0;
+    ctx->resetRequestsSent = 0;
+    ctx->resetRequestsRcvd = 0;
+
+    // Only offer to decompress if the peer takes it and the table fits
+    ctx->ourRequest = !ctx->peerDeclines && ccpAllocTable(ctx, &ctx->rx);
+
+    ccpSendConfigRequest(ctx, ppp);
+    CCP_DEBUG("CCP: Started negotiation");
+}
+
+// ============================================================================
+// Close CCP
+// ============================================================================
+
+void ccpClose(CcpContext* ctx) {
+    ccpStop(ctx, CCP_STATE_CLOSED);
+}
+
+void ccpProtocolRejected(CcpContext* ctx) {
+    if (ctx->state != CCP_STATE_INITIAL) {
+        ccpStop(ctx, CCP_STATE_STOPPED);
+        CCP_DEBUG("CCP: Protocol rejected by peer");
+    }
+}
+
+// ============================================================================
+// Process incoming CCP packet
+// ============================================================================
+
+void ccpProcessPacket(CcpContext* ctx, PppContext* ppp,
+                      uint8_t* data, uint16_t length) {
+    if (!ctx->enabled || length < 4) {
+        return;
+    }
+
+    uint8_t code = data[0];
+    uint8_t id = data[1];
+    uint16_t pktLen = ((uint16_t)data[2] << 8) | data[3];
+
+    if (pktLen > length || pktLen < 4) {
+        return;
+    }
+
+    uint8_t* options = &data[4];
+    uint16_t optLen = pktLen - 4;
+
+    CCP_DEBUG_F("CCP: Received code=%d id=%d len=%d (state=%s)",
+                code, id, pktLen, ccpStateName(ctx->state));
+
+    switch (code) {
+        case CCP_CONFIGURE_REQUEST:
+            if (ctx->state == CCP_STATE_INITIAL || ctx->state == CCP_STATE_CLOSED ||
+                ctx->state == CCP_STATE_STOPPED) {
+                // Peer started (or restarted) CCP first
+                ccpOpen(ctx, ppp);
+            }
+            ccpHandleConfigRequest(ctx, ppp, id, options, optLen);
+            break;
+
+        case CCP_CONFIGURE_ACK:
+            ccpHandleConfigAck(ctx, ppp, id);
+            break;
+
+        case CCP_CONFIGURE_NAK:
+        case CCP_CONFIGURE_REJECT:
+            ccpHandleConfigNakOrReject(ctx, ppp, id);
+            break;
+
+        case CCP_TERMINATE_REQUEST:
+            ccpSendReply(ppp, CCP_TERMINATE_ACK, id, nullptr, 0);
+            ccpStop(ctx, CCP_STATE_STOPPED);
+            CCP_DEBUG("CCP: Terminated by peer");
+            break;
+
+        case CCP_TERMINATE_ACK:
+            if (ctx->state == CCP_STATE_CLOSING) {
+                ccpStop(ctx, CCP_STATE_CLOSED);
+            }
+            break;
+
+        case CCP_RESET_REQUEST:
+            // Peer's decompressor lost sync - restart our compressor
+            if (ctx->state == CCP_STATE_OPENED) {
+                ctx->resetRequestsRcvd++;
+                ccpResetTable(&ctx->tx);
+                ccpSendReply(ppp, CCP_RESET_ACK, id, nullptr, 0);
+                CCP_DEBUG_F("CCP: Reset-Request id=%d, compressor reset", id);
+            }
+            break;
+
+        case CCP_RESET_ACK:
+            // Peer has reset its compressor - restart our decompressor to match
+            if (ctx->rxResetPending && id == ctx->resetId) {
+                ccpResetTable(&ctx->rx);
+                ctx->rxResetPending = false;
+                CCP_DEBUG("CCP: Reset-Ack, decompressor reset");
+            }
+            break;
+
+        default:
+            CCP_DEBUG_F("CCP: Unknown code %d", code);
+            break;
+    }
+}
+
+// ============================================================================
+// Handle timeout
+// ============================================================================
+
+bool ccpTimeout(CcpContext* ctx, PppContext* ppp) {
+    unsigned long now = millis();
+
+    // Reset-Request or its Ack may have been lost
+    if (ctx->rxResetPending && now - ctx->lastResetTime >= CcpContext::RESET_TIMER_MS) {
+        ccpSendResetRequest(ctx, ppp);
+        return false;
+    }
+
+    if (ctx->lastSendTime == 0 || now - ctx->lastSendTime < pppRestartTimerMs(ppp, ctx->configRetries)) {
+        return false;
+    }
+
+    switch (ctx->state) {
+        case CCP_STATE_REQ_SENT:
+        case CCP_STATE_ACK_RCVD:
+        case CCP_STATE_ACK_SENT:
+            if (ctx->configRetries < CcpContext::MAX_CONFIGURE) {
+                ccpSendConfigRequest(ctx, ppp);
+            } else {
+                // Peer never answered - run without compression
+                ccpStop(ctx, CCP_STATE_STOPPED);
+                CCP_DEBUG("CCP: Max retries exceeded");
+            }
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
+// ============================================================================
+// Compress and send a datagram (RFC 1978 section 3.1)
+// ============================================================================
+// Payload: 16-bit original length (top bit set if compressed), data,
+// CRC-16 over the original length, protocol and data
+
+void ccpSendCompressed(CcpContext* ctx, PppContext* ppp, uint16_t protocol,
+                       const uint8_t* data, uint16_t length) {
+    uint16_t origLen = length + 2;
+    if (origLen > sizeof(ccpTxStage)) {
+        pppSendFrame(ppp, protocol, data, length);
+        return;
+    }
+
+    ccpTxStage[0] = (protocol >> 8) & 0xFF;
+    ccpTxStage[1] = protocol & 0xFF;
+    memcpy(&ccpTxStage[2], data, length);
+
+    uint16_t fcs = PPP_FCS_INIT;
+    fcs = pppCalcFcs(fcs, (origLen >> 8) & 0xFF);
+    fcs = pppCalcFcs(fcs, origLen & 0xFF);
+    for (uint16_t i = 0; i < origLen; i++) {
+        fcs = pppCalcFcs(fcs, ccpTxStage[i]);
+    }
+    fcs ^= 0xFFFF;
+
+    uint16_t pos = 2;
+    uint16_t compLen = pred1Compress(&ctx->tx, ccpTxStage, origLen, &ccpTxOut[pos]);
+    if (compLen < origLen) {
+        ccpTxOut[0] = ((origLen >> 8) & 0x7F) | 0x80;
+        pos += compLen;
+    } else {
+        // Incompressible - send as-is (the table was still updated above)
+        ccpTxOut[0] = (origLen >> 8) & 0x7F;
+        memcpy(&ccpTxOut[pos], ccpTxStage, origLen);
+        pos += origLen;
+    }
+    ccpTxOut[1] = origLen & 0xFF;
+    ccpTxOut[pos++] = fcs & 0xFF;
+    ccpTxOut[pos++] = (fcs >> 8) & 0xFF;
+
+    ctx->txBytesIn += origLen;
+    ctx->txBytesOut += pos;
+
+    pppSendFrame(ppp, PPP_PROTO_COMP, ccpTxOut, pos);
+}
+
+// ============================================================================
+// Decompress a received datagram
+// ============================================================================
+
+int ccpDecompress(CcpContext* ctx, PppContext* ppp, const uint8_t* in, uint16_t inLen,
+                  uint16_t* protocol, uint8_t* out, uint16_t outSize) {
+    // Waiting for the peer to acknowledge our reset - history is unusable
+    if (ctx->rxResetPending) {
+        return -1;
+    }
+
+    if (inLen < 5) {
+        goto bad;
+    }
+
+    {
+        bool compressed = (in[0] & 0x80) != 0;
+        uint16_t origLen = ((uint16_t)(in[0] & 0x7F) << 8) | in[1];
+        const uint8_t* data = in + 2;
+        uint16_t dataLen = inLen - 4;
+
+        if (origLen < 2 || origLen > outSize) {
+            goto bad;
+        }
+
+        if (compressed) {
+            if (pred1Decompress(&ctx->rx, data, dataLen, out, origLen) != origLen) {
+                goto bad;
+            }
+        } else {
+            if (dataLen != origLen) {
+                goto bad;
+            }
+            pred1Sync(&ctx->rx, data, out, origLen);
+        }
+
+        uint16_t fcs = PPP_FCS_INIT;
+        fcs = pppCalcFcs(fcs, (origLen >> 8) & 0xFF);
+        fcs = pppCalcFcs(fcs, origLen & 0xFF);
+        for (uint16_t i = 0; i < origLen; i++) {
+            fcs = pppCalcFcs(fcs, out[i]);
+        }
+        fcs = pppCalcFcs(fcs, in[inLen - 2]);
+        fcs = pppCalcFcs(fcs, in[inLen - 1]);
+        if (fcs != PPP_FCS_GOOD) {
+            goto bad;
+        }
+
+        // Inner protocol field may itself be compressed to one byte
+        uint16_t skip;
+        if (out[0] & 0x01) {
+            *protocol = out[0];
+            skip = 1;
+        } else {
+            *protocol = ((uint16_t)out[0] << 8) | out[1];
+            skip = 2;
+        }
+        memmove(out, out + skip, origLen - skip);
+
+        ctx->rxBytesIn += inLen;
+        ctx->rxBytesOut += origLen;
+        return origLen - skip;
+    }
+
+bad:
+    ctx->rxErrors++;
+    CCP_DEBUG_F("CCP: Decompression failed (len=%d), requesting reset", inLen);
+    ccpSendResetRequest(ctx, ppp);
+    return -1;
+}
+
+// ============================================================================
+// Compression ratios
+// ============================================================================
+
+uint16_t ccpTxRatio(CcpContext* ctx) {
+    if (ctx->txBytesOut == 0) {
+        return 100;
+    }
+    return (uint16_t)(((uint64_t)ctx->txBytesIn * 100) / ctx->txBytesOut);
+}
+
+uint16_t ccpRxRatio(CcpContext* ctx) {
+    if (ctx->rxBytesIn == 0) {
+        return 100;
+    }
+    return (uint16_t)(((uint64_t)ctx->rxBytesOut * 100) / ctx->rxBytesIn);
+}
+
+// ============================================================================
+// Get state name
+// ============================================================================
+
+const char* ccpStateName(CcpState state) {
+    switch (state) {
+        case CCP_STATE_INITIAL: return "INITIAL";
+        case CCP_STATE_CLOSED: return "CLOSED";
+        case CCP_STATE_STOPPED: return "STOPPED";
+        case CCP_STATE_CLOSING: return "CLOSING";
+        case CCP_STATE_REQ_SENT: return "REQ-SENT";
+        case CCP_STATE_ACK_RCVD: return "ACK-RCVD";
+        case CCP_STATE_ACK_SENT: return "ACK-SENT";
+        case CCP_STATE_OPENED: return "OPENED";
+        default: return "UNKNOWN";
+    }
+}
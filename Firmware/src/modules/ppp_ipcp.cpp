@@ -41,6 +41,16 @@ void ipcpInit(IpcpContext* ctx) {
     }
     ctx->pool.currentIndex = -1;
 
+    // VJ compression (enabled by PPP config)
+    ctx->vjAllowed = false;
+    ctx->vjRequest = false;
+    ctx->vjPeerRejects = false;
+    ctx->vjOurMaxSlot = IPCP_VJ_MAX_SLOT_ID;
+    ctx->vjOurAcked = false;
+    ctx->vjPeerAccepted = false;
+    ctx->vjPeerMaxSlot = 0;
+    ctx->vjPeerCompSlot = false;
+
     // Request tracking
     ctx->identifier = 0;
     ctx->configRetries = 0;
@@ -102,6 +112,8 @@ void ipcpReleaseIP(IpcpContext* ctx) {
 // Send Configure-Request
 // ============================================================================
 
+// Retransmissions too take a fresh Identifier, so a late reply to an
+// earlier copy is ignored rather than timed against this one
 static void ipcpSendConfigRequest(IpcpContext* ctx, PppContext* ppp) {
     uint8_t packet[32];
     uint16_t pos = 0;
@@ -120,6 +132,16 @@ static void ipcpSendConfigRequest(IpcpContext* ctx, PppContext* ppp) {
     packet[pos++] = ctx->ourIP[2];
     packet[pos++] = ctx->ourIP[3];
 
+    // Option: VJ compression toward us (unless the peer rejected it)
+    if (ctx->vjRequest) {
+        packet[pos++] = IPCP_OPT_IP_COMPRESSION;
+        packet[pos++] = 6;
+        packet[pos++] = (IPCP_VJ_PROTOCOL >> 8) & 0xFF;
+        packet[pos++] = IPCP_VJ_PROTOCOL & 0xFF;
+        packet[pos++] = ctx->vjOurMaxSlot;
+        packet[pos++] = 1;      // Slot id may be compressed
+    }
+
     // Fill in length
     packet[lenPos] = (pos >> 8) & 0xFF;
     packet[lenPos + 1] = pos & 0xFF;
@@ -212,6 +234,9 @@ static void ipcpHandleConfigRequest(IpcpContext* ctx, PppContext* ppp,
     uint16_t nakLen = 0;
     uint16_t rejLen = 0;
 
+    // Only the options in this request count
+    ctx->vjPeerAccepted = false;
+
     uint16_t pos = 0;
     while (pos < optLen) {
         uint8_t optType = options[pos];
@@ -364,12 +389,35 @@ static void ipcpHandleConfigRequest(IpcpContext* ctx, PppContext* ppp,
                 break;
             }
 
-            case IPCP_OPT_IP_COMPRESSION:
-                // Reject VJ compression - too complex for our needs
-                memcpy(&rejOptions[rejLen], &options[pos], optLen2);
-                rejLen += optLen2;
-                IPCP_DEBUG("IPCP: Rejecting IP compression");
+            case IPCP_OPT_IP_COMPRESSION: {
+                // Peer asks us to compress toward it
+                uint16_t proto = (optLen2 >= 4) ?
+                    (((uint16_t)options[pos + 2] << 8) | options[pos + 3]) : 0;
+
+                if (!ctx->vjAllowed || proto != IPCP_VJ_PROTOCOL || optLen2 != 6) {
+                    memcpy(&rejOptions[rejLen], &options[pos], optLen2);
+                    rejLen += optLen2;
+                    IPCP_DEBUG("IPCP: Rejecting IP compression");
+                } else if (options[pos + 4] > IPCP_VJ_MAX_SLOT_ID) {
+                    // More slots than we keep - suggest our maximum
+                    nakOptions[nakLen++] = IPCP_OPT_IP_COMPRESSION;
+                    nakOptions[nakLen++] = 6;
+                    nakOptions[nakLen++] = (IPCP_VJ_PROTOCOL >> 8) & 0xFF;
+                    nakOptions[nakLen++] = IPCP_VJ_PROTOCOL & 0xFF;
+                    nakOptions[nakLen++] = IPCP_VJ_MAX_SLOT_ID;
+                    nakOptions[nakLen++] = options[pos + 5];
+                    IPCP_DEBUG_F("IPCP: NAKing VJ max slot %d", options[pos + 4]);
+                } else {
+                    ctx->vjPeerAccepted = true;
+                    ctx->vjPeerMaxSlot = options[pos + 4];
+                    ctx->vjPeerCompSlot = options[pos + 5] != 0;
+                    memcpy(&ackOptions[ackLen], &options[pos], optLen2);
+                    ackLen += optLen2;
+                    IPCP_DEBUG_F("IPCP: ACKing VJ compression (max slot %d)",
+                                 ctx->vjPeerMaxSlot);
+                }
                 break;
+            }
 
             case IPCP_OPT_IP_ADDRESSES:
                 // Deprecated old option - reject
@@ -438,7 +486,9 @@ static void ipcpHandleConfigAck(IpcpContext* ctx, PppContext* ppp,
         return;
     }
 
+    pppNoteNegotiationRtt(ppp, millis() - ctx->lastSendTime);
     ctx->configRetries = 0;
+    ctx->vjOurAcked = ctx->vjRequest;
 
     IPCP_DEBUG_F("IPCP: Configure-Ack accepted id=%d, state=%d", id, ctx->state);
 
@@ -469,6 +519,8 @@ static void ipcpHandleConfigNak(IpcpContext* ctx, PppContext* ppp,
         return;
     }
 
+    pppNoteNegotiationRtt(ppp, millis() - ctx->lastSendTime);
+
     // Parse NAKed options and adjust
     uint16_t pos = 0;
     while (pos < optLen) {
@@ -484,6 +536,22 @@ static void ipcpHandleConfigNak(IpcpContext* ctx, PppContext* ppp,
                              ctx->ourIP[0], ctx->ourIP[1],
                              ctx->ourIP[2], ctx->ourIP[3]);
                 break;
+
+            case IPCP_OPT_IP_COMPRESSION:
+                // Peer wants fewer slots, or a protocol we don't speak
+                if (optLen2 == 6 &&
+                    (((uint16_t)options[pos + 2] << 8) | options[pos + 3]) == IPCP_VJ_PROTOCOL &&
+                    options[pos + 4] <= IPCP_VJ_MAX_SLOT_ID) {
+                    ctx->vjOurMaxSlot = options[pos + 4];
+                    IPCP_DEBUG_F("IPCP: Peer NAKed VJ, using max slot %d", ctx->vjOurMaxSlot);
+                } else {
+                    ctx->vjRequest = false;
+                }
+                break;
+        }
+
+        if (optLen2 < 2) {
+            break;  // Malformed
         }
 
         pos += optLen2;
@@ -504,6 +572,19 @@ static void ipcpHandleConfigReject(IpcpContext* ctx, PppContext* ppp,
         return;
     }
 
+    pppNoteNegotiationRtt(ppp, millis() - ctx->lastSendTime);
+
+    // Drop rejected VJ compression from further requests
+    uint16_t pos = 0;
+    while (pos + 1 < optLen && options[pos + 1] >= 2) {
+        if (options[pos] == IPCP_OPT_IP_COMPRESSION) {
+            ctx->vjRequest = false;
+            ctx->vjPeerRejects = true;
+            IPCP_DEBUG("IPCP: Peer rejected VJ compression");
+        }
+        pos += options[pos + 1];
+    }
+
     // For our minimal implementation, if IP address is rejected, that's a problem
     // Just try again without the rejected options (though IP is required)
     ctx->configRetries = 0;
@@ -520,6 +601,11 @@ void ipcpOpen(IpcpContext* ctx, PppContext* ppp) {
     ctx->identifier = 0;
     ctx->peerIPAssigned = false;
 
+    ctx->vjRequest = ctx->vjAllowed && !ctx->vjPeerRejects;
+    ctx->vjOurMaxSlot = IPCP_VJ_MAX_SLOT_ID;
+    ctx->vjOurAcked = false;
+    ctx->vjPeerAccepted = false;
+
     ipcpSendConfigRequest(ctx, ppp);
     IPCP_DEBUG("IPCP: Started negotiation");
 }
@@ -624,7 +710,7 @@ bool ipcpTimeout(IpcpContext* ctx, PppContext* ppp) {
     }
 
     unsigned long now = millis();
-    if (now - ctx->lastSendTime < IpcpContext::RESTART_TIMER_MS) {
+    if (now - ctx->lastSendTime < pppRestartTimerMs(ppp, ctx->configRetries)) {
         return false;
     }
 
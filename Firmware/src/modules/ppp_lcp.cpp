@@ -37,6 +37,7 @@ void lcpInit(LcpContext* ctx) {
     // Request tracking
     ctx->identifier = 0;
     ctx->configRetries = 0;
+    ctx->retransmitted = false;
     ctx->termRetries = 0;
     ctx->lastSendTime = 0;
 
@@ -44,19 +45,105 @@ void lcpInit(LcpContext* ctx) {
     ctx->ourMruAcked = false;
     ctx->ourAccmAcked = false;
     ctx->ourMagicAcked = false;
+
+    // Honor negotiated ACCM unless the peer looks like it needs full escaping
+    ctx->accmProfile = LCP_ACCM_AUTO;
+    ctx->peerLegacy = false;
+    ctx->rejectedProtocol = 0;
+
+    // Send every option until the peer rejects it
+    ctx->omitAccm = false;
+    ctx->omitMagic = false;
+    ctx->peerFingerprint = 0;
+
+    // Link quality reporting is off unless PPP mode enables it
+    ctx->lqrAllowed = false;
+    ctx->omitQuality = false;
+    ctx->ourLqrPeriod = LCP_LQR_PERIOD;
+    ctx->ourLqrAcked = false;
+    ctx->peerLqrAccepted = false;
+    ctx->peerLqrPeriod = 0;
+
+    ctx->echoReplied = false;
+    ctx->echoReplyId = 0;
+    ctx->echoLooped = false;
+}
+
+// ============================================================================
+// Fingerprint a peer's Configure-Request
+// ============================================================================
+// FNV-1a over the options, skipping the random magic number value, so the
+// same client software produces the same hash on every call.
+
+static uint32_t lcpFingerprint(const uint8_t* options, uint16_t optLen) {
+    uint32_t hash = 2166136261UL;
+    uint16_t pos = 0;
+    while (pos + 1 < optLen) {
+        uint8_t optType = options[pos];
+        uint8_t optLen2 = options[pos + 1];
+        if (optLen2 < 2 || pos + optLen2 > optLen) {
+            break;
+        }
+        uint8_t hashLen = (optType == LCP_OPT_MAGIC_NUMBER) ? 2 : optLen2;
+        for (uint8_t i = 0; i < hashLen; i++) {
+            hash = (hash ^ options[pos + i]) * 16777619UL;
+        }
+        pos += optLen2;
+    }
+    return hash ? hash : 1;
+}
+
+// ============================================================================
+// Apply negotiated ACCM to the framing layer
+// ============================================================================
+// Called when the link opens. txAccm is driven by what the PEER asked us to
+// escape in its Configure-Request; rxAccm by what the peer ACKed for us.
+
+static void lcpApplyAccm(LcpContext* ctx, PppContext* ppp) {
+    uint32_t accm;
+
+    switch (ctx->accmProfile) {
+        case LCP_ACCM_CONSERVATIVE:
+            accm = 0xFFFFFFFF;
+            break;
+        case LCP_ACCM_NEGOTIATED:
+            accm = ctx->peerAccm;
+            break;
+        case LCP_ACCM_AUTO:
+        default:
+            // Windows 9x serial drivers may act on raw control characters even
+            // after agreeing to a zero ACCM, so fall back for those peers
+            accm = ctx->peerLegacy ? 0xFFFFFFFF : ctx->peerAccm;
+            break;
+    }
+
+    // Software flow control on our side of the line: never send raw XON/XOFF
+    if (flowControl == F_SOFTWARE) {
+        accm |= LCP_ACCM_XON_XOFF;
+    }
+
+    ppp->txAccm = accm;
+    ppp->rxAccm = ctx->ourAccmAcked ? ctx->ourAccm : 0xFFFFFFFF;
+
+    LCP_DEBUG_F("LCP: ACCM profile=%s peer=0x%08lX tx=0x%08lX%s",
+                lcpAccmProfileName(ctx->accmProfile),
+                (unsigned long)ctx->peerAccm, (unsigned long)ppp->txAccm,
+                ctx->peerLegacy ? " (legacy peer)" : "");
 }
 
 // ============================================================================
 // Send Configure-Request
 // ============================================================================
 
-static void lcpSendConfigRequest(LcpContext* ctx, PppContext* ppp) {
+// A retransmission repeats the last request unchanged, so it keeps its
+// Identifier (RFC 1661 5.1) and a late Ack for the first copy still counts
+static void lcpSendConfigRequest(LcpContext* ctx, PppContext* ppp, bool retransmit) {
     uint8_t packet[32];
     uint16_t pos = 0;
 
     // LCP header: Code, Identifier, Length (length filled in later)
     packet[pos++] = LCP_CONFIGURE_REQUEST;
-    packet[pos++] = ++ctx->identifier;
+    packet[pos++] = retransmit ? ctx->identifier : ++ctx->identifier;
     uint16_t lenPos = pos;
     pos += 2;  // Reserve space for length
 
@@ -68,21 +155,40 @@ static void lcpSendConfigRequest(LcpContext* ctx, PppContext* ppp) {
         packet[pos++] = ctx->ourMru & 0xFF;
     }
 
-    // Option: ACCM (always send to negotiate minimal escaping)
-    packet[pos++] = LCP_OPT_ACCM;
-    packet[pos++] = 6;  // Length
-    packet[pos++] = (ctx->ourAccm >> 24) & 0xFF;
-    packet[pos++] = (ctx->ourAccm >> 16) & 0xFF;
-    packet[pos++] = (ctx->ourAccm >> 8) & 0xFF;
-    packet[pos++] = ctx->ourAccm & 0xFF;
+    // Option: ACCM (sent to negotiate minimal escaping unless rejected)
+    if (!ctx->omitAccm) {
+        packet[pos++] = LCP_OPT_ACCM;
+        packet[pos++] = 6;  // Length
+        packet[pos++] = (ctx->ourAccm >> 24) & 0xFF;
+        packet[pos++] = (ctx->ourAccm >> 16) & 0xFF;
+        packet[pos++] = (ctx->ourAccm >> 8) & 0xFF;
+        packet[pos++] = ctx->ourAccm & 0xFF;
+    }
 
-    // Option: Magic Number (for loop detection)
-    packet[pos++] = LCP_OPT_MAGIC_NUMBER;
-    packet[pos++] = 6;  // Length
-    packet[pos++] = (ctx->ourMagic >> 24) & 0xFF;
-    packet[pos++] = (ctx->ourMagic >> 16) & 0xFF;
-    packet[pos++] = (ctx->ourMagic >> 8) & 0xFF;
-    packet[pos++] = ctx->ourMagic & 0xFF;
+    // Option: Magic Number (for loop detection, unless rejected)
+    if (!ctx->omitMagic) {
+        if (ctx->ourMagic == 0) {
+            ctx->ourMagic = random(1, 0xFFFFFFFF);
+        }
+        packet[pos++] = LCP_OPT_MAGIC_NUMBER;
+        packet[pos++] = 6;  // Length
+        packet[pos++] = (ctx->ourMagic >> 24) & 0xFF;
+        packet[pos++] = (ctx->ourMagic >> 16) & 0xFF;
+        packet[pos++] = (ctx->ourMagic >> 8) & 0xFF;
+        packet[pos++] = ctx->ourMagic & 0xFF;
+    }
+
+    // Option: Quality-Protocol (ask the peer for Link-Quality-Reports)
+    if (ctx->lqrAllowed && !ctx->omitQuality) {
+        packet[pos++] = LCP_OPT_QUALITY;
+        packet[pos++] = 8;  // Length
+        packet[pos++] = (PPP_PROTO_LQR >> 8) & 0xFF;
+        packet[pos++] = PPP_PROTO_LQR & 0xFF;
+        packet[pos++] = (ctx->ourLqrPeriod >> 24) & 0xFF;
+        packet[pos++] = (ctx->ourLqrPeriod >> 16) & 0xFF;
+        packet[pos++] = (ctx->ourLqrPeriod >> 8) & 0xFF;
+        packet[pos++] = ctx->ourLqrPeriod & 0xFF;
+    }
 
     // Fill in length
     packet[lenPos] = (pos >> 8) & 0xFF;
@@ -92,6 +198,7 @@ static void lcpSendConfigRequest(LcpContext* ctx, PppContext* ppp) {
     pppSendFrame(ppp, PPP_PROTO_LCP, packet, pos);
     ctx->lastSendTime = millis();
     ctx->configRetries++;
+    ctx->retransmitted = retransmit;
 
     LCP_DEBUG_F("LCP: Sent Configure-Request id=%d\n", ctx->identifier);
 }
@@ -210,6 +317,27 @@ static void lcpSendEchoReply(LcpContext* ctx, PppContext* ppp,
     LCP_DEBUG_F("LCP: Sent Echo-Reply id=%d\n", id);
 }
 
+// ============================================================================
+// Send Echo-Request
+// ============================================================================
+
+void lcpSendEchoRequest(LcpContext* ctx, PppContext* ppp, uint8_t id) {
+    uint8_t packet[8];
+
+    packet[0] = LCP_ECHO_REQUEST;
+    packet[1] = id;
+    packet[2] = 0;
+    packet[3] = 8;  // Length: header + magic
+
+    packet[4] = (ctx->ourMagic >> 24) & 0xFF;
+    packet[5] = (ctx->ourMagic >> 16) & 0xFF;
+    packet[6] = (ctx->ourMagic >> 8) & 0xFF;
+    packet[7] = ctx->ourMagic & 0xFF;
+
+    pppSendFrame(ppp, PPP_PROTO_LCP, packet, 8);
+    LCP_DEBUG_F("LCP: Sent Echo-Request id=%d", id);
+}
+
 // ============================================================================
 // Handle incoming Configure-Request
 // ============================================================================
@@ -223,6 +351,27 @@ static void lcpHandleConfigRequest(LcpContext* ctx, PppContext* ppp,
     uint16_t nakLen = 0;
     uint16_t rejLen = 0;
 
+    // An option omitted from this request reverts to its RFC 1662 default
+    ctx->peerAccm = 0xFFFFFFFF;
+    ctx->peerLqrAccepted = false;
+
+    // First request from this peer: remember its fingerprint, and repeat our
+    // own request right away - the peer was likely not listening yet when
+    // the server-first request went out
+    bool firstRequest = (ctx->peerFingerprint == 0);
+    if (firstRequest) {
+        ctx->peerFingerprint = lcpFingerprint(options, optLen);
+        LCP_DEBUG_F("LCP: Peer fingerprint 0x%08lX", (unsigned long)ctx->peerFingerprint);
+    }
+
+    // A peer renegotiating an already-open link is a sign that our relaxed
+    // escaping did not survive its serial driver - be conservative from now on
+    if (ctx->state == LCP_STATE_OPENED && ctx->accmProfile == LCP_ACCM_AUTO &&
+        ppp->txAccm != 0xFFFFFFFF) {
+        ctx->peerLegacy = true;
+        LCP_DEBUG("LCP: Peer renegotiated open link, falling back to full ACCM");
+    }
+
     uint16_t pos = 0;
     while (pos < optLen) {
         uint8_t optType = options[pos];
@@ -308,7 +457,26 @@ static void lcpHandleConfigRequest(LcpContext* ctx, PppContext* ppp,
                 break;
 
             case LCP_OPT_QUALITY:
-                // Reject quality protocol
+                // Accept Link-Quality-Report if enabled, reject anything else
+                if (ctx->lqrAllowed && optLen2 == 8 &&
+                    (((uint16_t)options[pos + 2] << 8) | options[pos + 3]) == PPP_PROTO_LQR) {
+                    ctx->peerLqrAccepted = true;
+                    ctx->peerLqrPeriod = ((uint32_t)options[pos + 4] << 24) |
+                                         ((uint32_t)options[pos + 5] << 16) |
+                                         ((uint32_t)options[pos + 6] << 8) |
+                                         options[pos + 7];
+                    memcpy(&ackOptions[ackLen], &options[pos], optLen2);
+                    ackLen += optLen2;
+                } else {
+                    memcpy(&rejOptions[rejLen], &options[pos], optLen2);
+                    rejLen += optLen2;
+                }
+                break;
+
+            case LCP_OPT_CALLBACK:
+                // Only Microsoft Dial-Up Networking sends this - use it as a
+                // fingerprint for the ACCM fallback, then reject as before
+                ctx->peerLegacy = true;
                 memcpy(&rejOptions[rejLen], &options[pos], optLen2);
                 rejLen += optLen2;
                 break;
@@ -340,14 +508,22 @@ static void lcpHandleConfigRequest(LcpContext* ctx, PppContext* ppp,
                 break;
             case LCP_STATE_ACK_RCVD:
                 ctx->state = LCP_STATE_OPENED;
-                // Update PPP context with negotiated ACCM
-                ppp->rxAccm = ctx->peerAccm;
+                lcpApplyAccm(ctx, ppp);
                 LCP_DEBUG("LCP: Link OPENED!");
                 break;
+            case LCP_STATE_OPENED:
+                // Peer renegotiated - re-apply in case the fallback kicked in
+                lcpApplyAccm(ctx, ppp);
+                break;
             default:
                 break;
         }
     }
+
+    if (firstRequest && (ctx->state == LCP_STATE_REQ_SENT || ctx->state == LCP_STATE_ACK_SENT) &&
+        millis() - ctx->lastSendTime >= PPP_RESTART_MIN_MS) {
+        lcpSendConfigRequest(ctx, ppp, true);
+    }
 }
 
 // ============================================================================
@@ -363,6 +539,10 @@ static void lcpHandleConfigAck(LcpContext* ctx, PppContext* ppp,
         return;
     }
 
+    if (!ctx->retransmitted) {
+        pppNoteNegotiationRtt(ppp, millis() - ctx->lastSendTime);
+    }
+
     // Parse ACKed options to confirm what peer accepted
     uint16_t pos = 0;
     while (pos < optLen) {
@@ -374,15 +554,16 @@ static void lcpHandleConfigAck(LcpContext* ctx, PppContext* ppp,
                 ctx->ourMruAcked = true;
                 break;
             case LCP_OPT_ACCM:
+                // Peer will honor our receive ACCM; what WE escape when sending
+                // is decided from the peer's own request in lcpApplyAccm()
                 ctx->ourAccmAcked = true;
-                // Peer accepted our ACCM request, but we still escape all control chars
-                // when SENDING for compatibility with Windows 98 serial drivers that
-                // may interpret control characters (XON/XOFF, etc.)
-                ppp->txAccm = 0xFFFFFFFF;  // Always escape all control chars for safety
                 break;
             case LCP_OPT_MAGIC_NUMBER:
                 ctx->ourMagicAcked = true;
                 break;
+            case LCP_OPT_QUALITY:
+                ctx->ourLqrAcked = true;
+                break;
         }
 
         pos += optLen2;
@@ -397,6 +578,7 @@ static void lcpHandleConfigAck(LcpContext* ctx, PppContext* ppp,
             break;
         case LCP_STATE_ACK_SENT:
             ctx->state = LCP_STATE_OPENED;
+            lcpApplyAccm(ctx, ppp);
             LCP_DEBUG("LCP: Link OPENED!");
             break;
         default:
@@ -414,6 +596,10 @@ static void lcpHandleConfigNak(LcpContext* ctx, PppContext* ppp,
         return;
     }
 
+    if (!ctx->retransmitted) {
+        pppNoteNegotiationRtt(ppp, millis() - ctx->lastSendTime);
+    }
+
     // Parse NAKed options and adjust our values
     uint16_t pos = 0;
     while (pos < optLen) {
@@ -436,6 +622,18 @@ static void lcpHandleConfigNak(LcpContext* ctx, PppContext* ppp,
                 // Use suggested magic number (or generate new one)
                 ctx->ourMagic = random(1, 0xFFFFFFFF);
                 break;
+            case LCP_OPT_QUALITY:
+                // Use the peer's period if it still means LQR, else give up on it
+                if (optLen2 == 8 &&
+                    (((uint16_t)options[pos + 2] << 8) | options[pos + 3]) == PPP_PROTO_LQR) {
+                    ctx->ourLqrPeriod = ((uint32_t)options[pos + 4] << 24) |
+                                        ((uint32_t)options[pos + 5] << 16) |
+                                        ((uint32_t)options[pos + 6] << 8) |
+                                        options[pos + 7];
+                } else {
+                    ctx->omitQuality = true;
+                }
+                break;
         }
 
         pos += optLen2;
@@ -443,7 +641,7 @@ static void lcpHandleConfigNak(LcpContext* ctx, PppContext* ppp,
 
     // Resend Configure-Request with adjusted values
     ctx->configRetries = 0;  // Reset retry counter for new attempt
-    lcpSendConfigRequest(ctx, ppp);
+    lcpSendConfigRequest(ctx, ppp, false);
 }
 
 // ============================================================================
@@ -456,9 +654,11 @@ static void lcpHandleConfigReject(LcpContext* ctx, PppContext* ppp,
         return;
     }
 
+    if (!ctx->retransmitted) {
+        pppNoteNegotiationRtt(ppp, millis() - ctx->lastSendTime);
+    }
+
     // Parse rejected options - don't send them again
-    // For simplicity, we just resend without the rejected options
-    // In a full implementation, we'd track which options were rejected
 
     uint16_t pos = 0;
     while (pos < optLen) {
@@ -473,20 +673,27 @@ static void lcpHandleConfigReject(LcpContext* ctx, PppContext* ppp,
             case LCP_OPT_ACCM:
                 ctx->ourAccm = 0xFFFFFFFF;  // Use safe default
                 ctx->ourAccmAcked = true;
-                ppp->txAccm = 0xFFFFFFFF;   // Always escape all control chars
+                ctx->omitAccm = true;
                 break;
             case LCP_OPT_MAGIC_NUMBER:
                 ctx->ourMagic = 0;  // Disable magic number
                 ctx->ourMagicAcked = true;
+                ctx->omitMagic = true;
+                break;
+            case LCP_OPT_QUALITY:
+                ctx->omitQuality = true;
                 break;
         }
 
+        if (optLen2 < 2) {
+            break;  // Malformed
+        }
         pos += optLen2;
     }
 
     // Resend Configure-Request without rejected options
     ctx->configRetries = 0;
-    lcpSendConfigRequest(ctx, ppp);
+    lcpSendConfigRequest(ctx, ppp, false);
 }
 
 // ============================================================================
@@ -502,14 +709,31 @@ void lcpOpen(LcpContext* ctx, PppContext* ppp) {
     ctx->ourMruAcked = false;
     ctx->ourAccmAcked = false;
     ctx->ourMagicAcked = false;
+    ctx->peerLegacy = false;
+    ctx->peerFingerprint = 0;
+    ctx->ourLqrAcked = false;
+    ctx->peerLqrAccepted = false;
+    ctx->ourLqrPeriod = LCP_LQR_PERIOD;
 
-    // Generate new magic number
-    ctx->ourMagic = random(1, 0xFFFFFFFF);
+    // Generate new magic number (zero if this peer is known to reject it)
+    ctx->ourMagic = ctx->omitMagic ? 0 : random(1, 0xFFFFFFFF);
 
-    lcpSendConfigRequest(ctx, ppp);
+    lcpSendConfigRequest(ctx, ppp, false);
     LCP_DEBUG("LCP: Started negotiation");
 }
 
+// ============================================================================
+// Retransmit Configure-Request early
+// ============================================================================
+
+void lcpResendRequest(LcpContext* ctx, PppContext* ppp) {
+    // Rate limited so a burst of peer packets sends at most one extra request
+    if (lcpIsNegotiating(ctx) && ctx->configRetries < LcpContext::MAX_CONFIGURE &&
+        millis() - ctx->lastSendTime >= PPP_RESTART_MIN_MS) {
+        lcpSendConfigRequest(ctx, ppp, true);
+    }
+}
+
 // ============================================================================
 // Close LCP
 // ============================================================================
@@ -589,7 +813,14 @@ void lcpProcessPacket(LcpContext* ctx, PppContext* ppp,
             break;
 
         case LCP_ECHO_REPLY:
-            // Could track for keepalive, but we ignore for simplicity
+            // Hand to the link quality monitor
+            if (length >= 8) {
+                uint32_t magic = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) |
+                                 ((uint32_t)data[6] << 8) | data[7];
+                ctx->echoReplied = true;
+                ctx->echoReplyId = id;
+                ctx->echoLooped = (magic != 0 && magic == ctx->ourMagic);
+            }
             break;
 
         case LCP_DISCARD_REQUEST:
@@ -597,9 +828,16 @@ void lcpProcessPacket(LcpContext* ctx, PppContext* ppp,
             break;
 
         case LCP_CODE_REJECT:
-        case LCP_PROTOCOL_REJECT:
             // Log and continue
-            LCP_DEBUG_F("LCP: Received Code/Protocol-Reject code=%d\n", code);
+            LCP_DEBUG_F("LCP: Received Code-Reject\n");
+            break;
+
+        case LCP_PROTOCOL_REJECT:
+            // Record which protocol so the owning layer can stop sending it
+            if (length >= 6) {
+                ctx->rejectedProtocol = ((uint16_t)data[4] << 8) | data[5];
+            }
+            LCP_DEBUG_F("LCP: Received Protocol-Reject for 0x%04X\n", ctx->rejectedProtocol);
             break;
 
         default:
@@ -629,7 +867,8 @@ bool lcpTimeout(LcpContext* ctx, PppContext* ppp) {
     }
 
     unsigned long now = millis();
-    if (now - ctx->lastSendTime < LcpContext::RESTART_TIMER_MS) {
+    uint8_t sends = lcpIsNegotiating(ctx) ? ctx->configRetries : ctx->termRetries;
+    if (now - ctx->lastSendTime < pppRestartTimerMs(ppp, sends)) {
         return false;  // Not timed out yet
     }
 
@@ -638,7 +877,7 @@ bool lcpTimeout(LcpContext* ctx, PppContext* ppp) {
         case LCP_STATE_ACK_RCVD:
         case LCP_STATE_ACK_SENT:
             if (ctx->configRetries < LcpContext::MAX_CONFIGURE) {
-                lcpSendConfigRequest(ctx, ppp);
+                lcpSendConfigRequest(ctx, ppp, true);
                 return true;
             } else {
                 // Too many retries - give up
@@ -694,3 +933,16 @@ const char* lcpStateName(LcpState state) {
         default: return "UNKNOWN";
     }
 }
+
+// ============================================================================
+// Get ACCM profile name for display
+// ============================================================================
+
+const char* lcpAccmProfileName(LcpAccmProfile profile) {
+    switch (profile) {
+        case LCP_ACCM_AUTO: return "AUTO";
+        case LCP_ACCM_NEGOTIATED: return "NEGOTIATED";
+        case LCP_ACCM_CONSERVATIVE: return "CONSERVATIVE";
+        default: return "UNKNOWN";
+    }
+}
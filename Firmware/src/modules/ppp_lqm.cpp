@@ -0,0 +1,293 @@
+// ============================================================================
+// PPP Link Quality Monitoring Implementation
+// ============================================================================
+// Echo prober (RFC 1661 section 5.8) and Link-Quality-Report (RFC 1989)
+// ============================================================================
+
+#include "ppp_lqm.h"
+#include "globals.h"
+
+// ============================================================================
+// Debug output (can be disabled in production)
+// ============================================================================
+
+#ifdef PPP_DEBUG
+#define LQM_DEBUG(msg) Serial.print(msg); Serial.print("\r\n")
+#define LQM_DEBUG_F(fmt, ...) Serial.printf(fmt "\r\n", ##__VA_ARGS__)
+#else
+#define LQM_DEBUG(msg)
+#define LQM_DEBUG_F(fmt, ...)
+#endif
+
+// ============================================================================
+// Initialize LQM Context
+// ============================================================================
+
+void lqmInit(LqmContext* ctx, uint8_t echoIntervalSec, uint8_t echoFailures) {
+    memset(ctx, 0, sizeof(LqmContext));
+    ctx->echoIntervalSec = echoIntervalSec;
+    ctx->echoFailures = echoFailures;
+}
+
+// ============================================================================
+// Start / Stop
+// ============================================================================
+
+void lqmStart(LqmContext* ctx, LcpContext* lcp) {
+    unsigned long now = millis();
+
+    ctx->running = true;
+    ctx->linkDown = false;
+    ctx->echoPending = false;
+    ctx->echoSendTime = now;    // First probe one interval after LCP opens
+    ctx->consecutiveMisses = 0;
+
+    // Directions are independent: the peer's option tells us how often to
+    // report, ours tells the peer
+    ctx->lqrTx = lcp->peerLqrAccepted;
+    ctx->lqrRx = lcp->ourLqrAcked;
+    ctx->lqrPeriodMs = ctx->lqrTx ? lcp->peerLqrPeriod * 10 : 0;
+    ctx->lastLqrSent = now;
+    ctx->havePeerLqr = false;
+
+    LQM_DEBUG_F("LQM: Started, echo every %ds, LQR tx=%d rx=%d period=%lums",
+                ctx->echoIntervalSec, ctx->lqrTx, ctx->lqrRx,
+                (unsigned long)ctx->lqrPeriodMs);
+}
+
+void lqmStop(LqmContext* ctx) {
+    ctx->running = false;
+    ctx->echoPending = false;
+    ctx->lqrTx = false;
+    ctx->lqrRx = false;
+}
+
+// ============================================================================
+// Record an echo round trip
+// ============================================================================
+
+static void lqmAddRtt(LqmContext* ctx, unsigned long rtt) {
+    uint16_t ms = (rtt > 0xFFFF) ? 0xFFFF : (uint16_t)rtt;
+
+    ctx->rttSamples[ctx->rttNext] = ms;
+    ctx->rttNext = (ctx->rttNext + 1) % LQM_RTT_SAMPLES;
+    if (ctx->rttCount < LQM_RTT_SAMPLES) {
+        ctx->rttCount++;
+    }
+
+    ctx->rttLastMs = ms;
+    if (ctx->echoReplies == 1 || ms < ctx->rttMinMs) {
+        ctx->rttMinMs = ms;
+    }
+    if (ms > ctx->rttMaxMs) {
+        ctx->rttMaxMs = ms;
+    }
+}
+
+// ============================================================================
+// Send Link-Quality-Report (RFC 1989 section 2.6)
+// ============================================================================
+
+static void lqmPut32(uint8_t* p, uint32_t value) {
+    p[0] = (value >> 24) & 0xFF;
+    p[1] = (value >> 16) & 0xFF;
+    p[2] = (value >> 8) & 0xFF;
+    p[3] = value & 0xFF;
+}
+
+static uint32_t lqmGet32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void lqmSendLqr(LqmContext* ctx, LcpContext* lcp, PppContext* ppp) {
+    uint8_t packet[LQR_PACKET_LEN];
+
+    ctx->outLqrs++;
+
+    lqmPut32(&packet[0], lcp->ourMagic);
+
+    // Echo back the peer's transmit counters from its last report
+    lqmPut32(&packet[4], ctx->peerOutLqrs);
+    lqmPut32(&packet[8], ctx->peerOutPackets);
+    lqmPut32(&packet[12], ctx->peerOutOctets);
+
+    // Our receive counters when that report arrived
+    lqmPut32(&packet[16], ctx->saveInLqrs);
+    lqmPut32(&packet[20], ctx->saveInPackets);
+    lqmPut32(&packet[24], 0);               // InDiscards - not tracked
+    lqmPut32(&packet[28], ctx->saveInErrors);
+    lqmPut32(&packet[32], ctx->saveInOctets);
+
+    // Our transmit counters, including this packet
+    lqmPut32(&packet[36], ctx->outLqrs);
+    lqmPut32(&packet[40], ppp->framesSent + 1);
+    lqmPut32(&packet[44], ppp->bytesSent);
+
+    pppSendFrame(ppp, PPP_PROTO_LQR, packet, LQR_PACKET_LEN);
+    ctx->lastLqrSent = millis();
+}
+
+// ============================================================================
+// Periodic work
+// ============================================================================
+
+bool lqmPoll(LqmContext* ctx, LcpContext* lcp, PppContext* ppp) {
+    // Echo-Reply noted by LCP since the last call
+    if (lcp->echoReplied) {
+        lcp->echoReplied = false;
+        if (lcp->echoLooped) {
+            ctx->loopbacks++;
+        } else if (ctx->echoPending && lcp->echoReplyId == ctx->echoId) {
+            ctx->echoPending = false;
+            ctx->echoReplies++;
+            ctx->consecutiveMisses = 0;
+            lqmAddRtt(ctx, millis() - ctx->echoSendTime);
+        } else {
+            // Already counted as missed, but the link is evidently alive
+            ctx->echoesLate++;
+            ctx->consecutiveMisses = 0;
+        }
+    }
+
+    if (!ctx->running || ctx->linkDown) {
+        return false;
+    }
+
+    unsigned long now = millis();
+
+    if (ctx->echoIntervalSec > 0 &&
+        now - ctx->echoSendTime >= (unsigned long)ctx->echoIntervalSec * 1000) {
+        if (ctx->echoPending) {
+            ctx->echoesMissed++;
+            ctx->echoPending = false;
+
+            // Other traffic proves the link is up, even from a peer that
+            // ignores echoes - only silence counts toward link down
+            if (ppp->framesReceived == ctx->framesAtProbe) {
+                ctx->consecutiveMisses++;
+            } else {
+                ctx->consecutiveMisses = 0;
+            }
+            LQM_DEBUG_F("LQM: Echo id=%d missed (%d in a row)", ctx->echoId, ctx->consecutiveMisses);
+
+            if (ctx->echoFailures > 0 && ctx->consecutiveMisses >= ctx->echoFailures) {
+                ctx->linkDown = true;
+                LQM_DEBUG("LQM: Link down");
+                return true;
+            }
+        }
+
+        ctx->echoId++;
+        ctx->echoPending = true;
+        ctx->echoSendTime = now;
+        ctx->framesAtProbe = ppp->framesReceived;
+        ctx->echoesSent++;
+        lcpSendEchoRequest(lcp, ppp, ctx->echoId);
+    }
+
+    if (ctx->lqrTx && ctx->lqrPeriodMs > 0 && now - ctx->lastLqrSent >= ctx->lqrPeriodMs) {
+        lqmSendLqr(ctx, lcp, ppp);
+    }
+
+    return false;
+}
+
+// ============================================================================
+// Process incoming Link-Quality-Report (RFC 1989 section 2.7)
+// ============================================================================
+// Loss in each direction is the difference between what one side says it
+// sent and what the other side says it received over the same interval.
+
+void lqmProcessLqr(LqmContext* ctx, LcpContext* lcp, PppContext* ppp,
+                   const uint8_t* data, uint16_t length) {
+    if (!ctx->running || length < LQR_PACKET_LEN) {
+        return;
+    }
+
+    // Snapshot our receive counters at the moment the report arrived
+    ctx->inLqrs++;
+    ctx->saveInLqrs = ctx->inLqrs;
+    ctx->saveInPackets = ppp->framesReceived;
+    ctx->saveInErrors = ppp->fcsErrors + ppp->rxErrors;
+    ctx->saveInOctets = ppp->bytesReceived;
+
+    uint32_t lastOutPackets = lqmGet32(&data[8]);
+    uint32_t peerInPackets = lqmGet32(&data[20]);
+    uint32_t peerOutLqrs = lqmGet32(&data[36]);
+    uint32_t peerOutPackets = lqmGet32(&data[40]);
+    uint32_t peerOutOctets = lqmGet32(&data[44]);
+
+    if (ctx->havePeerLqr) {
+        // Toward the peer - LastOutPackets is zero until it has seen one of ours
+        if (lastOutPackets != 0 && ctx->peerLastOutPackets != 0) {
+            uint32_t sent = lastOutPackets - ctx->peerLastOutPackets;
+            uint32_t rcvd = peerInPackets - ctx->peerInPackets;
+            ctx->lqrOutSent += sent;
+            if (sent > rcvd) {
+                ctx->lqrOutLost += sent - rcvd;
+            }
+        }
+
+        // From the peer
+        uint32_t sent = peerOutPackets - ctx->peerOutPackets;
+        uint32_t rcvd = ctx->saveInPackets - ctx->prevSaveInPackets;
+        ctx->lqrInSent += sent;
+        if (sent > rcvd) {
+            ctx->lqrInLost += sent - rcvd;
+        }
+    }
+
+    ctx->havePeerLqr = true;
+    ctx->peerLastOutPackets = lastOutPackets;
+    ctx->peerInPackets = peerInPackets;
+    ctx->peerOutLqrs = peerOutLqrs;
+    ctx->peerOutPackets = peerOutPackets;
+    ctx->peerOutOctets = peerOutOctets;
+    ctx->prevSaveInPackets = ctx->saveInPackets;
+
+    LQM_DEBUG_F("LQM: LQR in, loss out %lu/%lu in %lu/%lu",
+                (unsigned long)ctx->lqrOutLost, (unsigned long)ctx->lqrOutSent,
+                (unsigned long)ctx->lqrInLost, (unsigned long)ctx->lqrInSent);
+
+    // Without a timer of our own, each report is answered with one
+    if (ctx->lqrTx && ctx->lqrPeriodMs == 0) {
+        lqmSendLqr(ctx, lcp, ppp);
+    }
+}
+
+// ============================================================================
+// Statistics helpers
+// ============================================================================
+
+uint16_t lqmRttPercentile(LqmContext* ctx, uint8_t pct) {
+    if (ctx->rttCount == 0) {
+        return 0;
+    }
+
+    // Insertion sort a copy - at most LQM_RTT_SAMPLES entries
+    uint16_t sorted[LQM_RTT_SAMPLES];
+    uint8_t n = ctx->rttCount;
+    for (uint8_t i = 0; i < n; i++) {
+        uint16_t v = ctx->rttSamples[i];
+        int j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+
+    if (pct > 100) {
+        pct = 100;
+    }
+    return sorted[((uint16_t)pct * (n - 1) + 50) / 100];
+}
+
+uint16_t lqmEchoLossPermille(LqmContext* ctx) {
+    uint32_t answered = ctx->echoesSent - (ctx->echoPending ? 1 : 0);
+    if (answered == 0) {
+        return 0;
+    }
+    return (uint16_t)((uint64_t)ctx->echoesMissed * 1000 / answered);
+}
@@ -10,9 +10,12 @@
 #include "display_menu.h"
 #include "network.h"
 #include "modem.h"
+#include "gateway_link.h"
 #include <EEPROM.h>
+#include <WebServer.h>
 
 extern bool usbDebug;
+extern WebServer webServer;
 
 // ============================================================================
 // Global Contexts
@@ -21,8 +24,17 @@ extern bool usbDebug;
 PppContext pppCtx;
 LcpContext lcpCtx;
 IpcpContext ipcpCtx;
-PppNatContext pppNatCtx;
+CcpContext ccpCtx;
+NatContext pppNatCtx;
 PppModeContext pppModeCtx;
+VjContext pppVjCtx;
+LqmContext lqmCtx;
+
+// Rebuilt IP packet from a VJ-compressed frame
+static uint8_t pppVjRxBuffer[PPP_BUFFER_SIZE];
+
+// Datagram recovered from a CCP-compressed frame
+static uint8_t pppCcpRxBuffer[PPP_BUFFER_SIZE];
 
 // Menu definitions
 static String pppMenuDisp[] = { "MAIN", "Start Gateway", "Configure IP", "Port Forwards", "View Stats" };
@@ -53,6 +65,17 @@ static void pppMenuLoop();
 static void pppActiveLoop();
 static void pppUpdateActiveDisplay();
 static void pppProcessFrame();
+static void pppProcessDatagram(uint16_t protocol, uint8_t* payload, uint16_t payloadLen);
+static void pppNatLinkSend(void* link, uint8_t* packet, uint16_t length);
+static void pppSendProtocolReject(uint16_t protocol, const uint8_t* payload, uint16_t payloadLen);
+static void pppApplyVj();
+static void pppStartNcps(const char* message);
+static void pppGatewayActivated();
+static void pppApplyPeerProfile(const PppPeerProfile* profile);
+static void pppSeedPeerProfile();
+static void pppMatchPeerProfile();
+static void pppSavePeerProfile();
+static String pppRatioString(uint16_t ratio);
 static bool parseIPAddress(const String& str, IPAddress& ip);
 static void pppConfigureIP();
 static void pppConfigurePortForward();
@@ -264,9 +287,28 @@ static void pppActiveLoop() {
     static int escapePos = 0;
     static unsigned long lastEscapeTime = 0;
 
-    // Process incoming bytes from PhysicalSerial through PPP framing
-    while (PhysicalSerial.available()) {
-        uint8_t byte = PhysicalSerial.read();
+    // TCP link: negotiation starts when the emulator connects, and the
+    // session ends when it disconnects
+    if (gwLinkAccept() && pppModeCtx.state == PPP_MODE_STARTING) {
+        pppModeCtx.stateStartTime = now;
+        pppModeCtx.state = PPP_MODE_LCP;
+        lcpOpen(&lcpCtx, &pppCtx);
+        SerialPrintLn("LCP: Initiating negotiation (server-first mode)");
+    }
+    if (gwLinkDropped()) {
+        SerialPrintLn("PPP: TCP link closed");
+        exitPppMode();
+        if (pppModeCtx.previousMenuMode == MODE_MODEM) {
+            menuMode = MODE_MODEM;
+        } else {
+            pppMenu(false);
+        }
+        return;
+    }
+
+    // Process incoming bytes from the gateway link through PPP framing
+    while (gwLinkAvailable()) {
+        uint8_t byte = gwLinkRead();
 
         // Check for +++ escape (only check before PPP established)
         if (byte == '+' && pppModeCtx.state == PPP_MODE_STARTING) {
@@ -294,16 +336,19 @@ static void pppActiveLoop() {
             // Complete PPP frame received
             pppProcessFrame();
         } else if (frameLen < 0) {
-            // FCS error - log protocol bytes for diagnosis
+            // FCS error or aborted frame - log protocol bytes for diagnosis
             if (usbDebug) {
                 UsbDebugPrint("");
-                Serial.printf("PPP: FCS error (rxPos=%d, bytes:", pppCtx.rxPos);
+                Serial.printf("PPP: Bad frame (rxPos=%d, bytes:", pppCtx.rxPos);
                 int dumpLen = (pppCtx.rxPos > 16) ? 16 : pppCtx.rxPos;
                 for (int i = 0; i < dumpLen; i++) {
                     Serial.printf(" %02X", pppCtx.rxBuffer[i]);
                 }
                 Serial.printf(")\r\n");
             }
+
+            // A lost frame desyncs the VJ decompressor until the peer resends a slot id
+            vjToss(&pppVjCtx);
         }
     }
 
@@ -324,7 +369,8 @@ static void pppActiveLoop() {
     // }
 
     // Handle LCP/IPCP timeouts
-    if (now - pppModeCtx.lastLcpTimeout > 100) {
+    // Checked every 10ms - restart timers can be as short as PPP_RESTART_MIN_MS
+    if (now - pppModeCtx.lastLcpTimeout >= 10) {
         pppModeCtx.lastLcpTimeout = now;
 
         if (pppModeCtx.state == PPP_MODE_LCP) {
@@ -333,30 +379,23 @@ static void pppActiveLoop() {
             }
             if (lcpIsOpened(&lcpCtx)) {
                 // LCP opened - start IPCP
-                pppModeCtx.state = PPP_MODE_IPCP;
-                ipcpOpen(&ipcpCtx, &pppCtx);
-                SerialPrintLn("LCP opened, starting IPCP...");
+                pppStartNcps("LCP opened, starting IPCP...");
             }
         }
         else if (pppModeCtx.state == PPP_MODE_IPCP) {
             if (ipcpTimeout(&ipcpCtx, &pppCtx)) {
                 // State changed
             }
+            ccpTimeout(&ccpCtx, &pppCtx);
             if (ipcpIsOpened(&ipcpCtx)) {
                 // IPCP opened - gateway active
-                pppModeCtx.state = PPP_MODE_ACTIVE;
-                SerialPrintLn("PPP Gateway ACTIVE");
-                SerialPrint("  Client IP: ");
-                SerialPrintLn(ipToString(ipcpCtx.peerIP));
-
-                // Configure NAT with assigned IP
-                pppNatSetIPs(&pppNatCtx, ipcpCtx.ourIP, ipcpCtx.peerIP,
-                             IPAddress(255, 255, 255, 0), ipcpCtx.primaryDns);
-
-                // Start port forward servers now that gateway is active
-                pppNatStartPortForwardServers(&pppNatCtx);
+                pppGatewayActivated();
             }
         }
+        else if (pppModeCtx.state == PPP_MODE_ACTIVE) {
+            // CCP may still be negotiating, or waiting on a Reset-Ack
+            ccpTimeout(&ccpCtx, &pppCtx);
+        }
 
         // Check for link down during negotiation
         if (pppModeCtx.state == PPP_MODE_LCP &&
@@ -366,11 +405,17 @@ static void pppActiveLoop() {
         }
     }
 
+    // Link quality probes and reports
+    bool linkDown = lqmPoll(&lqmCtx, &lcpCtx, &pppCtx);
+
+    // Keep the status page and /api/ppp reachable over WiFi
+    webServer.handleClient();
+
     // When active, poll NAT connections
     if (pppModeCtx.state == PPP_MODE_ACTIVE) {
-        // Check if peer terminated the link
-        if (lcpCtx.state == LCP_STATE_STOPPED) {
-            SerialPrintLn("PPP: Peer disconnected");
+        // Check if peer terminated the link, or stopped answering
+        if (lcpCtx.state == LCP_STATE_STOPPED || linkDown) {
+            SerialPrintLn(linkDown ? "PPP: Link down (no reply to LCP echo)" : "PPP: Peer disconnected");
             exitPppMode();
             // Return to previous mode (modem mode or PPP menu)
             if (pppModeCtx.previousMenuMode == MODE_MODEM) {
@@ -381,14 +426,14 @@ static void pppActiveLoop() {
             return;
         }
 
-        pppNatPollConnections(&pppNatCtx, &pppCtx);
+        natPollConnections(&pppNatCtx);
 
         // Check port forwards for incoming connections
-        pppNatCheckPortForwards(&pppNatCtx, &pppCtx);
+        natCheckPortForwards(&pppNatCtx);
 
         // Periodic cleanup
         if (now - pppModeCtx.lastCleanup > 10000) {
-            pppNatCleanupExpired(&pppNatCtx);
+            natCleanupExpired(&pppNatCtx);
             pppModeCtx.lastCleanup = now;
 
             // Diagnostic: show PPP and ICMP stats
@@ -398,10 +443,6 @@ static void pppActiveLoop() {
                     pppCtx.framesReceived, pppCtx.framesSent,
                     pppCtx.fcsErrors, pppCtx.rxErrors);
 
-                extern volatile uint32_t g_icmpCallbackCount;
-                extern volatile uint32_t g_icmpCallbackStored;
-                extern volatile uint32_t g_icmpCallbackDropped;
-                extern volatile uint32_t g_icmpProcessedCount;
                 if (g_icmpCallbackCount > 0) {
                     UsbDebugPrint("");
                     Serial.printf("ICMP stats: callback=%u stored=%u dropped=%u processed=%u\r\n",
@@ -418,8 +459,8 @@ static void pppActiveLoop() {
         pppModeCtx.lastStatusUpdate = now;
     }
 
-    // Timeout waiting for PPP frames
-    if (pppModeCtx.state == PPP_MODE_STARTING) {
+    // Timeout waiting for PPP frames (a TCP listener waits for its client)
+    if (pppModeCtx.state == PPP_MODE_STARTING && !gwLinkIsTcp()) {
         if (now - pppModeCtx.stateStartTime > 60000) {
             SerialPrintLn("Timeout waiting for PPP");
             pppModeCtx.state = PPP_MODE_ERROR;
@@ -448,41 +489,60 @@ static void pppProcessFrame() {
                 pppModeCtx.state = PPP_MODE_LCP;
                 lcpOpen(&lcpCtx, &pppCtx);
             }
+            if (pppModeCtx.linkStartTime == 0) {
+                pppModeCtx.linkStartTime = millis();
+            }
             lcpProcessPacket(&lcpCtx, &pppCtx, payload, payloadLen);
 
-            // Immediately check if LCP just opened - don't wait for 100ms timer!
+            // Link quality monitoring runs while LCP is open
+            if (lcpIsOpened(&lcpCtx) && !lqmCtx.running) {
+                lqmStart(&lqmCtx, &lcpCtx);
+            } else if (!lcpIsOpened(&lcpCtx) && lqmCtx.running) {
+                lqmStop(&lqmCtx);
+            }
+
+            // First Configure-Request identifies the client - switch to its
+            // remembered profile if it differs from the one we guessed
+            pppMatchPeerProfile();
+
+            // Peer doesn't speak CCP - stop asking
+            if (lcpCtx.rejectedProtocol == PPP_PROTO_CCP) {
+                ccpProtocolRejected(&ccpCtx);
+                pppModeCtx.ccpUnsupported = true;
+                if (pppModeCtx.state == PPP_MODE_ACTIVE) {
+                    pppSavePeerProfile();
+                }
+            }
+            lcpCtx.rejectedProtocol = 0;
+
+            // Immediately check if LCP just opened - don't wait for the timer!
             // Without this, IPCP packets from fast peers (e.g. Linux pppd) arrive
             // while we're still in PPP_MODE_LCP and get silently dropped, causing
             // an infinite IPCP negotiation loop.
             if (pppModeCtx.state == PPP_MODE_LCP && lcpIsOpened(&lcpCtx)) {
-                pppModeCtx.state = PPP_MODE_IPCP;
-                ipcpOpen(&ipcpCtx, &pppCtx);
-                SerialPrintLn("LCP opened, starting IPCP...");
+                pppStartNcps("LCP opened, starting IPCP...");
             }
             break;
 
         case PPP_PROTO_IPCP:
             // If LCP is open but we haven't transitioned yet, do it now
             if (pppModeCtx.state == PPP_MODE_LCP && lcpIsOpened(&lcpCtx)) {
-                pppModeCtx.state = PPP_MODE_IPCP;
-                ipcpOpen(&ipcpCtx, &pppCtx);
-                SerialPrintLn("LCP opened (triggered by IPCP rx), starting IPCP...");
+                pppStartNcps("LCP opened (triggered by IPCP rx), starting IPCP...");
             }
             if (pppModeCtx.state == PPP_MODE_IPCP || pppModeCtx.state == PPP_MODE_ACTIVE) {
                 ipcpProcessPacket(&ipcpCtx, &pppCtx, payload, payloadLen);
 
                 // Immediately check if IPCP just opened - same principle as LCP above
                 if (pppModeCtx.state == PPP_MODE_IPCP && ipcpIsOpened(&ipcpCtx)) {
-                    pppModeCtx.state = PPP_MODE_ACTIVE;
-                    SerialPrintLn("PPP Gateway ACTIVE");
-                    SerialPrint("  Client IP: ");
-                    SerialPrintLn(ipToString(ipcpCtx.peerIP));
-
-                    pppNatSetIPs(&pppNatCtx, ipcpCtx.ourIP, ipcpCtx.peerIP,
-                                 IPAddress(255, 255, 255, 0), ipcpCtx.primaryDns);
-                    pppNatStartPortForwardServers(&pppNatCtx);
+                    pppGatewayActivated();
                 }
             } else {
+                // Peer already considers LCP open, so it Acked a request of
+                // ours that we never saw - repeat it now rather than waiting
+                // out the restart timer (the NCP packet itself is discarded)
+                if (pppModeCtx.state == PPP_MODE_LCP && lcpCtx.state == LCP_STATE_ACK_SENT) {
+                    lcpResendRequest(&lcpCtx, &pppCtx);
+                }
                 if (usbDebug) {
                     UsbDebugPrint("");
                     Serial.printf("IPCP packet DROPPED: pppMode=%d (need IPCP=%d or ACTIVE=%d)\r\n",
@@ -491,6 +551,64 @@ static void pppProcessFrame() {
             }
             break;
 
+        case PPP_PROTO_IP:
+        case PPP_PROTO_VJC_COMP:
+        case PPP_PROTO_VJC_UNCOMP:
+            pppProcessDatagram(protocol, payload, payloadLen);
+            break;
+
+        case PPP_PROTO_CCP:
+            if (ccpCtx.enabled && lcpIsOpened(&lcpCtx)) {
+                ccpProcessPacket(&ccpCtx, &pppCtx, payload, payloadLen);
+            } else {
+                pppSendProtocolReject(protocol, payload, payloadLen);
+            }
+            break;
+
+        case PPP_PROTO_LQR:
+            if (lqmCtx.lqrTx || lqmCtx.lqrRx) {
+                lqmProcessLqr(&lqmCtx, &lcpCtx, &pppCtx, payload, payloadLen);
+            } else {
+                pppSendProtocolReject(protocol, payload, payloadLen);
+            }
+            break;
+
+        case PPP_PROTO_COMP:
+            // CCP-compressed datagram - expand, then handle the inner protocol
+            if (pppModeCtx.state == PPP_MODE_ACTIVE && ccpRxActive(&ccpCtx)) {
+                uint16_t innerProto = 0;
+                int innerLen = ccpDecompress(&ccpCtx, &pppCtx, payload, payloadLen, &innerProto,
+                                             pppCcpRxBuffer, sizeof(pppCcpRxBuffer));
+                if (innerLen > 0) {
+                    pppProcessDatagram(innerProto, pppCcpRxBuffer, innerLen);
+                } else if (usbDebug) {
+                    UsbDebugPrint("");
+                    Serial.printf("CCP packet dropped, len=%d\r\n", payloadLen);
+                }
+            }
+            break;
+
+        default:
+            // Unknown protocol - send Protocol-Reject if LCP is open
+            pppSendProtocolReject(protocol, payload, payloadLen);
+            break;
+    }
+}
+
+// ============================================================================
+// NAT link adapter - packets for the client go out as PPP IP frames
+// ============================================================================
+
+static void pppNatLinkSend(void* link, uint8_t* packet, uint16_t length) {
+    pppSendIpPacket((PppContext*)link, packet, length);
+}
+
+// ============================================================================
+// Process Network-Layer Datagram (plain or decompressed)
+// ============================================================================
+
+static void pppProcessDatagram(uint16_t protocol, uint8_t* payload, uint16_t payloadLen) {
+    switch (protocol) {
         case PPP_PROTO_IP:
             // IP packet - route through NAT
             if (pppModeCtx.state == PPP_MODE_ACTIVE) {
@@ -498,7 +616,7 @@ static void pppProcessFrame() {
                     UsbDebugPrint("");
                     Serial.printf("IP packet received, len=%d\r\n", payloadLen);
                 }
-                pppNatProcessPacket(&pppNatCtx, &pppCtx, payload, payloadLen);
+                natProcessPacket(&pppNatCtx, payload, payloadLen);
             } else {
                 if (usbDebug) {
                     UsbDebugPrint("");
@@ -507,23 +625,219 @@ static void pppProcessFrame() {
             }
             break;
 
-        default:
-            // Unknown protocol - send Protocol-Reject if LCP is open
-            if (lcpIsOpened(&lcpCtx)) {
-                uint8_t reject[256];
-                uint16_t len = (payloadLen > 248) ? 248 : payloadLen;
-                reject[0] = LCP_PROTOCOL_REJECT;
-                reject[1] = lcpCtx.identifier + 1;
-                uint16_t totalLen = 4 + 2 + len;
-                reject[2] = (totalLen >> 8) & 0xFF;
-                reject[3] = totalLen & 0xFF;
-                reject[4] = (protocol >> 8) & 0xFF;
-                reject[5] = protocol & 0xFF;
-                memcpy(&reject[6], payload, len);
-                pppSendFrame(&pppCtx, PPP_PROTO_LCP, reject, 6 + len);
+        case PPP_PROTO_VJC_COMP:
+        case PPP_PROTO_VJC_UNCOMP:
+            // VJ-compressed TCP/IP - rebuild full header, then route through NAT
+            if (pppModeCtx.state == PPP_MODE_ACTIVE && pppVjCtx.rxEnabled) {
+                int ipLen = vjUncompress(&pppVjCtx,
+                    protocol == PPP_PROTO_VJC_COMP ? VJ_TYPE_COMPRESSED_TCP : VJ_TYPE_UNCOMPRESSED_TCP,
+                    payload, payloadLen, pppVjRxBuffer, sizeof(pppVjRxBuffer));
+                if (ipLen > 0) {
+                    natProcessPacket(&pppNatCtx, pppVjRxBuffer, ipLen);
+                } else if (usbDebug) {
+                    UsbDebugPrint("");
+                    Serial.printf("VJ packet dropped (%s), len=%d\r\n",
+                        ipLen < 0 ? "error" : "tossed", payloadLen);
+                }
             }
             break;
+
+        default:
+            pppSendProtocolReject(protocol, payload, payloadLen);
+            break;
+    }
+}
+
+// ============================================================================
+// Send LCP Protocol-Reject for an unsupported protocol
+// ============================================================================
+
+static void pppSendProtocolReject(uint16_t protocol, const uint8_t* payload, uint16_t payloadLen) {
+    if (!lcpIsOpened(&lcpCtx)) {
+        return;
+    }
+
+    uint8_t reject[256];
+    uint16_t len = (payloadLen > 248) ? 248 : payloadLen;
+    reject[0] = LCP_PROTOCOL_REJECT;
+    reject[1] = lcpCtx.identifier + 1;
+    uint16_t totalLen = 4 + 2 + len;
+    reject[2] = (totalLen >> 8) & 0xFF;
+    reject[3] = totalLen & 0xFF;
+    reject[4] = (protocol >> 8) & 0xFF;
+    reject[5] = protocol & 0xFF;
+    memcpy(&reject[6], payload, len);
+    pppSendFrame(&pppCtx, PPP_PROTO_LCP, reject, 6 + len);
+}
+
+// ============================================================================
+// Apply negotiated VJ compression (called when IPCP opens)
+// ============================================================================
+// RFC 1332: the option a side ACKs tells it how to compress toward the sender
+
+static void pppApplyVj() {
+    pppVjCtx.txEnabled = false;
+    pppVjCtx.rxEnabled = false;
+
+    if (ipcpCtx.vjPeerAccepted) {
+        vjEnableTx(&pppVjCtx, ipcpCtx.vjPeerMaxSlot, ipcpCtx.vjPeerCompSlot);
+    }
+    if (ipcpCtx.vjOurAcked) {
+        vjEnableRx(&pppVjCtx, ipcpCtx.vjOurMaxSlot);
+    }
+
+    if (pppVjCtx.txEnabled || pppVjCtx.rxEnabled) {
+        SerialPrint("  VJ compression: ");
+        SerialPrintLn(pppVjCtx.txEnabled && pppVjCtx.rxEnabled ? "both directions" :
+                      (pppVjCtx.txEnabled ? "to client only" : "from client only"));
+    }
+}
+
+// ============================================================================
+// Start the network control protocols (called when LCP opens)
+// ============================================================================
+// IPCP and CCP requests go out back to back in the same burst
+
+static void pppStartNcps(const char* message) {
+    pppModeCtx.state = PPP_MODE_IPCP;
+    if (pppModeCtx.linkStartTime != 0) {
+        pppModeCtx.lastLcpUpMs = millis() - pppModeCtx.linkStartTime;
+    }
+
+    ipcpOpen(&ipcpCtx, &pppCtx);
+    if (!pppModeCtx.ccpUnsupported) {
+        ccpOpen(&ccpCtx, &pppCtx);
+    }
+    SerialPrintLn(message);
+}
+
+// ============================================================================
+// Gateway activation (called when IPCP opens)
+// ============================================================================
+
+static void pppGatewayActivated() {
+    pppModeCtx.state = PPP_MODE_ACTIVE;
+    if (pppModeCtx.linkStartTime != 0) {
+        pppModeCtx.lastTimeToIpMs = millis() - pppModeCtx.linkStartTime;
+    }
+
+    SerialPrintLn("PPP Gateway ACTIVE");
+    SerialPrint("  Client IP: ");
+    SerialPrintLn(ipToString(ipcpCtx.peerIP));
+    if (pppModeCtx.lastTimeToIpMs > 0) {
+        SerialPrint("  Time to IP: ");
+        SerialPrint(String(pppModeCtx.lastTimeToIpMs));
+        SerialPrintLn(" ms");
+    }
+
+    pppApplyVj();
+
+    // Configure NAT with assigned IP
+    natSetIPs(&pppNatCtx, ipcpCtx.ourIP, ipcpCtx.peerIP,
+              IPAddress(255, 255, 255, 0), pppModeCtx.config.primaryDns);
+
+    // TCP segments and advertised MSS follow the MRUs LCP settled before IPCP came up
+    natSetLinkMtu(&pppNatCtx, lcpCtx.peerMru, lcpCtx.ourMru);
+
+    // Start port forward servers now that gateway is active
+    natStartPortForwardServers(&pppNatCtx);
+
+    // Remember what this client refused for its next call
+    pppSavePeerProfile();
+}
+
+// ============================================================================
+// Peer profile cache
+// ============================================================================
+// Before the client speaks we can only guess, so the most recent profile is
+// applied up front (a BBS usually serves the same machine call after call).
+// The client's first LCP Configure-Request then confirms or corrects the guess.
+
+static void pppApplyPeerProfile(const PppPeerProfile* profile) {
+    lcpCtx.omitAccm = profile && profile->omitAccm;
+    lcpCtx.omitMagic = profile && profile->omitMagic;
+    lcpCtx.omitQuality = profile && profile->omitQuality;
+    ipcpCtx.vjPeerRejects = profile && profile->vjRejected;
+    ccpCtx.peerDeclines = profile && profile->ccpDeclined;
+    pppModeCtx.ccpUnsupported = profile && profile->ccpUnsupported;
+
+    // A sample from this call beats a remembered one
+    if (pppCtx.negotiationRttMs == 0 && profile) {
+        pppCtx.negotiationRttMs = profile->negotiationRttMs;
+    }
+}
+
+static void pppSeedPeerProfile() {
+    PppPeerProfile* recent = nullptr;
+    for (int i = 0; i < PPP_PEER_PROFILES; i++) {
+        PppPeerProfile* p = &pppModeCtx.profiles[i];
+        if (p->fingerprint != 0 && (!recent || p->lastUsed > recent->lastUsed)) {
+            recent = p;
+        }
+    }
+
+    pppApplyPeerProfile(recent);
+    pppModeCtx.profileFingerprint = recent ? recent->fingerprint : 0;
+}
+
+static void pppMatchPeerProfile() {
+    uint32_t fingerprint = lcpCtx.peerFingerprint;
+    if (fingerprint == 0 || fingerprint == pppModeCtx.profileFingerprint) {
+        return;
+    }
+
+    PppPeerProfile* match = nullptr;
+    for (int i = 0; i < PPP_PEER_PROFILES; i++) {
+        if (pppModeCtx.profiles[i].fingerprint == fingerprint) {
+            match = &pppModeCtx.profiles[i];
+            break;
+        }
+    }
+
+    // Unknown client - fall back to the full option set
+    pppApplyPeerProfile(match);
+    pppModeCtx.profileFingerprint = fingerprint;
+
+    if (usbDebug) {
+        UsbDebugPrint("");
+        Serial.printf("PPP: Peer 0x%08lX %s\r\n", (unsigned long)fingerprint,
+                      match ? "matches a saved profile" : "is new");
+    }
+}
+
+static void pppSavePeerProfile() {
+    uint32_t fingerprint = lcpCtx.peerFingerprint;
+    if (fingerprint == 0) {
+        return;
+    }
+
+    // Reuse this peer's slot, else evict the least recently used
+    PppPeerProfile* slot = nullptr;
+    for (int i = 0; i < PPP_PEER_PROFILES; i++) {
+        if (pppModeCtx.profiles[i].fingerprint == fingerprint) {
+            slot = &pppModeCtx.profiles[i];
+            break;
+        }
+    }
+    if (!slot) {
+        slot = &pppModeCtx.profiles[0];
+        for (int i = 1; i < PPP_PEER_PROFILES; i++) {
+            if (pppModeCtx.profiles[i].lastUsed < slot->lastUsed) {
+                slot = &pppModeCtx.profiles[i];
+            }
+        }
     }
+
+    slot->fingerprint = fingerprint;
+    slot->lastUsed = ++pppModeCtx.profileStamp;
+    slot->negotiationRttMs = pppCtx.negotiationRttMs;
+    slot->omitAccm = lcpCtx.omitAccm;
+    slot->omitMagic = lcpCtx.omitMagic;
+    slot->omitQuality = lcpCtx.omitQuality;
+    slot->vjRejected = ipcpCtx.vjPeerRejects;
+    slot->ccpDeclined = ccpCtx.peerDeclines;
+    slot->ccpUnsupported = pppModeCtx.ccpUnsupported;
+    pppModeCtx.profileFingerprint = fingerprint;
 }
 
 // ============================================================================
@@ -549,16 +863,34 @@ void enterPppMode() {
     // Initialize contexts
     pppInit(&pppCtx);
     lcpInit(&lcpCtx);
+    lcpCtx.accmProfile = (LcpAccmProfile)pppModeCtx.config.accmProfile;
+    lcpCtx.lqrAllowed = pppModeCtx.config.lqrEnabled;
+    lqmInit(&lqmCtx, pppModeCtx.config.echoInterval, pppModeCtx.config.echoFailures);
     ipcpInit(&ipcpCtx);
-    pppNatInit(&pppNatCtx);
+    ipcpCtx.vjAllowed = pppModeCtx.config.vjCompression;
+    vjInit(&pppVjCtx);
+    pppCtx.vj = &pppVjCtx;
+    ccpClose(&ccpCtx);
+    ccpInit(&ccpCtx);
+    ccpCtx.enabled = pppModeCtx.config.ccpCompression;
+    pppCtx.ccp = &ccpCtx;
+    pppSeedPeerProfile();
+    natInit(&pppNatCtx);
+    natSetLink(&pppNatCtx, pppNatLinkSend, &pppCtx);
 
     // Load port forwards from shared EEPROM storage
-    pppLoadPortForwards(&pppNatCtx);
+    loadPortForwards(&pppNatCtx);
 
     // Apply configuration
     ipcpSetGatewayIP(&ipcpCtx, pppModeCtx.config.gatewayIP);
     ipcpSetPoolStart(&ipcpCtx, pppModeCtx.config.poolStart);
-    ipcpSetDns(&ipcpCtx, pppModeCtx.config.primaryDns, pppModeCtx.config.secondaryDns);
+    // The client resolves through the gateway's DNS cache, with the
+    // configured server behind it in case the forwarder couldn't start
+    if (pppNatCtx.dns) {
+        ipcpSetDns(&ipcpCtx, pppModeCtx.config.gatewayIP, pppModeCtx.config.primaryDns);
+    } else {
+        ipcpSetDns(&ipcpCtx, pppModeCtx.config.primaryDns, pppModeCtx.config.secondaryDns);
+    }
 
     // Connect WiFi if needed
     if (WiFi.status() != WL_CONNECTED) {
@@ -571,10 +903,15 @@ void enterPppMode() {
         }
     }
 
+    gwLinkBegin();
+
     pppModeCtx.stateStartTime = millis();
     pppModeCtx.lastCleanup = millis();
     pppModeCtx.lastStatusUpdate = millis();
     pppModeCtx.lastLcpTimeout = millis();
+    pppModeCtx.linkStartTime = 0;
+    pppModeCtx.lastLcpUpMs = 0;
+    pppModeCtx.lastTimeToIpMs = 0;
 
     SerialPrintLn("PPP Gateway Starting...");
     SerialPrint("  Gateway IP: ");
@@ -583,17 +920,42 @@ void enterPppMode() {
     SerialPrintLn(ipToString(pppModeCtx.config.poolStart));
     SerialPrint("  WiFi IP:    ");
     SerialPrintLn(ipToString(WiFi.localIP()));
+    SerialPrint("  Link:       ");
+    SerialPrintLn(gwLinkDescription());
     SerialPrintLn("\r\nPress +++ or BACK button to exit");
 
-    // Start LCP negotiation immediately - server initiates
-    // Windows 98 and most dial-up clients expect the server to send first
-    pppModeCtx.state = PPP_MODE_LCP;
-    lcpOpen(&lcpCtx, &pppCtx);
-    SerialPrintLn("LCP: Initiating negotiation (server-first mode)");
+    if (gwLinkIsTcp()) {
+        // Nothing to negotiate with until the emulator connects
+        pppModeCtx.state = PPP_MODE_STARTING;
+        SerialPrintLn("Waiting for TCP client...");
+    } else {
+        // Start LCP negotiation immediately - server initiates
+        // Windows 98 and most dial-up clients expect the server to send first
+        pppModeCtx.state = PPP_MODE_LCP;
+        lcpOpen(&lcpCtx, &pppCtx);
+        SerialPrintLn("LCP: Initiating negotiation (server-first mode)");
+    }
 
     pppShowStatus();
 }
 
+// ============================================================================
+// Replay Early Link Input
+// ============================================================================
+// Bytes the auto-detector consumed while classifying the link; the rest of
+// the frame follows on the link and completes in the normal receive path
+
+void pppReplayInput(const uint8_t* data, uint16_t length) {
+    if (pppModeCtx.state == PPP_MODE_IDLE) {
+        return;
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        if (pppReceiveByte(&pppCtx, data[i]) > 0) {
+            pppProcessFrame();
+        }
+    }
+}
+
 // ============================================================================
 // Exit PPP Gateway Mode
 // ============================================================================
@@ -614,8 +976,15 @@ void exitPppMode() {
         lcpClose(&lcpCtx, &pppCtx);
     }
 
+    // Release CCP compression tables
+    ccpClose(&ccpCtx);
+    lqmStop(&lqmCtx);
+
     // Shutdown NAT
-    pppNatShutdown(&pppNatCtx);
+    natShutdown(&pppNatCtx);
+
+    // Release the TCP link (Terminate-Request above was pushed first)
+    gwLinkEnd();
 
     // Reset contexts
     pppReset(&pppCtx);
@@ -655,14 +1024,21 @@ static void pppUpdateActiveDisplay() {
         display.println(ipToString(ipcpCtx.peerIP));
 
         display.print("TCP: ");
-        display.print(pppNatGetActiveTcpCount(&pppNatCtx));
+        display.print(natGetActiveTcpCount(&pppNatCtx));
         display.print(" UDP: ");
-        display.println(pppNatGetActiveUdpCount(&pppNatCtx));
+        display.println(natGetActiveUdpCount(&pppNatCtx));
 
         display.print("TX:");
         display.print(pppNatCtx.packetsToInternet);
         display.print(" RX:");
         display.println(pppNatCtx.packetsFromInternet);
+
+        if (ccpTxActive(&ccpCtx) || ccpRxActive(&ccpCtx)) {
+            display.print("CCP T:");
+            display.print(pppRatioString(ccpTxRatio(&ccpCtx)));
+            display.print(" R:");
+            display.println(pppRatioString(ccpRxRatio(&ccpCtx)));
+        }
     } else if (pppModeCtx.state == PPP_MODE_LCP) {
         display.print("LCP: ");
         display.println(lcpStateName(lcpCtx.state));
@@ -677,6 +1053,19 @@ static void pppUpdateActiveDisplay() {
     display.display();
 }
 
+// ============================================================================
+// Format a compression ratio (hundredths) as "1.85"
+// ============================================================================
+
+static String pppRatioString(uint16_t ratio) {
+    String str = String(ratio / 100) + ".";
+    if (ratio % 100 < 10) {
+        str += "0";
+    }
+    str += String(ratio % 100);
+    return str;
+}
+
 // ============================================================================
 // Show PPP Status
 // ============================================================================
@@ -698,27 +1087,153 @@ void pppShowStatistics() {
     SerialPrintLn(String(pppCtx.framesSent));
     SerialPrint("FCS Errors:    ");
     SerialPrintLn(String(pppCtx.fcsErrors));
+    SerialPrint("Aborts:        ");
+    SerialPrintLn(String(pppCtx.rxAborts));
+    SerialPrint("Overruns:      ");
+    SerialPrintLn(String(pppCtx.rxOverruns));
+    SerialPrint("TX ACCM:       0x");
+    SerialPrintLn(String(pppCtx.txAccm, HEX));
+    SerialPrint("Time to IP:    ");
+    if (pppModeCtx.lastTimeToIpMs > 0) {
+        SerialPrint(String(pppModeCtx.lastTimeToIpMs));
+        SerialPrint(" ms (LCP ");
+        SerialPrint(String(pppModeCtx.lastLcpUpMs));
+        SerialPrintLn(" ms)");
+    } else {
+        SerialPrintLn("n/a");
+    }
+    SerialPrint("Config RTT:    ");
+    SerialPrint(String(pppCtx.negotiationRttMs));
+    SerialPrintLn(" ms");
+
+    SerialPrintLn("");
+    SerialPrint("VJ Compression: ");
+    if (pppVjCtx.txEnabled || pppVjCtx.rxEnabled) {
+        SerialPrint("TX ");
+        SerialPrint(pppVjCtx.txEnabled ? "on" : "off");
+        SerialPrint(", RX ");
+        SerialPrintLn(pppVjCtx.rxEnabled ? "on" : "off");
+    } else {
+        SerialPrintLn("not negotiated");
+    }
+    SerialPrint("VJ TX:         ");
+    SerialPrint(String(pppVjCtx.txCompressed));
+    SerialPrint(" compressed, ");
+    SerialPrint(String(pppVjCtx.txUncompressed));
+    SerialPrint(" full, ");
+    SerialPrint(String(pppVjCtx.txBytesSaved));
+    SerialPrintLn(" bytes saved");
+    SerialPrint("VJ RX:         ");
+    SerialPrint(String(pppVjCtx.rxCompressed));
+    SerialPrint(" compressed, ");
+    SerialPrint(String(pppVjCtx.rxUncompressed));
+    SerialPrint(" full, ");
+    SerialPrint(String(pppVjCtx.rxErrors));
+    SerialPrint(" errors, ");
+    SerialPrint(String(pppVjCtx.rxTossed));
+    SerialPrintLn(" tossed");
+
+    SerialPrintLn("");
+    SerialPrint("CCP:           ");
+    if (ccpTxActive(&ccpCtx) || ccpRxActive(&ccpCtx)) {
+        SerialPrint("Predictor-1 TX ");
+        SerialPrint(ccpTxActive(&ccpCtx) ? "on" : "off");
+        SerialPrint(", RX ");
+        SerialPrintLn(ccpRxActive(&ccpCtx) ? "on" : "off");
+    } else {
+        SerialPrintLn(ccpStateName(ccpCtx.state));
+    }
+    SerialPrint("CCP TX:        ");
+    SerialPrint(String(ccpCtx.txBytesIn));
+    SerialPrint(" -> ");
+    SerialPrint(String(ccpCtx.txBytesOut));
+    SerialPrint(" bytes (");
+    SerialPrint(pppRatioString(ccpTxRatio(&ccpCtx)));
+    SerialPrintLn(":1)");
+    SerialPrint("CCP RX:        ");
+    SerialPrint(String(ccpCtx.rxBytesIn));
+    SerialPrint(" -> ");
+    SerialPrint(String(ccpCtx.rxBytesOut));
+    SerialPrint(" bytes (");
+    SerialPrint(pppRatioString(ccpRxRatio(&ccpCtx)));
+    SerialPrintLn(":1)");
+    SerialPrint("CCP Resets:    ");
+    SerialPrint(String(ccpCtx.resetRequestsSent));
+    SerialPrint(" sent, ");
+    SerialPrint(String(ccpCtx.resetRequestsRcvd));
+    SerialPrint(" received, ");
+    SerialPrint(String(ccpCtx.rxErrors));
+    SerialPrintLn(" errors");
+    if (ccpCtx.heapRefusals > 0) {
+        SerialPrint("CCP Low Heap:  ");
+        SerialPrintLn(String(ccpCtx.heapRefusals));
+    }
 
     SerialPrintLn("");
     SerialPrint("Packets to Internet:   ");
     SerialPrintLn(String(pppNatCtx.packetsToInternet));
     SerialPrint("Packets from Internet: ");
     SerialPrintLn(String(pppNatCtx.packetsFromInternet));
+    SerialPrint("TCP Bytes to Client:   ");
+    SerialPrintLn(String(pppNatCtx.tcpBytesToClient));
+    SerialPrint("TCP Retransmits:       ");
+    SerialPrint(String(pppNatCtx.tcpRetransmits));
+    SerialPrint(" timeout, ");
+    SerialPrint(String(pppNatCtx.tcpFastRetransmits));
+    SerialPrintLn(" fast");
+    SerialPrint("TCP From Client:       ");
+    SerialPrint(String(pppNatCtx.tcpDupSegments));
+    SerialPrint(" duplicate, ");
+    SerialPrint(String(pppNatCtx.tcpOutOfOrder));
+    SerialPrintLn(" out of order");
+    SerialPrint("TCP Window Updates:    ");
+    SerialPrintLn(String(pppNatCtx.tcpWindowUpdates));
+    SerialPrint("TCP Read-Ahead:        ");
+    SerialPrint(String(pppNatCtx.readAheadBytes));
+    SerialPrint(" bytes held, peak ");
+    SerialPrint(String(pppNatCtx.readAheadPeak));
+    SerialPrintLn(" of " + String(NAT_READAHEAD_BUDGET));
+    SerialPrint("ICMP:                  ");
+    SerialPrint(String(pppNatCtx.icmpPackets));
+    SerialPrint(" echo, ");
+    SerialPrint(String(pppNatCtx.icmpErrors));
+    SerialPrint(" errors, ");
+    SerialPrint(String(g_icmpCallbackDropped));
+    SerialPrintLn(" queue overflows");
     SerialPrint("Dropped Packets:       ");
     SerialPrintLn(String(pppNatCtx.droppedPackets));
+    SerialPrint("Link MTU/MRU:          ");
+    SerialPrint(String(pppNatCtx.linkMtu));
+    SerialPrint("/");
+    SerialPrint(String(pppNatCtx.linkMru));
+    SerialPrint(", MSS clamped ");
+    SerialPrintLn(String(pppNatCtx.mssClamped));
 
     SerialPrintLn("");
     SerialPrint("TCP Connections: ");
-    SerialPrint(String(pppNatGetActiveTcpCount(&pppNatCtx)));
+    SerialPrint(String(natGetActiveTcpCount(&pppNatCtx)));
+    SerialPrint("/");
+    SerialPrint(String(pppNatCtx.tcpFlows.size));
     SerialPrint(" active, ");
     SerialPrint(String(pppNatCtx.tcpConnections));
-    SerialPrintLn(" total");
+    SerialPrint(" total, ");
+    SerialPrint(String(pppNatCtx.tcpFlows.evictions));
+    SerialPrintLn(" evicted");
 
     SerialPrint("UDP Sessions:    ");
-    SerialPrint(String(pppNatGetActiveUdpCount(&pppNatCtx)));
+    SerialPrint(String(natGetActiveUdpCount(&pppNatCtx)));
+    SerialPrint("/");
+    SerialPrint(String(pppNatCtx.udpFlows.size));
     SerialPrint(" active, ");
     SerialPrint(String(pppNatCtx.udpSessions));
-    SerialPrintLn(" total");
+    SerialPrint(" total, ");
+    SerialPrint(String(pppNatCtx.udpFlows.evictions));
+    SerialPrintLn(" evicted");
+
+    if (pppNatCtx.dns) {
+        SerialPrint("DNS Cache:       ");
+        SerialPrintLn(dnsFwdSummary(pppNatCtx.dns));
+    }
 
     SerialPrintLn("");
 
@@ -727,13 +1242,96 @@ void pppShowStatistics() {
     pppMenu(false);
 }
 
+// ============================================================================
+// Show Link Quality
+// ============================================================================
+
+void pppShowLinkQuality() {
+    SerialPrintLn("\r\n=== PPP Link Quality ===");
+
+    SerialPrint("Monitor:       ");
+    if (lqmCtx.linkDown) {
+        SerialPrintLn("LINK DOWN");
+    } else if (lqmCtx.running) {
+        SerialPrintLn(lqmCtx.echoIntervalSec > 0 ? "running" : "running (echo off)");
+    } else {
+        SerialPrintLn("idle");
+    }
+
+    SerialPrint("Echo:          ");
+    SerialPrint(String(lqmCtx.echoesSent));
+    SerialPrint(" sent, ");
+    SerialPrint(String(lqmCtx.echoReplies));
+    SerialPrint(" replies, ");
+    SerialPrint(String(lqmCtx.echoesMissed));
+    SerialPrint(" missed, ");
+    SerialPrint(String(lqmCtx.echoesLate));
+    SerialPrintLn(" late");
+
+    uint16_t loss = lqmEchoLossPermille(&lqmCtx);
+    SerialPrint("Echo Loss:     ");
+    SerialPrint(String(loss / 10));
+    SerialPrint(".");
+    SerialPrint(String(loss % 10));
+    SerialPrintLn("%");
+
+    SerialPrint("RTT (ms):      ");
+    if (lqmCtx.rttCount > 0) {
+        SerialPrint("last ");
+        SerialPrint(String(lqmCtx.rttLastMs));
+        SerialPrint(" min ");
+        SerialPrint(String(lqmCtx.rttMinMs));
+        SerialPrint(" p50 ");
+        SerialPrint(String(lqmRttPercentile(&lqmCtx, 50)));
+        SerialPrint(" p90 ");
+        SerialPrint(String(lqmRttPercentile(&lqmCtx, 90)));
+        SerialPrint(" max ");
+        SerialPrintLn(String(lqmCtx.rttMaxMs));
+    } else {
+        SerialPrintLn("no samples");
+    }
+
+    if (lqmCtx.loopbacks > 0) {
+        SerialPrint("Loopbacks:     ");
+        SerialPrintLn(String(lqmCtx.loopbacks));
+    }
+
+    SerialPrint("Framing:       ");
+    SerialPrint(String(pppCtx.fcsErrors));
+    SerialPrint(" FCS, ");
+    SerialPrint(String(pppCtx.rxAborts));
+    SerialPrint(" aborts, ");
+    SerialPrint(String(pppCtx.rxOverruns));
+    SerialPrint(" overruns in ");
+    SerialPrint(String(pppCtx.framesReceived));
+    SerialPrintLn(" frames");
+
+    SerialPrint("LQR:           ");
+    if (lqmCtx.lqrTx || lqmCtx.lqrRx || lqmCtx.inLqrs > 0) {
+        SerialPrint(String(lqmCtx.outLqrs));
+        SerialPrint(" sent, ");
+        SerialPrint(String(lqmCtx.inLqrs));
+        SerialPrintLn(" received");
+        SerialPrint("LQR Loss:      to client ");
+        SerialPrint(String(lqmCtx.lqrOutLost));
+        SerialPrint("/");
+        SerialPrint(String(lqmCtx.lqrOutSent));
+        SerialPrint(", from client ");
+        SerialPrint(String(lqmCtx.lqrInLost));
+        SerialPrint("/");
+        SerialPrintLn(String(lqmCtx.lqrInSent));
+    } else {
+        SerialPrintLn("not negotiated");
+    }
+}
+
 // ============================================================================
 // Configure Port Forwards - Submenu
 // ============================================================================
 
 static void pppConfigurePortForward() {
     // Load port forwards from EEPROM (in case of reboot)
-    pppLoadPortForwards(&pppNatCtx);
+    loadPortForwards(&pppNatCtx);
 
     // Show submenu
     SerialPrintLn("\r\n-=-=- PPP Port Forwarding Menu -=-=-");
@@ -791,7 +1389,7 @@ static void pppAddPortForward() {
         return;
     }
 
-    uint8_t proto = (protoStr == "TCP") ? PPP_IP_PROTO_TCP : PPP_IP_PROTO_UDP;
+    uint8_t proto = (protoStr == "TCP") ? IP_PROTO_TCP : IP_PROTO_UDP;
 
     // Prompt for external port
     String extPortPrompt = "External Port (on ESP32): ";
@@ -850,11 +1448,11 @@ static void pppAddPortForward() {
     }
 
     // Add the forward
-    int idx = pppNatAddPortForward(&pppNatCtx, proto, extPort, intIP, intPort);
+    int idx = natAddPortForward(&pppNatCtx, proto, extPort, intIP, intPort);
 
     if (idx >= 0) {
         // Save to EEPROM (shared storage with SLIP)
-        pppSavePortForwards(&pppNatCtx);
+        savePortForwards(&pppNatCtx);
 
         SerialPrintLn("\r\nPort forward added:");
         SerialPrint("  ");
@@ -886,12 +1484,12 @@ static void pppRemovePortForward() {
     SerialPrintLn("Active port forwards:");
 
     int count = 0;
-    for (int i = 0; i < PPP_NAT_MAX_PORT_FORWARDS; i++) {
+    for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
         if (pppNatCtx.portForwards[i].active) {
             SerialPrint("  ");
             SerialPrint(i);
             SerialPrint(": ");
-            SerialPrint(pppNatCtx.portForwards[i].protocol == PPP_IP_PROTO_TCP ? "TCP" : "UDP");
+            SerialPrint(pppNatCtx.portForwards[i].protocol == IP_PROTO_TCP ? "TCP" : "UDP");
             SerialPrint(" ");
             SerialPrint(pppNatCtx.portForwards[i].externalPort);
             SerialPrint(" -> ");
@@ -911,22 +1509,28 @@ static void pppRemovePortForward() {
     }
 
     SerialPrintLn();
-    SerialPrint("Index to remove (0-7, B=back): ");
+    String idxPrompt = "Index to remove (0-" + String(NAT_MAX_PORT_FORWARDS - 1) + ", B=back): ";
+    String idxStr = prompt(idxPrompt, "");
+    idxStr.trim();
 
-    // Wait for single keypress
-    while (SerialAvailable() == 0) {
-        delay(10);
-    }
-    char chr = SerialRead();
-    SerialPrintLn(chr);  // Echo the character
-
-    if (chr == 'B' || chr == 'b') {
+    if (idxStr == "" || idxStr.equalsIgnoreCase("B")) {
         pppConfigurePortForward();
         return;
     }
 
-    int idx = chr - '0';
-    if (idx < 0 || idx >= PPP_NAT_MAX_PORT_FORWARDS || !pppNatCtx.portForwards[idx].active) {
+    // Every character a digit - toInt() would read garbage as 0
+    int idx = -1;
+    if (idxStr.length() <= 2) {
+        idx = 0;
+        for (unsigned int i = 0; i < idxStr.length(); i++) {
+            if (idxStr[i] < '0' || idxStr[i] > '9') {
+                idx = -1;
+                break;
+            }
+            idx = idx * 10 + (idxStr[i] - '0');
+        }
+    }
+    if (idx < 0 || idx >= NAT_MAX_PORT_FORWARDS || !pppNatCtx.portForwards[idx].active) {
         SerialPrintLn("Invalid index");
         showMessage("Invalid index");
         delay(1500);
@@ -934,10 +1538,10 @@ static void pppRemovePortForward() {
         return;
     }
 
-    pppNatRemovePortForward(&pppNatCtx, idx);
+    natRemovePortForward(&pppNatCtx, idx);
 
     // Save to EEPROM (shared storage with SLIP)
-    pppSavePortForwards(&pppNatCtx);
+    savePortForwards(&pppNatCtx);
 
     SerialPrintLn("Port forward removed");
     showMessage("Forward\nremoved!");
@@ -955,12 +1559,12 @@ static void pppListPortForwards() {
     SerialPrintLn("Active port forwards:");
 
     int count = 0;
-    for (int i = 0; i < PPP_NAT_MAX_PORT_FORWARDS; i++) {
+    for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
         if (pppNatCtx.portForwards[i].active) {
             SerialPrint("  ");
             SerialPrint(i);
             SerialPrint(": ");
-            SerialPrint(pppNatCtx.portForwards[i].protocol == PPP_IP_PROTO_TCP ? "TCP" : "UDP");
+            SerialPrint(pppNatCtx.portForwards[i].protocol == IP_PROTO_TCP ? "TCP" : "UDP");
             SerialPrint(" ");
             SerialPrint(pppNatCtx.portForwards[i].externalPort);
             SerialPrint(" -> ");
@@ -1030,6 +1634,29 @@ void loadPppSettings() {
         EEPROM.read(PPP_SECONDARY_DNS_ADDRESS + 3)
     );
 
+    // Load ACCM compatibility profile (unprogrammed EEPROM reads 0xFF -> AUTO)
+    pppModeCtx.config.accmProfile = EEPROM.read(PPP_ACCM_PROFILE_ADDRESS);
+    if (pppModeCtx.config.accmProfile > LCP_ACCM_CONSERVATIVE) {
+        pppModeCtx.config.accmProfile = LCP_ACCM_AUTO;
+    }
+
+    // Load VJ compression setting (unprogrammed EEPROM reads 0xFF -> on)
+    pppModeCtx.config.vjCompression = EEPROM.read(PPP_VJ_ADDRESS) != 0;
+
+    // Load CCP setting (unprogrammed EEPROM reads 0xFF -> on)
+    pppModeCtx.config.ccpCompression = EEPROM.read(PPP_CCP_ADDRESS) != 0;
+
+    // Load link monitor settings (unprogrammed EEPROM reads 0xFF -> defaults)
+    pppModeCtx.config.echoInterval = EEPROM.read(PPP_ECHO_INTERVAL_ADDRESS);
+    if (pppModeCtx.config.echoInterval == 0xFF) {
+        pppModeCtx.config.echoInterval = LQM_DEFAULT_ECHO_INTERVAL;
+    }
+    pppModeCtx.config.echoFailures = EEPROM.read(PPP_ECHO_FAILURES_ADDRESS);
+    if (pppModeCtx.config.echoFailures == 0xFF) {
+        pppModeCtx.config.echoFailures = LQM_DEFAULT_ECHO_FAILURES;
+    }
+    pppModeCtx.config.lqrEnabled = EEPROM.read(PPP_LQR_ADDRESS) == 1;
+
     // Validate loaded configuration
     // Check that pool start matches gateway IP's network (first 3 octets should be related)
     // and that IPs are in valid private ranges
@@ -1085,6 +1712,20 @@ void savePppSettings() {
     EEPROM.write(PPP_SECONDARY_DNS_ADDRESS + 2, pppModeCtx.config.secondaryDns[2]);
     EEPROM.write(PPP_SECONDARY_DNS_ADDRESS + 3, pppModeCtx.config.secondaryDns[3]);
 
+    // Save ACCM compatibility profile
+    EEPROM.write(PPP_ACCM_PROFILE_ADDRESS, pppModeCtx.config.accmProfile);
+
+    // Save VJ compression setting
+    EEPROM.write(PPP_VJ_ADDRESS, pppModeCtx.config.vjCompression ? 1 : 0);
+
+    // Save CCP setting
+    EEPROM.write(PPP_CCP_ADDRESS, pppModeCtx.config.ccpCompression ? 1 : 0);
+
+    // Save link monitor settings
+    EEPROM.write(PPP_ECHO_INTERVAL_ADDRESS, pppModeCtx.config.echoInterval);
+    EEPROM.write(PPP_ECHO_FAILURES_ADDRESS, pppModeCtx.config.echoFailures);
+    EEPROM.write(PPP_LQR_ADDRESS, pppModeCtx.config.lqrEnabled ? 1 : 0);
+
     EEPROM.commit();
     pppModeCtx.configChanged = false;
 }
@@ -1098,6 +1739,12 @@ void pppDefaultConfig() {
     pppModeCtx.config.poolStart = IPAddress(192, 168, 8, 2);
     pppModeCtx.config.primaryDns = IPAddress(8, 8, 8, 8);
     pppModeCtx.config.secondaryDns = IPAddress(8, 8, 4, 4);
+    pppModeCtx.config.accmProfile = LCP_ACCM_AUTO;
+    pppModeCtx.config.vjCompression = true;
+    pppModeCtx.config.ccpCompression = true;
+    pppModeCtx.config.echoInterval = LQM_DEFAULT_ECHO_INTERVAL;
+    pppModeCtx.config.echoFailures = LQM_DEFAULT_ECHO_FAILURES;
+    pppModeCtx.config.lqrEnabled = false;
     pppModeCtx.state = PPP_MODE_IDLE;
     pppModeCtx.configChanged = true;
 }
@@ -1157,10 +1804,16 @@ bool handlePppCommand(String& cmd, String& upCmd) {
         return true;
     }
 
+    // AT$PPPLINK - Show link quality
+    if (upCmd == "AT$PPPLINK") {
+        pppShowLinkQuality();
+        return true;
+    }
+
     // AT$PPPSHOW - Show configuration
     if (upCmd == "AT$PPPSHOW") {
         loadPppSettings();
-        pppLoadPortForwards(&pppNatCtx);
+        loadPortForwards(&pppNatCtx);
         SerialPrintLn("\r\n=== PPP Configuration ===");
         SerialPrint("Gateway IP:    ");
         SerialPrintLn(ipToString(pppModeCtx.config.gatewayIP));
@@ -1170,14 +1823,36 @@ bool handlePppCommand(String& cmd, String& upCmd) {
         SerialPrintLn(ipToString(pppModeCtx.config.primaryDns));
         SerialPrint("Secondary DNS: ");
         SerialPrintLn(ipToString(pppModeCtx.config.secondaryDns));
+        SerialPrint("ACCM Profile:  ");
+        SerialPrintLn(lcpAccmProfileName((LcpAccmProfile)pppModeCtx.config.accmProfile));
+        SerialPrint("VJ Compress:   ");
+        SerialPrintLn(pppModeCtx.config.vjCompression ? "ON" : "OFF");
+        SerialPrint("CCP Compress:  ");
+        SerialPrintLn(pppModeCtx.config.ccpCompression ? "ON (Predictor-1)" : "OFF");
+        SerialPrint("LCP Echo:      ");
+        if (pppModeCtx.config.echoInterval > 0) {
+            SerialPrint("every ");
+            SerialPrint(String(pppModeCtx.config.echoInterval));
+            SerialPrint("s, drop after ");
+            SerialPrint(pppModeCtx.config.echoFailures > 0 ?
+                        String(pppModeCtx.config.echoFailures) + " missed" : String("never"));
+            SerialPrintLn("");
+        } else {
+            SerialPrintLn("OFF");
+        }
+        SerialPrint("LQR:           ");
+        SerialPrintLn(pppModeCtx.config.lqrEnabled ? "ON" : "OFF");
+        loadGwLinkSettings();
+        SerialPrint("Link:          ");
+        SerialPrintLn(gwLinkDescription());
 
         // Show port forwards
         SerialPrintLn("\r\n--- Port Forwards ---");
         int count = 0;
-        for (int i = 0; i < PPP_NAT_MAX_PORT_FORWARDS; i++) {
+        for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
             if (pppNatCtx.portForwards[i].active) {
                 SerialPrint("  ");
-                SerialPrint(pppNatCtx.portForwards[i].protocol == PPP_IP_PROTO_TCP ? "TCP" : "UDP");
+                SerialPrint(pppNatCtx.portForwards[i].protocol == IP_PROTO_TCP ? "TCP" : "UDP");
                 SerialPrint(" ");
                 SerialPrint(pppNatCtx.portForwards[i].externalPort);
                 SerialPrint(" -> ");
@@ -1257,6 +1932,99 @@ bool handlePppCommand(String& cmd, String& upCmd) {
         }
     }
 
+    // AT$PPPACCM=AUTO|NEG|SAFE - Set ACCM compatibility profile
+    if (upCmd.indexOf("AT$PPPACCM=") == 0) {
+        String mode = upCmd.substring(11);
+        LcpAccmProfile profile;
+        if (mode == "AUTO" || mode == "0") {
+            profile = LCP_ACCM_AUTO;
+        } else if (mode == "NEG" || mode == "NEGOTIATED" || mode == "1") {
+            profile = LCP_ACCM_NEGOTIATED;
+        } else if (mode == "SAFE" || mode == "CONSERVATIVE" || mode == "2") {
+            profile = LCP_ACCM_CONSERVATIVE;
+        } else {
+            SerialPrintLn("Usage: AT$PPPACCM=AUTO|NEG|SAFE");
+            return false;
+        }
+        loadPppSettings();
+        pppModeCtx.config.accmProfile = profile;
+        savePppSettings();
+        SerialPrint("ACCM profile set to ");
+        SerialPrintLn(lcpAccmProfileName(profile));
+        return true;
+    }
+
+    // AT$PPPVJ=0|1 - Disable/enable VJ header compression negotiation
+    if (upCmd.indexOf("AT$PPPVJ=") == 0) {
+        String mode = upCmd.substring(9);
+        if (mode != "0" && mode != "1") {
+            SerialPrintLn("Usage: AT$PPPVJ=0|1");
+            return false;
+        }
+        loadPppSettings();
+        pppModeCtx.config.vjCompression = (mode == "1");
+        savePppSettings();
+        SerialPrint("VJ compression ");
+        SerialPrintLn(pppModeCtx.config.vjCompression ? "enabled" : "disabled");
+        return true;
+    }
+
+    // AT$PPPCCP=0|1 - Disable/enable CCP (Predictor-1) compression negotiation
+    if (upCmd.indexOf("AT$PPPCCP=") == 0) {
+        String mode = upCmd.substring(10);
+        if (mode != "0" && mode != "1") {
+            SerialPrintLn("Usage: AT$PPPCCP=0|1");
+            return false;
+        }
+        loadPppSettings();
+        pppModeCtx.config.ccpCompression = (mode == "1");
+        savePppSettings();
+        SerialPrint("CCP compression ");
+        SerialPrintLn(pppModeCtx.config.ccpCompression ? "enabled" : "disabled");
+        return true;
+    }
+
+    // AT$PPPECHO=seconds[,failures] - LCP echo interval and link-down threshold
+    if (upCmd.indexOf("AT$PPPECHO=") == 0) {
+        String params = upCmd.substring(11);
+        int comma = params.indexOf(',');
+        String intervalStr = (comma >= 0) ? params.substring(0, comma) : params;
+        int interval = intervalStr.toInt();
+        int failures = (comma >= 0) ? params.substring(comma + 1).toInt() : -1;
+        if (intervalStr.length() == 0 || interval < 0 || interval > 254 ||
+            failures > 254 || (comma >= 0 && failures < 0)) {
+            SerialPrintLn("Usage: AT$PPPECHO=seconds[,failures] (0 = off)");
+            return false;
+        }
+        loadPppSettings();
+        pppModeCtx.config.echoInterval = interval;
+        if (failures >= 0) {
+            pppModeCtx.config.echoFailures = failures;
+        }
+        savePppSettings();
+        SerialPrint("LCP echo every ");
+        SerialPrint(String(pppModeCtx.config.echoInterval));
+        SerialPrint("s, link down after ");
+        SerialPrint(String(pppModeCtx.config.echoFailures));
+        SerialPrintLn(" missed");
+        return true;
+    }
+
+    // AT$PPPLQR=0|1 - Disable/enable Link-Quality-Report negotiation
+    if (upCmd.indexOf("AT$PPPLQR=") == 0) {
+        String mode = upCmd.substring(10);
+        if (mode != "0" && mode != "1") {
+            SerialPrintLn("Usage: AT$PPPLQR=0|1");
+            return false;
+        }
+        loadPppSettings();
+        pppModeCtx.config.lqrEnabled = (mode == "1");
+        savePppSettings();
+        SerialPrint("Link-Quality-Report ");
+        SerialPrintLn(pppModeCtx.config.lqrEnabled ? "enabled" : "disabled");
+        return true;
+    }
+
     // AT$PPPFWD=TCP,extport,intport - Add port forward (to pool start IP)
     if (upCmd.indexOf("AT$PPPFWD=") == 0) {
         String params = cmd.substring(10);
@@ -1272,9 +2040,9 @@ bool handlePppCommand(String& cmd, String& upCmd) {
 
         uint8_t proto;
         if (protoStr == "TCP") {
-            proto = PPP_IP_PROTO_TCP;
+            proto = IP_PROTO_TCP;
         } else if (protoStr == "UDP") {
-            proto = PPP_IP_PROTO_UDP;
+            proto = IP_PROTO_UDP;
         } else {
             SerialPrintLn("Invalid protocol (use TCP or UDP)");
             return false;
@@ -1301,13 +2069,13 @@ bool handlePppCommand(String& cmd, String& upCmd) {
 
         // Load current settings for client IP
         loadPppSettings();
-        pppLoadPortForwards(&pppNatCtx);
+        loadPortForwards(&pppNatCtx);
 
         // Add forward (using pool start as internal IP)
-        int idx = pppNatAddPortForward(&pppNatCtx, proto, extPort,
-                                        pppModeCtx.config.poolStart, intPort);
+        int idx = natAddPortForward(&pppNatCtx, proto, extPort,
+                                     pppModeCtx.config.poolStart, intPort);
         if (idx >= 0) {
-            pppSavePortForwards(&pppNatCtx);
+            savePortForwards(&pppNatCtx);
             SerialPrint("Port forward added: ");
             SerialPrint(protoStr);
             SerialPrint(" ");
@@ -1325,29 +2093,29 @@ bool handlePppCommand(String& cmd, String& upCmd) {
 
     // AT$PPPFWDDEL=index - Remove port forward
     if (upCmd.indexOf("AT$PPPFWDDEL=") == 0) {
-        pppLoadPortForwards(&pppNatCtx);
+        loadPortForwards(&pppNatCtx);
         int idx = cmd.substring(13).toInt();
-        if (idx < 0 || idx >= PPP_NAT_MAX_PORT_FORWARDS ||
+        if (idx < 0 || idx >= NAT_MAX_PORT_FORWARDS ||
             !pppNatCtx.portForwards[idx].active) {
             SerialPrintLn("Invalid index");
             return false;
         }
-        pppNatRemovePortForward(&pppNatCtx, idx);
-        pppSavePortForwards(&pppNatCtx);
+        natRemovePortForward(&pppNatCtx, idx);
+        savePortForwards(&pppNatCtx);
         SerialPrintLn("Port forward removed");
         return true;
     }
 
     // AT$PPPFWDLIST - List port forwards
     if (upCmd == "AT$PPPFWDLIST") {
-        pppLoadPortForwards(&pppNatCtx);
+        loadPortForwards(&pppNatCtx);
         SerialPrintLn("\r\n=== PPP Port Forwards ===");
         int count = 0;
-        for (int i = 0; i < PPP_NAT_MAX_PORT_FORWARDS; i++) {
+        for (int i = 0; i < NAT_MAX_PORT_FORWARDS; i++) {
             if (pppNatCtx.portForwards[i].active) {
                 SerialPrint(i);
                 SerialPrint(": ");
-                SerialPrint(pppNatCtx.portForwards[i].protocol == PPP_IP_PROTO_TCP ? "TCP" : "UDP");
+                SerialPrint(pppNatCtx.portForwards[i].protocol == IP_PROTO_TCP ? "TCP" : "UDP");
                 SerialPrint(" ");
                 SerialPrint(pppNatCtx.portForwards[i].externalPort);
                 SerialPrint(" -> ");
@@ -7,6 +7,7 @@
 #include "slip.h"
 #include "globals.h"
 #include "serial_io.h"
+#include "gateway_link.h"
 
 // Debug support
 extern bool usbDebug;
@@ -19,6 +20,8 @@ void slipInit(SlipContext* ctx) {
     ctx->rxState = SLIP_RX_IDLE;
     ctx->rxPos = 0;
     ctx->txPos = 0;
+    ctx->lastTxTime = 0;
+    ctx->vj = nullptr;
     ctx->framesReceived = 0;
     ctx->framesSent = 0;
     ctx->rxErrors = 0;
@@ -28,92 +31,121 @@ void slipInit(SlipContext* ctx) {
 }
 
 // ============================================================================
-// Receive SLIP-encoded byte
+// Receive SLIP-encoded span
 // ============================================================================
-// Process one byte at a time from serial input
-// Returns: 0 = continue receiving
-//          >0 = complete frame length (data in rxBuffer)
+// Runs of ordinary bytes are copied in one go; only END and ESC need the
+// state machine. An END both closes a frame and opens the next, so a peer
+// that only sends trailing ENDs loses nothing.
 
-int slipReceiveByte(SlipContext* ctx, uint8_t byte) {
-    ctx->bytesReceived++;
+int slipReceive(SlipContext* ctx, const uint8_t* data, uint16_t length,
+                uint16_t* consumed) {
+    uint16_t i = 0;
+    int frameLen = 0;
 
-    switch (ctx->rxState) {
-        case SLIP_RX_IDLE:
-            // Waiting for frame start
-            if (byte == SLIP_END) {
-                // Start of frame (or empty frame delimiter)
+    while (i < length && frameLen == 0) {
+        switch (ctx->rxState) {
+            case SLIP_RX_IDLE: {
+                // Waiting for frame start - skip line noise up to the next END
+                const uint8_t* end = (const uint8_t*)memchr(&data[i], SLIP_END, length - i);
+                if (!end) {
+                    i = length;
+                    break;
+                }
+                i = (end - data) + 1;
                 ctx->rxPos = 0;
                 ctx->rxState = SLIP_RX_RECEIVING;
+                break;
             }
-            // Ignore any other bytes while idle (line noise)
-            return 0;
-
-        case SLIP_RX_RECEIVING:
-            if (byte == SLIP_END) {
-                // End of frame
-                if (ctx->rxPos > 0) {
-                    // Valid frame received
+
+            case SLIP_RX_RECEIVING: {
+                // Copy the run of regular data bytes
+                uint16_t run = 0;
+                while (i + run < length && data[i + run] != SLIP_END && data[i + run] != SLIP_ESC) {
+                    run++;
+                }
+                if (run > 0) {
+                    if (ctx->rxPos + run <= SLIP_BUFFER_SIZE) {
+                        memcpy(&ctx->rxBuffer[ctx->rxPos], &data[i], run);
+                        ctx->rxPos += run;
+                    } else {
+                        // Buffer overflow - discard frame
+                        ctx->rxErrors++;
+                        ctx->rxState = SLIP_RX_IDLE;
+                        ctx->rxPos = 0;
+                    }
+                    i += run;
+                    break;
+                }
+
+                if (data[i++] == SLIP_ESC) {
+                    // Escape sequence starting
+                    ctx->rxState = SLIP_RX_ESCAPE;
+                } else if (ctx->rxPos > 0) {
+                    // End of frame - rxBuffer holds it until the next call
                     ctx->framesReceived++;
-                    int len = ctx->rxPos;
-                    ctx->rxState = SLIP_RX_IDLE;
-                    // Don't reset rxPos - caller needs the data
-                    return len;
+                    frameLen = ctx->rxPos;
+                    ctx->rxPos = 0;
                 }
                 // Empty frame (consecutive ENDs) - stay receiving
-                ctx->rxPos = 0;
-                return 0;
-            } else if (byte == SLIP_ESC) {
-                // Escape sequence starting
-                ctx->rxState = SLIP_RX_ESCAPE;
-                return 0;
-            } else {
-                // Regular data byte
+                break;
+            }
+
+            case SLIP_RX_ESCAPE: {
+                uint8_t byte = data[i++];
+                ctx->rxState = SLIP_RX_RECEIVING;
+
+                if (byte == SLIP_ESC_END) {
+                    // Escaped END -> store actual END character
+                    byte = SLIP_END;
+                } else if (byte == SLIP_ESC_ESC) {
+                    // Escaped ESC -> store actual ESC character
+                    byte = SLIP_ESC;
+                } else {
+                    // Invalid escape sequence - protocol error
+                    // RFC 1055 suggests storing the byte anyway, but we'll flag error
+                    ctx->rxErrors++;
+                }
+
                 if (ctx->rxPos < SLIP_BUFFER_SIZE) {
                     ctx->rxBuffer[ctx->rxPos++] = byte;
                 } else {
-                    // Buffer overflow - discard frame
+                    // Buffer overflow
                     ctx->rxErrors++;
                     ctx->rxState = SLIP_RX_IDLE;
                     ctx->rxPos = 0;
                 }
-                return 0;
+                break;
             }
+        }
+    }
 
-        case SLIP_RX_ESCAPE:
-            // Process escaped byte
-            ctx->rxState = SLIP_RX_RECEIVING;
-
-            if (byte == SLIP_ESC_END) {
-                // Escaped END -> store actual END character
-                byte = SLIP_END;
-            } else if (byte == SLIP_ESC_ESC) {
-                // Escaped ESC -> store actual ESC character
-                byte = SLIP_ESC;
-            } else {
-                // Invalid escape sequence - protocol error
-                // RFC 1055 suggests storing the byte anyway, but we'll flag error
-                ctx->rxErrors++;
-                // Continue anyway - some implementations may have quirks
-            }
+    ctx->bytesReceived += i;
+    *consumed = i;
+    return frameLen;
+}
 
-            if (ctx->rxPos < SLIP_BUFFER_SIZE) {
-                ctx->rxBuffer[ctx->rxPos++] = byte;
-            } else {
-                // Buffer overflow
-                ctx->rxErrors++;
-                ctx->rxState = SLIP_RX_IDLE;
-                ctx->rxPos = 0;
-            }
-            return 0;
-    }
+// ============================================================================
+// Receive SLIP-encoded byte
+// ============================================================================
+// Returns: 0 = continue receiving
+//          >0 = complete frame length (data in rxBuffer)
 
-    return 0;
+int slipReceiveByte(SlipContext* ctx, uint8_t byte) {
+    uint16_t consumed;
+    return slipReceive(ctx, &byte, 1, &consumed);
 }
 
 // ============================================================================
 // Send SLIP-encoded frame
 // ============================================================================
-// Takes raw IP packet data and sends it with SLIP framing to PhysicalSerial
+// Takes raw IP packet data and sends it with SLIP framing over the gateway link
+
+// Hand the encoded bytes to the link and start over at the top of txBuffer
+static void slipFlushTx(SlipContext* ctx) {
+    gwLinkWriteBytes(ctx->txBuffer, ctx->txPos);
+    ctx->bytesSent += ctx->txPos;
+    ctx->txPos = 0;
+}
 
 void slipSendFrame(SlipContext* ctx, const uint8_t* data, uint16_t length) {
     if (usbDebug) {
@@ -121,43 +153,102 @@ void slipSendFrame(SlipContext* ctx, const uint8_t* data, uint16_t length) {
         Serial.printf("SLIP: Sending frame, %d bytes\r\n", length);
     }
 
-    // RFC 1055 recommends sending END at start to flush any line noise
-    // This also serves as frame delimiter for back-to-back frames
-    PhysicalSerial.write(SLIP_END);
-    ctx->bytesSent++;
-
-    // Send data with escaping
-    for (uint16_t i = 0; i < length; i++) {
-        switch (data[i]) {
-            case SLIP_END:
-                // END character in data must be escaped
-                PhysicalSerial.write(SLIP_ESC);
-                PhysicalSerial.write(SLIP_ESC_END);
-                ctx->bytesSent += 2;
-                break;
+    // Wait for CTS once per frame when hardware flow control is enabled
+    gwLinkWaitClear();
 
-            case SLIP_ESC:
-                // ESC character in data must be escaped
-                PhysicalSerial.write(SLIP_ESC);
-                PhysicalSerial.write(SLIP_ESC_ESC);
-                ctx->bytesSent += 2;
-                break;
+    ctx->txPos = 0;
 
-            default:
-                // Regular byte - send as-is
-                PhysicalSerial.write(data[i]);
-                ctx->bytesSent++;
-                break;
+    // RFC 1055 recommends a leading END to flush line noise. Back to back,
+    // the previous frame's END already did that, so it only costs a byte
+    if (millis() - ctx->lastTxTime >= SLIP_IDLE_END_MS || ctx->framesSent == 0) {
+        ctx->txBuffer[ctx->txPos++] = SLIP_END;
+    }
+
+    uint16_t i = 0;
+    while (i < length) {
+        // Copy the run of bytes that need no escaping
+        uint16_t run = 0;
+        while (i + run < length && data[i + run] != SLIP_END && data[i + run] != SLIP_ESC) {
+            run++;
+        }
+        while (run > 0) {
+            uint16_t room = SLIP_BUFFER_SIZE - ctx->txPos;
+            uint16_t chunk = (run < room) ? run : room;
+            memcpy(&ctx->txBuffer[ctx->txPos], &data[i], chunk);
+            ctx->txPos += chunk;
+            i += chunk;
+            run -= chunk;
+            if (ctx->txPos == SLIP_BUFFER_SIZE) {
+                slipFlushTx(ctx);
+            }
+        }
+
+        // END or ESC in data must be escaped
+        if (i < length) {
+            if (ctx->txPos + 2 > SLIP_BUFFER_SIZE) {
+                slipFlushTx(ctx);
+            }
+            ctx->txBuffer[ctx->txPos++] = SLIP_ESC;
+            ctx->txBuffer[ctx->txPos++] = (data[i] == SLIP_END) ? SLIP_ESC_END : SLIP_ESC_ESC;
+            i++;
         }
     }
 
     // End frame
-    PhysicalSerial.write(SLIP_END);
-    ctx->bytesSent++;
+    if (ctx->txPos + 1 > SLIP_BUFFER_SIZE) {
+        slipFlushTx(ctx);
+    }
+    ctx->txBuffer[ctx->txPos++] = SLIP_END;
+    slipFlushTx(ctx);
+    gwLinkPush();
 
+    ctx->lastTxTime = millis();
     ctx->framesSent++;
 }
 
+// ============================================================================
+// Send IP packet (with optional CSLIP header compression)
+// ============================================================================
+// CSLIP has no protocol field, so the packet type rides in the top bits of
+// the first byte - for an UNCOMPRESSED_TCP packet that is the IP version
+
+void slipSendIpPacket(SlipContext* ctx, uint8_t* packet, uint16_t length) {
+    if (ctx->vj != nullptr && ctx->vj->txEnabled) {
+        uint8_t type = vjCompress(ctx->vj, &packet, &length);
+        if (type == VJ_TYPE_COMPRESSED_TCP) {
+            packet[0] |= VJ_TYPE_COMPRESSED_TCP;
+        } else if (type == VJ_TYPE_UNCOMPRESSED_TCP) {
+            packet[0] = (packet[0] & CSLIP_IP_MASK) | VJ_TYPE_UNCOMPRESSED_TCP;
+        }
+    }
+
+    slipSendFrame(ctx, packet, length);
+}
+
+// ============================================================================
+// Rebuild a received IP packet (undoing CSLIP header compression)
+// ============================================================================
+// The type bits sit over the IP version nibble or the change mask, so they
+// come off before the header is rebuilt
+
+int slipUncompressFrame(SlipContext* ctx, uint8_t* frame, uint16_t length,
+                        uint8_t* out, uint16_t outSize, uint8_t** packet) {
+    uint8_t type = cslipFrameType(frame);
+
+    if (type == VJ_TYPE_IP || ctx->vj == nullptr || !ctx->vj->rxEnabled) {
+        *packet = frame;
+        return length;
+    }
+
+    if (type == VJ_TYPE_UNCOMPRESSED_TCP) {
+        frame[0] &= CSLIP_IP_MASK;
+    } else {
+        frame[0] &= ~VJ_TYPE_COMPRESSED_TCP;
+    }
+    *packet = out;
+    return vjUncompress(ctx->vj, type, frame, length, out, outSize);
+}
+
 // ============================================================================
 // Reset SLIP receiver state
 // ============================================================================
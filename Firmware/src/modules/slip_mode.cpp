@@ -10,6 +10,7 @@
 #include "display_menu.h"
 #include "network.h"
 #include "modem.h"
+#include "gateway_link.h"
 #include <EEPROM.h>
 
 // Result code for AT OK response (matches enum in modem.cpp)
@@ -25,6 +26,13 @@ extern bool usbDebug;
 SlipContext slipCtx;
 NatContext natCtx;
 SlipModeContext slipModeCtx;
+VjContext slipVjCtx;
+
+// Link bytes are read and decoded a span at a time
+static uint8_t slipReadBuffer[256];
+
+// Rebuilt IP packet from a CSLIP-compressed frame
+static uint8_t slipVjRxBuffer[SLIP_BUFFER_SIZE];
 
 // Menu definitions
 String slipMenuDisp[] = { "MAIN", "Start Gateway", "Configure IP", "Port Forwards", "View Stats" };
@@ -55,6 +63,10 @@ extern bool BTNBK;
 static void slipMenuLoop();
 static void slipActiveLoop();
 static void slipUpdateActiveDisplay();
+static void slipProcessInput(const uint8_t* data, uint16_t length);
+static void slipNatLinkSend(void* link, uint8_t* packet, uint16_t length);
+static void slipStartCslip();
+static const char* slipCslipModeName(uint8_t mode);
 static bool parseIPAddress(const String& str, IPAddress& ip);
 static void slipAddPortForward();
 static void slipRemovePortForward();
@@ -157,6 +169,92 @@ static void slipMenuLoop() {
     }
 }
 
+// ============================================================================
+// NAT link adapter - packets for the client go out as SLIP frames
+// ============================================================================
+
+static void slipNatLinkSend(void* link, uint8_t* packet, uint16_t length) {
+    slipSendIpPacket((SlipContext*)link, packet, length);
+}
+
+// ============================================================================
+// Decode link input and hand complete packets to NAT
+// ============================================================================
+
+static void slipProcessFrame(uint8_t* frame, uint16_t frameLen) {
+    uint8_t* packet;
+    int ipLen = slipUncompressFrame(&slipCtx, frame, frameLen, slipVjRxBuffer,
+                                    sizeof(slipVjRxBuffer), &packet);
+    if (ipLen <= 0) {
+        if (usbDebug) {
+            UsbDebugPrint("");
+            Serial.printf("CSLIP packet dropped (%s), len=%d\r\n",
+                ipLen < 0 ? "error" : "tossed", frameLen);
+        }
+        return;
+    }
+
+    // Auto mode: a rebuilt header means the client speaks CSLIP, so answer
+    // in kind
+    if (packet != frame && !slipVjCtx.txEnabled &&
+        slipModeCtx.config.cslipMode == SLIP_CSLIP_AUTO) {
+        vjEnableTx(&slipVjCtx, SLIP_VJ_MAX_SLOT, true);
+        if (usbDebug) {
+            UsbDebugPrintLn("SLIP: Client uses CSLIP, compressing replies");
+        }
+    }
+
+    // Plain or rebuilt IP packet - process through NAT
+    natProcessPacket(&natCtx, packet, ipLen);
+}
+
+static void slipProcessInput(const uint8_t* data, uint16_t length) {
+    while (length > 0) {
+        uint32_t rxErrors = slipCtx.rxErrors;
+        uint16_t consumed;
+        int frameLen = slipReceive(&slipCtx, data, length, &consumed);
+        data += consumed;
+        length -= consumed;
+
+        if (slipCtx.rxErrors != rxErrors) {
+            // A damaged frame desyncs the decompressor until the next full header
+            vjToss(&slipVjCtx);
+        }
+
+        if (frameLen > 0) {
+            if (usbDebug) {
+                UsbDebugPrint("");
+                Serial.printf("SLIP: Received frame, %d bytes\r\n", frameLen);
+            }
+            slipProcessFrame(slipCtx.rxBuffer, frameLen);
+        }
+    }
+}
+
+// ============================================================================
+// Start CSLIP header compression for a new link
+// ============================================================================
+// Slot state belongs to one client, so every (re)connect starts from scratch
+
+static void slipStartCslip() {
+    vjInit(&slipVjCtx);
+    if (slipModeCtx.config.cslipMode != SLIP_CSLIP_OFF) {
+        vjEnableRx(&slipVjCtx, SLIP_VJ_MAX_SLOT);
+    }
+    if (slipModeCtx.config.cslipMode == SLIP_CSLIP_ON) {
+        vjEnableTx(&slipVjCtx, SLIP_VJ_MAX_SLOT, true);
+    }
+    slipCtx.vj = &slipVjCtx;
+}
+
+static const char* slipCslipModeName(uint8_t mode) {
+    switch (mode) {
+        case SLIP_CSLIP_OFF: return "OFF";
+        case SLIP_CSLIP_ON:  return "ON";
+        default:             return "AUTO";
+    }
+}
+
 // ============================================================================
 // SLIP Active Loop (When Gateway Running)
 // ============================================================================
@@ -223,21 +321,25 @@ static void slipActiveLoop() {
         }
     }
 
-    // Process incoming SLIP frames from PhysicalSerial only
-    while (PhysicalSerial.available()) {
-        uint8_t byte = PhysicalSerial.read();
-        int frameLen = slipReceiveByte(&slipCtx, byte);
-
-        if (frameLen > 0) {
-            // Complete IP packet received - process through NAT
-            if (usbDebug) {
-                UsbDebugPrint("");
-                Serial.printf("SLIP: Received frame, %d bytes\r\n", frameLen);
-            }
-            natProcessPacket(&natCtx, slipCtx.rxBuffer, frameLen);
+    // TCP link: SLIP has no session, so a new client just starts framing afresh
+    if (gwLinkAccept()) {
+        slipReset(&slipCtx);
+        slipStartCslip();
+    }
+    if (gwLinkDropped()) {
+        slipReset(&slipCtx);
+        slipStartCslip();
+        if (usbDebug) {
+            UsbDebugPrintLn("SLIP: TCP link closed, waiting for next client");
         }
     }
 
+    // Process incoming SLIP frames from the gateway link only
+    int len;
+    while ((len = gwLinkReadBytes(slipReadBuffer, sizeof(slipReadBuffer))) > 0) {
+        slipProcessInput(slipReadBuffer, len);
+    }
+
     // Poll NAT connections for incoming data from internet
     natPollConnections(&natCtx);
 
@@ -281,12 +383,15 @@ void enterSlipMode() {
 
     // Initialize SLIP context
     slipInit(&slipCtx);
+    slipStartCslip();
 
     // Initialize NAT context
     natInit(&natCtx);
+    natSetLink(&natCtx, slipNatLinkSend, &slipCtx);
+    natSetLinkMtu(&natCtx, SLIP_MTU, SLIP_MTU);
 
     // Apply loaded configuration
-    natCtx.slipIP = slipModeCtx.config.slipIP;
+    natCtx.gatewayIP = slipModeCtx.config.slipIP;
     natCtx.clientIP = slipModeCtx.config.clientIP;
     natCtx.subnetMask = slipModeCtx.config.subnetMask;
     natCtx.dnsServer = slipModeCtx.config.dnsServer;
@@ -302,6 +407,8 @@ void enterSlipMode() {
         }
     }
 
+    gwLinkBegin();
+
     slipModeCtx.state = SLIP_MODE_ACTIVE;
 
     // Load port forwards from EEPROM and start servers
@@ -311,16 +418,32 @@ void enterSlipMode() {
     // Display configuration
     SerialPrintLn("SLIP Gateway Active");
     SerialPrint("  Gateway IP: ");
-    SerialPrintLn(ipToString(natCtx.slipIP));
+    SerialPrintLn(ipToString(natCtx.gatewayIP));
     SerialPrint("  Client IP:  ");
     SerialPrintLn(ipToString(natCtx.clientIP));
     SerialPrint("  WiFi IP:    ");
     SerialPrintLn(ipToString(WiFi.localIP()));
+    SerialPrint("  Link:       ");
+    SerialPrintLn(gwLinkDescription());
+    SerialPrint("  CSLIP:      ");
+    SerialPrintLn(slipCslipModeName(slipModeCtx.config.cslipMode));
     SerialPrintLn("\r\nPress +++ or BACK button to exit");
 
     slipShowStatus();
 }
 
+// ============================================================================
+// Replay Early Link Input
+// ============================================================================
+// Bytes the auto-detector consumed while classifying the link
+
+void slipReplayInput(const uint8_t* data, uint16_t length) {
+    if (slipModeCtx.state != SLIP_MODE_ACTIVE) {
+        return;
+    }
+    slipProcessInput(data, length);
+}
+
 // ============================================================================
 // Exit SLIP Gateway Mode
 // ============================================================================
@@ -334,6 +457,9 @@ void exitSlipMode() {
     // Shutdown NAT (closes all connections)
     natShutdown(&natCtx);
 
+    // Release the TCP link
+    gwLinkEnd();
+
     // Reset SLIP state
     slipReset(&slipCtx);
 
@@ -364,7 +490,7 @@ void slipShowStatus() {
     // Status info
     display.setCursor(3, 19);
     display.print("GW: ");
-    display.print(ipToString(natCtx.slipIP));
+    display.print(ipToString(natCtx.gatewayIP));
 
     display.setCursor(3, 29);
     display.print("CL: ");
@@ -416,12 +542,63 @@ void slipShowStatistics() {
     SerialPrint("SLIP RX Errors:       ");
     SerialPrintLn(slipCtx.rxErrors);
     SerialPrintLn();
+    SerialPrint("CSLIP:                ");
+    SerialPrint(slipCslipModeName(slipModeCtx.config.cslipMode));
+    SerialPrint(", TX ");
+    SerialPrint(slipVjCtx.txEnabled ? "on" : "off");
+    SerialPrint(", RX ");
+    SerialPrintLn(slipVjCtx.rxEnabled ? "on" : "off");
+    SerialPrint("CSLIP TX:             ");
+    SerialPrint(String(slipVjCtx.txCompressed));
+    SerialPrint(" compressed, ");
+    SerialPrint(String(slipVjCtx.txUncompressed));
+    SerialPrint(" full, ");
+    SerialPrint(String(slipVjCtx.txBytesSaved));
+    SerialPrintLn(" bytes saved");
+    SerialPrint("CSLIP RX:             ");
+    SerialPrint(String(slipVjCtx.rxCompressed));
+    SerialPrint(" compressed, ");
+    SerialPrint(String(slipVjCtx.rxUncompressed));
+    SerialPrint(" full, ");
+    SerialPrint(String(slipVjCtx.rxErrors));
+    SerialPrint(" errors, ");
+    SerialPrint(String(slipVjCtx.rxTossed));
+    SerialPrintLn(" tossed");
+    SerialPrintLn();
     SerialPrint("Packets to Internet:  ");
     SerialPrintLn(natCtx.packetsToInternet);
     SerialPrint("Packets from Internet:");
     SerialPrintLn(natCtx.packetsFromInternet);
+    SerialPrint("TCP Bytes to Client:  ");
+    SerialPrintLn(natCtx.tcpBytesToClient);
+    SerialPrint("TCP Retransmits:      ");
+    SerialPrint(String(natCtx.tcpRetransmits));
+    SerialPrint(" timeout, ");
+    SerialPrint(String(natCtx.tcpFastRetransmits));
+    SerialPrintLn(" fast");
+    SerialPrint("TCP From Client:      ");
+    SerialPrint(String(natCtx.tcpDupSegments));
+    SerialPrint(" duplicate, ");
+    SerialPrint(String(natCtx.tcpOutOfOrder));
+    SerialPrintLn(" out of order");
+    SerialPrint("TCP Window Updates:   ");
+    SerialPrintLn(String(natCtx.tcpWindowUpdates));
+    SerialPrint("TCP Read-Ahead:       ");
+    SerialPrint(String(natCtx.readAheadBytes));
+    SerialPrint(" bytes held, peak ");
+    SerialPrint(String(natCtx.readAheadPeak));
+    SerialPrintLn(" of " + String(NAT_READAHEAD_BUDGET));
+    SerialPrint("ICMP:                 ");
+    SerialPrint(String(natCtx.icmpPackets));
+    SerialPrint(" echo, ");
+    SerialPrint(String(natCtx.icmpErrors));
+    SerialPrint(" errors, ");
+    SerialPrint(String(g_icmpCallbackDropped));
+    SerialPrintLn(" queue overflows");
     SerialPrint("Dropped Packets:      ");
     SerialPrintLn(natCtx.droppedPackets);
+    SerialPrint("MSS Clamped:          ");
+    SerialPrintLn(natCtx.mssClamped);
     SerialPrintLn();
     SerialPrint("Active TCP:           ");
     SerialPrintLn(natGetActiveTcpCount(&natCtx));
@@ -431,6 +608,17 @@ void slipShowStatistics() {
     SerialPrintLn(natCtx.tcpConnections);
     SerialPrint("Total UDP Sessions:   ");
     SerialPrintLn(natCtx.udpSessions);
+    SerialPrint("Flow Slots TCP/UDP:   ");
+    SerialPrint(String(natCtx.tcpFlows.size));
+    SerialPrint("/");
+    SerialPrintLn(String(natCtx.udpFlows.size));
+    SerialPrint("Flows Evicted:        ");
+    SerialPrintLn(natCtx.tcpFlows.evictions + natCtx.udpFlows.evictions +
+                  natCtx.icmpFlows.evictions);
+    if (natCtx.dns) {
+        SerialPrint("DNS Cache:            ");
+        SerialPrintLn(dnsFwdSummary(natCtx.dns));
+    }
     SerialPrintLn();
 
     showMessage("Stats shown\non serial");
@@ -488,6 +676,12 @@ void loadSlipSettings() {
         slipModeCtx.config.dnsServer = IPAddress(ip[0], ip[1], ip[2], ip[3]);
     }
 
+    // Load CSLIP mode (unprogrammed EEPROM reads 0xFF -> auto)
+    slipModeCtx.config.cslipMode = EEPROM.read(SLIP_CSLIP_ADDRESS);
+    if (slipModeCtx.config.cslipMode > SLIP_CSLIP_AUTO) {
+        slipModeCtx.config.cslipMode = SLIP_CSLIP_AUTO;
+    }
+
     slipModeCtx.configChanged = false;
 }
 
@@ -516,6 +710,9 @@ void saveSlipSettings() {
         EEPROM.write(SLIP_DNS_ADDRESS + i, slipModeCtx.config.dnsServer[i]);
     }
 
+    // Save CSLIP mode
+    EEPROM.write(SLIP_CSLIP_ADDRESS, slipModeCtx.config.cslipMode);
+
     EEPROM.commit();
     slipModeCtx.configChanged = false;
 }
@@ -773,21 +970,27 @@ static void slipRemovePortForward() {
     }
 
     SerialPrintLn();
-    SerialPrint("Index to remove (0-7, B=back): ");
-
-    // Wait for single keypress
-    while (SerialAvailable() == 0) {
-        delay(10);
-    }
-    char chr = SerialRead();
-    SerialPrintLn(chr);  // Echo the character
+    String idxPrompt = "Index to remove (0-" + String(NAT_MAX_PORT_FORWARDS - 1) + ", B=back): ";
+    String idxStr = prompt(idxPrompt, "");
+    idxStr.trim();
 
-    if (chr == 'B' || chr == 'b') {
+    if (idxStr == "" || idxStr.equalsIgnoreCase("B")) {
         slipConfigurePortForward();
         return;
     }
 
-    int idx = chr - '0';
+    // Every character a digit - toInt() would read garbage as 0
+    int idx = -1;
+    if (idxStr.length() <= 2) {
+        idx = 0;
+        for (unsigned int i = 0; i < idxStr.length(); i++) {
+            if (idxStr[i] < '0' || idxStr[i] > '9') {
+                idx = -1;
+                break;
+            }
+            idx = idx * 10 + (idxStr[i] - '0');
+        }
+    }
     if (idx < 0 || idx >= NAT_MAX_PORT_FORWARDS || !natCtx.portForwards[idx].active) {
         SerialPrintLn("Invalid index");
         showMessage("Invalid index");
@@ -851,6 +1054,7 @@ void slipDefaultConfig() {
     slipModeCtx.config.clientIP = IPAddress(192, 168, 7, 2);
     slipModeCtx.config.subnetMask = IPAddress(255, 255, 255, 0);
     slipModeCtx.config.dnsServer = IPAddress(8, 8, 8, 8);
+    slipModeCtx.config.cslipMode = SLIP_CSLIP_AUTO;
     slipModeCtx.configChanged = true;
 }
 
@@ -944,6 +1148,26 @@ bool handleSlipCommand(String& cmd, String& upCmd) {
         }
     }
 
+    // AT$SLIPVJ=0|1|AUTO - CSLIP header compression off, on, or follow the client
+    if (upCmd.startsWith("AT$SLIPVJ=")) {
+        String mode = upCmd.substring(10);
+        loadSlipSettings();
+        if (mode == "0" || mode == "OFF") {
+            slipModeCtx.config.cslipMode = SLIP_CSLIP_OFF;
+        } else if (mode == "1" || mode == "ON") {
+            slipModeCtx.config.cslipMode = SLIP_CSLIP_ON;
+        } else if (mode == "AUTO" || mode == "2") {
+            slipModeCtx.config.cslipMode = SLIP_CSLIP_AUTO;
+        } else {
+            SerialPrintLn("Usage: AT$SLIPVJ=0|1|AUTO");
+            return false;
+        }
+        saveSlipSettings();
+        SerialPrint("CSLIP set to ");
+        SerialPrintLn(slipCslipModeName(slipModeCtx.config.cslipMode));
+        return true;
+    }
+
     // AT$SLIPFWD=TCP,extport,intport - Add port forward
     if (upCmd.startsWith("AT$SLIPFWD=")) {
         String params = cmd.substring(11);
@@ -999,6 +1223,11 @@ bool handleSlipCommand(String& cmd, String& upCmd) {
         SerialPrintLn(ipToString(slipModeCtx.config.subnetMask));
         SerialPrint("DNS Server: ");
         SerialPrintLn(ipToString(slipModeCtx.config.dnsServer));
+        SerialPrint("CSLIP:      ");
+        SerialPrintLn(slipCslipModeName(slipModeCtx.config.cslipMode));
+        loadGwLinkSettings();
+        SerialPrint("Link:       ");
+        SerialPrintLn(gwLinkDescription());
         return true;
     }
 
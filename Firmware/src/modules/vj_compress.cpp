@@ -0,0 +1,531 @@
+// ============================================================================
+// Van Jacobson TCP/IP Header Compression Implementation (RFC 1144)
+// ============================================================================
+// Follows the reference slcompress algorithm. Headers are handled as raw
+// network-order byte arrays so packets need no particular alignment.
+// ============================================================================
+
+#include "vj_compress.h"
+#include "globals.h"
+
+// ============================================================================
+// Debug output
+// ============================================================================
+
+#ifdef PPP_DEBUG
+#define VJ_DEBUG_F(fmt, ...) Serial.printf(fmt "\r\n", ##__VA_ARGS__)
+#else
+#define VJ_DEBUG_F(fmt, ...)
+#endif
+
+// ============================================================================
+// Header field offsets (IPv4 / TCP)
+// ============================================================================
+
+#define VJ_IP_TOTLEN    2
+#define VJ_IP_ID        4
+#define VJ_IP_FRAG      6
+#define VJ_IP_PROTO     9
+#define VJ_IP_CSUM      10
+#define VJ_IP_SRC       12
+
+#define VJ_TCP_SEQ      4
+#define VJ_TCP_ACK      8
+#define VJ_TCP_OFF      12
+#define VJ_TCP_FLAGS    13
+#define VJ_TCP_WIN      14
+#define VJ_TCP_CSUM     16
+#define VJ_TCP_URP      18
+
+#define VJ_TH_FIN       0x01
+#define VJ_TH_SYN       0x02
+#define VJ_TH_RST       0x04
+#define VJ_TH_PUSH      0x08
+#define VJ_TH_ACK       0x10
+#define VJ_TH_URG       0x20
+
+#define VJ_PROTO_TCP    6
+
+// Largest compressed header: change mask, slot id, checksum, 5 x 3-byte deltas
+#define VJ_MAX_COMP_HDR 19
+
+// ============================================================================
+// Byte access helpers
+// ============================================================================
+
+static inline uint16_t vjGet16(const uint8_t* p) {
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t vjGet32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void vjPut16(uint8_t* p, uint16_t v) {
+    p[0] = (v >> 8) & 0xFF;
+    p[1] = v & 0xFF;
+}
+
+static inline void vjPut32(uint8_t* p, uint32_t v) {
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+}
+
+static uint16_t vjIpChecksum(const uint8_t* hdr, uint16_t length) {
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i + 1 < length; i += 2) {
+        sum += vjGet16(&hdr[i]);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return ~sum & 0xFFFF;
+}
+
+// Delta encoding: 1-255 in one byte, 0 or >255 as 0x00 + 16-bit value
+static inline uint8_t* vjEncode(uint8_t* cp, uint16_t n) {
+    if (n >= 256 || n == 0) {
+        *cp++ = 0;
+        *cp++ = (n >> 8) & 0xFF;
+        *cp++ = n & 0xFF;
+    } else {
+        *cp++ = (uint8_t)n;
+    }
+    return cp;
+}
+
+// Window/ack/seq deltas are only encoded when non-zero
+static inline uint8_t* vjEncodeNz(uint8_t* cp, uint16_t n) {
+    if (n >= 256) {
+        *cp++ = 0;
+        *cp++ = (n >> 8) & 0xFF;
+        *cp++ = n & 0xFF;
+    } else {
+        *cp++ = (uint8_t)n;
+    }
+    return cp;
+}
+
+static inline bool vjDecode(const uint8_t** cp, const uint8_t* end, uint16_t* n) {
+    const uint8_t* p = *cp;
+    if (p >= end) {
+        return false;
+    }
+    if (*p == 0) {
+        if (p + 3 > end) {
+            return false;
+        }
+        *n = vjGet16(p + 1);
+        *cp = p + 3;
+    } else {
+        *n = *p;
+        *cp = p + 1;
+    }
+    return true;
+}
+
+// ============================================================================
+// Initialize VJ Context
+// ============================================================================
+
+void vjInit(VjContext* ctx) {
+    memset(ctx, 0, sizeof(VjContext));
+    ctx->txMaxSlot = VJ_MAX_SLOTS - 1;
+    ctx->rxMaxSlot = VJ_MAX_SLOTS - 1;
+    ctx->txLastSlot = 0xFF;
+    ctx->rxLastSlot = 0;
+    ctx->rxToss = true;     // Nothing to decompress against until first UNCOMPRESSED_TCP
+}
+
+void vjEnableTx(VjContext* ctx, uint8_t maxSlot, bool compressSlotId) {
+    if (maxSlot >= VJ_MAX_SLOTS) {
+        maxSlot = VJ_MAX_SLOTS - 1;
+    }
+    ctx->txEnabled = true;
+    ctx->txMaxSlot = maxSlot;
+    ctx->txCompressSlotId = compressSlotId;
+    ctx->txLastSlot = 0xFF;
+    for (int i = 0; i < VJ_MAX_SLOTS; i++) {
+        ctx->txSlots[i].hdrLen = 0;
+        ctx->txSlots[i].lastUsed = 0;
+    }
+    VJ_DEBUG_F("VJ: TX enabled, %d slots, slot-id compression %s",
+               maxSlot + 1, compressSlotId ? "on" : "off");
+}
+
+void vjEnableRx(VjContext* ctx, uint8_t maxSlot) {
+    if (maxSlot >= VJ_MAX_SLOTS) {
+        maxSlot = VJ_MAX_SLOTS - 1;
+    }
+    ctx->rxEnabled = true;
+    ctx->rxMaxSlot = maxSlot;
+    ctx->rxLastSlot = 0;
+    ctx->rxToss = true;
+    for (int i = 0; i < VJ_MAX_SLOTS; i++) {
+        ctx->rxSlots[i].hdrLen = 0;
+    }
+    VJ_DEBUG_F("VJ: RX enabled, %d slots", maxSlot + 1);
+}
+
+void vjToss(VjContext* ctx) {
+    if (ctx->rxEnabled) {
+        ctx->rxToss = true;
+    }
+}
+
+// ============================================================================
+// Compressor
+// ============================================================================
+
+uint8_t vjCompress(VjContext* ctx, uint8_t** packet, uint16_t* length) {
+    uint8_t* ip = *packet;
+    uint16_t len = *length;
+
+    if (!ctx->txEnabled || len < 40) {
+        return VJ_TYPE_IP;
+    }
+
+    // Only unfragmented IPv4 TCP segments with ACK set and no SYN/FIN/RST
+    if ((ip[0] >> 4) != 4 || ip[VJ_IP_PROTO] != VJ_PROTO_TCP) {
+        return VJ_TYPE_IP;
+    }
+    if (vjGet16(&ip[VJ_IP_FRAG]) & 0x3FFF) {
+        return VJ_TYPE_IP;
+    }
+
+    uint16_t ipHlen = (ip[0] & 0x0F) * 4;
+    if (ipHlen < 20 || ipHlen + 20 > len) {
+        return VJ_TYPE_IP;
+    }
+
+    uint8_t* th = ip + ipHlen;
+    uint16_t tcpHlen = (th[VJ_TCP_OFF] >> 4) * 4;
+    uint16_t hlen = ipHlen + tcpHlen;
+    if (tcpHlen < 20 || hlen > len || hlen > VJ_MAX_HDR) {
+        return VJ_TYPE_IP;
+    }
+
+    uint8_t flags = th[VJ_TCP_FLAGS];
+    if ((flags & (VJ_TH_SYN | VJ_TH_FIN | VJ_TH_RST | VJ_TH_ACK)) != VJ_TH_ACK) {
+        return VJ_TYPE_IP;
+    }
+
+    // Find the slot for this connection (addresses + ports), else evict LRU
+    ctx->txSearches++;
+    int slotId = -1;
+    int freeId = -1;
+    int lruId = 0;
+    for (int i = 0; i <= ctx->txMaxSlot; i++) {
+        VjSlot* s = &ctx->txSlots[i];
+        if (s->hdrLen == 0) {
+            if (freeId < 0) {
+                freeId = i;
+            }
+            continue;
+        }
+        const uint8_t* sth = s->hdr + (s->hdr[0] & 0x0F) * 4;
+        if (memcmp(&s->hdr[VJ_IP_SRC], &ip[VJ_IP_SRC], 8) == 0 &&
+            memcmp(sth, th, 4) == 0) {
+            slotId = i;
+            break;
+        }
+        if (s->lastUsed < ctx->txSlots[lruId].lastUsed) {
+            lruId = i;
+        }
+    }
+
+    VjSlot* cs;
+    uint8_t changes = 0;
+    uint8_t comp[VJ_MAX_COMP_HDR];
+    uint8_t* cp = comp + 4;     // Leave room for change mask, slot id, checksum
+
+    if (slotId < 0) {
+        ctx->txMisses++;
+        slotId = (freeId >= 0) ? freeId : lruId;
+        cs = &ctx->txSlots[slotId];
+        goto uncompressed;
+    }
+
+    cs = &ctx->txSlots[slotId];
+    {
+        uint8_t* oip = cs->hdr;
+        uint16_t oIpHlen = (oip[0] & 0x0F) * 4;
+        uint8_t* oth = oip + oIpHlen;
+
+        // Fields that must not change between packets of a compressed stream
+        if (memcmp(&oip[0], &ip[0], 2) != 0 ||              // Version/IHL/TOS
+            memcmp(&oip[VJ_IP_FRAG], &ip[VJ_IP_FRAG], 4) != 0 ||   // Frag, TTL, proto
+            oth[VJ_TCP_OFF] != th[VJ_TCP_OFF] ||
+            oIpHlen != ipHlen ||
+            (ipHlen > 20 && memcmp(&oip[20], &ip[20], ipHlen - 20) != 0) ||
+            (tcpHlen > 20 && memcmp(&oth[20], &th[20], tcpHlen - 20) != 0)) {
+            goto uncompressed;
+        }
+
+        uint16_t delta;
+        if (flags & VJ_TH_URG) {
+            cp = vjEncode(cp, vjGet16(&th[VJ_TCP_URP]));
+            changes |= VJ_NEW_U;
+        } else if (vjGet16(&th[VJ_TCP_URP]) != vjGet16(&oth[VJ_TCP_URP])) {
+            goto uncompressed;
+        }
+
+        delta = vjGet16(&th[VJ_TCP_WIN]) - vjGet16(&oth[VJ_TCP_WIN]);
+        if (delta) {
+            cp = vjEncodeNz(cp, delta);
+            changes |= VJ_NEW_W;
+        }
+
+        uint32_t deltaA = vjGet32(&th[VJ_TCP_ACK]) - vjGet32(&oth[VJ_TCP_ACK]);
+        if (deltaA) {
+            if (deltaA > 0xFFFF) {
+                goto uncompressed;
+            }
+            cp = vjEncodeNz(cp, (uint16_t)deltaA);
+            changes |= VJ_NEW_A;
+        }
+
+        uint32_t deltaS = vjGet32(&th[VJ_TCP_SEQ]) - vjGet32(&oth[VJ_TCP_SEQ]);
+        if (deltaS) {
+            if (deltaS > 0xFFFF) {
+                goto uncompressed;
+            }
+            cp = vjEncodeNz(cp, (uint16_t)deltaS);
+            changes |= VJ_NEW_S;
+        }
+
+        uint16_t oldDataLen = vjGet16(&oip[VJ_IP_TOTLEN]) - hlen;
+
+        switch (changes) {
+            case 0:
+                // Nothing changed: only a data packet following a pure ACK is
+                // safe, anything else is a retransmit or probe
+                if (vjGet16(&ip[VJ_IP_TOTLEN]) != vjGet16(&oip[VJ_IP_TOTLEN]) &&
+                    vjGet16(&oip[VJ_IP_TOTLEN]) == hlen) {
+                    break;
+                }
+                goto uncompressed;
+
+            case VJ_SPECIAL_I:
+            case VJ_SPECIAL_D:
+                // Real deltas would be mistaken for the special cases
+                goto uncompressed;
+
+            case VJ_NEW_S | VJ_NEW_A:
+                if (deltaS == deltaA && deltaS == oldDataLen) {
+                    // Echoed interactive traffic
+                    changes = VJ_SPECIAL_I;
+                    cp = comp + 4;
+                }
+                break;
+
+            case VJ_NEW_S:
+                if (deltaS == oldDataLen) {
+                    // Unidirectional bulk data
+                    changes = VJ_SPECIAL_D;
+                    cp = comp + 4;
+                }
+                break;
+        }
+
+        delta = vjGet16(&ip[VJ_IP_ID]) - vjGet16(&oip[VJ_IP_ID]);
+        if (delta != 1) {
+            cp = vjEncode(cp, delta);
+            changes |= VJ_NEW_I;
+        }
+        if (flags & VJ_TH_PUSH) {
+            changes |= VJ_TCP_PUSH;
+        }
+
+        // Save this header as the new reference
+        memcpy(cs->hdr, ip, hlen);
+        cs->hdrLen = hlen;
+        cs->lastUsed = ++ctx->txStamp;
+
+        // Assemble: change mask, [slot id], TCP checksum, deltas
+        uint16_t deltaLen = cp - (comp + 4);
+        uint8_t hdr[4];
+        uint8_t hdrLen = 0;
+        if (!ctx->txCompressSlotId || ctx->txLastSlot != slotId) {
+            ctx->txLastSlot = slotId;
+            hdr[hdrLen++] = changes | VJ_NEW_C;
+            hdr[hdrLen++] = slotId;
+        } else {
+            hdr[hdrLen++] = changes;
+        }
+        hdr[hdrLen++] = th[VJ_TCP_CSUM];
+        hdr[hdrLen++] = th[VJ_TCP_CSUM + 1];
+
+        uint16_t clen = hdrLen + deltaLen;
+        uint8_t* out = ip + hlen - clen;
+        memmove(out + hdrLen, comp + 4, deltaLen);
+        memcpy(out, hdr, hdrLen);
+
+        *packet = out;
+        *length = len - hlen + clen;
+        ctx->txCompressed++;
+        ctx->txBytesSaved += hlen - clen;
+        return VJ_TYPE_COMPRESSED_TCP;
+    }
+
+uncompressed:
+    // Refresh the slot and send the full header with the slot id in the
+    // IP protocol field
+    memcpy(cs->hdr, ip, hlen);
+    cs->hdrLen = hlen;
+    cs->lastUsed = ++ctx->txStamp;
+    ip[VJ_IP_PROTO] = slotId;
+    ctx->txLastSlot = slotId;
+    ctx->txUncompressed++;
+    return VJ_TYPE_UNCOMPRESSED_TCP;
+}
+
+// ============================================================================
+// Decompressor
+// ============================================================================
+
+int vjUncompress(VjContext* ctx, uint8_t type, const uint8_t* in, uint16_t inLen,
+                 uint8_t* out, uint16_t outSize) {
+    if (!ctx->rxEnabled) {
+        ctx->rxErrors++;
+        return -1;
+    }
+
+    if (type == VJ_TYPE_UNCOMPRESSED_TCP) {
+        if (inLen < 40) {
+            goto bad;
+        }
+        uint8_t slotId = in[VJ_IP_PROTO];
+        if (slotId > ctx->rxMaxSlot) {
+            goto bad;
+        }
+        uint16_t hlen = (in[0] & 0x0F) * 4;
+        if (hlen < 20 || hlen + 20 > inLen) {
+            goto bad;
+        }
+        hlen += (in[hlen + VJ_TCP_OFF] >> 4) * 4;
+        if (hlen > inLen || hlen > VJ_MAX_HDR || inLen > outSize) {
+            goto bad;
+        }
+
+        memcpy(out, in, inLen);
+        out[VJ_IP_PROTO] = VJ_PROTO_TCP;
+
+        VjSlot* cs = &ctx->rxSlots[slotId];
+        memcpy(cs->hdr, out, hlen);
+        cs->hdrLen = hlen;
+        ctx->rxLastSlot = slotId;
+        ctx->rxToss = false;
+        ctx->rxUncompressed++;
+        return inLen;
+    }
+
+    if (type != VJ_TYPE_COMPRESSED_TCP || inLen < 3) {
+        goto bad;
+    }
+
+    {
+        const uint8_t* cp = in;
+        const uint8_t* end = in + inLen;
+        uint8_t changes = *cp++;
+
+        if (changes & VJ_NEW_C) {
+            uint8_t slotId = *cp++;
+            if (slotId > ctx->rxMaxSlot) {
+                goto bad;
+            }
+            ctx->rxToss = false;
+            ctx->rxLastSlot = slotId;
+        } else if (ctx->rxToss) {
+            // Lost sync after a framing error - wait for an explicit slot id
+            ctx->rxTossed++;
+            return 0;
+        }
+
+        VjSlot* cs = &ctx->rxSlots[ctx->rxLastSlot];
+        if (cs->hdrLen == 0 || cp + 2 > end) {
+            goto bad;
+        }
+
+        uint8_t* ip = cs->hdr;
+        uint16_t hlen = cs->hdrLen;
+        uint8_t* th = ip + (ip[0] & 0x0F) * 4;
+        uint16_t oldDataLen = vjGet16(&ip[VJ_IP_TOTLEN]) - hlen;
+        uint16_t v;
+
+        th[VJ_TCP_CSUM] = *cp++;
+        th[VJ_TCP_CSUM + 1] = *cp++;
+
+        if (changes & VJ_TCP_PUSH) {
+            th[VJ_TCP_FLAGS] |= VJ_TH_PUSH;
+        } else {
+            th[VJ_TCP_FLAGS] &= ~VJ_TH_PUSH;
+        }
+
+        switch (changes & VJ_SPECIALS_MASK) {
+            case VJ_SPECIAL_I:
+                vjPut32(&th[VJ_TCP_ACK], vjGet32(&th[VJ_TCP_ACK]) + oldDataLen);
+                vjPut32(&th[VJ_TCP_SEQ], vjGet32(&th[VJ_TCP_SEQ]) + oldDataLen);
+                break;
+
+            case VJ_SPECIAL_D:
+                vjPut32(&th[VJ_TCP_SEQ], vjGet32(&th[VJ_TCP_SEQ]) + oldDataLen);
+                break;
+
+            default:
+                if (changes & VJ_NEW_U) {
+                    th[VJ_TCP_FLAGS] |= VJ_TH_URG;
+                    if (!vjDecode(&cp, end, &v)) goto bad;
+                    vjPut16(&th[VJ_TCP_URP], v);
+                } else {
+                    th[VJ_TCP_FLAGS] &= ~VJ_TH_URG;
+                }
+                if (changes & VJ_NEW_W) {
+                    if (!vjDecode(&cp, end, &v)) goto bad;
+                    vjPut16(&th[VJ_TCP_WIN], vjGet16(&th[VJ_TCP_WIN]) + v);
+                }
+                if (changes & VJ_NEW_A) {
+                    if (!vjDecode(&cp, end, &v)) goto bad;
+                    vjPut32(&th[VJ_TCP_ACK], vjGet32(&th[VJ_TCP_ACK]) + v);
+                }
+                if (changes & VJ_NEW_S) {
+                    if (!vjDecode(&cp, end, &v)) goto bad;
+                    vjPut32(&th[VJ_TCP_SEQ], vjGet32(&th[VJ_TCP_SEQ]) + v);
+                }
+                break;
+        }
+
+        if (changes & VJ_NEW_I) {
+            if (!vjDecode(&cp, end, &v)) goto bad;
+            vjPut16(&ip[VJ_IP_ID], vjGet16(&ip[VJ_IP_ID]) + v);
+        } else {
+            vjPut16(&ip[VJ_IP_ID], vjGet16(&ip[VJ_IP_ID]) + 1);
+        }
+
+        // Rebuild: saved header + remaining payload, fresh length and checksum
+        uint16_t dataLen = end - cp;
+        uint16_t total = hlen + dataLen;
+        if (total > outSize) {
+            goto bad;
+        }
+
+        vjPut16(&ip[VJ_IP_TOTLEN], total);
+        vjPut16(&ip[VJ_IP_CSUM], 0);
+        vjPut16(&ip[VJ_IP_CSUM], vjIpChecksum(ip, (ip[0] & 0x0F) * 4));
+
+        memcpy(out, ip, hlen);
+        memcpy(out + hlen, cp, dataLen);
+        ctx->rxCompressed++;
+        return total;
+    }
+
+bad:
+    ctx->rxErrors++;
+    ctx->rxToss = true;
+    VJ_DEBUG_F("VJ: Bad %s packet (len=%d), tossing until resync",
+               type == VJ_TYPE_COMPRESSED_TCP ? "compressed" : "uncompressed", inLen);
+    return -1;
+}
@@ -6,6 +6,7 @@
 #include "SD.h"
 #include "web_ui.h"
 #include "settings.h"
+#include "ppp_mode.h"
 
 // External references to global objects and variables
 extern WebServer webServer;
@@ -44,6 +45,9 @@ void setupWebServer() {
   // Status API
   webServer.on("/api/status", HTTP_GET, handleApiStatus);
 
+  // PPP link status API
+  webServer.on("/api/ppp", HTTP_GET, handleApiPpp);
+
   // Settings API
   webServer.on("/api/settings", HTTP_GET, handleApiSettingsGet);
   webServer.on("/api/settings", HTTP_POST, handleApiSettingsPost);
@@ -128,6 +132,54 @@ void handleApiStatus() {
   webServer.send(200, "application/json", response);
 }
 
+// GET /api/ppp - Return PPP link state and quality as JSON
+void handleApiPpp() {
+  JsonDocument doc;
+
+  doc["active"] = (pppModeCtx.state == PPP_MODE_ACTIVE);
+  doc["state"] = (int)pppModeCtx.state;
+  if (pppModeCtx.state == PPP_MODE_ACTIVE) {
+    doc["clientIp"] = ipToString(ipcpCtx.peerIP);
+  }
+  doc["timeToIpMs"] = pppModeCtx.lastTimeToIpMs;
+
+  JsonObject framing = doc["framing"].to<JsonObject>();
+  framing["framesRx"] = pppCtx.framesReceived;
+  framing["framesTx"] = pppCtx.framesSent;
+  framing["fcsErrors"] = pppCtx.fcsErrors;
+  framing["aborts"] = pppCtx.rxAborts;
+  framing["overruns"] = pppCtx.rxOverruns;
+
+  JsonObject echo = doc["echo"].to<JsonObject>();
+  echo["intervalSec"] = lqmCtx.echoIntervalSec;
+  echo["sent"] = lqmCtx.echoesSent;
+  echo["replies"] = lqmCtx.echoReplies;
+  echo["missed"] = lqmCtx.echoesMissed;
+  echo["late"] = lqmCtx.echoesLate;
+  echo["lossPermille"] = lqmEchoLossPermille(&lqmCtx);
+  echo["rttLastMs"] = lqmCtx.rttLastMs;
+  echo["rttMinMs"] = lqmCtx.rttMinMs;
+  echo["rttP50Ms"] = lqmRttPercentile(&lqmCtx, 50);
+  echo["rttP90Ms"] = lqmRttPercentile(&lqmCtx, 90);
+  echo["rttMaxMs"] = lqmCtx.rttMaxMs;
+
+  JsonObject lqr = doc["lqr"].to<JsonObject>();
+  lqr["tx"] = lqmCtx.lqrTx;
+  lqr["rx"] = lqmCtx.lqrRx;
+  lqr["sent"] = lqmCtx.outLqrs;
+  lqr["received"] = lqmCtx.inLqrs;
+  lqr["toClientSent"] = lqmCtx.lqrOutSent;
+  lqr["toClientLost"] = lqmCtx.lqrOutLost;
+  lqr["fromClientSent"] = lqmCtx.lqrInSent;
+  lqr["fromClientLost"] = lqmCtx.lqrInLost;
+
+  doc["linkDown"] = lqmCtx.linkDown;
+
+  String response;
+  serializeJson(doc, response);
+  webServer.send(200, "application/json", response);
+}
+
 // GET /api/settings - Return all settings as JSON
 void handleApiSettingsGet() {
   JsonDocument doc;
@@ -0,0 +1,131 @@
+// ============================================================================
+// Concurrent Connect Benchmark
+// ============================================================================
+// A browser opening a page: one SYN per resource, all at once, to servers
+// that answer after different delays - one refuses, one never answers.
+// The clock steps a millisecond at a time; meanwhile the client pings the
+// gateway, which only gets answered if the link is still being serviced.
+// The blocking connect() the NAT used to make would have held the main
+// loop for each handshake in turn.
+// ============================================================================
+
+#include <stdio.h>
+#include <map>
+#include "bench.h"
+#include "fake_link.h"
+#include "fake_lwip.h"
+#include "host.h"
+#include "test_link.h"
+
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+
+static const uint32_t CLIENT  = ipAddr(192, 168, 7, 2);
+static const uint32_t GATEWAY = ipAddr(192, 168, 7, 1);
+
+enum Outcome { ACCEPT, REFUSE, SILENT };
+
+struct Server {
+    uint32_t delay;     // ms until the server answers
+    Outcome outcome;
+};
+
+// Page, stylesheets, scripts and images on a handful of hosts
+static const Server SERVERS[] = {
+    { 45, ACCEPT }, { 60, ACCEPT }, { 80, ACCEPT }, { 120, ACCEPT },
+    { 150, REFUSE }, { 220, ACCEPT }, { 350, ACCEPT }, { 600, ACCEPT },
+    { 1200, ACCEPT }, { 0, SILENT },
+};
+static const int SERVER_COUNT = sizeof(SERVERS) / sizeof(SERVERS[0]);
+
+static uint32_t serverAddr(int i) {
+    return ipAddr(10, 0, 1, 10 + i);
+}
+
+int main(int argc, char** argv) {
+    benchIterations(argc, argv, 1);     // The run is the same either way
+
+    hostReset();
+    hostSetFreeHeap(320000);            // Room for a slot per server
+    fakeLwipReset();
+    fakeLinkReset();
+    static NatContext nat;
+    natInit(&nat);
+    SlipTestLink link;
+    link.begin(&nat);
+
+    for (int i = 0; i < SERVER_COUNT; i++) {
+        link.send(buildTcp(CLIENT, 1200 + i, serverAddr(i), 80, 1000 * i, 0, TCP_SYN,
+                           4096, Bytes()));
+    }
+
+    std::map<uint16_t, uint32_t> resolved;     // Client port -> ms
+    std::map<uint16_t, bool> accepted;
+    std::map<uint16_t, uint32_t> pingSent;     // Sequence -> ms
+    uint32_t pings = 0, answered = 0, worstPing = 0, now = 0;
+
+    while ((int)resolved.size() < SERVER_COUNT && now < 20000) {
+        for (int i = 0; i < SERVER_COUNT; i++) {
+            if (SERVERS[i].outcome == SILENT || SERVERS[i].delay != now) {
+                continue;
+            }
+            struct tcp_pcb* pcb = fakeTcpFind(serverAddr(i), 80);
+            if (pcb && SERVERS[i].outcome == ACCEPT) {
+                fakeTcpAccept(pcb);
+            } else if (pcb) {
+                fakeTcpRefuse(pcb);
+            }
+        }
+
+        if (now % 50 == 0) {
+            pingSent[++pings] = now;
+            link.send(buildIcmpEcho(CLIENT, GATEWAY, 8, 0x77, pings, bytesOf("alive?")));
+        }
+        link.poll();
+
+        for (const Bytes& p : link.take()) {
+            Parsed r = parsePacket(p);
+            if (r.protocol == 1 && r.flags == 0 && pingSent.count(r.seq)) {
+                answered++;
+                worstPing = std::max(worstPing, now - pingSent[r.seq]);
+            } else if (r.protocol == 6 && !resolved.count(r.dstPort)) {
+                resolved[r.dstPort] = now;
+                accepted[r.dstPort] = (r.flags & TCP_SYN) && !(r.flags & TCP_RST);
+            }
+        }
+
+        hostAdvanceMs(1);
+        now++;
+    }
+
+    printf("%d connects opened at once\n", SERVER_COUNT);
+    printf("%-14s %10s %10s  %s\n", "server", "answers", "client", "result");
+    uint32_t blocking = 0, last = 0, lastAccepted = 0;
+    for (int i = 0; i < SERVER_COUNT; i++) {
+        uint16_t port = 1200 + i;
+        uint32_t wait = SERVERS[i].outcome == SILENT ? NAT_TCP_CONNECT_TIMEOUT_MS
+                                                     : SERVERS[i].delay;
+        blocking += wait;
+        IPAddress addr(serverAddr(i));
+        if (resolved.count(port)) {
+            last = std::max(last, resolved[port]);
+            if (accepted[port]) {
+                lastAccepted = std::max(lastAccepted, resolved[port]);
+            }
+            printf("%-14s %8ums %8ums  %s\n", addr.toString().c_str(), (unsigned)wait,
+                   (unsigned)resolved[port], accepted[port] ? "SYN-ACK" : "RST");
+        } else {
+            printf("%-14s %8ums %10s  unresolved\n", addr.toString().c_str(),
+                   (unsigned)wait, "-");
+        }
+    }
+    printf("connected by %u ms, all resolved by %u ms\n", (unsigned)lastAccepted,
+           (unsigned)last);
+    printf("blocking connects one after another: %u ms with the link unserviced\n",
+           (unsigned)blocking);
+    printf("gateway pings while connecting: %u sent, %u answered, worst %u ms\n",
+           (unsigned)pings, (unsigned)answered, (unsigned)worstPing);
+
+    natShutdown(&nat);
+    return ((int)resolved.size() == SERVER_COUNT && answered == pings) ? 0 : 1;
+}
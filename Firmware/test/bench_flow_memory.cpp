@@ -0,0 +1,54 @@
+// ============================================================================
+// Flow Memory
+// ============================================================================
+// What a NAT flow costs, and the flow tables natInit sizes from a given
+// free heap. Slot sizes are this build's; the rest is an estimate from the
+// Arduino-ESP32 lwIP config the stubs copy. A TCP flow is its slot, up to
+// a window of server data held until the client ACKs it and a send buffer
+// of client data lwIP holds for the server. On WiFiClient the same two
+// buffers sat in the socket, with the client's own receive buffer on top.
+// lwIP's tcp_pcb is left out of both: the stub's is not lwIP's.
+// ============================================================================
+
+#include <stdio.h>
+#include "bench.h"
+#include "fake_lwip.h"
+#include "host.h"
+#include "nat.h"
+
+#define WIFICLIENT_RX_BUFFER 1436   // arduino-esp32 WiFiClient's receive buffer
+
+int main(int argc, char** argv) {
+    benchIterations(argc, argv, 1);     // Nothing to repeat
+
+    printf("flow slots in this build (%u-byte pointers)\n", (unsigned)sizeof(void*));
+    printf("  NatTcpEntry   %4u B (bound %u B)\n", (unsigned)sizeof(NatTcpEntry),
+           (unsigned)NAT_TCP_ENTRY_MAX);
+    printf("  NatUdpEntry   %4u B\n", (unsigned)sizeof(NatUdpEntry));
+    printf("  NatIcmpEntry  %4u B\n", (unsigned)sizeof(NatIcmpEntry));
+
+    uint32_t raw = sizeof(NatTcpEntry) + TCP_WND + TCP_SND_BUF;
+    uint32_t wifi = raw + WIFICLIENT_RX_BUFFER;
+    printf("TCP flow, worst-case estimate (TCP_WND %u, TCP_SND_BUF %u, plus tcp_pcb)\n",
+           (unsigned)TCP_WND, (unsigned)TCP_SND_BUF);
+    printf("  raw pcb       %5u B (slot + TCP_WND + TCP_SND_BUF)\n", (unsigned)raw);
+    printf("  WiFiClient    %5u B (slot + socket TCP_WND + TCP_SND_BUF + rx buffer %u)\n",
+           (unsigned)wifi, WIFICLIENT_RX_BUFFER);
+
+    printf("tables natInit sizes (TCP capped at %d pcbs)\n",
+           MEMP_NUM_TCP_PCB - NAT_RESERVED_PCBS);
+    printf("  %9s %5s %5s %5s\n", "free heap", "TCP", "UDP", "ICMP");
+    for (uint32_t heap : { 80000u, 120000u, 160000u, 240000u }) {
+        hostReset();
+        fakeLwipReset();
+        hostSetFreeHeap(heap);
+        static NatContext nat;
+        nat = NatContext();
+        natInit(&nat);
+        printf("  %9u %5u %5u %5u\n", (unsigned)heap, nat.tcpFlows.size,
+               nat.udpFlows.size, nat.icmpFlows.size);
+        natShutdown(&nat);
+    }
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+// ============================================================================
+// TCP Goodput Benchmark
+// ============================================================================
+// A download through the NAT to a SLIP client on a simulated serial line:
+// each direction carries baud/10 bytes a second, and the client answers
+// every segment after a turnaround - a period stack, or a modem hop. A client
+// window of one MSS holds the NAT to one segment per round trip - the
+// stop-and-wait delivery it used to do - against a window of several.
+// ============================================================================
+
+#include <stdio.h>
+#include <deque>
+#include "bench.h"
+#include "fake_link.h"
+#include "fake_lwip.h"
+#include "host.h"
+#include "nat.h"
+#include "packets.h"
+#include "slip.h"
+
+#define TCP_SYN 0x02
+#define TCP_ACK 0x10
+#define CLIENT_MSS 536
+
+static const uint32_t CLIENT = ipAddr(192, 168, 7, 2);
+static const uint32_t SERVER = ipAddr(10, 0, 0, 80);
+
+// One direction of the serial line
+struct Wire {
+    std::deque<uint8_t> bytes;
+    double credit = 0;
+
+    // Bytes that finish crossing in the next millisecond
+    Bytes tick(double bytesPerMs) {
+        credit += bytesPerMs;
+        Bytes out;
+        while (credit >= 1 && !bytes.empty()) {
+            out.push_back(bytes.front());
+            bytes.pop_front();
+            credit -= 1;
+        }
+        if (bytes.empty()) {
+            credit = 0;
+        }
+        return out;
+    }
+};
+
+struct Result {
+    double seconds;
+    uint32_t retransmits;
+};
+
+// Download total bytes at baud with the client advertising window, and
+// sending each ACK turnaround ms after the segment arrived
+static Result download(long baud, uint16_t window, uint32_t total, int turnaround) {
+    hostReset();
+    fakeLwipReset();
+    fakeLinkReset();
+
+    static NatContext nat;
+    nat = NatContext();
+    SlipContext gateway, client;
+    slipInit(&gateway);
+    slipInit(&client);
+    natInit(&nat);
+    natSetLink(&nat, [](void* link, uint8_t* packet, uint16_t length) {
+        slipSendIpPacket((SlipContext*)link, packet, length);
+    }, &gateway);
+    natSetLinkMtu(&nat, CLIENT_MSS + 40, CLIENT_MSS + 40);
+
+    Wire down, up;
+    double rate = baud / 10.0 / 1000.0;
+    std::deque<std::pair<unsigned long, Bytes>> pending;   // Client sends due
+    unsigned long now = 0;
+
+    uint32_t seq = 1000, rcvNext = 0, received = 0, delivered = 0;
+    bool established = false;
+    struct tcp_pcb* pcb = nullptr;
+    unsigned long start = 0;
+
+    Bytes body(CLIENT_MSS);
+    for (size_t i = 0; i < body.size(); i++) {
+        body[i] = (uint8_t)i;
+    }
+    uint8_t mss[] = { 2, 4, CLIENT_MSS >> 8, CLIENT_MSS & 0xFF };
+    pending.push_back({ 0, buildTcp(CLIENT, 1100, SERVER, 80, seq, 0, TCP_SYN, window,
+                                    Bytes(), Bytes(mss, mss + 4)) });
+
+    while (received < total && now < 3600000) {
+        // Server: accept, then keep its send window full
+        if (!pcb && (pcb = fakeTcpFind(SERVER, 80)) != nullptr) {
+            fakeTcpAccept(pcb);
+        }
+        if (established) {
+            while (delivered < total && delivered - fakeTcpRecved(pcb) < TCP_WND) {
+                uint16_t chunk = std::min<uint32_t>(body.size(), total - delivered);
+                if (!fakeTcpDeliver(pcb, body.data(), chunk)) {
+                    break;
+                }
+                delivered += chunk;
+            }
+        }
+
+        // Gateway: service the NAT, its frames join the downstream line
+        natPollConnections(&nat);
+        Bytes out = fakeLinkTake();
+        down.bytes.insert(down.bytes.end(), out.begin(), out.end());
+
+        // Client: take what arrived, acknowledge in order data
+        Bytes arrived = down.tick(rate);
+        uint16_t pos = 0;
+        while (pos < arrived.size()) {
+            uint16_t consumed;
+            int n = slipReceive(&client, &arrived[pos], arrived.size() - pos, &consumed);
+            pos += consumed;
+            if (n <= 0) {
+                continue;
+            }
+            Parsed r = parsePacket(Bytes(client.rxBuffer, client.rxBuffer + n));
+            if (r.protocol != 6) {
+                continue;
+            }
+            if (r.flags & TCP_SYN) {
+                rcvNext = r.seq + 1;
+                seq++;
+                established = true;
+                start = now;
+            } else if (r.seq == rcvNext) {
+                rcvNext += r.payload.size();
+                received += r.payload.size();
+            }
+            pending.push_back({ now + turnaround,
+                                buildTcp(CLIENT, 1100, SERVER, 80, seq, rcvNext, TCP_ACK,
+                                         window, Bytes()) });
+        }
+        while (!pending.empty() && pending.front().first <= now) {
+            slipSendFrame(&client, pending.front().second.data(), pending.front().second.size());
+            Bytes frame = fakeLinkTake();
+            up.bytes.insert(up.bytes.end(), frame.begin(), frame.end());
+            pending.pop_front();
+        }
+
+        // Gateway: what crossed upstream goes to the NAT
+        Bytes sent = up.tick(rate);
+        pos = 0;
+        while (pos < sent.size()) {
+            uint16_t consumed;
+            int n = slipReceive(&gateway, &sent[pos], sent.size() - pos, &consumed);
+            pos += consumed;
+            if (n > 0) {
+                natProcessPacket(&nat, gateway.rxBuffer, n);
+            }
+        }
+
+        hostAdvanceMs(1);
+        now++;
+    }
+
+    Result result = { (now - start) / 1000.0, nat.tcpRetransmits };
+    natShutdown(&nat);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    bool quick = benchIterations(argc, argv, 1) != 1;
+    uint32_t total = quick ? 4096 : 65536;
+    static const long BAUDS[] = { 2400, 9600, 19200, 57600, 115200 };
+
+    for (int turnaround : { 10, 100 }) {
+        if (quick && turnaround != 10) {
+            continue;
+        }
+        printf("%u byte download, MSS %d, client turnaround %d ms\n",
+               (unsigned)total, CLIENT_MSS, turnaround);
+        printf("%7s %22s %22s %8s\n", "baud", "stop-and-wait (1 MSS)", "window (4 MSS)",
+               "speedup");
+        for (long baud : BAUDS) {
+            if (quick && baud != 19200) {
+                continue;
+            }
+            Result before = download(baud, CLIENT_MSS, total, turnaround);
+            Result after = download(baud, 4 * CLIENT_MSS, total, turnaround);
+            double line = baud / 10.0;
+            double gBefore = total / before.seconds, gAfter = total / after.seconds;
+            printf("%7ld %9.0f B/s (%3.0f%%)%s %9.0f B/s (%3.0f%%)%s %7.2fx\n", baud,
+                   gBefore, 100 * gBefore / line, before.retransmits ? "*" : " ",
+                   gAfter, 100 * gAfter / line, after.retransmits ? "*" : " ",
+                   gAfter / gBefore);
+        }
+    }
+    printf("(%% of line rate; * = the NAT retransmitted)\n");
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+// ============================================================================
+// SLIP Codec Benchmark
+// ============================================================================
+// Encode and decode throughput for small and full-size packets, typical and
+// all-END payloads, next to the byte-at-a-time codec slip.cpp replaced:
+// one link write per encoded byte, one decoder call per received byte.
+// ============================================================================
+
+#include <stdio.h>
+#include "bench.h"
+#include "fake_link.h"
+#include "gateway_link.h"
+#include "host.h"
+#include "packets.h"
+#include "slip.h"
+
+// The old encoder - every byte its own link write
+static void slipSendFrameBytewise(const uint8_t* data, uint16_t length) {
+    gwLinkWrite(SLIP_END);
+    for (uint16_t i = 0; i < length; i++) {
+        if (data[i] == SLIP_END) {
+            gwLinkWrite(SLIP_ESC);
+            gwLinkWrite(SLIP_ESC_END);
+        } else if (data[i] == SLIP_ESC) {
+            gwLinkWrite(SLIP_ESC);
+            gwLinkWrite(SLIP_ESC_ESC);
+        } else {
+            gwLinkWrite(data[i]);
+        }
+    }
+    gwLinkWrite(SLIP_END);
+}
+
+static void run(const char* label, const Bytes& payload, long iterations) {
+    static SlipContext ctx;
+    slipInit(&ctx);
+    fakeLinkReset();
+
+    double spanEncode = benchNs(iterations, [&] {
+        slipSendFrame(&ctx, payload.data(), payload.size());
+        benchSink += fakeLinkTake().size();
+    });
+    uint32_t spanWrites = fakeLinkWrites();
+    fakeLinkReset();
+    double byteEncode = benchNs(iterations, [&] {
+        slipSendFrameBytewise(payload.data(), payload.size());
+        benchSink += fakeLinkTake().size();
+    });
+    uint32_t byteWrites = fakeLinkWrites();
+
+    slipSendFrame(&ctx, payload.data(), payload.size());
+    Bytes wire = fakeLinkTake();
+    double spanDecode = benchNs(iterations, [&] {
+        uint16_t pos = 0;
+        while (pos < wire.size()) {
+            uint16_t consumed;
+            benchSink += slipReceive(&ctx, &wire[pos], wire.size() - pos, &consumed);
+            pos += consumed;
+        }
+    });
+    double byteDecode = benchNs(iterations, [&] {
+        for (uint8_t b : wire) {
+            benchSink += slipReceiveByte(&ctx, b);
+        }
+    });
+
+    double mb = payload.size() / 1e6;
+    printf("%-18s encode %7.1f MB/s (%5.1f writes/frame) vs %7.1f MB/s (%6.1f)"
+           "   decode %7.1f MB/s vs %7.1f MB/s\n",
+           label, mb / (spanEncode * 1e-9), (double)spanWrites / iterations,
+           mb / (byteEncode * 1e-9), (double)byteWrites / iterations,
+           mb / (spanDecode * 1e-9), mb / (byteDecode * 1e-9));
+}
+
+int main(int argc, char** argv) {
+    long iterations = benchIterations(argc, argv, 20000);
+    hostReset();
+
+    // Random bytes carry an END or ESC about once in 128
+    Bytes small(40), full(SLIP_MTU);
+    for (uint8_t& b : small) {
+        b = (uint8_t)random(0, 256);
+    }
+    for (uint8_t& b : full) {
+        b = (uint8_t)random(0, 256);
+    }
+
+    printf("span codec vs byte-at-a-time\n");
+    run("40 B random", small, iterations * 20);
+    run("1500 B random", full, iterations);
+    run("1500 B all END", Bytes(SLIP_MTU, SLIP_END), iterations);
+    run("1500 B all ESC", Bytes(SLIP_MTU, SLIP_ESC), iterations);
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+// ============================================================================
+// Benchmarks
+// ============================================================================
+// Wall-clock timing for the host benchmarks. Run with --quick (as ctest
+// does) they only make sure every path still runs; the numbers want a
+// full run of a Release build.
+// ============================================================================
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <stdint.h>
+#include <string.h>
+
+// Results are folded in here so the optimizer keeps the work
+inline volatile uint32_t benchSink;
+
+// full iterations, or a handful with --quick
+inline long benchIterations(int argc, char** argv, long full) {
+    return (argc > 1 && strcmp(argv[1], "--quick") == 0) ? 3 : full;
+}
+
+// Nanoseconds per call of fn()
+template <typename F>
+double benchNs(long iterations, F fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+#endif // BENCH_H
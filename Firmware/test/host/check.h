@@ -0,0 +1,39 @@
+// ============================================================================
+// Test Checks
+// ============================================================================
+// Each test program is one executable: CHECKs count failures and carry on,
+// testResult() prints the tally and is main()'s return value for ctest
+// ============================================================================
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+inline int testChecks = 0;
+inline int testFailures = 0;
+
+#define CHECK(cond) do { \
+    testChecks++; \
+    if (!(cond)) { \
+        testFailures++; \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    testChecks++; \
+    long long va_ = (long long)(a), vb_ = (long long)(b); \
+    if (va_ != vb_) { \
+        testFailures++; \
+        fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+                __FILE__, __LINE__, #a, #b, va_, vb_); \
+    } \
+} while (0)
+
+inline int testResult(const char* name) {
+    printf("%s: %d checks, %d failed\n", name, testChecks, testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
+
+#endif // CHECK_H
@@ -0,0 +1,102 @@
+// ============================================================================
+// Fake Gateway Link Implementation
+// ============================================================================
+
+#include "fake_link.h"
+#include "gateway_link.h"
+
+GwLinkConfig gwLinkConfig = { GW_LINK_SERIAL, GW_LINK_DEFAULT_PORT };
+
+static std::vector<uint8_t> fakeLinkOut;
+static uint32_t fakeLinkWriteCount = 0;
+
+void fakeLinkReset() {
+    fakeLinkOut.clear();
+    fakeLinkWriteCount = 0;
+    gwLinkConfig.transport = GW_LINK_SERIAL;
+}
+
+std::vector<uint8_t> fakeLinkTake() {
+    std::vector<uint8_t> out;
+    out.swap(fakeLinkOut);
+    return out;
+}
+
+void fakeLinkSetTcp(bool tcp) {
+    gwLinkConfig.transport = tcp ? GW_LINK_TCP : GW_LINK_SERIAL;
+}
+
+uint32_t fakeLinkWrites() {
+    return fakeLinkWriteCount;
+}
+
+// ============================================================================
+// gateway_link.h
+// ============================================================================
+
+void loadGwLinkSettings() {
+}
+
+void saveGwLinkSettings() {
+}
+
+void gwLinkBegin() {
+}
+
+void gwLinkEnd() {
+}
+
+bool gwLinkIsTcp() {
+    return gwLinkConfig.transport == GW_LINK_TCP;
+}
+
+bool gwLinkConnected() {
+    return true;
+}
+
+bool gwLinkAccept() {
+    return false;
+}
+
+bool gwLinkDropped() {
+    return false;
+}
+
+int gwLinkAvailable() {
+    return 0;
+}
+
+int gwLinkRead() {
+    return -1;
+}
+
+int gwLinkReadBytes(uint8_t* buffer, int maxLen) {
+    return 0;
+}
+
+void gwLinkWrite(uint8_t byte) {
+    fakeLinkOut.push_back(byte);
+    fakeLinkWriteCount++;
+}
+
+void gwLinkWriteBytes(const uint8_t* data, uint16_t length) {
+    fakeLinkOut.insert(fakeLinkOut.end(), data, data + length);
+    fakeLinkWriteCount++;
+}
+
+void gwLinkPush() {
+}
+
+void gwLinkFlush() {
+}
+
+void gwLinkWaitClear() {
+}
+
+String gwLinkDescription() {
+    return gwLinkIsTcp() ? "TCP (host test)" : "Serial (host test)";
+}
+
+bool handleGwLinkCommand(String& cmd, String& upCmd) {
+    return false;
+}
@@ -0,0 +1,26 @@
+// ============================================================================
+// Fake Gateway Link
+// ============================================================================
+// Stands in for gateway_link.cpp: what the framers write is kept for the
+// test to decode, nothing is read from it, and CTS is always clear
+// ============================================================================
+
+#ifndef FAKE_LINK_H
+#define FAKE_LINK_H
+
+#include <Arduino.h>
+#include <vector>
+
+// Drop captured bytes and counters, back to the UART transport
+void fakeLinkReset();
+
+// Bytes written since the last take
+std::vector<uint8_t> fakeLinkTake();
+
+// Report the TCP transport (gwLinkIsTcp) instead of the UART
+void fakeLinkSetTcp(bool tcp);
+
+// Link writes so far - gwLinkWriteBytes calls and single bytes
+uint32_t fakeLinkWrites();
+
+#endif // FAKE_LINK_H
@@ -0,0 +1,493 @@
+// ============================================================================
+// Fake lwIP Implementation
+// ============================================================================
+
+#include "fake_lwip.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+extern "C" {
+#include "lwip/priv/tcpip_priv.h"
+}
+
+const ip_addr_t ip_addr_any = IPADDR4_INIT(0);
+
+#define FAKE_PORT_FIRST 49152       // lwIP's ephemeral range starts here
+
+struct FakeTcp {
+    bool listening;
+    bool shutdown;
+    uint32_t recved;
+    std::string written;
+};
+
+static int fakePbufCount = 0;
+static std::map<struct tcp_pcb*, FakeTcp> fakeTcps;
+static std::vector<struct tcp_pcb*> fakeTcpOrder;
+static std::vector<struct udp_pcb*> fakeUdps;
+static std::vector<struct udp_pcb*> fakeUdpPool;    // Removed pcbs, last freed on top
+static struct raw_pcb* fakeRaw = nullptr;
+static std::vector<FakeDatagram> fakeUdpSent;
+static std::vector<FakeDatagram> fakeRawSent;
+static uint16_t fakeNextPort = FAKE_PORT_FIRST;
+
+// ============================================================================
+// pbufs
+// ============================================================================
+// One block per pbuf, payload right behind the header
+
+struct pbuf* pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+    struct pbuf* p = (struct pbuf*)malloc(sizeof(struct pbuf) + length);
+    if (!p) {
+        return nullptr;
+    }
+    p->next = nullptr;
+    p->payload = (uint8_t*)(p + 1);
+    p->tot_len = length;
+    p->len = length;
+    p->ref = 1;
+    fakePbufCount++;
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf* p) {
+    u8_t count = 0;
+    while (p && --p->ref == 0) {
+        struct pbuf* next = p->next;
+        free(p);
+        fakePbufCount--;
+        count++;
+        p = next;
+    }
+    return count;
+}
+
+void pbuf_ref(struct pbuf* p) {
+    p->ref++;
+}
+
+void pbuf_cat(struct pbuf* head, struct pbuf* tail) {
+    struct pbuf* p = head;
+    for (; p->next; p = p->next) {
+        p->tot_len += tail->tot_len;
+    }
+    p->tot_len += tail->tot_len;
+    p->next = tail;
+}
+
+struct pbuf* pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf* p) {
+    struct pbuf* q = pbuf_alloc(layer, p->tot_len, type);
+    if (q) {
+        pbuf_copy_partial(p, q->payload, p->tot_len, 0);
+    }
+    return q;
+}
+
+struct pbuf* pbuf_free_header(struct pbuf* q, u16_t size) {
+    struct pbuf* p = q;
+    while (size > 0 && p) {
+        if (size >= p->len) {
+            struct pbuf* f = p;
+            size -= p->len;
+            p = p->next;
+            f->next = nullptr;
+            pbuf_free(f);
+        } else {
+            p->payload = (uint8_t*)p->payload + size;
+            p->len -= size;
+            p->tot_len -= size;
+            size = 0;
+        }
+    }
+    return p;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf* p, void* dataptr, u16_t len, u16_t offset) {
+    u16_t copied = 0;
+    for (; p && copied < len; p = p->next) {
+        if (offset >= p->len) {
+            offset -= p->len;
+            continue;
+        }
+        u16_t n = std::min((u16_t)(p->len - offset), (u16_t)(len - copied));
+        memcpy((uint8_t*)dataptr + copied, (const uint8_t*)p->payload + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+err_t pbuf_take(struct pbuf* p, const void* dataptr, u16_t len) {
+    u16_t done = 0;
+    for (; p && done < len; p = p->next) {
+        u16_t n = std::min(p->len, (u16_t)(len - done));
+        memcpy(p->payload, (const uint8_t*)dataptr + done, n);
+        done += n;
+    }
+    return done == len ? ERR_OK : ERR_MEM;
+}
+
+static struct pbuf* fakePbufFrom(const uint8_t* data, uint16_t length) {
+    struct pbuf* p = pbuf_alloc(PBUF_RAW, length, PBUF_RAM);
+    memcpy(p->payload, data, length);
+    return p;
+}
+
+// ============================================================================
+// tcpip thread
+// ============================================================================
+
+err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data* call) {
+    return fn(call);
+}
+
+// ============================================================================
+// TCP
+// ============================================================================
+
+static struct tcp_pcb* fakeTcpNew() {
+    struct tcp_pcb* pcb = (struct tcp_pcb*)calloc(1, sizeof(struct tcp_pcb));
+    fakeTcps[pcb] = FakeTcp();
+    fakeTcpOrder.push_back(pcb);
+    return pcb;
+}
+
+static void fakeTcpFree(struct tcp_pcb* pcb) {
+    fakeTcps.erase(pcb);
+    fakeTcpOrder.erase(std::find(fakeTcpOrder.begin(), fakeTcpOrder.end(), pcb));
+    free(pcb);
+}
+
+struct tcp_pcb* tcp_new_ip_type(u8_t type) {
+    return fakeTcpNew();
+}
+
+void tcp_arg(struct tcp_pcb* pcb, void* arg) {
+    pcb->callback_arg = arg;
+}
+
+void tcp_recv(struct tcp_pcb* pcb, tcp_recv_fn recv) {
+    pcb->recv = recv;
+}
+
+void tcp_err(struct tcp_pcb* pcb, tcp_err_fn err) {
+    pcb->errf = err;
+}
+
+void tcp_accept(struct tcp_pcb* pcb, tcp_accept_fn accept) {
+    pcb->accept = accept;
+}
+
+err_t tcp_bind(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port) {
+    for (auto& it : fakeTcps) {
+        if (it.first != pcb && it.second.listening && it.first->local_port == port) {
+            return ERR_USE;
+        }
+    }
+    pcb->local_port = port ? port : fakeNextPort++;
+    return ERR_OK;
+}
+
+err_t tcp_connect(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port,
+                  tcp_connected_fn connected) {
+    pcb->remote_ip = *ipaddr;
+    pcb->remote_port = port;
+    pcb->local_port = fakeNextPort++;
+    pcb->connected = connected;
+    return ERR_OK;
+}
+
+struct tcp_pcb* tcp_listen_with_backlog(struct tcp_pcb* pcb, u8_t backlog) {
+    fakeTcps[pcb].listening = true;
+    return pcb;
+}
+
+err_t tcp_close(struct tcp_pcb* pcb) {
+    fakeTcpFree(pcb);
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb* pcb) {
+    tcp_err_fn errf = pcb->errf;
+    void* arg = pcb->callback_arg;
+    fakeTcpFree(pcb);
+    if (errf) {
+        errf(arg, ERR_ABRT);
+    }
+}
+
+err_t tcp_shutdown(struct tcp_pcb* pcb, int shut_rx, int shut_tx) {
+    if (shut_tx) {
+        fakeTcps[pcb].shutdown = true;
+    }
+    return ERR_OK;
+}
+
+err_t tcp_write(struct tcp_pcb* pcb, const void* dataptr, u16_t len, u8_t apiflags) {
+    if (len > tcp_sndbuf(pcb)) {
+        return ERR_MEM;
+    }
+    fakeTcps[pcb].written.append((const char*)dataptr, len);
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb* pcb) {
+    return ERR_OK;
+}
+
+void tcp_recved(struct tcp_pcb* pcb, u16_t len) {
+    fakeTcps[pcb].recved += len;
+}
+
+// Written data holds send buffer until the test takes it - the server's ACK
+u16_t tcp_sndbuf(const struct tcp_pcb* pcb) {
+    return TCP_SND_BUF - fakeTcps[(struct tcp_pcb*)pcb].written.size();
+}
+
+std::vector<struct tcp_pcb*> fakeTcpConnections() {
+    std::vector<struct tcp_pcb*> pcbs;
+    for (struct tcp_pcb* pcb : fakeTcpOrder) {
+        if (!fakeTcps[pcb].listening) {
+            pcbs.push_back(pcb);
+        }
+    }
+    return pcbs;
+}
+
+struct tcp_pcb* fakeTcpFind(uint32_t addr, uint16_t port) {
+    for (struct tcp_pcb* pcb : fakeTcpConnections()) {
+        if (ip4_addr_get_u32(ip_2_ip4(&pcb->remote_ip)) == addr && pcb->remote_port == port) {
+            return pcb;
+        }
+    }
+    return nullptr;
+}
+
+void fakeTcpAccept(struct tcp_pcb* pcb) {
+    pcb->connected(pcb->callback_arg, pcb, ERR_OK);
+}
+
+void fakeTcpRefuse(struct tcp_pcb* pcb) {
+    tcp_err_fn errf = pcb->errf;
+    void* arg = pcb->callback_arg;
+    fakeTcpFree(pcb);       // lwIP frees the pcb before telling us
+    if (errf) {
+        errf(arg, ERR_RST);
+    }
+}
+
+struct tcp_pcb* fakeTcpIncoming(uint16_t port, uint32_t addr, uint16_t remotePort) {
+    for (auto& it : fakeTcps) {
+        struct tcp_pcb* listener = it.first;
+        if (!it.second.listening || listener->local_port != port || !listener->accept) {
+            continue;
+        }
+        struct tcp_pcb* pcb = fakeTcpNew();
+        pcb->local_port = port;
+        pcb->remote_ip.u_addr.ip4.addr = addr;
+        pcb->remote_port = remotePort;
+        if (listener->accept(listener->callback_arg, pcb, ERR_OK) != ERR_OK) {
+            return nullptr;         // Refused - it aborted the pcb
+        }
+        return pcb;
+    }
+    return nullptr;
+}
+
+bool fakeTcpDeliver(struct tcp_pcb* pcb, const uint8_t* data, uint16_t length) {
+    struct pbuf* p = fakePbufFrom(data, length);
+    if (pcb->recv(pcb->callback_arg, pcb, p, ERR_OK) != ERR_OK) {
+        pbuf_free(p);               // Refused - lwIP would offer it again later
+        return false;
+    }
+    return true;
+}
+
+void fakeTcpRemoteClose(struct tcp_pcb* pcb) {
+    pcb->recv(pcb->callback_arg, pcb, nullptr, ERR_OK);
+}
+
+std::string fakeTcpTakeWritten(struct tcp_pcb* pcb) {
+    std::string out;
+    out.swap(fakeTcps[pcb].written);
+    return out;
+}
+
+bool fakeTcpShutdownSent(struct tcp_pcb* pcb) {
+    return fakeTcps[pcb].shutdown;
+}
+
+uint32_t fakeTcpRecved(struct tcp_pcb* pcb) {
+    return fakeTcps[pcb].recved;
+}
+
+// ============================================================================
+// UDP
+// ============================================================================
+
+// Like lwIP's memp pool, the pcb freed last is the next one handed out
+struct udp_pcb* udp_new_ip_type(u8_t type) {
+    struct udp_pcb* pcb;
+    if (!fakeUdpPool.empty()) {
+        pcb = fakeUdpPool.back();
+        fakeUdpPool.pop_back();
+        memset(pcb, 0, sizeof(struct udp_pcb));
+    } else {
+        pcb = (struct udp_pcb*)calloc(1, sizeof(struct udp_pcb));
+    }
+    pcb->ttl = 255;
+    fakeUdps.push_back(pcb);
+    return pcb;
+}
+
+void udp_remove(struct udp_pcb* pcb) {
+    fakeUdps.erase(std::find(fakeUdps.begin(), fakeUdps.end(), pcb));
+    fakeUdpPool.push_back(pcb);
+}
+
+err_t udp_bind(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port) {
+    pcb->local_port = port ? port : fakeNextPort++;
+    return ERR_OK;
+}
+
+err_t udp_connect(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port) {
+    pcb->remote_ip = *ipaddr;
+    pcb->remote_port = port;
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb* pcb, udp_recv_fn recv, void* recv_arg) {
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* dst_ip, u16_t dst_port) {
+    FakeDatagram d;
+    d.pcb = pcb;
+    d.addr = ip4_addr_get_u32(ip_2_ip4(dst_ip));
+    d.port = dst_port;
+    d.ttl = pcb->ttl;
+    d.data.resize(p->tot_len);
+    pbuf_copy_partial(p, d.data.data(), p->tot_len, 0);
+    fakeUdpSent.push_back(d);
+    return ERR_OK;
+}
+
+err_t udp_send(struct udp_pcb* pcb, struct pbuf* p) {
+    return udp_sendto(pcb, p, &pcb->remote_ip, pcb->remote_port);
+}
+
+std::vector<FakeDatagram> fakeUdpTakeSent() {
+    std::vector<FakeDatagram> out;
+    out.swap(fakeUdpSent);
+    return out;
+}
+
+struct udp_pcb* fakeUdpFind(uint16_t localPort) {
+    for (struct udp_pcb* pcb : fakeUdps) {
+        if (pcb->local_port == localPort) {
+            return pcb;
+        }
+    }
+    return nullptr;
+}
+
+void fakeUdpDeliver(struct udp_pcb* pcb, const uint8_t* data, uint16_t length,
+                    uint32_t addr, uint16_t port) {
+    ip_addr_t from = IPADDR4_INIT(addr);
+    pcb->recv(pcb->recv_arg, pcb, fakePbufFrom(data, length), &from, port);
+}
+
+// ============================================================================
+// Raw (ICMP)
+// ============================================================================
+
+struct raw_pcb* raw_new(u8_t proto) {
+    struct raw_pcb* pcb = (struct raw_pcb*)calloc(1, sizeof(struct raw_pcb));
+    pcb->protocol = proto;
+    pcb->ttl = 255;
+    fakeRaw = pcb;
+    return pcb;
+}
+
+void raw_remove(struct raw_pcb* pcb) {
+    if (fakeRaw == pcb) {
+        fakeRaw = nullptr;
+    }
+    free(pcb);
+}
+
+err_t raw_bind(struct raw_pcb* pcb, const ip_addr_t* ipaddr) {
+    return ERR_OK;
+}
+
+void raw_recv(struct raw_pcb* pcb, raw_recv_fn recv, void* recv_arg) {
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t raw_sendto(struct raw_pcb* pcb, struct pbuf* p, const ip_addr_t* ipaddr) {
+    FakeDatagram d;
+    d.pcb = nullptr;
+    d.addr = ip4_addr_get_u32(ip_2_ip4(ipaddr));
+    d.port = 0;
+    d.ttl = pcb->ttl;
+    d.data.resize(p->tot_len);
+    pbuf_copy_partial(p, d.data.data(), p->tot_len, 0);
+    fakeRawSent.push_back(d);
+    return ERR_OK;
+}
+
+std::vector<FakeDatagram> fakeRawTakeSent() {
+    std::vector<FakeDatagram> out;
+    out.swap(fakeRawSent);
+    return out;
+}
+
+void fakeRawDeliver(const uint8_t* packet, uint16_t length, uint32_t from) {
+    if (!fakeRaw || !fakeRaw->recv) {
+        return;
+    }
+    ip_addr_t addr = IPADDR4_INIT(from);
+    struct pbuf* p = fakePbufFrom(packet, length);
+    if (fakeRaw->recv(fakeRaw->recv_arg, fakeRaw, p, &addr) == 0) {
+        pbuf_free(p);
+    }
+}
+
+// ============================================================================
+// Reset and leak checks
+// ============================================================================
+
+void fakeLwipReset() {
+    while (!fakeTcpOrder.empty()) {
+        fakeTcpFree(fakeTcpOrder.back());
+    }
+    while (!fakeUdps.empty()) {
+        udp_remove(fakeUdps.back());
+    }
+    for (struct udp_pcb* pcb : fakeUdpPool) {
+        free(pcb);
+    }
+    fakeUdpPool.clear();
+    if (fakeRaw) {
+        raw_remove(fakeRaw);
+    }
+    fakeUdpSent.clear();
+    fakeRawSent.clear();
+    fakeNextPort = FAKE_PORT_FIRST;
+}
+
+int fakePbufLive() {
+    return fakePbufCount;
+}
+
+int fakeTcpLive() {
+    return (int)fakeTcpOrder.size();
+}
+
+int fakeUdpLive() {
+    return (int)fakeUdps.size();
+}
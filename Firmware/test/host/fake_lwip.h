@@ -0,0 +1,90 @@
+// ============================================================================
+// Fake lwIP
+// ============================================================================
+// The raw TCP, UDP and ICMP API the NAT uses, with the network replaced by
+// the test: it sees what the NAT sends upstream and plays the servers'
+// side - accepting or refusing connects, sending data, closing. Calls that
+// would run in the lwIP task run inline, and callbacks fire from the
+// fake*() calls that cause them.
+// ============================================================================
+
+#ifndef FAKE_LWIP_H
+#define FAKE_LWIP_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "lwip/pbuf.h"
+#include "lwip/raw.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+}
+
+// A datagram the NAT sent upstream (UDP payload, or ICMP message for raw)
+struct FakeDatagram {
+    struct udp_pcb* pcb;        // Null for raw
+    uint32_t addr;              // Destination, network byte order
+    uint16_t port;
+    uint8_t ttl;
+    std::vector<uint8_t> data;
+};
+
+// Free every pcb and forget what was sent
+void fakeLwipReset();
+
+// Objects still allocated - for leak checks
+int fakePbufLive();
+int fakeTcpLive();
+int fakeUdpLive();
+
+// ============================================================================
+// TCP
+// ============================================================================
+
+// Connections the NAT opened or accepted, oldest first (no listeners)
+std::vector<struct tcp_pcb*> fakeTcpConnections();
+
+// The connection to a server, or null
+struct tcp_pcb* fakeTcpFind(uint32_t addr, uint16_t port);
+
+// Server side of a connect: accept it, or refuse it (the pcb is freed)
+void fakeTcpAccept(struct tcp_pcb* pcb);
+void fakeTcpRefuse(struct tcp_pcb* pcb);
+
+// A client on the network connecting to a listening port
+// Returns the accepted pcb, or null if nothing listens or it was refused
+struct tcp_pcb* fakeTcpIncoming(uint16_t port, uint32_t addr, uint16_t remotePort);
+
+// Server sends data, or its FIN
+// Returns false if the NAT refused the data - offer it again later
+bool fakeTcpDeliver(struct tcp_pcb* pcb, const uint8_t* data, uint16_t length);
+void fakeTcpRemoteClose(struct tcp_pcb* pcb);
+
+// What the NAT wrote toward the server since the last take
+std::string fakeTcpTakeWritten(struct tcp_pcb* pcb);
+
+// Whether the NAT sent its FIN, and how much window it has reopened
+bool fakeTcpShutdownSent(struct tcp_pcb* pcb);
+uint32_t fakeTcpRecved(struct tcp_pcb* pcb);
+
+// ============================================================================
+// UDP and ICMP
+// ============================================================================
+
+// Datagrams sent since the last take
+std::vector<FakeDatagram> fakeUdpTakeSent();
+std::vector<FakeDatagram> fakeRawTakeSent();
+
+// A UDP pcb of the NAT's, by its local port
+struct udp_pcb* fakeUdpFind(uint16_t localPort);
+
+// A datagram arriving on a UDP pcb
+void fakeUdpDeliver(struct udp_pcb* pcb, const uint8_t* data, uint16_t length,
+                    uint32_t addr, uint16_t port);
+
+// An IP packet (header included) arriving on the ICMP raw pcb
+void fakeRawDeliver(const uint8_t* packet, uint16_t length, uint32_t from);
+
+#endif // FAKE_LWIP_H
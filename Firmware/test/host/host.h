@@ -0,0 +1,22 @@
+// ============================================================================
+// Host Runtime
+// ============================================================================
+// Controls for the Arduino stubs: a clock the tests step, repeatable
+// random numbers, and the heap size the NAT sizes its tables from
+// ============================================================================
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <Arduino.h>
+
+// Back to time zero, reseed random(), default heap
+void hostReset();
+
+// Step the millis() / micros() clock
+void hostAdvanceMs(unsigned long ms);
+
+// What ESP.getFreeHeap() reports
+void hostSetFreeHeap(uint32_t bytes);
+
+#endif // HOST_H
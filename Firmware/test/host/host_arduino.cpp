@@ -0,0 +1,109 @@
+// ============================================================================
+// Host Runtime Implementation
+// ============================================================================
+// The Arduino core and firmware globals the link codecs and the NAT link
+// against, with debug output off
+// ============================================================================
+
+#include "host.h"
+#include <EEPROM.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+EEPROMClass EEPROM;
+
+// Firmware globals (main.cpp)
+bool usbDebug = false;
+byte serialSpeed = 8;           // 115200
+byte flowControl = 0;           // F_NONE
+byte pinPolarity = 0;
+extern const int bauds[] = { 300, 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200 };
+
+static unsigned long hostMicros = 0;
+static uint32_t hostRandom = 1;
+static uint32_t hostFreeHeap = 200000;
+
+void hostReset() {
+    hostMicros = 0;
+    hostRandom = 1;
+    hostFreeHeap = 200000;
+}
+
+void hostAdvanceMs(unsigned long ms) {
+    hostMicros += ms * 1000;
+}
+
+void hostSetFreeHeap(uint32_t bytes) {
+    hostFreeHeap = bytes;
+}
+
+// ============================================================================
+// Arduino core
+// ============================================================================
+
+unsigned long millis() {
+    return hostMicros / 1000;
+}
+
+unsigned long micros() {
+    return hostMicros;
+}
+
+void delay(unsigned long ms) {
+    hostAdvanceMs(ms);
+}
+
+void yield() {
+}
+
+// xorshift32 - the same sequence every run, so both links see the same ISNs
+uint32_t esp_random() {
+    hostRandom ^= hostRandom << 13;
+    hostRandom ^= hostRandom >> 17;
+    hostRandom ^= hostRandom << 5;
+    return hostRandom;
+}
+
+long random(long howBig) {
+    return howBig > 0 ? (long)(esp_random() % (uint32_t)howBig) : 0;
+}
+
+long random(long howSmall, long howBig) {
+    return howBig > howSmall ? howSmall + random(howBig - howSmall) : howSmall;
+}
+
+int digitalRead(int pin) {
+    return LOW;
+}
+
+void digitalWrite(int pin, int value) {
+}
+
+void pinMode(int pin, int mode) {
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return hostFreeHeap;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+    return hostFreeHeap;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return hostFreeHeap;
+}
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(hostMicros * 240);
+}
+
+// ============================================================================
+// Serial I/O (serial_io.cpp)
+// ============================================================================
+
+void UsbDebugPrint(String s) {
+}
+
+void UsbDebugPrintLn(String s) {
+}
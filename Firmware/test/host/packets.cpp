@@ -0,0 +1,175 @@
+// ============================================================================
+// Test Packets Implementation
+// ============================================================================
+
+#include "packets.h"
+#include <string.h>
+
+uint32_t ipAddr(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+    uint8_t bytes[4] = { a, b, c, d };
+    uint32_t addr;
+    memcpy(&addr, bytes, 4);
+    return addr;
+}
+
+static uint32_t refSum(const uint8_t* data, size_t length, uint32_t sum) {
+    for (size_t i = 0; i + 1 < length; i += 2) {
+        sum += (data[i] << 8) | data[i + 1];
+    }
+    if (length & 1) {
+        sum += data[length - 1] << 8;
+    }
+    return sum;
+}
+
+uint16_t refChecksum(const uint8_t* data, size_t length, uint32_t sum) {
+    sum = refSum(data, length, sum);
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return ~sum & 0xFFFF;
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, v >> 16);
+    put16(p + 2, v & 0xFFFF);
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return ((uint32_t)get16(p) << 16) | get16(p + 2);
+}
+
+static uint32_t pseudoSum(const uint8_t* ip, uint8_t protocol, uint16_t length) {
+    uint32_t sum = refSum(ip + 12, 8, 0);
+    return sum + protocol + length;
+}
+
+static Bytes buildIp(uint32_t src, uint32_t dst, uint8_t protocol, uint8_t ttl,
+                     uint16_t id, const Bytes& transport) {
+    Bytes p(20 + transport.size());
+    p[0] = 0x45;
+    put16(&p[2], p.size());
+    put16(&p[4], id);
+    p[8] = ttl;
+    p[9] = protocol;
+    memcpy(&p[12], &src, 4);
+    memcpy(&p[16], &dst, 4);
+    put16(&p[10], refChecksum(&p[0], 20));
+    memcpy(&p[20], transport.data(), transport.size());
+    return p;
+}
+
+Bytes buildIcmpEcho(uint32_t src, uint32_t dst, uint8_t type, uint16_t id,
+                    uint16_t seq, const Bytes& payload, uint8_t ttl) {
+    Bytes icmp(8 + payload.size());
+    icmp[0] = type;
+    put16(&icmp[4], id);
+    put16(&icmp[6], seq);
+    memcpy(&icmp[8], payload.data(), payload.size());
+    put16(&icmp[2], refChecksum(icmp.data(), icmp.size()));
+    return buildIp(src, dst, 1, ttl, id, icmp);
+}
+
+Bytes buildUdp(uint32_t src, uint16_t srcPort, uint32_t dst, uint16_t dstPort,
+               const Bytes& payload, uint8_t ttl) {
+    Bytes udp(8 + payload.size());
+    put16(&udp[0], srcPort);
+    put16(&udp[2], dstPort);
+    put16(&udp[4], udp.size());
+    memcpy(&udp[8], payload.data(), payload.size());
+    Bytes p = buildIp(src, dst, 17, ttl, 0, udp);
+    uint16_t sum = refChecksum(&p[20], udp.size(), pseudoSum(p.data(), 17, udp.size()));
+    put16(&p[26], sum ? sum : 0xFFFF);
+    return p;
+}
+
+Bytes buildTcp(uint32_t src, uint16_t srcPort, uint32_t dst, uint16_t dstPort,
+               uint32_t seq, uint32_t ack, uint8_t flags, uint16_t window,
+               const Bytes& payload, const Bytes& options, uint16_t ipId) {
+    size_t headerLen = 20 + ((options.size() + 3) & ~3u);
+    Bytes tcp(headerLen + payload.size());
+    put16(&tcp[0], srcPort);
+    put16(&tcp[2], dstPort);
+    put32(&tcp[4], seq);
+    put32(&tcp[8], ack);
+    tcp[12] = (headerLen / 4) << 4;
+    tcp[13] = flags;
+    put16(&tcp[14], window);
+    memcpy(&tcp[20], options.data(), options.size());
+    memcpy(&tcp[headerLen], payload.data(), payload.size());
+    Bytes p = buildIp(src, dst, 6, 64, ipId, tcp);
+    put16(&p[36], refChecksum(&p[20], tcp.size(), pseudoSum(p.data(), 6, tcp.size())));
+    return p;
+}
+
+Parsed parsePacket(const Bytes& packet) {
+    Parsed r = {};
+    if (packet.size() < 20 || (packet[0] >> 4) != 4) {
+        return r;
+    }
+    size_t ihl = (packet[0] & 0x0F) * 4;
+    size_t total = get16(&packet[2]);
+    if (ihl < 20 || total > packet.size() || total < ihl) {
+        return r;
+    }
+    bool ipOk = refChecksum(packet.data(), ihl) == 0;
+    r.ttl = packet[8];
+    r.protocol = packet[9];
+    memcpy(&r.src, &packet[12], 4);
+    memcpy(&r.dst, &packet[16], 4);
+    const uint8_t* t = &packet[ihl];
+    size_t tLen = total - ihl;
+
+    bool tOk = false;
+    if (r.protocol == 6 && tLen >= 20) {
+        size_t off = (t[12] >> 4) * 4;
+        r.srcPort = get16(t);
+        r.dstPort = get16(t + 2);
+        r.seq = get32(t + 4);
+        r.ack = get32(t + 8);
+        r.flags = t[13];
+        r.window = get16(t + 14);
+        for (size_t i = 20; i < off && i < tLen && t[i] != 0;) {
+            if (t[i] == 1) {
+                i++;
+                continue;
+            }
+            if (i + 1 >= off || t[i + 1] < 2) {
+                break;
+            }
+            if (t[i] == 2 && t[i + 1] == 4 && i + 4 <= off) {
+                r.mss = get16(t + i + 2);
+            }
+            i += t[i + 1];
+        }
+        r.payload.assign(t + off, t + tLen);
+        tOk = refChecksum(t, tLen, pseudoSum(packet.data(), 6, tLen)) == 0;
+    } else if (r.protocol == 17 && tLen >= 8) {
+        r.srcPort = get16(t);
+        r.dstPort = get16(t + 2);
+        r.payload.assign(t + 8, t + tLen);
+        tOk = get16(t + 6) == 0 ||
+              refChecksum(t, tLen, pseudoSum(packet.data(), 17, tLen)) == 0;
+    } else if (r.protocol == 1 && tLen >= 8) {
+        r.flags = t[0];
+        r.srcPort = get16(t + 4);
+        r.seq = get16(t + 6);
+        r.payload.assign(t + 8, t + tLen);
+        tOk = refChecksum(t, tLen) == 0;
+    }
+    r.ok = ipOk && tOk;
+    return r;
+}
+
+Bytes bytesOf(const std::string& s) {
+    return Bytes(s.begin(), s.end());
+}
@@ -0,0 +1,53 @@
+// ============================================================================
+// Test Packets
+// ============================================================================
+// Builds the client's IPv4 packets and picks apart the ones it gets back.
+// Checksums here are the plain byte-pair sum of RFC 1071, independent of
+// checksum.cpp, so tests can hold the NAT's to it.
+// ============================================================================
+
+#ifndef PACKETS_H
+#define PACKETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+// An address as stored in an IP header (network byte order in memory)
+uint32_t ipAddr(uint8_t a, uint8_t b, uint8_t c, uint8_t d);
+
+// RFC 1071 sum of data, one big-endian 16-bit word at a time, folded and
+// complemented - in host order
+uint16_t refChecksum(const uint8_t* data, size_t length, uint32_t sum = 0);
+
+Bytes buildIcmpEcho(uint32_t src, uint32_t dst, uint8_t type, uint16_t id,
+                    uint16_t seq, const Bytes& payload, uint8_t ttl = 64);
+Bytes buildUdp(uint32_t src, uint16_t srcPort, uint32_t dst, uint16_t dstPort,
+               const Bytes& payload, uint8_t ttl = 64);
+Bytes buildTcp(uint32_t src, uint16_t srcPort, uint32_t dst, uint16_t dstPort,
+               uint32_t seq, uint32_t ack, uint8_t flags, uint16_t window,
+               const Bytes& payload, const Bytes& options = Bytes(),
+               uint16_t ipId = 0);
+
+// The fields of a packet the client received
+struct Parsed {
+    bool ok;                // Well formed, IP and transport checksums good
+    uint8_t protocol;
+    uint8_t ttl;
+    uint32_t src, dst;
+    uint16_t srcPort, dstPort;  // ICMP: id in srcPort
+    uint32_t seq, ack;          // ICMP: sequence in seq
+    uint8_t flags;              // ICMP: type
+    uint16_t window;
+    uint16_t mss;               // From a TCP MSS option, 0 if none
+    Bytes payload;
+};
+
+Parsed parsePacket(const Bytes& packet);
+
+Bytes bytesOf(const std::string& s);
+
+#endif // PACKETS_H
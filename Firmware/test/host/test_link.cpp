@@ -0,0 +1,128 @@
+// ============================================================================
+// Test Links Implementation
+// ============================================================================
+
+#include "test_link.h"
+#include "fake_link.h"
+
+// ============================================================================
+// Common
+// ============================================================================
+
+// Whatever the gateway wrote since the last look goes to the client
+void TestLink::deliver() {
+    Bytes bytes = fakeLinkTake();
+    wire += bytes.size();
+    clientDecode(bytes);
+}
+
+void TestLink::send(const Bytes& packet) {
+    deliver();
+
+    clientEncode(packet);
+    Bytes bytes = fakeLinkTake();
+    wire += bytes.size();
+    gatewayDecode(bytes);
+
+    deliver();
+}
+
+void TestLink::poll() {
+    natProcessPendingIcmp(nat);
+    natPollConnections(nat);
+    deliver();
+}
+
+std::vector<Bytes> TestLink::take() {
+    std::vector<Bytes> packets;
+    packets.swap(received);
+    return packets;
+}
+
+// ============================================================================
+// SLIP
+// ============================================================================
+
+static void slipLinkSend(void* link, uint8_t* packet, uint16_t length) {
+    slipSendIpPacket((SlipContext*)link, packet, length);
+}
+
+void SlipTestLink::begin(NatContext* ctx) {
+    nat = ctx;
+    slipInit(&gateway);
+    slipInit(&client);
+    natSetLink(ctx, slipLinkSend, &gateway);
+    natSetLinkMtu(ctx, SLIP_MTU, SLIP_MTU);
+}
+
+void SlipTestLink::clientEncode(const Bytes& packet) {
+    slipSendFrame(&client, packet.data(), packet.size());
+}
+
+void SlipTestLink::gatewayDecode(const Bytes& bytes) {
+    uint16_t pos = 0;
+    while (pos < bytes.size()) {
+        uint16_t consumed;
+        int frameLen = slipReceive(&gateway, &bytes[pos], bytes.size() - pos, &consumed);
+        pos += consumed;
+        if (frameLen > 0) {
+            natProcessPacket(nat, slipGetRxBuffer(&gateway), frameLen);
+        }
+    }
+}
+
+void SlipTestLink::clientDecode(const Bytes& bytes) {
+    uint16_t pos = 0;
+    while (pos < bytes.size()) {
+        uint16_t consumed;
+        int frameLen = slipReceive(&client, &bytes[pos], bytes.size() - pos, &consumed);
+        pos += consumed;
+        if (frameLen > 0) {
+            uint8_t* frame = slipGetRxBuffer(&client);
+            received.push_back(Bytes(frame, frame + frameLen));
+        }
+    }
+}
+
+// ============================================================================
+// PPP
+// ============================================================================
+// The link is taken as already up: LCP and IPCP defaults, no VJ or CCP
+
+static void pppLinkSend(void* link, uint8_t* packet, uint16_t length) {
+    pppSendIpPacket((PppContext*)link, packet, length);
+}
+
+void PppTestLink::begin(NatContext* ctx) {
+    nat = ctx;
+    pppInit(&gateway);
+    pppInit(&client);
+    natSetLink(ctx, pppLinkSend, &gateway);
+    natSetLinkMtu(ctx, PPP_MTU, PPP_MTU);
+}
+
+void PppTestLink::clientEncode(const Bytes& packet) {
+    pppSendFrame(&client, PPP_PROTO_IP, packet.data(), packet.size());
+}
+
+void PppTestLink::gatewayDecode(const Bytes& bytes) {
+    for (uint8_t byte : bytes) {
+        if (pppReceiveByte(&gateway, byte) > 0 &&
+            pppGetProtocol(&gateway) == PPP_PROTO_IP) {
+            uint16_t length;
+            uint8_t* payload = pppGetPayload(&gateway, &length);
+            natProcessPacket(nat, payload, length);
+        }
+    }
+}
+
+void PppTestLink::clientDecode(const Bytes& bytes) {
+    for (uint8_t byte : bytes) {
+        if (pppReceiveByte(&client, byte) > 0 &&
+            pppGetProtocol(&client) == PPP_PROTO_IP) {
+            uint16_t length;
+            uint8_t* payload = pppGetPayload(&client, &length);
+            received.push_back(Bytes(payload, payload + length));
+        }
+    }
+}
@@ -0,0 +1,84 @@
+// ============================================================================
+// Test Links
+// ============================================================================
+// Connects a scripted client to the NAT engine over one of the real link
+// codecs. The gateway side is wired the way slip_mode / ppp_mode wire it;
+// the client side runs the same codec to frame what it sends and deframe
+// what it gets, so every packet crosses the serial encoding both ways.
+// ============================================================================
+
+#ifndef TEST_LINK_H
+#define TEST_LINK_H
+
+#include "nat.h"
+#include "slip.h"
+#include "ppp.h"
+#include "packets.h"
+
+class TestLink {
+public:
+    virtual ~TestLink() {}
+
+    virtual const char* name() const = 0;
+
+    // Attach the gateway codec to ctx as its link, MTU 1500 both ways
+    virtual void begin(NatContext* ctx) = 0;
+
+    // Frame a packet on the client side and feed the bytes to the gateway
+    void send(const Bytes& packet);
+
+    // Service the NAT as the mode loops do and collect what it sent
+    void poll();
+
+    // Packets the client has received since the last take
+    std::vector<Bytes> take();
+
+    // Serial bytes carried so far, both directions
+    uint32_t wireBytes() const { return wire; }
+
+protected:
+    NatContext* nat = nullptr;
+
+    virtual void clientEncode(const Bytes& packet) = 0;
+    virtual void gatewayDecode(const Bytes& bytes) = 0;
+    virtual void clientDecode(const Bytes& bytes) = 0;
+
+    std::vector<Bytes> received;
+
+private:
+    uint32_t wire = 0;
+
+    void deliver();
+};
+
+class SlipTestLink : public TestLink {
+public:
+    const char* name() const override { return "SLIP"; }
+    void begin(NatContext* ctx) override;
+
+protected:
+    void clientEncode(const Bytes& packet) override;
+    void gatewayDecode(const Bytes& bytes) override;
+    void clientDecode(const Bytes& bytes) override;
+
+private:
+    SlipContext gateway;
+    SlipContext client;
+};
+
+class PppTestLink : public TestLink {
+public:
+    const char* name() const override { return "PPP"; }
+    void begin(NatContext* ctx) override;
+
+protected:
+    void clientEncode(const Bytes& packet) override;
+    void gatewayDecode(const Bytes& bytes) override;
+    void clientDecode(const Bytes& bytes) override;
+
+private:
+    PppContext gateway;
+    PppContext client;
+};
+
+#endif // TEST_LINK_H
@@ -0,0 +1,70 @@
+// ============================================================================
+// Test TCP Client Implementation
+// ============================================================================
+
+#include "test_tcp.h"
+
+static const uint32_t CLIENT = ipAddr(192, 168, 7, 2);
+
+TestTcpClient::TestTcpClient(TestLink& link, uint32_t server, uint16_t serverPort,
+                             uint16_t port)
+    : link(link), server(server), serverPort(serverPort), port(port) {
+    seq = 1000 + port;
+}
+
+struct tcp_pcb* TestTcpClient::connect(uint16_t window, uint16_t mss) {
+    this->window = window;
+    uint8_t option[] = { 2, 4, (uint8_t)(mss >> 8), (uint8_t)(mss & 0xFF) };
+    link.send(buildTcp(CLIENT, port, server, serverPort, seq, 0, TCP_SYN, window,
+                       Bytes(), Bytes(option, option + 4)));
+    seq++;
+
+    struct tcp_pcb* pcb = fakeTcpFind(server, serverPort);
+    if (!pcb) {
+        return nullptr;
+    }
+    fakeTcpAccept(pcb);
+    link.poll();
+    for (const Bytes& p : link.take()) {
+        Parsed r = parsePacket(p);
+        if (r.ok && r.dstPort == port && r.flags == (TCP_SYN | TCP_ACK)) {
+            rcvNext = r.seq + 1;
+            ack(window);
+            return pcb;
+        }
+    }
+    return nullptr;
+}
+
+void TestTcpClient::send(const Bytes& payload, uint8_t flags) {
+    link.send(buildTcp(CLIENT, port, server, serverPort, seq, rcvNext, flags, window,
+                       payload));
+    seq += payload.size() + ((flags & TCP_FIN) ? 1 : 0);
+}
+
+void TestTcpClient::ack(uint16_t window) {
+    this->window = window;
+    link.send(buildTcp(CLIENT, port, server, serverPort, seq, rcvNext, TCP_ACK, window,
+                       Bytes()));
+}
+
+std::vector<Parsed> TestTcpClient::receive() {
+    link.poll();
+    std::vector<Parsed> segments;
+    for (const Bytes& p : link.take()) {
+        Parsed r = parsePacket(p);
+        if (r.protocol != 6 || r.dstPort != port) {
+            continue;
+        }
+        if (r.seq == rcvNext && !r.payload.empty()) {
+            data.insert(data.end(), r.payload.begin(), r.payload.end());
+            rcvNext += r.payload.size();
+        }
+        if ((r.flags & TCP_FIN) && !finReceived && r.seq + r.payload.size() == rcvNext) {
+            finReceived = true;
+            rcvNext++;
+        }
+        segments.push_back(r);
+    }
+    return segments;
+}
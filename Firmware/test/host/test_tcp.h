@@ -0,0 +1,52 @@
+// ============================================================================
+// Test TCP Client
+// ============================================================================
+// The serial client's end of one TCP connection through the NAT, driven
+// by the test a segment at a time. It keeps the sequence numbers; what it
+// sends and whether it answers is up to the test.
+// ============================================================================
+
+#ifndef TEST_TCP_H
+#define TEST_TCP_H
+
+#include "fake_lwip.h"
+#include "test_link.h"
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+class TestTcpClient {
+public:
+    TestTcpClient(TestLink& link, uint32_t server, uint16_t serverPort, uint16_t port);
+
+    // SYN through the NAT, the server accepts, SYN-ACK, ACK
+    // Returns the server's pcb, or null if the handshake failed
+    struct tcp_pcb* connect(uint16_t window, uint16_t mss);
+
+    // A segment at our next sequence number (payload and FIN advance it)
+    void send(const Bytes& payload, uint8_t flags = TCP_PSH | TCP_ACK);
+
+    // A bare ACK of everything received so far, with this window
+    void ack(uint16_t window);
+
+    // Poll the NAT and take what reached the client. In-order payload is
+    // appended to data; nothing is acknowledged
+    std::vector<Parsed> receive();
+
+    uint32_t seq = 0;           // Next sequence number we send
+    uint32_t rcvNext = 0;       // Next sequence number we expect
+    uint16_t window = 0;        // Window we advertise
+    bool finReceived = false;
+    Bytes data;                 // Server data received in order
+
+private:
+    TestLink& link;
+    uint32_t server;
+    uint16_t serverPort;
+    uint16_t port;
+};
+
+#endif // TEST_TCP_H
@@ -0,0 +1,9 @@
+// Host stub: OLED display - declarations only
+#ifndef HOST_ADAFRUIT_SSD1306_H
+#define HOST_ADAFRUIT_SSD1306_H
+
+#include <Arduino.h>
+
+class Adafruit_SSD1306 {};
+
+#endif // HOST_ADAFRUIT_SSD1306_H
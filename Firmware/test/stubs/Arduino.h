@@ -0,0 +1,169 @@
+// ============================================================================
+// Host stub: Arduino core
+// ============================================================================
+// Just enough of the Arduino-ESP32 API for the link codecs and the NAT to
+// build on the host. millis() runs on a clock the tests advance.
+// ============================================================================
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <arpa/inet.h>
+#include <string>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define HEX 16
+#define DEC 10
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define SERIAL_8N1 0
+#define F(x) x
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define lowByte(w) ((uint8_t)((w) & 0xFF))
+#define word(h, l) ((uint16_t)(((h) << 8) | (l)))
+
+using std::min;
+using std::max;
+
+template <class T, class L, class H>
+T constrain(T x, L lo, H hi) {
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+long random(long howBig);
+long random(long howSmall, long howBig);
+uint32_t esp_random();
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+void pinMode(int pin, int mode);
+
+// ============================================================================
+// String
+// ============================================================================
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v, int base = 10) { format(base == 16 ? "%x" : "%d", v); }
+    String(unsigned int v, int base = 10) { format(base == 16 ? "%x" : "%u", v); }
+    String(long v, int base = 10) { format(base == 16 ? "%lx" : "%ld", v); }
+    String(unsigned long v, int base = 10) { format(base == 16 ? "%lx" : "%lu", v); }
+    String(unsigned char v, int base = 10) : String((unsigned int)v, base) {}
+    String(double v, int digits = 2) { format("%.*f", digits, v); }
+
+    unsigned int length() const { return s_.size(); }
+    const char* c_str() const { return s_.c_str(); }
+    char operator[](unsigned int i) const { return s_[i]; }
+    char charAt(unsigned int i) const { return s_[i]; }
+    String substring(unsigned int from) const {
+        return from > s_.size() ? String() : String(s_.substr(from));
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        return from > s_.size() ? String() : String(s_.substr(from, to - from));
+    }
+    int indexOf(char c, unsigned int from = 0) const { return pos(s_.find(c, from)); }
+    int indexOf(const String& str, unsigned int from = 0) const {
+        return pos(s_.find(str.s_, from));
+    }
+    long toInt() const { return atol(s_.c_str()); }
+    void toUpperCase() { for (auto& c : s_) c = toupper(c); }
+    void trim() {
+        s_.erase(0, s_.find_first_not_of(" \t\r\n"));
+        s_.erase(s_.find_last_not_of(" \t\r\n") + 1);
+    }
+    bool startsWith(const String& prefix) const { return s_.rfind(prefix.s_, 0) == 0; }
+    bool equals(const String& other) const { return s_ == other.s_; }
+
+    String& operator+=(const String& other) { s_ += other.s_; return *this; }
+    String& operator+=(const char* other) { s_ += other; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    bool operator==(const String& other) const { return s_ == other.s_; }
+    bool operator==(const char* other) const { return s_ == other; }
+    bool operator!=(const String& other) const { return s_ != other.s_; }
+
+    friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String& a, const char* b) { return String(a.s_ + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.s_); }
+
+private:
+    template <class... A>
+    void format(const char* fmt, A... args) {
+        char buf[40];
+        snprintf(buf, sizeof(buf), fmt, args...);
+        s_ = buf;
+    }
+    static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+
+    std::string s_;
+};
+
+// ============================================================================
+// Print / Stream / HardwareSerial - output is discarded
+// ============================================================================
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) { return size; }
+    template <class T> size_t print(const T&, int = DEC) { return 0; }
+    template <class T> size_t println(const T&, int = DEC) { return 0; }
+    size_t println() { return 0; }
+    size_t printf(const char*, ...) __attribute__((format(printf, 2, 3))) { return 0; }
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+};
+
+class HardwareSerial : public Stream {
+public:
+    HardwareSerial(int uart = 0) {}
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int rx = -1, int tx = -1) {}
+    void end() {}
+    int availableForWrite() { return 128; }
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+struct EspClass {
+    uint32_t getFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getCycleCount();
+    void restart() {}
+};
+
+extern EspClass ESP;
+
+#endif // HOST_ARDUINO_H
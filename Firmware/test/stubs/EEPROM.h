@@ -0,0 +1,20 @@
+// Host stub: EEPROM, a RAM array
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+    bool begin(size_t size) { return true; }
+    uint8_t read(int address) { return data_[address]; }
+    void write(int address, uint8_t value) { data_[address] = value; }
+    bool commit() { return true; }
+
+private:
+    uint8_t data_[4096];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // HOST_EEPROM_H
@@ -0,0 +1,7 @@
+// Host stub: mDNS - declarations only
+#ifndef HOST_ESPMDNS_H
+#define HOST_ESPMDNS_H
+
+class MDNSResponder {};
+
+#endif // HOST_ESPMDNS_H
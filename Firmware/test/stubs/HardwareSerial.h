@@ -0,0 +1,2 @@
+// Host stub: HardwareSerial lives in Arduino.h
+#include <Arduino.h>
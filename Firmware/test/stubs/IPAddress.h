@@ -0,0 +1,37 @@
+// Host stub: IPAddress, stored in network byte order like the ESP32 core's
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        bytes_[0] = a; bytes_[1] = b; bytes_[2] = c; bytes_[3] = d;
+    }
+    IPAddress(uint32_t addr) { memcpy(bytes_, &addr, 4); }
+
+    operator uint32_t() const { uint32_t addr; memcpy(&addr, bytes_, 4); return addr; }
+    uint8_t operator[](int i) const { return bytes_[i]; }
+    uint8_t& operator[](int i) { return bytes_[i]; }
+    bool operator==(const IPAddress& other) const { return memcmp(bytes_, other.bytes_, 4) == 0; }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes_[0], bytes_[1], bytes_[2], bytes_[3]);
+        return String(buf);
+    }
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        if (sscanf(s, "%u.%u.%u.%u", &a, &b, &c, &d) != 4) return false;
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    bool fromString(const String& s) { return fromString(s.c_str()); }
+
+private:
+    uint8_t bytes_[4] = {0, 0, 0, 0};
+};
+
+#endif // HOST_IPADDRESS_H
@@ -0,0 +1,9 @@
+// Host stub: SD card - declarations only
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include <Arduino.h>
+
+class File {};
+
+#endif // HOST_SD_H
@@ -0,0 +1,12 @@
+// Host stub: WebServer - declarations only
+#ifndef HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include <WiFi.h>
+
+class WebServer {
+public:
+    WebServer(int port = 80) {}
+};
+
+#endif // HOST_WEBSERVER_H
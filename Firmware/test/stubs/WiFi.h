@@ -0,0 +1,14 @@
+// Host stub: WiFi - declarations only, nothing under test talks to the radio
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFiClient.h>
+
+class WiFiServer {
+public:
+    WiFiServer(uint16_t port = 80) {}
+};
+
+#endif // HOST_WIFI_H
@@ -0,0 +1,13 @@
+// Host stub: WiFiClient - declarations only
+#ifndef HOST_WIFICLIENT_H
+#define HOST_WIFICLIENT_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+class WiFiClient : public Stream {
+public:
+    using Stream::write;
+};
+
+#endif // HOST_WIFICLIENT_H
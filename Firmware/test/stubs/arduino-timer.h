@@ -0,0 +1,8 @@
+// Host stub: arduino-timer - declarations only
+#ifndef HOST_ARDUINO_TIMER_H
+#define HOST_ARDUINO_TIMER_H
+
+template <unsigned N = 16>
+class Timer {};
+
+#endif // HOST_ARDUINO_TIMER_H
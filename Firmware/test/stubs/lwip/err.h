@@ -0,0 +1,30 @@
+// Host stub: lwIP base types and error codes (values as in lwIP 2.1)
+#ifndef HOST_LWIP_ERR_H
+#define HOST_LWIP_ERR_H
+
+#include <stdint.h>
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t s8_t;
+typedef int16_t s16_t;
+typedef s8_t err_t;
+
+#define ERR_OK      0
+#define ERR_MEM    -1
+#define ERR_BUF    -2
+#define ERR_TIMEOUT -3
+#define ERR_RTE    -4
+#define ERR_VAL    -6
+#define ERR_USE    -8
+#define ERR_CONN   -11
+#define ERR_ABRT   -13
+#define ERR_RST    -14
+#define ERR_CLSD   -15
+
+#define IP_PROTO_ICMP   1
+#define IP_PROTO_TCP    6
+#define IP_PROTO_UDP    17
+
+#endif // HOST_LWIP_ERR_H
@@ -0,0 +1,12 @@
+// Host stub: lwIP ICMP definitions
+#ifndef HOST_LWIP_ICMP_H
+#define HOST_LWIP_ICMP_H
+
+#include "lwip/err.h"
+
+#define ICMP_ER     0
+#define ICMP_DUR    3
+#define ICMP_ECHO   8
+#define ICMP_TE     11
+
+#endif // HOST_LWIP_ICMP_H
@@ -0,0 +1,7 @@
+// Host stub: lwIP checksum helpers (the NAT brings its own)
+#ifndef HOST_LWIP_INET_CHKSUM_H
+#define HOST_LWIP_INET_CHKSUM_H
+
+#include "lwip/err.h"
+
+#endif // HOST_LWIP_INET_CHKSUM_H
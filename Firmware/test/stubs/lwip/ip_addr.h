@@ -0,0 +1,41 @@
+// Host stub: lwIP IPv4 addresses (network byte order, as in lwIP)
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ip4_addr {
+    u32_t addr;
+};
+typedef struct ip4_addr ip4_addr_t;
+
+typedef struct ip_addr {
+    union {
+        ip4_addr_t ip4;
+    } u_addr;
+    u8_t type;
+} ip_addr_t;
+
+#define IPADDR_TYPE_V4  0U
+
+#define IPADDR4_INIT(u32val)    { { { u32val } }, IPADDR_TYPE_V4 }
+#define IP_ADDR4(ipaddr, a, b, c, d) \
+    ((ipaddr)->u_addr.ip4.addr = ((u32_t)(a) | ((u32_t)(b) << 8) | \
+                                  ((u32_t)(c) << 16) | ((u32_t)(d) << 24)), \
+     (ipaddr)->type = IPADDR_TYPE_V4)
+#define ip_2_ip4(ipaddr)        (&((ipaddr)->u_addr.ip4))
+#define ip4_addr_get_u32(a)     ((a)->addr)
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY     (&ip_addr_any)
+#define IP4_ADDR_ANY    (&ip_addr_any)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_LWIP_IP_ADDR_H
@@ -0,0 +1,35 @@
+// Host stub: lwIP pbufs - heap blocks that can be chained
+#ifndef HOST_LWIP_PBUF_H
+#define HOST_LWIP_PBUF_H
+
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum { PBUF_TRANSPORT, PBUF_IP, PBUF_LINK, PBUF_RAW } pbuf_layer;
+typedef enum { PBUF_RAM, PBUF_ROM, PBUF_REF, PBUF_POOL } pbuf_type;
+
+struct pbuf {
+    struct pbuf* next;
+    void* payload;
+    u16_t tot_len;      // This pbuf and the rest of the chain
+    u16_t len;          // This pbuf
+    u16_t ref;
+};
+
+struct pbuf* pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+u8_t pbuf_free(struct pbuf* p);
+void pbuf_ref(struct pbuf* p);
+void pbuf_cat(struct pbuf* head, struct pbuf* tail);
+struct pbuf* pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf* p);
+struct pbuf* pbuf_free_header(struct pbuf* q, u16_t size);
+u16_t pbuf_copy_partial(const struct pbuf* p, void* dataptr, u16_t len, u16_t offset);
+err_t pbuf_take(struct pbuf* p, const void* dataptr, u16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_LWIP_PBUF_H
@@ -0,0 +1,22 @@
+// Host stub: tcpip_api_call - there is no lwIP task, so it runs the call inline
+#ifndef HOST_LWIP_TCPIP_PRIV_H
+#define HOST_LWIP_TCPIP_PRIV_H
+
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct tcpip_api_call_data {
+    err_t err;
+};
+typedef err_t (*tcpip_api_call_fn)(struct tcpip_api_call_data* call);
+
+err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data* call);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_LWIP_TCPIP_PRIV_H
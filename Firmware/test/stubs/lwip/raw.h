@@ -0,0 +1,33 @@
+// Host stub: lwIP raw API
+#ifndef HOST_LWIP_RAW_H
+#define HOST_LWIP_RAW_H
+
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct raw_pcb;
+typedef u8_t (*raw_recv_fn)(void* arg, struct raw_pcb* pcb, struct pbuf* p,
+                            const ip_addr_t* addr);
+
+struct raw_pcb {
+    u8_t protocol;
+    u8_t ttl;
+    raw_recv_fn recv;
+    void* recv_arg;
+};
+
+struct raw_pcb* raw_new(u8_t proto);
+void raw_remove(struct raw_pcb* pcb);
+err_t raw_bind(struct raw_pcb* pcb, const ip_addr_t* ipaddr);
+void raw_recv(struct raw_pcb* pcb, raw_recv_fn recv, void* recv_arg);
+err_t raw_sendto(struct raw_pcb* pcb, struct pbuf* p, const ip_addr_t* ipaddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_LWIP_RAW_H
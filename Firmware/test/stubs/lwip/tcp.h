@@ -0,0 +1,59 @@
+// Host stub: lwIP TCP raw API (sizes as in the Arduino-ESP32 build)
+#ifndef HOST_LWIP_TCP_H
+#define HOST_LWIP_TCP_H
+
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+
+#define TCP_MSS                 1436
+#define TCP_WND                 5744
+#define TCP_SND_BUF             5744
+#define MEMP_NUM_TCP_PCB        16
+#define MEMP_NUM_TCP_PCB_LISTEN 16
+#define TCP_WRITE_FLAG_COPY     0x01
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct tcp_pcb;
+typedef err_t (*tcp_recv_fn)(void* arg, struct tcp_pcb* tpcb, struct pbuf* p, err_t err);
+typedef err_t (*tcp_accept_fn)(void* arg, struct tcp_pcb* newpcb, err_t err);
+typedef err_t (*tcp_connected_fn)(void* arg, struct tcp_pcb* tpcb, err_t err);
+typedef void (*tcp_err_fn)(void* arg, err_t err);
+
+struct tcp_pcb {
+    ip_addr_t local_ip;
+    ip_addr_t remote_ip;
+    u16_t local_port;
+    u16_t remote_port;
+    void* callback_arg;
+    tcp_recv_fn recv;
+    tcp_err_fn errf;
+    tcp_connected_fn connected;
+    tcp_accept_fn accept;
+};
+
+struct tcp_pcb* tcp_new_ip_type(u8_t type);
+void tcp_arg(struct tcp_pcb* pcb, void* arg);
+void tcp_recv(struct tcp_pcb* pcb, tcp_recv_fn recv);
+void tcp_err(struct tcp_pcb* pcb, tcp_err_fn err);
+void tcp_accept(struct tcp_pcb* pcb, tcp_accept_fn accept);
+err_t tcp_bind(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port);
+err_t tcp_connect(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port,
+                  tcp_connected_fn connected);
+struct tcp_pcb* tcp_listen_with_backlog(struct tcp_pcb* pcb, u8_t backlog);
+#define tcp_listen(pcb) tcp_listen_with_backlog(pcb, 255)
+err_t tcp_close(struct tcp_pcb* pcb);
+void tcp_abort(struct tcp_pcb* pcb);
+err_t tcp_shutdown(struct tcp_pcb* pcb, int shut_rx, int shut_tx);
+err_t tcp_write(struct tcp_pcb* pcb, const void* dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb* pcb);
+void tcp_recved(struct tcp_pcb* pcb, u16_t len);
+u16_t tcp_sndbuf(const struct tcp_pcb* pcb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_LWIP_TCP_H
@@ -0,0 +1,7 @@
+// Host stub: lwIP tcpip thread API
+#ifndef HOST_LWIP_TCPIP_H
+#define HOST_LWIP_TCPIP_H
+
+#include "lwip/err.h"
+
+#endif // HOST_LWIP_TCPIP_H
@@ -0,0 +1,40 @@
+// Host stub: lwIP UDP raw API
+#ifndef HOST_LWIP_UDP_H
+#define HOST_LWIP_UDP_H
+
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+
+#define MEMP_NUM_UDP_PCB    16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void* arg, struct udp_pcb* pcb, struct pbuf* p,
+                            const ip_addr_t* addr, u16_t port);
+
+struct udp_pcb {
+    ip_addr_t local_ip;
+    ip_addr_t remote_ip;
+    u16_t local_port;
+    u16_t remote_port;
+    u8_t ttl;
+    udp_recv_fn recv;
+    void* recv_arg;
+};
+
+struct udp_pcb* udp_new_ip_type(u8_t type);
+void udp_remove(struct udp_pcb* pcb);
+err_t udp_bind(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port);
+err_t udp_connect(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port);
+void udp_recv(struct udp_pcb* pcb, udp_recv_fn recv, void* recv_arg);
+err_t udp_send(struct udp_pcb* pcb, struct pbuf* p);
+err_t udp_sendto(struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* dst_ip, u16_t dst_port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_LWIP_UDP_H
@@ -0,0 +1,136 @@
+// ============================================================================
+// Checksum Tests
+// ============================================================================
+// The word-wide sums against the byte-pair reference of RFC 1071 at every
+// small length and alignment, and the RFC 1624 updates against a full
+// recompute of the changed packet.
+// ============================================================================
+
+#include "check.h"
+#include "checksum.h"
+#include "host.h"
+#include "packets.h"
+
+// A folded checksum as it sits in the packet, from the host-order reference
+static uint16_t stored(uint16_t hostOrder) {
+    return htons(hostOrder);
+}
+
+static void fill(uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)random(0, 256);
+    }
+}
+
+static void testPartial() {
+    static uint8_t buffer[1500 + 8];
+    fill(buffer, sizeof(buffer));
+
+    // Every length up to 160 and some long odd ones, at all 8 alignments
+    for (int length = 0; length <= 1500; length += (length < 160) ? 1 : 97) {
+        for (int offset = 0; offset < 8; offset++) {
+            const uint8_t* data = buffer + offset;
+            uint16_t expect = stored(refChecksum(data, length));
+            CHECK_EQ(csumFold(csumPartial(data, length, 0)), expect);
+
+            uint8_t copy[1500];
+            memset(copy, 0, sizeof(copy));
+            CHECK_EQ(csumFold(csumCopy(copy, data, length)), expect);
+            CHECK(memcmp(copy, data, length) == 0);
+        }
+    }
+
+    // All ones sum to -0, all zeros fold to 0xFFFF, as the reference does
+    uint8_t ones[41], zeros[41];
+    memset(ones, 0xFF, sizeof(ones));
+    memset(zeros, 0, sizeof(zeros));
+    CHECK_EQ(csumFold(csumPartial(ones, 41, 0)), stored(refChecksum(ones, 41)));
+    CHECK_EQ(csumFold(csumPartial(zeros, 41, 0)), stored(refChecksum(zeros, 41)));
+}
+
+static void testJoin() {
+    uint8_t data[301];
+    fill(data, sizeof(data));
+    uint16_t expect = stored(refChecksum(data, sizeof(data)));
+
+    // Split anywhere, odd offsets included - e.g. a header and its payload
+    for (uint16_t split = 0; split <= sizeof(data); split++) {
+        uint32_t sum = csumPartial(data, split, 0);
+        uint32_t piece = csumPartial(data + split, sizeof(data) - split, 0);
+        CHECK_EQ(csumFold(csumAddAt(sum, piece, split)), expect);
+    }
+}
+
+static void testPseudo() {
+    Bytes udp = buildUdp(ipAddr(192, 168, 7, 2), 1025, ipAddr(10, 1, 2, 3), 53,
+                         bytesOf("odd length payload!"));
+    uint32_t src, dst;
+    memcpy(&src, &udp[12], 4);
+    memcpy(&dst, &udp[16], 4);
+    uint16_t length = udp.size() - 20;
+
+    uint32_t sum = csumPseudo(src, dst, 17, length);
+    CHECK_EQ(csumFold(csumPartial(&udp[20], length, sum)), 0);
+}
+
+// Full TCP checksum of a packet: pseudo header, then the segment
+static uint16_t refTcpChecksum(const Bytes& p) {
+    uint16_t length = p.size() - 20;
+    Bytes pseudo(p.begin() + 12, p.begin() + 20);
+    pseudo.push_back(0);
+    pseudo.push_back(6);
+    pseudo.push_back(length >> 8);
+    pseudo.push_back(length & 0xFF);
+    pseudo.insert(pseudo.end(), p.begin() + 20, p.end());
+    return refChecksum(pseudo.data(), pseudo.size());
+}
+
+static void testReplace() {
+    // RFC 1624 section 4: 0xDD2F with 0x5555 -> 0x3285 is 0x0000, not -0
+    CHECK_EQ(csumReplace16(htons(0xDD2F), htons(0x5555), htons(0x3285)), htons(0x0000));
+
+    for (int round = 0; round < 2000; round++) {
+        // A TCP segment as the NAT sees it inbound, random length and data
+        Bytes payload(random(0, 200));
+        fill(payload.data(), payload.size());
+        uint32_t src = (uint32_t)esp_random();
+        Bytes p = buildTcp(src, random(1, 65536), ipAddr(192, 168, 7, 1),
+                           random(1, 65536), esp_random(), esp_random(), 0x18,
+                           random(0, 65536), payload);
+        uint8_t* tcp = &p[20];
+
+        // Rewrite the destination address and port, as the NAT does
+        uint32_t oldAddr, newAddr = ipAddr(192, 168, 7, 2);
+        uint16_t oldPort, newPort = htons(random(0, 65536));
+        uint16_t ipCheck, tcpCheck;
+        memcpy(&oldAddr, &p[16], 4);
+        memcpy(&oldPort, &tcp[2], 2);
+        memcpy(&ipCheck, &p[10], 2);
+        memcpy(&tcpCheck, &tcp[16], 2);
+
+        ipCheck = csumReplace32(ipCheck, oldAddr, newAddr);
+        tcpCheck = csumReplace32(tcpCheck, oldAddr, newAddr);
+        tcpCheck = csumReplace16(tcpCheck, oldPort, newPort);
+
+        memcpy(&p[16], &newAddr, 4);
+        memcpy(&tcp[2], &newPort, 2);
+
+        // The updated checksums are what a full recompute gives
+        Bytes full = p;
+        memset(&full[10], 0, 2);
+        memset(&full[36], 0, 2);
+        CHECK_EQ(ipCheck, stored(refChecksum(full.data(), 20)));
+        CHECK_EQ(tcpCheck, stored(refTcpChecksum(full)));
+    }
+}
+
+int main() {
+    hostReset();
+
+    testPartial();
+    testJoin();
+    testPseudo();
+    testReplace();
+
+    return testResult("checksum");
+}
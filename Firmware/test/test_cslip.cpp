@@ -0,0 +1,186 @@
+// ============================================================================
+// CSLIP Tests
+// ============================================================================
+// A CSLIP client's frames through the gateway's SLIP receiver and
+// slipUncompressFrame: TYPE_IP passes through, UNCOMPRESSED_TCP has its
+// version nibble restored by the 0x4F mask, COMPRESSED_TCP is rebuilt from
+// the slot - and a gateway with CSLIP off leaves every frame alone.
+// ============================================================================
+
+#include "check.h"
+#include "fake_link.h"
+#include "host.h"
+#include "packets.h"
+#include "slip.h"
+
+static const uint32_t CLIENT = ipAddr(192, 168, 7, 2);
+static const uint32_t SERVER = ipAddr(10, 0, 0, 80);
+
+static SlipContext client, gateway;
+static VjContext clientVj, gatewayVj;
+static uint8_t rebuilt[SLIP_BUFFER_SIZE];
+
+static void reset(bool gatewayCslip) {
+    hostReset();
+    fakeLinkReset();
+    slipInit(&client);
+    slipInit(&gateway);
+    vjInit(&clientVj);
+    vjInit(&gatewayVj);
+    vjEnableTx(&clientVj, 15, true);
+    client.vj = &clientVj;
+    if (gatewayCslip) {
+        vjEnableRx(&gatewayVj, 15);
+    }
+    gateway.vj = &gatewayVj;
+}
+
+// Client sends a packet; the gateway deframes it
+// Returns the frame as it crossed the link
+static Bytes send(const Bytes& packet) {
+    Bytes work = packet;
+    slipSendIpPacket(&client, work.data(), work.size());
+    Bytes wire = fakeLinkTake();
+
+    uint16_t consumed;
+    int frameLen = slipReceive(&gateway, wire.data(), wire.size(), &consumed);
+    CHECK(frameLen > 0);
+    return Bytes(gateway.rxBuffer, gateway.rxBuffer + (frameLen > 0 ? frameLen : 0));
+}
+
+// What the gateway hands to NAT for the frame now in its receive buffer
+static int receive(uint16_t frameLen, Bytes& packet) {
+    uint8_t* p;
+    int n = slipUncompressFrame(&gateway, gateway.rxBuffer, frameLen, rebuilt,
+                                sizeof(rebuilt), &p);
+    packet.assign(p, p + (n > 0 ? n : 0));
+    return n;
+}
+
+static Bytes segment(uint32_t seq, uint32_t ack, uint8_t flags, const std::string& data,
+                     uint16_t ipId) {
+    return buildTcp(CLIENT, 1030, SERVER, 80, seq, ack, flags, 4096, bytesOf(data),
+                    Bytes(), ipId);
+}
+
+// The same segment with four bytes of IP options (IHL 6)
+static Bytes withIpOptions(const Bytes& p) {
+    Bytes q(p.begin(), p.begin() + 20);
+    q.insert(q.end(), { 0x01, 0x01, 0x01, 0x00 });
+    q.insert(q.end(), p.begin() + 20, p.end());
+    q[0] = 0x46;
+    q[2] = q.size() >> 8;
+    q[3] = q.size() & 0xFF;
+    q[10] = q[11] = 0;
+    uint16_t sum = refChecksum(q.data(), 24);
+    q[10] = sum >> 8;
+    q[11] = sum & 0xFF;
+    return q;
+}
+
+static void testTypeIp() {
+    reset(true);
+    // UDP and a SYN are never compressed - the first byte is the IP header's
+    Bytes udp = buildUdp(CLIENT, 1025, SERVER, 53, bytesOf("query"));
+    Bytes frame = send(udp);
+    CHECK_EQ(cslipFrameType(frame.data()), VJ_TYPE_IP);
+    Bytes packet;
+    CHECK_EQ(receive(frame.size(), packet), udp.size());
+    CHECK(packet == udp);
+
+    Bytes syn = segment(1000, 0, 0x02, "", 1);
+    frame = send(syn);
+    CHECK_EQ(frame[0], 0x45);
+    CHECK_EQ(receive(frame.size(), packet), syn.size());
+    CHECK(packet == syn);
+    CHECK_EQ(gatewayVj.rxUncompressed + gatewayVj.rxCompressed, 0);
+}
+
+static void testUncompressedTcp() {
+    for (bool options : { false, true }) {
+        reset(true);
+        Bytes ack = segment(1001, 5001, 0x10, "", 2);
+        if (options) {
+            ack = withIpOptions(ack);
+        }
+        Bytes frame = send(ack);
+
+        // Type over the version nibble, slot id in the protocol byte
+        CHECK_EQ(frame[0], 0x70 | (ack[0] & 0x0F));
+        CHECK_EQ(cslipFrameType(frame.data()), VJ_TYPE_UNCOMPRESSED_TCP);
+        CHECK_EQ(frame[9], 0);
+
+        Bytes packet;
+        CHECK_EQ(receive(frame.size(), packet), ack.size());
+        CHECK(packet == ack);
+        CHECK(parsePacket(packet).ok);
+        CHECK_EQ(gatewayVj.rxUncompressed, 1);
+    }
+}
+
+static void testCompressedTcp() {
+    reset(true);
+    Bytes packet;
+    Bytes ack = segment(1001, 5001, 0x10, "", 2);
+    Bytes frame = send(ack);
+    CHECK(receive(frame.size(), packet) > 0);
+
+    // Keystrokes, then a bulk write, then a new connection's first segment
+    uint32_t seq = 1001;
+    uint16_t id = 3;
+    const char* data[] = { "l", "s", "\r", "cat README.TXT\r", "x" };
+    for (const char* d : data) {
+        Bytes p = segment(seq, 5001, 0x18, d, id++);
+        seq += strlen(d);
+        frame = send(p);
+        CHECK(frame[0] & VJ_TYPE_COMPRESSED_TCP);
+        CHECK_EQ(cslipFrameType(frame.data()), VJ_TYPE_COMPRESSED_TCP);
+        CHECK(frame.size() < p.size() - 30);
+        CHECK_EQ(receive(frame.size(), packet), p.size());
+        CHECK(packet == p);
+    }
+    CHECK_EQ(gatewayVj.rxCompressed, 5);
+
+    // A second flow: its first compressed frame carries NEW_C (0x40) in the
+    // change mask, under the type bit - it must not read as an IP header
+    Bytes other = buildTcp(CLIENT, 1031, SERVER, 80, 9000, 7000, 0x10, 4096, Bytes(),
+                           Bytes(), 20);
+    frame = send(other);
+    CHECK(receive(frame.size(), packet) > 0);
+    Bytes back = segment(seq, 5001, 0x18, "y", id++);
+    frame = send(back);
+    CHECK_EQ(frame[0] & (VJ_TYPE_COMPRESSED_TCP | VJ_NEW_C),
+             VJ_TYPE_COMPRESSED_TCP | VJ_NEW_C);
+    CHECK_EQ(receive(frame.size(), packet), back.size());
+    CHECK(packet == back);
+
+    // Lost sync: a compressed frame without a slot id is tossed
+    vjToss(&gatewayVj);
+    frame = send(segment(seq + 1, 5001, 0x18, "z", id++));
+    CHECK_EQ(receive(frame.size(), packet), 0);
+    CHECK_EQ(gatewayVj.rxTossed, 1);
+}
+
+static void testCslipOff() {
+    // Gateway with CSLIP off: frames reach NAT untouched, which drops them
+    reset(false);
+    Bytes packet;
+    Bytes ack = segment(1001, 5001, 0x10, "", 2);
+    Bytes frame = send(ack);
+    CHECK_EQ(receive(frame.size(), packet), frame.size());
+    CHECK(packet == frame);
+    CHECK_EQ(packet[0], 0x75);
+
+    gateway.vj = nullptr;
+    CHECK_EQ(receive(frame.size(), packet), frame.size());
+    CHECK(packet == frame);
+}
+
+int main() {
+    testTypeIp();
+    testUncompressedTcp();
+    testCompressedTcp();
+    testCslipOff();
+
+    return testResult("cslip");
+}
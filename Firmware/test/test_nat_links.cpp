@@ -0,0 +1,234 @@
+// ============================================================================
+// NAT over SLIP and PPP
+// ============================================================================
+// One client session - gateway ping, UDP, a TCP download, remote ping -
+// is played over each link. The NAT is link-agnostic, so the packets the
+// client gets back must be byte-identical on both, and sane on their own.
+// ============================================================================
+
+#include "check.h"
+#include "fake_link.h"
+#include "fake_lwip.h"
+#include "host.h"
+#include "test_link.h"
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_ACK 0x10
+
+static const uint32_t CLIENT  = ipAddr(192, 168, 7, 2);
+static const uint32_t GATEWAY = ipAddr(192, 168, 7, 1);
+static const uint32_t SERVER  = ipAddr(10, 0, 0, 80);
+static const uint32_t ECHOER  = ipAddr(10, 0, 0, 7);
+
+// Everything the client received, in order
+static std::vector<Bytes> transcript;
+
+static std::vector<Bytes> collect(TestLink& link) {
+    std::vector<Bytes> packets = link.take();
+    transcript.insert(transcript.end(), packets.begin(), packets.end());
+    return packets;
+}
+
+static void pingGateway(TestLink& link) {
+    link.send(buildIcmpEcho(CLIENT, GATEWAY, 8, 0x1234, 1, bytesOf("ping")));
+    std::vector<Bytes> got = collect(link);
+    CHECK_EQ(got.size(), 1);
+    if (got.size() == 1) {
+        Parsed r = parsePacket(got[0]);
+        CHECK(r.ok);
+        CHECK_EQ(r.flags, 0);           // Echo reply
+        CHECK_EQ(r.src, GATEWAY);
+        CHECK_EQ(r.srcPort, 0x1234);
+        CHECK(r.payload == bytesOf("ping"));
+    }
+}
+
+static void udpExchange(TestLink& link) {
+    link.send(buildUdp(CLIENT, 1025, ECHOER, 7, bytesOf("hello")));
+    std::vector<FakeDatagram> sent = fakeUdpTakeSent();
+    CHECK_EQ(sent.size(), 1);
+    if (sent.size() != 1) {
+        return;
+    }
+    CHECK_EQ(sent[0].addr, ECHOER);
+    CHECK_EQ(sent[0].port, 7);
+    CHECK(sent[0].data == bytesOf("hello"));
+
+    Bytes reply = bytesOf("HELLO");
+    fakeUdpDeliver(sent[0].pcb, reply.data(), reply.size(), ECHOER, 7);
+    link.poll();
+    std::vector<Bytes> got = collect(link);
+    CHECK_EQ(got.size(), 1);
+    if (got.size() == 1) {
+        Parsed r = parsePacket(got[0]);
+        CHECK(r.ok);
+        CHECK_EQ(r.protocol, 17);
+        CHECK_EQ(r.src, ECHOER);
+        CHECK_EQ(r.dst, CLIENT);
+        CHECK_EQ(r.srcPort, 7);
+        CHECK_EQ(r.dstPort, 1025);
+        CHECK(r.payload == reply);
+    }
+}
+
+static void tcpDownload(TestLink& link) {
+    const uint16_t port = 1100;
+    uint32_t seq = 1000;
+    uint8_t mss[] = { 2, 4, 0x05, 0xB4 };   // 1460
+
+    link.send(buildTcp(CLIENT, port, SERVER, 80, seq, 0, TCP_SYN, 4096, Bytes(),
+                       Bytes(mss, mss + 4)));
+    CHECK_EQ(collect(link).size(), 0);      // Nothing until the server answers
+    struct tcp_pcb* pcb = fakeTcpFind(SERVER, 80);
+    CHECK(pcb != nullptr);
+    if (!pcb) {
+        return;
+    }
+    fakeTcpAccept(pcb);
+    link.poll();
+
+    std::vector<Bytes> got = collect(link);
+    CHECK_EQ(got.size(), 1);
+    if (got.size() != 1) {
+        return;
+    }
+    Parsed synAck = parsePacket(got[0]);
+    CHECK(synAck.ok);
+    CHECK_EQ(synAck.flags, TCP_SYN | TCP_ACK);
+    CHECK_EQ(synAck.ack, seq + 1);
+    CHECK(synAck.mss > 0 && synAck.mss <= 1460);
+    seq++;
+    uint32_t ack = synAck.seq + 1;
+
+    Bytes request = bytesOf("GET / HTTP/1.0\r\n\r\n");
+    link.send(buildTcp(CLIENT, port, SERVER, 80, seq, ack, TCP_ACK, 4096, Bytes()));
+    link.send(buildTcp(CLIENT, port, SERVER, 80, seq, ack, TCP_ACK, 4096, request));
+    seq += request.size();
+    CHECK(fakeTcpTakeWritten(pcb) == std::string(request.begin(), request.end()));
+
+    // 3000 bytes from the server, acknowledged as they arrive
+    Bytes body(3000);
+    for (size_t i = 0; i < body.size(); i++) {
+        body[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    fakeTcpDeliver(pcb, body.data(), body.size());
+    fakeTcpRemoteClose(pcb);
+
+    Bytes data;
+    bool fin = false;
+    for (int round = 0; round < 20 && !fin; round++) {
+        link.poll();
+        got = collect(link);
+        for (const Bytes& p : got) {
+            Parsed r = parsePacket(p);
+            CHECK(r.ok);
+            CHECK(r.payload.size() <= synAck.mss);
+            if (r.seq == ack) {
+                data.insert(data.end(), r.payload.begin(), r.payload.end());
+                ack += r.payload.size();
+                if (r.flags & TCP_FIN) {
+                    ack++;
+                    fin = true;
+                }
+            }
+        }
+        if (!got.empty()) {
+            link.send(buildTcp(CLIENT, port, SERVER, 80, seq, ack, TCP_ACK, 4096, Bytes()));
+        }
+    }
+    CHECK(fin);
+    CHECK(data == body);
+
+    // Close our half - the NAT passes the FIN up and acknowledges it
+    link.send(buildTcp(CLIENT, port, SERVER, 80, seq, ack, TCP_FIN | TCP_ACK, 4096, Bytes()));
+    link.poll();
+    got = collect(link);
+    CHECK(!got.empty());
+    if (!got.empty()) {
+        Parsed r = parsePacket(got.back());
+        CHECK(r.ok);
+        CHECK(r.flags & TCP_ACK);
+        CHECK_EQ(r.ack, seq + 1);
+    }
+}
+
+static void pingRemote(TestLink& link) {
+    link.send(buildIcmpEcho(CLIENT, ECHOER, 8, 0x4321, 1, bytesOf("far")));
+    std::vector<FakeDatagram> sent = fakeRawTakeSent();
+    CHECK_EQ(sent.size(), 1);
+    if (sent.size() != 1) {
+        return;
+    }
+    CHECK_EQ(sent[0].addr, ECHOER);
+    CHECK_EQ(sent[0].ttl, 63);
+
+    // The echo reply answers the NAT's id and sequence, as an IP packet
+    // on the raw pcb
+    const Bytes& icmp = sent[0].data;
+    CHECK(icmp.size() == 8 + 3);
+    if (icmp.size() < 8) {
+        return;
+    }
+    Bytes reply = buildIcmpEcho(ECHOER, ipAddr(10, 0, 0, 2), 0,
+                                (icmp[4] << 8) | icmp[5], (icmp[6] << 8) | icmp[7],
+                                Bytes(icmp.begin() + 8, icmp.end()), 60);
+    fakeRawDeliver(reply.data(), reply.size(), ECHOER);
+    link.poll();
+
+    std::vector<Bytes> got = collect(link);
+    CHECK_EQ(got.size(), 1);
+    if (got.size() == 1) {
+        Parsed r = parsePacket(got[0]);
+        CHECK(r.ok);
+        CHECK_EQ(r.flags, 0);
+        CHECK_EQ(r.src, ECHOER);
+        CHECK_EQ(r.dst, CLIENT);
+        CHECK_EQ(r.srcPort, 0x4321);
+        CHECK(r.payload == bytesOf("far"));
+    }
+}
+
+static std::vector<Bytes> runSession(TestLink& link) {
+    hostReset();
+    fakeLwipReset();
+    fakeLinkReset();
+    transcript.clear();
+
+    NatContext* nat = new NatContext();
+    natInit(nat);
+    link.begin(nat);
+
+    pingGateway(link);
+    udpExchange(link);
+    tcpDownload(link);
+    pingRemote(link);
+
+    natShutdown(nat);
+    delete nat;
+
+    // Everything the session allocated went back
+    CHECK_EQ(fakePbufLive(), 0);
+    CHECK_EQ(fakeTcpLive(), 0);
+    CHECK_EQ(fakeUdpLive(), 0);
+
+    printf("%s: %zu packets to the client, %u bytes on the wire\n",
+           link.name(), transcript.size(), (unsigned)link.wireBytes());
+    return transcript;
+}
+
+int main() {
+    SlipTestLink slip;
+    PppTestLink ppp;
+
+    std::vector<Bytes> overSlip = runSession(slip);
+    std::vector<Bytes> overPpp = runSession(ppp);
+
+    CHECK(!overSlip.empty());
+    CHECK_EQ(overSlip.size(), overPpp.size());
+    for (size_t i = 0; i < overSlip.size() && i < overPpp.size(); i++) {
+        CHECK(overSlip[i] == overPpp[i]);
+    }
+
+    return testResult("nat_links");
+}
@@ -0,0 +1,182 @@
+// ============================================================================
+// NAT TCP Flow Control
+// ============================================================================
+// The client's side of a TCP flow is scripted segment by segment, so each
+// test can hold its window shut, lose an ACK or half-close when it likes.
+// ============================================================================
+
+#include "check.h"
+#include "fake_link.h"
+#include "fake_lwip.h"
+#include "host.h"
+#include "test_tcp.h"
+
+static const uint32_t SERVER = ipAddr(10, 0, 0, 80);
+
+static Bytes pattern(size_t length) {
+    Bytes data(length);
+    for (size_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(i * 7 + 3);
+    }
+    return data;
+}
+
+// The client shuts its window with data still queued, then opens it again
+// in an update that is lost. Only the NAT's probes can fetch the window
+static void zeroWindowLostUpdate(TestLink& link) {
+    TestTcpClient client(link, SERVER, 80, 1200);
+    struct tcp_pcb* pcb = client.connect(1072, 536);
+    CHECK(pcb != nullptr);
+    if (!pcb) {
+        return;
+    }
+
+    Bytes reply = pattern(3000);
+    CHECK(fakeTcpDeliver(pcb, reply.data(), reply.size()));
+    client.receive();
+    CHECK_EQ(client.data.size(), 1072);
+
+    // Everything ACKed, nothing more may be sent
+    client.ack(0);
+    unsigned long start = millis();
+    std::vector<unsigned long> probes;
+    while (probes.size() < 3 && millis() - start < 30000) {
+        hostAdvanceMs(100);
+        for (const Parsed& r : client.receive()) {
+            CHECK(r.payload.empty());
+            if (r.payload.empty() && r.seq == client.rcvNext - 1) {
+                probes.push_back(millis());
+            }
+        }
+    }
+    CHECK_EQ(client.data.size(), 1072);
+    CHECK_EQ(probes.size(), 3);
+    if (probes.size() == 3) {
+        unsigned long first = probes[1] - probes[0];
+        unsigned long second = probes[2] - probes[1];
+        CHECK(first >= NAT_TCP_RTO_MIN_MS);
+        CHECK(second >= 2 * first - 100);
+    }
+
+    // The answer to a probe carries the open window
+    client.ack(4096);
+    for (int i = 0; i < 20 && client.data.size() < reply.size(); i++) {
+        client.receive();
+        client.ack(4096);
+    }
+    CHECK(client.data == reply);
+}
+
+// An upload the server is slow to ACK is held in lwIP's send buffer, not
+// ours: the window we advertise closes as that fills and reopens as the
+// server takes it
+static void uploadWindowFollowsSendBuffer(TestLink& link) {
+    TestTcpClient client(link, SERVER, 80, 1201);
+    struct tcp_pcb* pcb = client.connect(4096, 536);
+    CHECK(pcb != nullptr);
+    if (!pcb) {
+        return;
+    }
+
+    Bytes upload = pattern(3 * TCP_SND_BUF);
+    size_t offered = 0;
+    uint32_t window = TCP_SND_BUF;
+    for (int i = 0; i < 40 && window >= 500 && offered < upload.size(); i++) {
+        client.send(Bytes(upload.begin() + offered, upload.begin() + offered + 500));
+        offered += 500;
+        for (const Parsed& r : client.receive()) {
+            CHECK_EQ(r.ack, client.seq);
+            window = r.window;
+        }
+    }
+    CHECK(window < 500);
+    CHECK(offered <= TCP_SND_BUF);
+    std::string written = fakeTcpTakeWritten(pcb);
+    CHECK_EQ(written.size(), offered);
+
+    // The server ACKed it all - the window reopens without the client asking
+    std::vector<Parsed> update = client.receive();
+    CHECK_EQ(update.size(), 1);
+    if (update.size() == 1) {
+        CHECK(update[0].window >= TCP_SND_BUF / 2);
+        CHECK_EQ(update[0].ack, client.seq);
+    }
+
+    while (offered < upload.size()) {
+        size_t chunk = min((size_t)500, upload.size() - offered);
+        client.send(Bytes(upload.begin() + offered, upload.begin() + offered + chunk));
+        offered += chunk;
+        client.receive();
+        written += fakeTcpTakeWritten(pcb);
+    }
+    CHECK(written == std::string(upload.begin(), upload.end()));
+}
+
+// The server closes first; the client still has something to say, which
+// must reach the server and be ACKed before the client closes in turn
+static void clientSendsAfterServerCloses(TestLink& link) {
+    TestTcpClient client(link, SERVER, 80, 1202);
+    struct tcp_pcb* pcb = client.connect(4096, 536);
+    CHECK(pcb != nullptr);
+    if (!pcb) {
+        return;
+    }
+
+    Bytes reply = bytesOf("bye");
+    CHECK(fakeTcpDeliver(pcb, reply.data(), reply.size()));
+    fakeTcpRemoteClose(pcb);
+    for (int i = 0; i < 4 && !client.finReceived; i++) {
+        client.receive();
+        client.ack(4096);
+    }
+    CHECK(client.data == reply);
+    CHECK(client.finReceived);
+
+    client.send(bytesOf("last words"));
+    std::vector<Parsed> acks = client.receive();
+    CHECK_EQ(acks.size(), 1);
+    if (acks.size() == 1) {
+        CHECK_EQ(acks[0].ack, client.seq);
+        CHECK(acks[0].window > 0);
+    }
+    CHECK(fakeTcpTakeWritten(pcb) == "last words");
+    CHECK(!fakeTcpShutdownSent(pcb));
+
+    client.send(Bytes(), TCP_FIN | TCP_ACK);
+    acks = client.receive();
+    CHECK_EQ(acks.size(), 1);
+    if (acks.size() == 1) {
+        CHECK_EQ(acks[0].ack, client.seq);
+    }
+    CHECK(fakeTcpShutdownSent(pcb));
+
+    // Nothing after the FIN is taken
+    client.send(bytesOf("late"));
+    client.receive();
+    CHECK(fakeTcpTakeWritten(pcb).empty());
+}
+
+static void run(TestLink& link, void (*test)(TestLink&)) {
+    hostReset();
+    fakeLwipReset();
+    fakeLinkReset();
+
+    NatContext* nat = new NatContext();
+    natInit(nat);
+    link.begin(nat);
+
+    test(link);
+
+    natShutdown(nat);
+    delete nat;
+    CHECK_EQ(fakePbufLive(), 0);
+    CHECK_EQ(fakeTcpLive(), 0);
+}
+
+int main() {
+    SlipTestLink slip;
+    run(slip, zeroWindowLostUpdate);
+    run(slip, uploadWindowFollowsSendBuffer);
+    run(slip, clientSendsAfterServerCloses);
+    return testResult("nat_tcp");
+}
@@ -0,0 +1,161 @@
+// ============================================================================
+// NAT UDP Sessions
+// ============================================================================
+// Replies wait in a queue between lwIP's callback and the poll loop, and a
+// full table recycles sessions meanwhile. A reply must reach the session it
+// was sent to or nobody - and a DNS answer the lookup it answers - and it
+// must fit the client's link.
+// ============================================================================
+
+#include <string.h>
+#include "check.h"
+#include "fake_link.h"
+#include "fake_lwip.h"
+#include "host.h"
+#include "dns_forward.h"
+#include "test_link.h"
+
+static const uint32_t CLIENT = ipAddr(192, 168, 7, 2);
+static const uint32_t ECHOER = ipAddr(10, 0, 0, 7);
+static const uint32_t GATEWAY = ipAddr(192, 168, 7, 1);
+static const uint32_t RESOLVER = ipAddr(8, 8, 8, 8);
+
+// A one-question query, or with answer set the bare response to it
+static Bytes dnsMessage(uint16_t id, const char* label, bool answer) {
+    Bytes msg = { (uint8_t)(id >> 8), (uint8_t)id, (uint8_t)(answer ? 0x81 : 0x01),
+                  (uint8_t)(answer ? 0x80 : 0x00), 0, 1, 0, 0, 0, 0, 0, 0 };
+    msg.push_back((uint8_t)strlen(label));
+    msg.insert(msg.end(), label, label + strlen(label));
+    Bytes tail = { 0, 0, 1, 0, 1 };     // Root, type A, class IN
+    msg.insert(msg.end(), tail.begin(), tail.end());
+    return msg;
+}
+
+static uint16_t dnsId(const Bytes& msg) {
+    return (uint16_t)(msg[0] << 8) | msg[1];
+}
+
+// Fill the table, queue a reply for the oldest session, then open one more:
+// it takes the oldest session's slot, and likely its freed pcb too
+static void recycledSlotDropsStaleReply(TestLink& link) {
+    std::vector<FakeDatagram> sent;
+    for (int i = 0; i < NAT_UDP_FLOWS_MIN; i++) {
+        link.send(buildUdp(CLIENT, 2000 + i, ECHOER, 7, bytesOf("hello")));
+        hostAdvanceMs(10);
+    }
+    sent = fakeUdpTakeSent();
+    CHECK_EQ(sent.size(), NAT_UDP_FLOWS_MIN);
+    if (sent.empty()) {
+        return;
+    }
+
+    Bytes stale = bytesOf("for port 2000");
+    fakeUdpDeliver(sent[0].pcb, stale.data(), stale.size(), ECHOER, 7);
+
+    link.send(buildUdp(CLIENT, 3000, ECHOER, 7, bytesOf("newcomer")));
+    std::vector<FakeDatagram> newcomer = fakeUdpTakeSent();
+    CHECK_EQ(newcomer.size(), 1);
+
+    link.poll();
+    for (const Bytes& p : link.take()) {
+        Parsed r = parsePacket(p);
+        CHECK(!(r.protocol == 17 && r.payload == stale));
+    }
+
+    // The new session's own replies still arrive
+    if (newcomer.size() == 1) {
+        Bytes reply = bytesOf("for port 3000");
+        fakeUdpDeliver(newcomer[0].pcb, reply.data(), reply.size(), ECHOER, 7);
+        link.poll();
+        std::vector<Bytes> got = link.take();
+        CHECK_EQ(got.size(), 1);
+        if (got.size() == 1) {
+            Parsed r = parsePacket(got[0]);
+            CHECK_EQ(r.dstPort, 3000);
+            CHECK(r.payload == reply);
+        }
+    }
+}
+
+// Each lookup goes upstream from its own random port, and an answer only
+// counts on the port its query left from
+static void dnsLookupsUseOwnPorts(TestLink& link) {
+    link.send(buildUdp(CLIENT, 4000, GATEWAY, 53, dnsMessage(0x1111, "one", false)));
+    link.send(buildUdp(CLIENT, 4001, GATEWAY, 53, dnsMessage(0x2222, "two", false)));
+    std::vector<FakeDatagram> up = fakeUdpTakeSent();
+    CHECK_EQ(up.size(), 2);
+    if (up.size() != 2) {
+        return;
+    }
+    CHECK(up[0].pcb != up[1].pcb);
+    CHECK(up[0].pcb->local_port >= DNS_PORT_RANDOM_MIN);
+    CHECK(up[1].pcb->local_port >= DNS_PORT_RANDOM_MIN);
+    CHECK(up[0].pcb->local_port != up[1].pcb->local_port);
+    CHECK_EQ(up[0].addr, RESOLVER);
+    int live = fakeUdpLive();
+
+    // The first lookup's answer, on the second lookup's port
+    Bytes answer = dnsMessage(dnsId(up[0].data), "one", true);
+    fakeUdpDeliver(up[1].pcb, answer.data(), answer.size(), RESOLVER, 53);
+    link.poll();
+    CHECK(link.take().empty());
+
+    fakeUdpDeliver(up[0].pcb, answer.data(), answer.size(), RESOLVER, 53);
+    link.poll();
+    std::vector<Bytes> got = link.take();
+    CHECK_EQ(got.size(), 1);
+    if (got.size() == 1) {
+        Parsed r = parsePacket(got[0]);
+        CHECK_EQ(r.srcPort, 53);
+        CHECK_EQ(r.dstPort, 4000);
+        CHECK(r.payload.size() >= 2 && dnsId(r.payload) == 0x1111);
+    }
+    CHECK_EQ(fakeUdpLive(), live - 1);     // Its socket is closed
+}
+
+// The client's link takes nothing larger than its MTU, and the reply can't
+// be fragmented on the way
+static void replyBeyondLinkMtuDropped(TestLink& link, NatContext* nat) {
+    natSetLinkMtu(nat, 576, 576);
+    link.send(buildUdp(CLIENT, 5000, ECHOER, 7, bytesOf("big?")));
+    std::vector<FakeDatagram> sent = fakeUdpTakeSent();
+    CHECK_EQ(sent.size(), 1);
+    if (sent.size() != 1) {
+        return;
+    }
+
+    Bytes large(576 - 28 + 1, 0x55);
+    Bytes fits(576 - 28, 0xAA);
+    fakeUdpDeliver(sent[0].pcb, large.data(), large.size(), ECHOER, 7);
+    fakeUdpDeliver(sent[0].pcb, fits.data(), fits.size(), ECHOER, 7);
+    link.poll();
+    std::vector<Bytes> got = link.take();
+    CHECK_EQ(got.size(), 1);
+    if (got.size() == 1) {
+        CHECK(parsePacket(got[0]).payload == fits);
+    }
+    natSetLinkMtu(nat, NAT_LINK_MTU_MAX, NAT_LINK_MTU_MAX);
+}
+
+int main() {
+    hostReset();
+    hostSetFreeHeap(60000);     // Smallest tables
+    fakeLwipReset();
+    fakeLinkReset();
+
+    NatContext* nat = new NatContext();
+    natInit(nat);
+    SlipTestLink link;
+    link.begin(nat);
+    CHECK_EQ(nat->udpFlows.size, NAT_UDP_FLOWS_MIN);
+
+    recycledSlotDropsStaleReply(link);
+    dnsLookupsUseOwnPorts(link);
+    replyBeyondLinkMtuDropped(link, nat);
+
+    natShutdown(nat);
+    delete nat;
+    CHECK_EQ(fakePbufLive(), 0);
+    CHECK_EQ(fakeUdpLive(), 0);
+    return testResult("nat_udp");
+}
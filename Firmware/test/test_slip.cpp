@@ -0,0 +1,218 @@
+// ============================================================================
+// SLIP Codec Tests
+// ============================================================================
+// Encoder and span decoder against each other: END and ESC anywhere in the
+// payload, frames that outgrow txBuffer and go out in several writes,
+// input split at every boundary, and the leading END on an idle line.
+// ============================================================================
+
+#include "check.h"
+#include "fake_link.h"
+#include "host.h"
+#include "packets.h"
+#include "slip.h"
+
+static SlipContext tx;
+static SlipContext rx;
+
+static void reset() {
+    hostReset();
+    fakeLinkReset();
+    slipInit(&tx);
+    slipInit(&rx);
+}
+
+static Bytes encode(const Bytes& payload) {
+    slipSendFrame(&tx, payload.data(), payload.size());
+    return fakeLinkTake();
+}
+
+// Decode a byte stream fed in pieces of chunk bytes (0 = all at once)
+static std::vector<Bytes> decode(const Bytes& wire, size_t chunk = 0) {
+    std::vector<Bytes> frames;
+    size_t pos = 0;
+    while (pos < wire.size()) {
+        size_t take = (chunk == 0) ? wire.size() - pos : std::min(chunk, wire.size() - pos);
+        uint16_t used = 0;
+        while (used < take) {
+            uint16_t consumed;
+            int frameLen = slipReceive(&rx, &wire[pos + used], take - used, &consumed);
+            used += consumed;
+            if (frameLen > 0) {
+                frames.push_back(Bytes(rx.rxBuffer, rx.rxBuffer + frameLen));
+            }
+        }
+        pos += take;
+    }
+    return frames;
+}
+
+// RFC 1055 decode of one frame with no buffer limit, for frames longer
+// than the receiver takes
+static Bytes refDecode(const Bytes& wire) {
+    Bytes out;
+    for (size_t i = 0; i < wire.size(); i++) {
+        if (wire[i] == SLIP_ESC && i + 1 < wire.size()) {
+            out.push_back(wire[++i] == SLIP_ESC_END ? SLIP_END : SLIP_ESC);
+        } else if (wire[i] != SLIP_END) {
+            out.push_back(wire[i]);
+        }
+    }
+    return out;
+}
+
+static size_t specials(const Bytes& payload) {
+    size_t n = 0;
+    for (uint8_t b : payload) {
+        n += (b == SLIP_END || b == SLIP_ESC);
+    }
+    return n;
+}
+
+static void checkRoundTrip(const Bytes& payload) {
+    reset();
+    Bytes wire = encode(payload);
+
+    // Leading END, escapes, trailing END - and no bare END inside
+    CHECK_EQ(wire.size(), payload.size() + specials(payload) + 2);
+    CHECK_EQ(wire.front(), SLIP_END);
+    CHECK_EQ(wire.back(), SLIP_END);
+    CHECK(std::find(wire.begin() + 1, wire.end() - 1, SLIP_END) == wire.end() - 1);
+
+    std::vector<Bytes> frames = decode(wire);
+    CHECK_EQ(frames.size(), 1);
+    CHECK(frames.size() == 1 && frames[0] == payload);
+    CHECK_EQ(rx.rxErrors, 0);
+}
+
+static void testSpecialBytes() {
+    checkRoundTrip(Bytes{ 0x45 });
+    checkRoundTrip(Bytes{ SLIP_END });
+    checkRoundTrip(Bytes{ SLIP_ESC });
+    checkRoundTrip(Bytes{ SLIP_ESC, SLIP_ESC_END });    // Not an escape in data
+    checkRoundTrip(Bytes{ SLIP_ESC_END, SLIP_ESC_ESC, SLIP_END, SLIP_ESC });
+    checkRoundTrip(Bytes(100, SLIP_END));
+    checkRoundTrip(Bytes(100, SLIP_ESC));
+
+    for (int round = 0; round < 200; round++) {
+        Bytes payload(random(1, SLIP_MTU + 1));
+        for (uint8_t& b : payload) {
+            // Heavy on the two special bytes
+            long r = random(0, 8);
+            b = (r == 0) ? SLIP_END : (r == 1) ? SLIP_ESC : (uint8_t)random(0, 256);
+        }
+        checkRoundTrip(payload);
+    }
+}
+
+static void testChunkedFlush() {
+    // All END doubles a full-size packet past SLIP_BUFFER_SIZE
+    reset();
+    Bytes payload(SLIP_MTU, SLIP_END);
+    Bytes wire = encode(payload);
+    CHECK(fakeLinkWrites() > 1);
+    CHECK_EQ(wire.size(), 2 * SLIP_MTU + 2);
+    std::vector<Bytes> frames = decode(wire);
+    CHECK(frames.size() == 1 && frames[0] == payload);
+
+    // An escape pair or the closing END landing on the buffer's last byte
+    for (uint16_t run = SLIP_BUFFER_SIZE - 4; run <= SLIP_BUFFER_SIZE + 1; run++) {
+        for (uint8_t special : { SLIP_END, SLIP_ESC }) {
+            reset();
+            Bytes p(run, 0x45);
+            p.push_back(special);
+            p.push_back(0x46);
+            wire = encode(p);
+            CHECK_EQ(wire.size(), p.size() + 3);
+            CHECK(refDecode(wire) == p);
+
+            reset();
+            p.assign(run, 0x45);
+            wire = encode(p);
+            CHECK_EQ(wire.size(), p.size() + 2);
+            CHECK(refDecode(wire) == p);
+        }
+    }
+}
+
+static void testSplitInput() {
+    reset();
+    std::vector<Bytes> sent;
+    Bytes wire;
+    for (int i = 0; i < 6; i++) {
+        Bytes p(random(1, 300));
+        for (uint8_t& b : p) {
+            b = (random(0, 4) == 0) ? SLIP_END : (random(0, 4) == 0) ? SLIP_ESC : 0x20 + i;
+        }
+        sent.push_back(p);
+        Bytes w = encode(p);
+        wire.insert(wire.end(), w.begin(), w.end());
+    }
+
+    // Every span size, so ESC pairs and ENDs fall across every cut
+    for (size_t chunk = 1; chunk <= 17; chunk++) {
+        slipInit(&rx);
+        CHECK(decode(wire, chunk) == sent);
+    }
+
+    // And the per-byte entry point
+    slipInit(&rx);
+    std::vector<Bytes> frames;
+    for (uint8_t b : wire) {
+        int frameLen = slipReceiveByte(&rx, b);
+        if (frameLen > 0) {
+            frames.push_back(Bytes(rx.rxBuffer, rx.rxBuffer + frameLen));
+        }
+    }
+    CHECK(frames == sent);
+    CHECK_EQ(rx.framesReceived, sent.size());
+    CHECK_EQ(rx.bytesReceived, wire.size());
+}
+
+static void testLeadingEnd() {
+    reset();
+    Bytes p{ 1, 2, 3 };
+    Bytes first = encode(p);
+    Bytes backToBack = encode(p);
+    hostAdvanceMs(SLIP_IDLE_END_MS);
+    Bytes afterIdle = encode(p);
+
+    CHECK_EQ(first.size(), 5);
+    CHECK_EQ(backToBack.size(), 4);         // The last frame's END opens it
+    CHECK_EQ(backToBack.front(), 1);
+    CHECK_EQ(afterIdle.size(), 5);
+    CHECK_EQ(afterIdle.front(), SLIP_END);
+
+    Bytes wire = first;
+    wire.insert(wire.end(), backToBack.begin(), backToBack.end());
+    wire.insert(wire.end(), afterIdle.begin(), afterIdle.end());
+    CHECK(decode(wire) == std::vector<Bytes>(3, p));
+}
+
+static void testBadInput() {
+    reset();
+    // Noise before the first END, empty frames, a bad escape, an overrun
+    Bytes wire{ 0x11, 0x22, SLIP_END, SLIP_END, SLIP_END, 0x01, SLIP_ESC, 0x33, 0x02, SLIP_END };
+    Bytes longFrame(SLIP_BUFFER_SIZE + 10, 0x55);
+    wire.insert(wire.end(), longFrame.begin(), longFrame.end());
+    wire.push_back(SLIP_END);
+    wire.insert(wire.end(), { 0x07, 0x08, SLIP_END });
+
+    std::vector<Bytes> frames = decode(wire);
+    CHECK_EQ(frames.size(), 2);
+    if (frames.size() == 2) {
+        CHECK(frames[0] == (Bytes{ 0x01, 0x33, 0x02 }));   // Kept, and counted
+        CHECK(frames[1] == (Bytes{ 0x07, 0x08 }));
+    }
+    CHECK_EQ(rx.rxErrors, 2);
+}
+
+int main() {
+    testSpecialBytes();
+    testChunkedFlush();
+    testSplitInput();
+    testLeadingEnd();
+    testBadInput();
+
+    return testResult("slip");
+}
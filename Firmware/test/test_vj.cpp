@@ -0,0 +1,265 @@
+// ============================================================================
+// VJ Header Compression Tests
+// ============================================================================
+// Replays a recorded trace of downstream TCP traffic through the compressor
+// and decompressor. Every packet must come back byte for byte; after a lost
+// frame the decompressor may toss, and may rebuild a bad packet the TCP
+// checksum rejects, but never a good-looking wrong one - until the next
+// UNCOMPRESSED_TCP resyncs the flow.
+// ============================================================================
+
+#include "check.h"
+#include "host.h"
+#include "packets.h"
+#include "vj_compress.h"
+
+#define A  0x10
+#define PA 0x18
+#define FA 0x11
+#define UA 0x30
+
+// One packet of the trace. seq and ack are relative to the flow's initial
+// numbers; payload bytes are a function of the sequence number.
+struct TraceRecord {
+    uint8_t flow;
+    uint8_t flags;
+    uint32_t seq;
+    uint32_t ack;
+    uint16_t window;
+    uint16_t length;
+    uint16_t ipId;
+    uint16_t urgent;
+};
+
+// Telnet echo (0), an FTP download across the sequence wrap with a
+// retransmission (1), a web page ending in FIN (2) and mail (3), interleaved
+static const TraceRecord trace[] = {
+    { 0, A,  1,     1,   8192, 0,    100, 0 },
+    { 0, PA, 1,     1,   8192, 12,   101, 0 },
+    { 0, PA, 13,    2,   8192, 1,    102, 0 },
+    { 0, PA, 14,    3,   8192, 1,    103, 0 },
+    { 0, PA, 15,    4,   8192, 1,    104, 0 },
+    { 1, A,  1,     1,   16384, 0,   500, 0 },
+    { 1, A,  1,     1,   16384, 1436, 501, 0 },
+    { 1, A,  1437,  1,   16384, 1436, 502, 0 },
+    { 0, PA, 16,    5,   8192, 1,    105, 0 },
+    { 1, PA, 2873,  1,   16384, 1436, 503, 0 },
+    { 1, A,  4309,  1,   16384, 1436, 504, 0 },
+    { 1, A,  5745,  1,   15000, 1436, 505, 0 },
+    { 1, A,  4309,  1,   15000, 1436, 506, 0 },
+    { 1, A,  7181,  1,   15000, 1436, 507, 0 },
+    { 0, PA, 17,    6,   8192, 1,    108, 0 },
+    { 2, A,  1,     120, 5840, 0,    900, 0 },
+    { 2, PA, 1,     120, 5840, 512,  901, 0 },
+    { 2, A,  513,   120, 5840, 1436, 902, 0 },
+    { 2, A,  1949,  120, 5840, 1436, 903, 0 },
+    { 2, PA, 3385,  120, 5840, 300,  904, 0 },
+    { 2, FA, 3685,  120, 5840, 0,    905, 0 },
+    { 1, A,  8617,  1,   16384, 1436, 508, 0 },
+    { 1, A,  10053, 1,   16384, 1436, 509, 0 },
+    { 0, PA, 18,    7,   8192, 3,    109, 0 },
+    { 0, A,  21,    7,   8192, 0,    110, 0 },
+    { 1, A,  11489, 1,   16384, 800,  510, 0 },
+    { 0, UA, 21,    8,   8192, 1,    111, 1 },
+    { 1, FA, 12289, 1,   16384, 0,    511, 0 },
+    { 0, PA, 22,    9,   8192, 20,   112, 0 },
+    { 3, PA, 1,     1,   4096, 40,   300, 0 },
+    { 0, PA, 42,    10,  8192, 1,    113, 0 },
+    { 3, PA, 41,    20,  4096, 60,   301, 0 },
+    { 0, PA, 43,    11,  8192, 1,    114, 0 },
+    { 3, PA, 101,   40,  4096, 8,    302, 0 },
+    { 0, PA, 44,    12,  8192, 1,    115, 0 },
+    { 3, A,  109,   40,  4096, 0,    303, 0 },
+    { 0, PA, 45,    13,  8192, 1,    116, 0 },
+};
+static const int TRACE_LEN = sizeof(trace) / sizeof(trace[0]);
+
+static const uint32_t CLIENT = ipAddr(192, 168, 7, 2);
+static const uint32_t SERVERS[] = {
+    ipAddr(10, 0, 0, 23), ipAddr(10, 0, 0, 21), ipAddr(10, 0, 0, 80), ipAddr(10, 0, 0, 25)
+};
+static const uint16_t SERVER_PORTS[] = { 23, 20, 80, 25 };
+static const uint32_t SEQ_BASE[] = { 0x12345678, 0xFFFFE000, 0x00000100, 0x7FFFFFF0 };
+static const uint32_t ACK_BASE[] = { 0x0BADF00D, 0x40000000, 0xFFFFFF80, 0x00000001 };
+
+static Bytes tracePacket(const TraceRecord& r) {
+    uint32_t seq = SEQ_BASE[r.flow] + r.seq;
+    Bytes payload(r.length);
+    for (size_t i = 0; i < payload.size(); i++) {
+        payload[i] = (uint8_t)((seq + i) * 13);
+    }
+    Bytes p = buildTcp(SERVERS[r.flow], SERVER_PORTS[r.flow], CLIENT, 1030 + r.flow,
+                       seq, ACK_BASE[r.flow] + r.ack, r.flags, r.window, payload,
+                       Bytes(), r.ipId);
+    if (r.urgent) {
+        // Urgent pointer in, TCP checksum fixed up by the 16-bit change
+        p[38] = r.urgent >> 8;
+        p[39] = r.urgent & 0xFF;
+        uint16_t sum = (p[36] << 8) | p[37];
+        uint32_t s = (uint16_t)~sum + (uint32_t)r.urgent;
+        s = (s & 0xFFFF) + (s >> 16);
+        sum = ~s & 0xFFFF;
+        p[36] = sum >> 8;
+        p[37] = sum & 0xFF;
+    }
+    return p;
+}
+
+// Compress for the link, then rebuild on the other side
+// Returns the vjUncompress result (the length as is for VJ_TYPE_IP)
+static int carry(VjContext* tx, VjContext* rx, const Bytes& packet, Bytes& rebuilt,
+                 uint8_t* typeOut = nullptr, bool lose = false) {
+    Bytes work = packet;
+    uint8_t* frame = work.data();
+    uint16_t length = work.size();
+    uint8_t type = vjCompress(tx, &frame, &length);
+    if (typeOut) {
+        *typeOut = type;
+    }
+    if (lose) {
+        return 0;
+    }
+    if (type == VJ_TYPE_IP) {
+        rebuilt.assign(frame, frame + length);
+        return length;
+    }
+    rebuilt.assign(1600, 0);
+    int n = vjUncompress(rx, type, frame, length, rebuilt.data(), rebuilt.size());
+    rebuilt.resize(n > 0 ? n : 0);
+    return n;
+}
+
+static void testReplay(uint8_t maxSlot, bool compressSlotId) {
+    VjContext tx, rx;
+    vjInit(&tx);
+    vjInit(&rx);
+    vjEnableTx(&tx, maxSlot, compressSlotId);
+    vjEnableRx(&rx, maxSlot);
+
+    int compressed = 0;
+    for (int i = 0; i < TRACE_LEN; i++) {
+        Bytes packet = tracePacket(trace[i]);
+        Bytes rebuilt;
+        uint8_t type;
+        int n = carry(&tx, &rx, packet, rebuilt, &type);
+        CHECK_EQ(n, packet.size());
+        CHECK(rebuilt == packet);
+        compressed += (type == VJ_TYPE_COMPRESSED_TCP);
+        // SYN/FIN never compress
+        if (trace[i].flags & 0x03) {
+            CHECK_EQ(type, VJ_TYPE_IP);
+        }
+    }
+
+    CHECK_EQ(tx.txCompressed, compressed);
+    CHECK_EQ(rx.rxCompressed, compressed);
+    CHECK_EQ(rx.rxErrors, 0);
+    CHECK_EQ(rx.rxTossed, 0);
+    if (maxSlot >= 3) {
+        // Four flows fit: only first packets, the retransmission and the
+        // urgent-pointer reset go uncompressed
+        CHECK(compressed >= TRACE_LEN - 12);
+    } else {
+        CHECK(tx.txMisses > 4);
+    }
+}
+
+static void testLoss() {
+    int discarded = 0;
+
+    // Lose each packet of the trace in turn
+    for (int lost = 0; lost < TRACE_LEN; lost++) {
+        VjContext tx, rx;
+        vjInit(&tx);
+        vjInit(&rx);
+        vjEnableTx(&tx, 15, true);
+        vjEnableRx(&rx, 15);
+
+        bool synced[4] = { true, true, true, true };
+        for (int i = 0; i < TRACE_LEN; i++) {
+            Bytes packet = tracePacket(trace[i]);
+            Bytes rebuilt;
+            uint8_t type;
+            int n = carry(&tx, &rx, packet, rebuilt, &type, i == lost);
+            if (i == lost) {
+                // The framer saw a bad frame and tells VJ
+                synced[trace[i].flow] = (type == VJ_TYPE_IP);
+                vjToss(&rx);
+                continue;
+            }
+            if (type == VJ_TYPE_UNCOMPRESSED_TCP) {
+                synced[trace[i].flow] = true;
+            }
+
+            if (n <= 0) {
+                // Tossed, or no reference to rebuild against
+                CHECK(!synced[trace[i].flow] || n == 0);
+                discarded++;
+                continue;
+            }
+            if (synced[trace[i].flow]) {
+                CHECK(rebuilt == packet);
+            } else if (rebuilt != packet) {
+                // A stale reference - the TCP checksum must catch it
+                CHECK(!parsePacket(rebuilt).ok);
+                discarded++;
+            }
+        }
+    }
+    CHECK(discarded > 0);
+}
+
+static void testBadInput() {
+    VjContext tx, rx;
+    vjInit(&tx);
+    vjInit(&rx);
+    vjEnableTx(&tx, 15, true);
+    vjEnableRx(&rx, 3);
+    uint8_t out[1600];
+
+    // Compressed before any UNCOMPRESSED_TCP: nothing to rebuild against
+    uint8_t early[] = { VJ_NEW_C | VJ_NEW_S, 0, 0x12, 0x34, 5 };
+    CHECK(vjUncompress(&rx, VJ_TYPE_COMPRESSED_TCP, early, sizeof(early), out, sizeof(out)) < 0);
+
+    // A slot id past what we offered
+    Bytes packet = tracePacket(trace[0]);
+    packet[9] = 7;
+    CHECK_EQ(vjUncompress(&rx, VJ_TYPE_UNCOMPRESSED_TCP, packet.data(), packet.size(),
+                          out, sizeof(out)), -1);
+
+    // Truncated compressed header: an error, then tossing until resync
+    packet = tracePacket(trace[1]);
+    packet[9] = 0;
+    CHECK(vjUncompress(&rx, VJ_TYPE_UNCOMPRESSED_TCP, packet.data(), packet.size(),
+                       out, sizeof(out)) > 0);
+    uint8_t truncated[] = { VJ_NEW_C | VJ_NEW_S, 0, 0x12 };
+    CHECK_EQ(vjUncompress(&rx, VJ_TYPE_COMPRESSED_TCP, truncated, sizeof(truncated),
+                          out, sizeof(out)), -1);
+    CHECK(rx.rxToss);
+    uint8_t implicit[] = { VJ_SPECIAL_I, 0x12, 0x34 };
+    CHECK_EQ(vjUncompress(&rx, VJ_TYPE_COMPRESSED_TCP, implicit, sizeof(implicit),
+                          out, sizeof(out)), 0);
+    CHECK_EQ(rx.rxTossed, 1);
+
+    // Not negotiated: every VJ packet is an error
+    VjContext off;
+    vjInit(&off);
+    CHECK_EQ(vjUncompress(&off, VJ_TYPE_UNCOMPRESSED_TCP, packet.data(), packet.size(),
+                          out, sizeof(out)), -1);
+    Bytes plain = tracePacket(trace[2]);
+    uint8_t* p = plain.data();
+    uint16_t len = plain.size();
+    CHECK_EQ(vjCompress(&off, &p, &len), VJ_TYPE_IP);
+}
+
+int main() {
+    hostReset();
+
+    testReplay(15, true);
+    testReplay(15, false);
+    testReplay(1, true);
+    testLoss();
+    testBadInput();
+
+    return testResult("vj");
+}